@@ -0,0 +1,52 @@
+//
+//  KHMockViewBinding.h
+//  KHBenchmark
+//
+//  Created by Calvin Huang on 2017/3/10.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "KHBindingCore.h"
+
+/**
+ *  不需要 UIKit 的 binding，行為跟 KHDataBinding 的 array observe 一樣，
+ *  只是不更新 view，改成計算 reloadData 與局部更新的次數
+ */
+
+@interface KHBenchPair : NSObject <KHBindingPair>
+
+@property (nonatomic,assign) id model;
+
+@end
+
+
+@interface KHMockViewBinding : NSObject <KHArrayObserveDelegate>
+
+@property (nonatomic,readonly) KHBindingCore *core;
+@property (nonatomic) BOOL isNeedAnimation;
+
+//  同 KHBindingCore.compactPairs，要在 bindArray: 之前設定
+@property (nonatomic) BOOL compactPairs;
+
+@property (nonatomic,readonly) NSUInteger reloadCount;
+@property (nonatomic,readonly) NSUInteger batchUpdateCount;
+//  局部更新影響的 row 數
+@property (nonatomic,readonly) NSUInteger updatedRowCount;
+
+//  每個 section 前幾個 row 當作在畫面上，預設 NSUIntegerMax，全部都在畫面上
+@property (nonatomic) NSUInteger visibleRowCount;
+//  跟 KHDataBinding 一樣，update / replace 在畫面上的 row 直接更新，不在的只標記 stale
+@property (nonatomic,readonly) NSUInteger appliedUpdateCount;
+@property (nonatomic,readonly) NSUInteger deferredUpdateCount;
+
+- (void)bindArray:(NSMutableArray*)array;
+- (void)deBindArray:(NSMutableArray*)array;
+- (void)deBindAll;
+
+//  模擬 view 顯示過一次，之後的變動才會走局部更新
+- (void)reloadData;
+
+- (void)resetCounters;
+
+@end
@@ -0,0 +1,199 @@
+//
+//  KHMockViewBinding.m
+//  KHBenchmark
+//
+//  Created by Calvin Huang on 2017/3/10.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import "KHMockViewBinding.h"
+
+@implementation KHBenchPair
+{
+    KHPairStore *_pairStore;
+    NSUInteger _slot;
+}
+
+@synthesize model = _model;
+
+- (id)model
+{
+    return _pairStore ? [_pairStore modelAtSlot:_slot] : _model;
+}
+
+- (void)setModel:(id)model
+{
+    if ( _pairStore && model ) {
+        [_pairStore moveSlot:_slot toModel:model];
+        return;
+    }
+    _model = model;
+}
+
+- (void)attachPairStore:(KHPairStore*)store slot:(NSUInteger)slot moveState:(BOOL)moveState
+{
+    _pairStore = store;
+    _slot = slot;
+    _model = nil;
+}
+
+- (void)detachPairStore
+{
+    _model = [_pairStore modelAtSlot:_slot];
+    _pairStore = nil;
+}
+
+@end
+
+
+@implementation KHMockViewBinding
+{
+    //  跟 KHTableDataBinding 一樣，view 第一次載入 cell 之後才做局部更新
+    BOOL _firstReload;
+}
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self) {
+        _isNeedAnimation = YES;
+        _visibleRowCount = NSUIntegerMax;
+        _core = [[KHBindingCore alloc] init];
+        _core.pairFactory = ^id<KHBindingPair>{
+            return [[KHBenchPair alloc] init];
+        };
+    }
+    return self;
+}
+
+- (void)setCompactPairs:(BOOL)compactPairs
+{
+    _core.compactPairs = compactPairs;
+}
+
+- (BOOL)compactPairs
+{
+    return _core.compactPairs;
+}
+
+- (void)bindArray:(NSMutableArray*)array
+{
+    if ( ![_core addSection:array delegate:self] ) {
+        return;
+    }
+    for ( id object in array ) {
+        [_core registerPair:object];
+    }
+    if ( array.count > 0 ) {
+        [self reloadData];
+    }
+}
+
+- (void)deBindArray:(NSMutableArray*)array
+{
+    if ( [_core removeSection:array] ) {
+        for ( id object in array ) {
+            [_core removePair:object];
+        }
+    }
+}
+
+- (void)deBindAll
+{
+    for ( NSMutableArray *array in [_core.sectionArray copy] ) {
+        [self deBindArray:array];
+    }
+}
+
+- (void)reloadData
+{
+    _reloadCount++;
+    _firstReload = YES;
+}
+
+- (void)resetCounters
+{
+    _reloadCount = 0;
+    _batchUpdateCount = 0;
+    _updatedRowCount = 0;
+    _appliedUpdateCount = 0;
+    _deferredUpdateCount = 0;
+}
+
+- (void)viewUpdateRows:(NSUInteger)rowCount
+{
+    if ( _firstReload && _isNeedAnimation ) {
+        _batchUpdateCount++;
+        _updatedRowCount += rowCount;
+    }
+    else{
+        [self reloadData];
+    }
+}
+
+- (void)viewRouteUpdateAtIndex:(NSIndexPath*)index
+{
+    if ( !_firstReload ) {
+        [self reloadData];
+    }
+    else if ( index.row < _visibleRowCount ) {
+        _appliedUpdateCount++;
+    }
+    else {
+        _deferredUpdateCount++;
+    }
+}
+
+#pragma mark - Array Observe
+
+-(void)arrayInsert:(NSMutableArray*)array insertObject:(id)object index:(NSIndexPath*)index
+{
+    [_core registerPair:object];
+    [self viewUpdateRows:1];
+}
+
+-(void)arrayInsertSome:(NSMutableArray *)array insertObjects:(NSArray *)objects indexes:(NSArray *)indexes
+{
+    for ( id model in objects ) {
+        [_core registerPair:model];
+    }
+    [self viewUpdateRows:indexes.count];
+}
+
+-(void)arrayRemove:(NSMutableArray*)array removeObject:(id)object index:(NSIndexPath*)index
+{
+    [_core removePair:object];
+    [self viewUpdateRows:1];
+}
+
+-(void)arrayRemoveSome:(NSMutableArray *)array removeObjects:(NSArray *)objects indexs:(NSArray *)indexs
+{
+    for ( id model in objects ) {
+        [_core removePair:model];
+    }
+    [self viewUpdateRows:indexs.count];
+}
+
+-(void)arrayReplace:(NSMutableArray*)array newObject:(id)newObj replacedObject:(id)oldObj index:(NSIndexPath*)index
+{
+    [_core replacePair:oldObj new:newObj];
+    [self viewRouteUpdateAtIndex:index];
+}
+
+-(void)arrayUpdate:(NSMutableArray *)array update:(id)object index:(NSIndexPath *)index
+{
+    [self viewRouteUpdateAtIndex:index];
+}
+
+-(void)arrayUpdateAll:(NSMutableArray *)array
+{
+    if ( !_firstReload ) {
+        [self reloadData];
+        return;
+    }
+    NSUInteger visible = MIN( _visibleRowCount, array.count );
+    _appliedUpdateCount += visible;
+    _deferredUpdateCount += array.count - visible;
+}
+
+@end
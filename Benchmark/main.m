@@ -0,0 +1,774 @@
+//
+//  main.m
+//  KHBenchmark
+//
+//  Created by Calvin Huang on 2017/3/10.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+//  Headless benchmark of the UIKit independent binding core.
+//
+//  khbench [--sizes 1000,10000,100000,1000000] [--iterations 5] [--output result.json]
+//  khbench --replay trace.khmt [--output result.json]
+//
+
+#import <Foundation/Foundation.h>
+#include <time.h>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+#import "KHBindingCore.h"
+#import "KHMockViewBinding.h"
+#import "KVCModel.h"
+#import "KHMutationTrace.h"
+#import "NSMutableArray+KHSwizzle.h"
+
+@interface KHBenchUser : KVCModel
+
+@property (nonatomic) NSString *name;
+@property (nonatomic) NSString *email;
+@property (nonatomic) NSInteger age;
+@property (nonatomic) double score;
+@property (nonatomic) NSArray *tags;
+
+@end
+
+@implementation KHBenchUser
+
+@end
+
+//  feed 資料，一筆有作者、五則留言，畫面只顯示 title、author.name、likeCount
+//  eager 與 lazy 的 class 宣告一樣的 property，只差在 decodesLazily
+#define KH_BENCH_AUTHOR_PROPERTIES \
+@property (nonatomic) NSString *name; \
+@property (nonatomic) NSString *avatar; \
+@property (nonatomic) NSString *bio; \
+@property (nonatomic) NSInteger followers;
+
+#define KH_BENCH_COMMENT_PROPERTIES( authorClass ) \
+@property (nonatomic) NSString *text; \
+@property (nonatomic) NSInteger likes; \
+@property (nonatomic) authorClass *author;
+
+#define KH_BENCH_FEED_PROPERTIES( authorClass, commentClass ) \
+@property (nonatomic) NSString *title; \
+@property (nonatomic) NSString *body; \
+@property (nonatomic) NSString *url; \
+@property (nonatomic) NSString *createdAt; \
+@property (nonatomic) NSInteger likeCount; \
+@property (nonatomic) NSInteger shareCount; \
+@property (nonatomic) double score; \
+@property (nonatomic) NSArray *tags; \
+@property (nonatomic) authorClass *author; \
+@property (nonatomic) NSArray *comments; \
+@property (nonatomic) commentClass *classof_comments;
+
+@interface KHBenchAuthor : KVCModel
+KH_BENCH_AUTHOR_PROPERTIES
+@end
+
+@implementation KHBenchAuthor
+@end
+
+@interface KHBenchComment : KVCModel
+KH_BENCH_COMMENT_PROPERTIES( KHBenchAuthor )
+@end
+
+@implementation KHBenchComment
+@end
+
+@interface KHBenchFeedItem : KVCModel
+KH_BENCH_FEED_PROPERTIES( KHBenchAuthor, KHBenchComment )
+@end
+
+@implementation KHBenchFeedItem
+@end
+
+@interface KHBenchLazyAuthor : KVCModel
+KH_BENCH_AUTHOR_PROPERTIES
+@end
+
+@implementation KHBenchLazyAuthor
++ (BOOL)decodesLazily { return YES; }
+@end
+
+@interface KHBenchLazyComment : KVCModel
+KH_BENCH_COMMENT_PROPERTIES( KHBenchLazyAuthor )
+@end
+
+@implementation KHBenchLazyComment
++ (BOOL)decodesLazily { return YES; }
+@end
+
+@interface KHBenchLazyFeedItem : KVCModel
+KH_BENCH_FEED_PROPERTIES( KHBenchLazyAuthor, KHBenchLazyComment )
+@end
+
+@implementation KHBenchLazyFeedItem
++ (BOOL)decodesLazily { return YES; }
+@end
+
+//  畫面用的 view model，從 feed 複製過來，author 與 comments 改成畫面自己的 class
+@interface KHBenchRowAuthor : KVCModel
+@property (nonatomic) NSString *name;
+@property (nonatomic) NSString *avatar;
+@property (nonatomic) NSInteger followers;
+@end
+
+@implementation KHBenchRowAuthor
+@end
+
+@interface KHBenchRowComment : KVCModel
+@property (nonatomic) NSString *text;
+@property (nonatomic) NSInteger likes;
+@property (nonatomic) KHBenchRowAuthor *author;
+@end
+
+@implementation KHBenchRowComment
+@end
+
+@interface KHBenchFeedRow : KVCModel
+@property (nonatomic) NSString *title;
+@property (nonatomic) NSString *url;
+@property (nonatomic) NSInteger likeCount;
+@property (nonatomic) double score;
+@property (nonatomic) NSArray *tags;
+@property (nonatomic) KHBenchRowAuthor *author;
+@property (nonatomic) NSArray *comments;
+@property (nonatomic) KHBenchRowComment *classof_comments;
+@end
+
+@implementation KHBenchFeedRow
+@end
+
+@interface KHBenchBanner : NSObject
+
+@end
+
+@implementation KHBenchBanner
+
+@end
+
+
+static double khNow(void)
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+//  目前 malloc 出去的 bytes，只有 glibc 2.33 以上有 mallinfo2，其他平台回傳 0
+static size_t khHeapInUse(void)
+{
+#if defined(__GLIBC__) && ( __GLIBC__ > 2 || ( __GLIBC__ == 2 && __GLIBC_MINOR__ >= 33 ) )
+    return mallinfo2().uordblks;
+#else
+    return 0;
+#endif
+}
+
+//  固定的 seed，每次跑的資料都一樣
+static uint32_t khRandomState = 1;
+static uint32_t khRandom(void)
+{
+    khRandomState = khRandomState * 1664525 + 1013904223;
+    return khRandomState;
+}
+
+static NSArray *khMakeUsers(NSUInteger count)
+{
+    NSMutableArray *users = [[NSMutableArray alloc] initWithCapacity: count ];
+    for ( NSUInteger i=0; i<count; i++ ) {
+        KHBenchUser *user = [[KHBenchUser alloc] init];
+        user.name = [NSString stringWithFormat:@"user%lu", (unsigned long)i];
+        user.age = khRandom() % 80;
+        [users addObject:user];
+    }
+    return users;
+}
+
+static NSArray *khMakeUserDictionarys(NSUInteger count)
+{
+    NSMutableArray *dicts = [[NSMutableArray alloc] initWithCapacity: count ];
+    for ( NSUInteger i=0; i<count; i++ ) {
+        [dicts addObject:@{ @"name":[NSString stringWithFormat:@"user%lu", (unsigned long)i],
+                            @"email":[NSString stringWithFormat:@"user%lu@example.com", (unsigned long)i],
+                            @"age":@( khRandom() % 80 ),
+                            @"score":@( (khRandom() % 10000) / 100.0 ),
+                            @"tags":@[ @"a", @"b" ] }];
+    }
+    return dicts;
+}
+
+static NSDictionary *khMakeAuthorDictionary(NSUInteger i)
+{
+    return @{ @"name":[NSString stringWithFormat:@"author%lu", (unsigned long)i],
+              @"avatar":[NSString stringWithFormat:@"https://example.com/avatar/%lu.png", (unsigned long)i],
+              @"bio":@"Writes about lists, caches and frame budgets.",
+              @"followers":@( khRandom() % 100000 ) };
+}
+
+static NSArray *khMakeFeedDictionarys(NSUInteger count)
+{
+    NSMutableArray *dicts = [[NSMutableArray alloc] initWithCapacity: count ];
+    for ( NSUInteger i=0; i<count; i++ ) {
+        NSMutableArray *comments = [[NSMutableArray alloc] initWithCapacity: 5 ];
+        for ( NSUInteger c=0; c<5; c++ ) {
+            [comments addObject:@{ @"text":[NSString stringWithFormat:@"comment %lu on post %lu", (unsigned long)c, (unsigned long)i],
+                                   @"likes":@( khRandom() % 500 ),
+                                   @"author":khMakeAuthorDictionary( khRandom() % 1000 ) }];
+        }
+        [dicts addObject:@{ @"title":[NSString stringWithFormat:@"post %lu", (unsigned long)i],
+                            @"body":@"A longer body that only the detail screen shows, repeated to look like real content.",
+                            @"url":[NSString stringWithFormat:@"https://example.com/posts/%lu", (unsigned long)i],
+                            @"createdAt":@"2017-03-12T10:00:00Z",
+                            @"likeCount":@( khRandom() % 10000 ),
+                            @"shareCount":@( khRandom() % 1000 ),
+                            @"score":@( (khRandom() % 10000) / 100.0 ),
+                            @"tags":@[ @"swift", @"objc", @"ios" ],
+                            @"author":khMakeAuthorDictionary( i ),
+                            @"comments":comments }];
+    }
+    return dicts;
+}
+
+//  模擬一段使用過程的 trace：下拉重整、分頁載入、取代風暴、更新、最上面插入新的貼文
+static NSData *khMakeMutationTrace(NSUInteger rows)
+{
+    KHMutationRecorder *recorder = [[KHMutationRecorder alloc] init];
+    NSMutableArray *array = [[NSMutableArray alloc] init];
+    [recorder recordArray:array];
+    for ( NSUInteger refresh=0; refresh<3; refresh++ ) {
+        [array removeAllObjects];
+        for ( NSUInteger page=0; page<MAX( rows / 50, 1 ); page++ ) {
+            NSMutableArray *objects = [[NSMutableArray alloc] initWithCapacity: 50 ];
+            for ( NSUInteger i=0; i<50; i++ ) {
+                [objects addObject:[[NSObject alloc] init]];
+            }
+            [array addObjectsFromArray:objects];
+        }
+        for ( NSUInteger i=0; i<rows / 10; i++ ) {
+            [array replaceObjectAtIndex:khRandom() % array.count withObject:[[NSObject alloc] init]];
+        }
+        for ( NSUInteger i=0; i<rows / 20; i++ ) {
+            [array update:array[khRandom() % array.count]];
+        }
+        for ( NSUInteger i=0; i<rows / 50; i++ ) {
+            [array insertObject:[[NSObject alloc] init] atIndex:0];
+            [array removeObjectAtIndex:khRandom() % array.count];
+        }
+    }
+    [recorder stopRecordingArray:array];
+    return [recorder traceData];
+}
+
+//  每個 section 的位置正確，每個 model 都有 pair，pair 的數量跟綁定的 model 一樣
+static NSString *khVerifyMockBinding(KHMockViewBinding *binding, NSArray<NSMutableArray*> *sections)
+{
+    KHBindingCore *core = binding.core;
+    NSHashTable *models = [[NSHashTable alloc] initWithOptions:NSPointerFunctionsObjectPointerPersonality capacity:0];
+    for ( NSUInteger s=0; s<sections.count; s++ ) {
+        NSMutableArray *array = sections[s];
+        if ( [core sectionOfArray:array] != s ) {
+            return [NSString stringWithFormat:@"section %lu is bound at %ld", (unsigned long)s, (long)[core sectionOfArray:array]];
+        }
+        for ( NSUInteger i=0; i<array.count; i++ ) {
+            if ( [core pairOfModel:array[i]] == nil ) {
+                return [NSString stringWithFormat:@"row %lu of section %lu has no pair", (unsigned long)i, (unsigned long)s];
+            }
+            [models addObject:array[i]];
+        }
+        //  indexPathOfModel: 是線性搜尋，只檢查頭尾
+        if ( array.count > 0 ) {
+            NSIndexPath *first = [core indexPathOfModel:array.firstObject];
+            NSUInteger lastRow = [array indexOfObjectIdenticalTo:array.lastObject];
+            NSIndexPath *last = [core indexPathOfModel:array.lastObject];
+            if ( first.section != s || first.row != 0 || last.section != s || last.row != lastRow ) {
+                return [NSString stringWithFormat:@"index of section %lu doesn't match the array", (unsigned long)s];
+            }
+        }
+    }
+    if ( [core pairCount] != models.count ) {
+        return [NSString stringWithFormat:@"%lu pairs for %lu bound models", (unsigned long)[core pairCount], (unsigned long)models.count];
+    }
+    return nil;
+}
+
+//  trace 套用到 mock view，回傳 replay 的報表加上 reload 與局部更新的次數
+static NSDictionary *khReplayOnMockView(KHMutationReplayer *replayer, BOOL verify)
+{
+    KHMockViewBinding *binding = [[KHMockViewBinding alloc] init];
+    KHMutationReplayResult *result = [replayer replayWithBind:^(NSMutableArray *array) {
+        [binding bindArray:array];
+    } deBind:^(NSMutableArray *array) {
+        [binding deBindArray:array];
+    } verify:verify ? ^NSString*(NSArray<NSMutableArray*> *sections) {
+        return khVerifyMockBinding( binding, sections );
+    } : nil];
+    [binding deBindAll];
+    NSMutableDictionary *report = [[result report] mutableCopy];
+    report[@"reloadCount"] = @(binding.reloadCount);
+    report[@"batchUpdateCount"] = @(binding.batchUpdateCount);
+    report[@"updatedRowCount"] = @(binding.updatedRowCount);
+    report[@"appliedUpdateCount"] = @(binding.appliedUpdateCount);
+    report[@"deferredUpdateCount"] = @(binding.deferredUpdateCount);
+    return report;
+}
+
+
+@interface KHBenchmark : NSObject
+
+@property (nonatomic) NSUInteger iterations;
+@property (nonatomic,readonly) NSMutableArray *results;
+
+- (void)runSize:(NSUInteger)size;
+
+@end
+
+@implementation KHBenchmark
+{
+    //  array 的 kh_delegate 會 retain binding，每輪結束要解綁定，不然會一直累積
+    NSMutableArray *_liveBindings;
+}
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self) {
+        _iterations = 5;
+        _results = [[NSMutableArray alloc] init];
+        _liveBindings = [[NSMutableArray alloc] init];
+    }
+    return self;
+}
+
+- (KHMockViewBinding*)newBinding
+{
+    KHMockViewBinding *binding = [[KHMockViewBinding alloc] init];
+    [_liveBindings addObject:binding];
+    return binding;
+}
+
+//  setup 不計時，body 回傳額外要輸出的資料
+- (void)scenario:(NSString*)name size:(NSUInteger)size setup:(id(^)(void))setup body:(NSDictionary*(^)(id context))body
+{
+    NSMutableArray *samples = [[NSMutableArray alloc] initWithCapacity: _iterations ];
+    NSDictionary *extra = nil;
+    for ( NSUInteger i=0; i<_iterations; i++ ) {
+        @autoreleasepool {
+            khRandomState = 1;
+            id context = setup ? setup() : nil;
+            double start = khNow();
+            extra = body( context );
+            [samples addObject:@( (khNow() - start) * 1000 )];
+            for ( KHMockViewBinding *binding in _liveBindings ) {
+                [binding deBindAll];
+            }
+            [_liveBindings removeAllObjects];
+        }
+    }
+    [samples sortUsingSelector:@selector(compare:)];
+
+    NSMutableDictionary *result = [@{ @"scenario":name,
+                                      @"models":@(size),
+                                      @"iterations":@(_iterations),
+                                      @"median_ms":samples[samples.count / 2],
+                                      @"min_ms":samples.firstObject,
+                                      @"max_ms":samples.lastObject } mutableCopy];
+    if ( extra ) {
+        [result addEntriesFromDictionary:extra];
+    }
+    [_results addObject:result];
+    fprintf( stderr, "%-24s %8lu  median %10.3f ms\n", [name UTF8String], (unsigned long)size, [samples[samples.count / 2] doubleValue] );
+}
+
+- (NSDictionary*)countersOf:(KHMockViewBinding*)binding
+{
+    return @{ @"reloads":@(binding.reloadCount),
+              @"batch_updates":@(binding.batchUpdateCount),
+              @"updated_rows":@(binding.updatedRowCount),
+              @"applied_updates":@(binding.appliedUpdateCount),
+              @"deferred_updates":@(binding.deferredUpdateCount) };
+}
+
+- (void)runSize:(NSUInteger)size
+{
+    //  bind 一個已經有資料的 array，建立所有 pair
+    [self scenario:@"bind_existing" size:size setup:^id{
+        return [[NSMutableArray alloc] initWithArray:khMakeUsers(size)];
+    } body:^NSDictionary*(NSMutableArray *array) {
+        KHMockViewBinding *binding = [self newBinding];
+        [binding bindArray:array];
+        return [self countersOf:binding];
+    }];
+
+    [self scenario:@"bind_existing_compact" size:size setup:^id{
+        return [[NSMutableArray alloc] initWithArray:khMakeUsers(size)];
+    } body:^NSDictionary*(NSMutableArray *array) {
+        KHMockViewBinding *binding = [self newBinding];
+        binding.compactPairs = YES;
+        [binding bindArray:array];
+        return [self countersOf:binding];
+    }];
+
+    //  每個 model 的 pair 佔用多少 memory，同一批 model 分別用 dictionary 與 compact store 綁定
+    [self scenario:@"pair_memory" size:size setup:^id{
+        NSArray *users = khMakeUsers(size);
+        return @[ [[NSMutableArray alloc] initWithArray:users], [[NSMutableArray alloc] initWithArray:users] ];
+    } body:^NSDictionary*(NSArray *arrays) {
+        size_t heapStart = khHeapInUse();
+        @autoreleasepool {
+            [[self newBinding] bindArray:arrays[0]];
+        }
+        size_t heapDictionary = khHeapInUse();
+        KHMockViewBinding *compact = [self newBinding];
+        @autoreleasepool {
+            compact.compactPairs = YES;
+            [compact bindArray:arrays[1]];
+        }
+        size_t heapCompact = khHeapInUse();
+        double models = MAX( size, 1 );
+        return @{ @"dictionary_bytes_per_model":@( heapStart ? ( (double)heapDictionary - heapStart ) / models : 0 ),
+                  @"compact_bytes_per_model":@( heapStart ? ( (double)heapCompact - heapDictionary ) / models : 0 ),
+                  @"compact_store_bytes_per_model":@( compact.core.pairStore.bytesUsed / models ) };
+    }];
+
+    //  已顯示的 list，一次加入全部
+    [self scenario:@"add_objects_batch" size:size setup:^id{
+        return khMakeUsers(size);
+    } body:^NSDictionary*(NSArray *users) {
+        KHMockViewBinding *binding = [self newBinding];
+        NSMutableArray *array = [[NSMutableArray alloc] init];
+        [binding bindArray:array];
+        [binding reloadData];
+        [array addObjectsFromArray:users];
+        return [self countersOf:binding];
+    }];
+
+    //  分頁載入，每次 50 筆
+    [self scenario:@"add_objects_paged" size:size setup:^id{
+        return khMakeUsers(size);
+    } body:^NSDictionary*(NSArray *users) {
+        KHMockViewBinding *binding = [self newBinding];
+        NSMutableArray *array = [[NSMutableArray alloc] init];
+        [binding bindArray:array];
+        [binding reloadData];
+        for ( NSUInteger i=0; i<users.count; i+=50 ) {
+            [array addObjectsFromArray:[users subarrayWithRange:NSMakeRange(i, MIN(50, users.count - i))]];
+        }
+        return [self countersOf:binding];
+    }];
+
+    //  從頭部一筆一筆插入，最多 10k 次，不然 1M 會跑太久
+    NSUInteger insertCount = MIN( size, 10000 );
+    [self scenario:@"insert_head_single" size:insertCount setup:^id{
+        return khMakeUsers(insertCount);
+    } body:^NSDictionary*(NSArray *users) {
+        KHMockViewBinding *binding = [self newBinding];
+        NSMutableArray *array = [[NSMutableArray alloc] init];
+        [binding bindArray:array];
+        [binding reloadData];
+        for ( id user in users ) {
+            [array insertObject:user atIndex:0];
+        }
+        return [self countersOf:binding];
+    }];
+
+    //  刪掉一半，再全部清掉
+    [self scenario:@"remove" size:size setup:^id{
+        KHMockViewBinding *binding = [self newBinding];
+        NSMutableArray *array = [[NSMutableArray alloc] initWithArray:khMakeUsers(size)];
+        [binding bindArray:array];
+        [binding resetCounters];
+        return @[ binding, array ];
+    } body:^NSDictionary*(NSArray *context) {
+        KHMockViewBinding *binding = context[0];
+        NSMutableArray *array = context[1];
+        NSUInteger removeCount = MIN( array.count / 2, 10000 );
+        for ( NSUInteger i=0; i<removeCount; i++ ) {
+            [array removeObjectAtIndex:array.count - 1];
+        }
+        [array removeAllObjects];
+        return [self countersOf:binding];
+    }];
+
+    //  隨機 replace，再 update 其中一些，畫面上有 20 個 row
+    [self scenario:@"replace_update" size:size setup:^id{
+        KHMockViewBinding *binding = [self newBinding];
+        binding.visibleRowCount = 20;
+        NSMutableArray *array = [[NSMutableArray alloc] initWithArray:khMakeUsers(size)];
+        [binding bindArray:array];
+        [binding resetCounters];
+        return @[ binding, array, khMakeUsers(MIN(size, 10000)) ];
+    } body:^NSDictionary*(NSArray *context) {
+        KHMockViewBinding *binding = context[0];
+        NSMutableArray *array = context[1];
+        NSArray *newUsers = context[2];
+        for ( NSUInteger i=0; i<newUsers.count; i++ ) {
+            NSUInteger index = khRandom() % array.count;
+            [array replaceObjectAtIndex:index withObject:newUsers[i]];
+        }
+        //  update: 是線性搜尋，只做 100 次
+        for ( NSUInteger i=0; i<MIN(newUsers.count, 100); i++ ) {
+            [array update:newUsers[i]];
+        }
+        return [self countersOf:binding];
+    }];
+
+    //  updateAll 只更新畫面上的 row，其他的延後
+    [self scenario:@"update_all_visible" size:size setup:^id{
+        KHMockViewBinding *binding = [self newBinding];
+        binding.visibleRowCount = 20;
+        NSMutableArray *array = [[NSMutableArray alloc] initWithArray:khMakeUsers(size)];
+        [binding bindArray:array];
+        [binding resetCounters];
+        return @[ binding, array ];
+    } body:^NSDictionary*(NSArray *context) {
+        KHMockViewBinding *binding = context[0];
+        NSMutableArray *array = context[1];
+        for ( NSUInteger i=0; i<10; i++ ) {
+            [array updateAll];
+        }
+        return [self countersOf:binding];
+    }];
+
+    //  model -> cell name，一半用字串 mapping，一半用 block
+    [self scenario:@"mapping_resolve" size:size setup:^id{
+        KHBindingCore *core = [[KHBindingCore alloc] init];
+        [core setMappingModelName:@"KHBenchUser" cellName:@"UserInfoCell"];
+        [core setMappingModelName:@"KHBenchBanner" block:^Class(id model, NSIndexPath *index) {
+            return index.row % 2 ? [NSObject class] : [NSString class];
+        }];
+        NSMutableArray *models = [[NSMutableArray alloc] initWithArray:khMakeUsers(MIN(size, 1000))];
+        for ( NSUInteger i=0; i<models.count; i+=2 ) {
+            models[i] = [[KHBenchBanner alloc] init];
+        }
+        return @[ core, models ];
+    } body:^NSDictionary*(NSArray *context) {
+        KHBindingCore *core = context[0];
+        NSArray *models = context[1];
+        NSUInteger hash = 0;
+        for ( NSUInteger i=0; i<size; i++ ) {
+            NSIndexPath *index = [NSIndexPath indexPathForRow:i inSection:0];
+            hash += [[core cellNameForModel:models[i % models.count] index:index] length];
+        }
+        return @{ @"checksum":@(hash) };
+    }];
+
+    //  model -> index，線性搜尋，取 1000 個樣本
+    [self scenario:@"index_of_model" size:size setup:^id{
+        KHMockViewBinding *binding = [self newBinding];
+        NSMutableArray *array = [[NSMutableArray alloc] initWithArray:khMakeUsers(size)];
+        [binding bindArray:array];
+        return @[ binding, array ];
+    } body:^NSDictionary*(NSArray *context) {
+        KHMockViewBinding *binding = context[0];
+        NSArray *array = context[1];
+        NSUInteger sum = 0;
+        for ( NSUInteger i=0; i<1000; i++ ) {
+            sum += [binding.core indexPathOfModel:array[khRandom() % array.count]].row;
+        }
+        return @{ @"lookups":@1000, @"checksum":@(sum) };
+    }];
+
+    //  pair 查找
+    for ( NSNumber *compact in @[ @NO, @YES ] ) {
+        [self scenario:compact.boolValue ? @"pair_lookup_compact" : @"pair_lookup" size:size setup:^id{
+            KHMockViewBinding *binding = [self newBinding];
+            binding.compactPairs = compact.boolValue;
+            NSMutableArray *array = [[NSMutableArray alloc] initWithArray:khMakeUsers(size)];
+            [binding bindArray:array];
+            return @[ binding, array ];
+        } body:^NSDictionary*(NSArray *context) {
+            KHMockViewBinding *binding = context[0];
+            NSArray *array = context[1];
+            NSUInteger found = 0;
+            for ( id model in array ) {
+                if ( [binding.core pairOfModel:model] ) found++;
+            }
+            return @{ @"found":@(found) };
+        }];
+    }
+
+    //  replay 一段錄下來的變動，每一步之後都檢查 index 與 pair
+    NSUInteger traceRows = MIN( size, 20000 );
+    [self scenario:@"trace_replay" size:traceRows setup:^id{
+        NSData *trace = khMakeMutationTrace(traceRows);
+        return [[KHMutationReplayer alloc] initWithData:trace error:nil];
+    } body:^NSDictionary*(KHMutationReplayer *replayer) {
+        NSDictionary *report = khReplayOnMockView( replayer, traceRows <= 1000 );
+        NSMutableDictionary *extra = [@{ @"events":report[@"events"],
+                                         @"events_per_sec":report[@"eventsPerSecond"],
+                                         @"latency_p50_us":@( [report[@"latencyP50"] doubleValue] * 1e6 ),
+                                         @"latency_p99_us":@( [report[@"latencyP99"] doubleValue] * 1e6 ),
+                                         @"reloads":report[@"reloadCount"],
+                                         @"batch_updates":report[@"batchUpdateCount"] } mutableCopy];
+        if ( report[@"failure"] ) {
+            extra[@"failure"] = report[@"failure"];
+        }
+        return extra;
+    }];
+
+    //  KVCModel decode / encode
+    [self scenario:@"kvc_decode" size:size setup:^id{
+        return khMakeUserDictionarys(size);
+    } body:^NSDictionary*(NSArray *dicts) {
+        NSArray *users = [KVCModel convertArray:dicts toClass:[KHBenchUser class] keyCorrespond:nil];
+        return @{ @"decoded":@(users.count) };
+    }];
+
+    //  decode 整個 feed 到第一個畫面（20 筆，每筆讀三個欄位）顯示出來，以及 decode 後留著的 memory
+    //  一筆 feed 有六個 model，最多 100k 筆
+    NSUInteger feedCount = MIN( size, 100000 );
+    for ( NSNumber *lazy in @[ @NO, @YES ] ) {
+        Class feedClass = lazy.boolValue ? [KHBenchLazyFeedItem class] : [KHBenchFeedItem class];
+        [self scenario:lazy.boolValue ? @"feed_first_render_lazy" : @"feed_first_render_eager" size:feedCount setup:^id{
+            return khMakeFeedDictionarys(feedCount);
+        } body:^NSDictionary*(NSArray *dicts) {
+            size_t heapStart = khHeapInUse();
+            NSArray *items = [KVCModel convertArray:dicts toClass:feedClass keyCorrespond:nil];
+            NSUInteger checksum = 0;
+            for ( NSUInteger i=0; i<MIN(items.count, 20); i++ ) {
+                KHBenchFeedItem *item = items[i];
+                checksum += item.title.length + item.author.name.length + item.likeCount;
+            }
+            size_t heapEnd = khHeapInUse();
+            return @{ @"checksum":@(checksum),
+                      @"bytes_per_model":@( heapStart ? ( (double)heapEnd - heapStart ) / MAX( feedCount, 1 ) : 0 ) };
+        }];
+        
+        //  最差的情況，每個欄位都讀過
+        [self scenario:lazy.boolValue ? @"feed_read_all_lazy" : @"feed_read_all_eager" size:feedCount setup:^id{
+            return khMakeFeedDictionarys(feedCount);
+        } body:^NSDictionary*(NSArray *dicts) {
+            NSArray *items = [KVCModel convertArray:dicts toClass:feedClass keyCorrespond:nil];
+            NSUInteger checksum = 0;
+            for ( KHBenchFeedItem *item in items ) {
+                checksum += item.title.length + item.body.length + item.url.length + item.createdAt.length;
+                checksum += item.likeCount + item.shareCount + (NSUInteger)item.score + item.tags.count;
+                checksum += item.author.name.length + item.author.avatar.length + item.author.bio.length + item.author.followers;
+                for ( KHBenchComment *comment in item.comments ) {
+                    checksum += comment.text.length + comment.likes + comment.author.name.length;
+                }
+            }
+            return @{ @"checksum":@(checksum) };
+        }];
+    }
+
+    //  feed model 複製成畫面的 view model，以前是先轉 dictionary 再轉回來
+    for ( NSNumber *direct in @[ @NO, @YES ] ) {
+        [self scenario:direct.boolValue ? @"model_copy_direct" : @"model_copy_dictionary" size:feedCount setup:^id{
+            return [KVCModel convertArray:khMakeFeedDictionarys(feedCount) toClass:[KHBenchFeedItem class] keyCorrespond:nil];
+        } body:^NSDictionary*(NSArray *items) {
+            NSArray *rows = nil;
+            if ( direct.boolValue ) {
+                rows = [KVCModel convertModels:items toClass:[KHBenchFeedRow class] keyCorrespond:nil];
+            }
+            else {
+                NSMutableArray *copied = [[NSMutableArray alloc] initWithCapacity: items.count ];
+                for ( KHBenchFeedItem *item in items ) {
+                    KHBenchFeedRow *row = [KHBenchFeedRow new];
+                    [KVCModel injectDictionary:[KVCModel dictionaryWithObj:item] toObject:row ];
+                    [copied addObject:row];
+                }
+                rows = copied;
+            }
+            NSUInteger checksum = 0;
+            for ( KHBenchFeedRow *row in rows ) {
+                checksum += row.title.length + row.likeCount + row.author.name.length + row.comments.count;
+            }
+            //  一筆 row 有 row、author、五則留言與留言的 author，共 12 個 model
+            return @{ @"checksum":@(checksum),
+                      @"copied_models":@( rows.count * 12 ) };
+        }];
+    }
+
+    [self scenario:@"kvc_encode" size:size setup:^id{
+        return [KVCModel convertArray:khMakeUserDictionarys(size) toClass:[KHBenchUser class] keyCorrespond:nil];
+    } body:^NSDictionary*(NSArray *users) {
+        NSArray *dicts = [KVCModel convertDictionarys:users keyCorrespond:nil];
+        return @{ @"encoded":@(dicts.count) };
+    }];
+}
+
+@end
+
+
+int main(int argc, const char * argv[])
+{
+    @autoreleasepool {
+        NSArray *sizes = @[ @1000, @10000, @100000, @1000000 ];
+        NSUInteger iterations = 5;
+        NSString *outputPath = nil;
+        NSString *replayPath = nil;
+
+        for ( int i=1; i<argc; i++ ) {
+            NSString *arg = [NSString stringWithUTF8String:argv[i]];
+            NSString *value = i+1 < argc ? [NSString stringWithUTF8String:argv[i+1]] : nil;
+            if ( [arg isEqualToString:@"--sizes"] && value ) {
+                NSMutableArray *parsed = [[NSMutableArray alloc] init];
+                for ( NSString *size in [value componentsSeparatedByString:@","] ) {
+                    if ( [size integerValue] > 0 ) [parsed addObject:@([size integerValue])];
+                }
+                sizes = parsed;
+                i++;
+            }
+            else if ( [arg isEqualToString:@"--iterations"] && value ) {
+                iterations = MAX( 1, [value integerValue] );
+                i++;
+            }
+            else if ( [arg isEqualToString:@"--output"] && value ) {
+                outputPath = value;
+                i++;
+            }
+            else if ( [arg isEqualToString:@"--replay"] && value ) {
+                replayPath = value;
+                i++;
+            }
+            else {
+                fprintf( stderr, "usage: khbench [--sizes 1000,10000] [--iterations 5] [--output result.json]\n" );
+                fprintf( stderr, "       khbench --replay trace.khmt [--output result.json]\n" );
+                return 1;
+            }
+        }
+
+        //  錄下來的 trace 套用到 mock view，每一步都檢查
+        if ( replayPath ) {
+            NSData *trace = [NSData dataWithContentsOfFile:replayPath];
+            NSError *error = nil;
+            KHMutationReplayer *replayer = trace ? [[KHMutationReplayer alloc] initWithData:trace error:&error] : nil;
+            if ( replayer == nil ) {
+                fprintf( stderr, "can't read %s: %s\n", [replayPath UTF8String], error ? [error.localizedDescription UTF8String] : "no such file" );
+                return 1;
+            }
+            NSDictionary *report = khReplayOnMockView( replayer, YES );
+            NSData *json = [NSJSONSerialization dataWithJSONObject:report options:NSJSONWritingPrettyPrinted error:nil];
+            if ( outputPath ) {
+                [json writeToFile:outputPath atomically:YES];
+            }
+            else {
+                fwrite( json.bytes, 1, json.length, stdout );
+                fputc( '\n', stdout );
+            }
+            return report[@"failure"] ? 2 : 0;
+        }
+
+        KHBenchmark *benchmark = [[KHBenchmark alloc] init];
+        benchmark.iterations = iterations;
+        for ( NSNumber *size in sizes ) {
+            [benchmark runSize:[size unsignedIntegerValue]];
+        }
+
+        NSDictionary *report = @{ @"suite":@"KHDataBinding-core",
+                                  @"version":@1,
+                                  @"results":benchmark.results };
+        NSData *json = [NSJSONSerialization dataWithJSONObject:report options:NSJSONWritingPrettyPrinted error:nil];
+        if ( outputPath ) {
+            [json writeToFile:outputPath atomically:YES];
+        }
+        else {
+            fwrite( json.bytes, 1, json.length, stdout );
+            fputc( '\n', stdout );
+        }
+    }
+    return 0;
+}
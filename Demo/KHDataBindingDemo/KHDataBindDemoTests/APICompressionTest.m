@@ -0,0 +1,207 @@
+//
+//  APICompressionTest.m
+//  KHDataBindDemo
+//
+//  Created by Calvin Huang on 2017/3/13.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import "APIOperation.h"
+#import "APICompression.h"
+#import "APIStubURLProtocol.h"
+
+@interface APICompressionTest : XCTestCase
+
+@end
+
+@implementation APICompressionTest
+{
+    NSOperationQueue *apiQueue;
+}
+
+- (void)setUp {
+    [super setUp];
+    NSURLSessionConfiguration *configuration = [NSURLSessionConfiguration ephemeralSessionConfiguration];
+    configuration.protocolClasses = @[[APIStubURLProtocol class]];
+    [APIOperation setSessionConfiguration:configuration];
+    [APIStubURLProtocol reset];
+    apiQueue = [[NSOperationQueue alloc] init];
+}
+
+- (void)tearDown {
+    [apiQueue cancelAllOperations];
+    [APIOperation setSessionConfiguration:nil];
+    [super tearDown];
+}
+
+- (NSData*)usersJSONWithCount:(NSInteger)count
+{
+    NSMutableArray *users = [[NSMutableArray alloc] initWithCapacity: count ];
+    for ( NSInteger i=0; i<count; i++ ) {
+        [users addObject:@{ @"id":@(i), @"name":[NSString stringWithFormat:@"user %ld", (long)i], @"email":[NSString stringWithFormat:@"user%ld@example.com", (long)i] }];
+    }
+    //  跟 KVCModel 的 jsonData 一樣是 pretty printed
+    return [NSJSONSerialization dataWithJSONObject:@{ @"results":users } options:NSJSONWritingPrettyPrinted error:nil];
+}
+
+//  逐段解壓，每種切段大小都要得到一樣的結果
+- (void)inflate:(NSData*)compressed expect:(NSData*)expect
+{
+    for ( NSUInteger chunkSize=1; chunkSize<=compressed.length; chunkSize = chunkSize < 16 ? chunkSize + 1 : chunkSize * 3 ) {
+        NSMutableData *output = [[NSMutableData alloc] init];
+        APIInflateStream *stream = [[APIInflateStream alloc] init];
+        stream.outputBlock = ^(NSData *data) {
+            [output appendData:data];
+        };
+        for ( NSUInteger offset=0; offset<compressed.length; offset+=chunkSize ) {
+            NSData *chunk = [compressed subdataWithRange:NSMakeRange(offset, MIN(chunkSize, compressed.length - offset))];
+            XCTAssert( [stream appendData:chunk error:nil] );
+        }
+        XCTAssert( [stream finish:nil] );
+        XCTAssertEqualObjects( output, expect, @"chunk size %lu", (unsigned long)chunkSize );
+        XCTAssert( stream.inputLength == compressed.length );
+    }
+}
+
+#pragma mark - Codec
+
+- (void)testGzipRoundTrip
+{
+    NSData *json = [self usersJSONWithCount:500];
+    NSData *gzip = [APICompression gzipData:json];
+    XCTAssert( gzip.length < json.length / 4 );
+    XCTAssert( [APICompression isCompressedData:gzip encoding:APIContentEncodingGzip] );
+    XCTAssertFalse( [APICompression isCompressedData:json encoding:APIContentEncodingGzip] );
+    [self inflate:gzip expect:json];
+}
+
+- (void)testDeflateRoundTrip
+{
+    NSData *json = [self usersJSONWithCount:500];
+    NSData *deflate = [APICompression deflateData:json];
+    XCTAssert( [APICompression isCompressedData:deflate encoding:APIContentEncodingDeflate] );
+    XCTAssertFalse( [APICompression isCompressedData:json encoding:APIContentEncodingDeflate] );
+    [self inflate:deflate expect:json];
+}
+
+- (void)testEmptyAndMultiMember
+{
+    NSData *empty = [APICompression gzipData:[NSData data]];
+    XCTAssertEqualObjects( [APICompression inflateData:empty error:nil], [NSData data] );
+
+    //  多個 gzip member 接在一起
+    NSData *a = [@"hello " dataUsingEncoding:NSUTF8StringEncoding];
+    NSData *b = [@"world" dataUsingEncoding:NSUTF8StringEncoding];
+    NSMutableData *joined = [[APICompression gzipData:a] mutableCopy];
+    [joined appendData:[APICompression gzipData:b]];
+    XCTAssertEqualObjects( [APICompression inflateData:joined error:nil], [@"hello world" dataUsingEncoding:NSUTF8StringEncoding] );
+}
+
+- (void)testCorruptData
+{
+    NSData *gzip = [APICompression gzipData:[self usersJSONWithCount:100]];
+    NSError *error = nil;
+
+    //  截斷
+    XCTAssertNil( [APICompression inflateData:[gzip subdataWithRange:NSMakeRange(0, gzip.length - 8)] error:&error] );
+    XCTAssertEqualObjects( error.domain, APICompressionErrorDomain );
+
+    //  資料被改掉
+    NSMutableData *corrupt = [gzip mutableCopy];
+    ((uint8_t*)corrupt.mutableBytes)[20] ^= 0xff;
+    error = nil;
+    XCTAssertNil( [APICompression inflateData:corrupt error:&error] );
+    XCTAssertNotNil( error );
+}
+
+#pragma mark - APIOperation
+
+- (void)testGzipResponse
+{
+    for ( NSString *encoding in @[ @"gzip", @"deflate" ] ) {
+        XCTestExpectation *expectation = [self expectationWithDescription:encoding];
+        APIOperation *api = [[APIOperation alloc] init];
+        [api GET:@"http://stub.local/users" param:@{@"size":@500, @"chunks":@8, @"encoding":encoding} body:nil response:^(APIOperation *api, id responseObject) {
+            XCTAssert( [responseObject[@"results"] count] == 500 );
+            XCTAssert( api.receivedBytes < api.decodedBytes );
+            [expectation fulfill];
+        } fail:^(APIOperation *api, NSError *error) {
+            XCTFail( @"%@", error );
+        }];
+        [apiQueue addOperation: api ];
+        [self waitForExpectationsWithTimeout:5 handler:nil];
+        XCTAssertEqualObjects( [[APIStubURLProtocol lastRequest] valueForHTTPHeaderField:@"Accept-Encoding"], @"gzip, deflate" );
+    }
+}
+
+- (void)testRequestCompression
+{
+    NSData *json = [self usersJSONWithCount:200];
+    APIOperation *api = [[APIOperation alloc] initWithSerializer:nil unserializer:[APIJSONSerializer new]];
+    api.requestCompressionThreshold = 1024;
+    api.contentType = @"application/json";
+    [api POST:@"http://stub.local/users" param:nil body:json response:nil fail:nil];
+    [self keyValueObservingExpectationForObject:api keyPath:@"isFinished" expectedValue:@YES];
+    [apiQueue addOperation: api ];
+    [self waitForExpectationsWithTimeout:5 handler:nil];
+
+    NSData *sent = [APIStubURLProtocol lastRequestBody];
+    XCTAssertEqualObjects( [[APIStubURLProtocol lastRequest] valueForHTTPHeaderField:@"Content-Encoding"], @"gzip" );
+    XCTAssert( sent.length < json.length );
+    XCTAssertEqualObjects( [APICompression inflateData:sent error:nil], json );
+
+    //  比門檻小的不壓縮
+    NSData *small = [@"{\"id\":1}" dataUsingEncoding:NSUTF8StringEncoding];
+    api = [[APIOperation alloc] initWithSerializer:nil unserializer:[APIJSONSerializer new]];
+    api.requestCompressionThreshold = 1024;
+    [api POST:@"http://stub.local/users" param:nil body:small response:nil fail:nil];
+    [self keyValueObservingExpectationForObject:api keyPath:@"isFinished" expectedValue:@YES];
+    [apiQueue addOperation: api ];
+    [self waitForExpectationsWithTimeout:5 handler:nil];
+    XCTAssertNil( [[APIStubURLProtocol lastRequest] valueForHTTPHeaderField:@"Content-Encoding"] );
+    XCTAssertEqualObjects( [APIStubURLProtocol lastRequestBody], small );
+}
+
+//  壓縮後只有幾十 byte，也要能解開
+- (void)testSmallGzipResponse
+{
+    XCTestExpectation *expectation = [self expectationWithDescription:@"response"];
+    APIOperation *api = [[APIOperation alloc] init];
+    [api GET:@"http://stub.local/users" param:@{@"size":@0, @"chunks":@4, @"encoding":@"gzip"} body:nil response:^(APIOperation *api, id responseObject) {
+        XCTAssert( [responseObject[@"results"] count] == 0 );
+        [expectation fulfill];
+    } fail:^(APIOperation *api, NSError *error) {
+        XCTFail( @"%@", error );
+    }];
+    [apiQueue addOperation: api ];
+    [self waitForExpectationsWithTimeout:5 handler:nil];
+}
+
+#pragma mark - Benchmark
+
+//  2000 筆，比較傳輸量與解碼時間
+- (void)testCompressionBenchmark
+{
+    NSData *json = [self usersJSONWithCount:2000];
+    NSData *gzip = [APICompression gzipData:json];
+    NSData *compact = [NSJSONSerialization dataWithJSONObject:[NSJSONSerialization JSONObjectWithData:json options:0 error:nil] options:0 error:nil];
+    NSLog(@"pretty %lu bytes, compact %lu bytes, gzip %lu bytes (%.1f%%)",
+          (unsigned long)json.length, (unsigned long)compact.length, (unsigned long)gzip.length, gzip.length * 100.0 / json.length );
+    XCTAssert( gzip.length * 5 < json.length );
+
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    for ( int i=0; i<20; i++ ) {
+        [NSJSONSerialization JSONObjectWithData:json options:0 error:nil];
+    }
+    NSLog(@"json only: %.3fms", ( CFAbsoluteTimeGetCurrent() - start ) * 1000 / 20 );
+
+    [self measureBlock:^{
+        for ( int i=0; i<20; i++ ) {
+            NSData *data = [APICompression inflateData:gzip error:nil];
+            [NSJSONSerialization JSONObjectWithData:data options:0 error:nil];
+        }
+    }];
+}
+
+@end
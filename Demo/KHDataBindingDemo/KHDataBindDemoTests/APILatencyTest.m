@@ -0,0 +1,291 @@
+//
+//  APILatencyTest.m
+//  KHDataBindDemo
+//
+//  Created by Calvin Huang on 2017/3/12.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import "APIOperation.h"
+#import "APILatencyTracker.h"
+#import "APIStubURLProtocol.h"
+
+static NSString *const StubURL = @"http://stub.local/users";
+
+@interface APILatencyTest : XCTestCase
+
+@end
+
+@implementation APILatencyTest
+{
+    NSOperationQueue *apiQueue;
+    APILatencyTracker *tracker;
+    NSString *endpoint;
+}
+
+- (void)setUp {
+    [super setUp];
+    NSURLSessionConfiguration *configuration = [NSURLSessionConfiguration ephemeralSessionConfiguration];
+    configuration.protocolClasses = @[[APIStubURLProtocol class]];
+    [APIOperation setSessionConfiguration:configuration];
+    [APIStubURLProtocol reset];
+    apiQueue = [[NSOperationQueue alloc] init];
+    tracker = [[APILatencyTracker alloc] init];
+    endpoint = [APILatencyTracker endpointWithMethod:@"GET" url:[NSURL URLWithString:StubURL]];
+}
+
+- (void)tearDown {
+    [apiQueue cancelAllOperations];
+    [APIOperation setSessionConfiguration:nil];
+    [super tearDown];
+}
+
+//  執行一個 operation，等它結束，回傳 response block 收到的 status code，fail 回傳 -1
+- (NSInteger)runOperation:(APIOperation*)api method:(NSString*)method
+{
+    __block NSInteger statusCode = 0;
+    [api requestMethod:method api:StubURL param:@{@"size":@3} body:nil response:^(APIOperation *api, id responseObject) {
+        statusCode = api.statusCode;
+    } fail:^(APIOperation *api, NSError *error) {
+        statusCode = -1;
+    }];
+    [self keyValueObservingExpectationForObject:api keyPath:@"isFinished" expectedValue:@YES];
+    [apiQueue addOperation: api ];
+    [self waitForExpectationsWithTimeout:10 handler:nil];
+    return statusCode;
+}
+
+- (APIOperation*)operation
+{
+    APIOperation *api = [[APIOperation alloc] init];
+    api.latencyTracker = tracker;
+    api.retryBaseDelay = 0.01;
+    return api;
+}
+
+#pragma mark - Tracker
+
+- (void)testPercentile
+{
+    for ( int i=0; i<90; i++ ) [tracker recordLatency:0.010 forEndpoint:endpoint];
+    for ( int i=0; i<9; i++ ) [tracker recordLatency:0.100 forEndpoint:endpoint];
+    [tracker recordLatency:1.0 forEndpoint:endpoint];
+
+    //  回傳 bucket 的上限，誤差在 10% 內
+    XCTAssertEqualWithAccuracy( [tracker latencyAtPercentile:0.5 forEndpoint:endpoint], 0.010, 0.0011 );
+    XCTAssertEqualWithAccuracy( [tracker latencyAtPercentile:0.95 forEndpoint:endpoint], 0.100, 0.011 );
+    XCTAssertEqualWithAccuracy( [tracker latencyAtPercentile:0.99 forEndpoint:endpoint], 0.100, 0.011 );
+    XCTAssertEqualWithAccuracy( [tracker latencyAtPercentile:1.0 forEndpoint:endpoint], 1.0, 0.11 );
+    XCTAssert( [tracker sampleCountForEndpoint:endpoint] == 100 );
+}
+
+- (void)testMinimumSamples
+{
+    for ( int i=0; i<19; i++ ) [tracker recordLatency:0.010 forEndpoint:endpoint];
+    XCTAssert( [tracker latencyAtPercentile:0.5 forEndpoint:endpoint] == 0 );
+    [tracker recordLatency:0.010 forEndpoint:endpoint];
+    XCTAssert( [tracker latencyAtPercentile:0.5 forEndpoint:endpoint] > 0 );
+    //  其他 endpoint 不受影響
+    XCTAssert( [tracker latencyAtPercentile:0.5 forEndpoint:@"POST stub.local/users"] == 0 );
+}
+
+//  server 變慢後，舊的樣本會淡出
+- (void)testDecay
+{
+    tracker.maxSamples = 200;
+    for ( int i=0; i<200; i++ ) [tracker recordLatency:0.010 forEndpoint:endpoint];
+    for ( int i=0; i<400; i++ ) [tracker recordLatency:0.200 forEndpoint:endpoint];
+    XCTAssertEqualWithAccuracy( [tracker latencyAtPercentile:0.5 forEndpoint:endpoint], 0.200, 0.022 );
+    XCTAssert( [tracker sampleCountForEndpoint:endpoint] <= 200 );
+}
+
+- (void)testEndpoint
+{
+    NSString *a = [APILatencyTracker endpointWithMethod:@"GET" url:[NSURL URLWithString:@"http://stub.local/users?page=1"]];
+    NSString *b = [APILatencyTracker endpointWithMethod:@"GET" url:[NSURL URLWithString:@"http://stub.local/users?page=2"]];
+    XCTAssertEqualObjects( a, b );
+}
+
+#pragma mark - Timeout
+
+- (void)testAdaptiveTimeout
+{
+    for ( int i=0; i<100; i++ ) [tracker recordLatency:1.0 forEndpoint:endpoint];
+    APIOperation *api = [self operation];
+    XCTAssert( [self runOperation:api method:@"GET"] == 200 );
+    //  p99 約 1 秒，timeout 是 3 倍
+    NSTimeInterval timeout = [APIStubURLProtocol lastRequest].timeoutInterval;
+    XCTAssert( timeout >= 3.0 && timeout < 3.5, @"%f", timeout );
+
+    //  樣本不足時用 timeoutInterval
+    [tracker reset];
+    api = [self operation];
+    api.timeoutInterval = 7;
+    [self runOperation:api method:@"GET"];
+    XCTAssertEqualWithAccuracy( [APIStubURLProtocol lastRequest].timeoutInterval, 7, 0.001 );
+}
+
+//  server 變慢到超過學到的 timeout，逾時的嘗試記成樣本，重試用完整的 timeoutInterval，request 還是會成功
+- (void)testTimeoutAfterSlowdown
+{
+    for ( int i=0; i<100; i++ ) [tracker recordLatency:0.05 forEndpoint:endpoint];
+    [APIStubURLProtocol setLatencyBlock:^NSTimeInterval(NSInteger requestIndex) {
+        return 1.5;
+    }];
+    APIOperation *api = [self operation];
+    api.timeoutInterval = 5;
+    XCTAssert( [self runOperation:api method:@"GET"] == 200 );
+    //  第一次用 p99 算出的 1 秒逾時，重試成功
+    XCTAssert( api.retryCount == 1 );
+    XCTAssert( [APIStubURLProtocol requestCount] == 2 );
+    XCTAssertEqualWithAccuracy( [APIStubURLProtocol lastRequest].timeoutInterval, 5, 0.001 );
+    //  逾時的 1 秒與成功的 1.5 秒都有記
+    XCTAssert( [tracker sampleCountForEndpoint:endpoint] == 102 );
+
+    //  之後的 operation 依新的 p99 算 timeout，第一次就成功
+    api = [self operation];
+    api.timeoutInterval = 5;
+    XCTAssert( [self runOperation:api method:@"GET"] == 200 );
+    XCTAssert( api.retryCount == 0 );
+    XCTAssert( [APIStubURLProtocol requestCount] == 3 );
+}
+
+- (void)testRecordLatency
+{
+    [APIStubURLProtocol setLatencyBlock:^NSTimeInterval(NSInteger requestIndex) {
+        return 0.05;
+    }];
+    for ( int i=0; i<3; i++ ) {
+        [self runOperation:[self operation] method:@"GET"];
+    }
+    XCTAssert( [tracker sampleCountForEndpoint:endpoint] == 3 );
+}
+
+#pragma mark - Retry
+
+- (void)testRetryServiceUnavailable
+{
+    [APIStubURLProtocol setStatusBlock:^NSInteger(NSInteger requestIndex) {
+        return requestIndex < 2 ? 503 : 200;
+    }];
+    APIOperation *api = [self operation];
+    XCTAssert( [self runOperation:api method:@"GET"] == 200 );
+    XCTAssert( api.retryCount == 2 );
+    XCTAssert( [APIStubURLProtocol requestCount] == 3 );
+}
+
+- (void)testRetryConnectionLost
+{
+    [APIStubURLProtocol setStatusBlock:^NSInteger(NSInteger requestIndex) {
+        return requestIndex == 0 ? -1 : 200;
+    }];
+    APIOperation *api = [self operation];
+    XCTAssert( [self runOperation:api method:@"GET"] == 200 );
+    XCTAssert( api.retryCount == 1 );
+}
+
+- (void)testRetryLimit
+{
+    [APIStubURLProtocol setStatusBlock:^NSInteger(NSInteger requestIndex) {
+        return 503;
+    }];
+    APIOperation *api = [self operation];
+    api.maxRetryCount = 1;
+    //  重試完還是 503，交給 response block
+    XCTAssert( [self runOperation:api method:@"GET"] == 503 );
+    XCTAssert( [APIStubURLProtocol requestCount] == 2 );
+}
+
+//  POST 不是 idempotent，不能重試
+- (void)testNoRetryForPOST
+{
+    [APIStubURLProtocol setStatusBlock:^NSInteger(NSInteger requestIndex) {
+        return requestIndex == 0 ? -1 : 200;
+    }];
+    APIOperation *api = [self operation];
+    XCTAssert( [self runOperation:api method:@"POST"] == -1 );
+    XCTAssert( api.retryCount == 0 );
+    XCTAssert( [APIStubURLProtocol requestCount] == 1 );
+}
+
+- (void)testCancelWhileWaitingRetry
+{
+    [APIStubURLProtocol setStatusBlock:^NSInteger(NSInteger requestIndex) {
+        return 503;
+    }];
+    APIOperation *api = [self operation];
+    api.retryBaseDelay = 2;
+    api.maxRetryCount = 10;
+    [api GET:StubURL param:nil body:nil response:^(APIOperation *api, id responseObject) {
+        XCTFail( @"should not response" );
+    } fail:^(APIOperation *api, NSError *error) {
+        XCTFail( @"should not fail" );
+    }];
+    [self keyValueObservingExpectationForObject:api keyPath:@"isFinished" expectedValue:@YES];
+    [apiQueue addOperation: api ];
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(0.2 * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+        [api cancel];
+    });
+    [self waitForExpectationsWithTimeout:1 handler:nil];
+}
+
+#pragma mark - Hedge
+
+//  平常 50ms，第一個 request 卡住 2 秒，hedge 在 p95 之後送出並先回應
+- (void)testHedgeWins
+{
+    for ( int i=0; i<100; i++ ) [tracker recordLatency:0.05 forEndpoint:endpoint];
+    [APIStubURLProtocol setLatencyBlock:^NSTimeInterval(NSInteger requestIndex) {
+        return requestIndex == 0 ? 2.0 : 0.01;
+    }];
+    APIOperation *api = [self operation];
+    api.hedged = YES;
+    XCTAssert( [self runOperation:api method:@"GET"] == 200 );
+    XCTAssert( api.hedgeWon );
+    XCTAssert( [APIStubURLProtocol requestCount] == 2 );
+    //  記的是從 primary 送出算起的時間，至少是 hedge 的等待時間加上 hedge 的延遲
+    XCTAssert( [tracker sampleCountForEndpoint:endpoint] == 101 );
+    XCTAssert( [tracker latencyAtPercentile:1.0 forEndpoint:endpoint] > 0.056 );
+}
+
+//  p95 內就回應，不會送 hedge
+- (void)testNoHedgeWhenFast
+{
+    for ( int i=0; i<100; i++ ) [tracker recordLatency:0.2 forEndpoint:endpoint];
+    [APIStubURLProtocol setLatencyBlock:^NSTimeInterval(NSInteger requestIndex) {
+        return 0.01;
+    }];
+    APIOperation *api = [self operation];
+    api.hedged = YES;
+    XCTAssert( [self runOperation:api method:@"GET"] == 200 );
+    XCTAssertFalse( api.hedgeWon );
+    XCTAssert( [APIStubURLProtocol requestCount] == 1 );
+}
+
+//  延遲的分佈有長尾時，慢的 request 都由 hedge 回應
+- (void)testHedgeTailLatency
+{
+    for ( int i=0; i<100; i++ ) [tracker recordLatency:0.2 forEndpoint:endpoint];
+    //  request 的順序 (含 hedge) 每 10 個有一個慢 1 秒
+    [APIStubURLProtocol setLatencyBlock:^NSTimeInterval(NSInteger requestIndex) {
+        return requestIndex % 10 == 0 ? 1.0 : 0.01;
+    }];
+    NSInteger hedgeWonCount = 0;
+    for ( int i=0; i<20; i++ ) {
+        APIOperation *api = [self operation];
+        api.hedged = YES;
+        XCTAssert( [self runOperation:api method:@"GET"] == 200 );
+        if ( api.hedgeWon ) {
+            hedgeWonCount++;
+        }
+    }
+    //  第 0、10、20 個 request 慢，各多送一個 hedge
+    XCTAssert( hedgeWonCount == 3 );
+    XCTAssert( [APIStubURLProtocol requestCount] == 23 );
+    XCTAssert( [tracker sampleCountForEndpoint:endpoint] == 120 );
+    //  hedge 先回應的，記的還是 primary 等了多久，p95 不會被拉低
+    XCTAssert( [tracker latencyAtPercentile:0.95 forEndpoint:endpoint] >= 0.19 );
+}
+
+@end
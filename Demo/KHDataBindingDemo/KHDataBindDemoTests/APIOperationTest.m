@@ -0,0 +1,308 @@
+//
+//  APIOperationTest.m
+//  KHDataBindDemo
+//
+//  Created by Calvin Huang on 2017/3/10.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import <UIKit/UIKit.h>
+#import <XCTest/XCTest.h>
+#import "APIOperation.h"
+#import "APIStubURLProtocol.h"
+#import "APIStreamArrayUnserializer.h"
+#import "KHJSONArrayDecoder.h"
+#import "KHDataBinding.h"
+
+//  記錄收到幾段資料的 unserializer
+@interface APIChunkCountUnserializer : NSObject <APIDataSerializeDelegate>
+
+@property (nonatomic) NSInteger beginCount;
+@property (nonatomic) NSInteger chunkCount;
+@property (nonatomic) NSMutableData *data;
+
+@end
+
+@implementation APIChunkCountUnserializer
+
+- (void)unSerializeBegin:(APIOperation*)api
+{
+    _beginCount++;
+    _chunkCount = 0;
+    _data = [[NSMutableData alloc] init];
+}
+
+- (void)unSerialize:(APIOperation*)api didReceiveData:(NSData*)data
+{
+    _chunkCount++;
+    [_data appendData:data];
+}
+
+- (id)unSerializeDidFinish:(APIOperation*)api
+{
+    return [NSJSONSerialization JSONObjectWithData:_data options:0 error:nil];
+}
+
+@end
+
+
+@interface APIOperationTest : XCTestCase
+
+@end
+
+@implementation APIOperationTest
+{
+    NSOperationQueue *apiQueue;
+}
+
+- (void)setUp {
+    [super setUp];
+    NSURLSessionConfiguration *configuration = [NSURLSessionConfiguration ephemeralSessionConfiguration];
+    configuration.protocolClasses = @[[APIStubURLProtocol class]];
+    configuration.HTTPMaximumConnectionsPerHost = 64;
+    [APIOperation setSessionConfiguration:configuration];
+    [APIStubURLProtocol reset];
+    [[APILatencyTracker sharedTracker] reset];
+    apiQueue = [[NSOperationQueue alloc] init];
+}
+
+- (void)tearDown {
+    [apiQueue cancelAllOperations];
+    [APIOperation setSessionConfiguration:nil];
+    [super tearDown];
+}
+
+- (void)testResponse
+{
+    XCTestExpectation *expectation = [self expectationWithDescription:@"response"];
+    APIOperation *api = [[APIOperation alloc] init];
+    [api GET:@"http://stub.local/users" param:@{@"size":@5} body:nil response:^(APIOperation *api, id responseObject) {
+        XCTAssert( api.statusCode == 200 );
+        XCTAssert( [responseObject[@"results"] count] == 5 );
+        [expectation fulfill];
+    } fail:^(APIOperation *api, NSError *error) {
+        XCTFail( @"%@", error );
+    }];
+    [apiQueue addOperation: api ];
+    [self waitForExpectationsWithTimeout:5 handler:nil];
+}
+
+- (void)testStreamingUnserializer
+{
+    XCTestExpectation *expectation = [self expectationWithDescription:@"response"];
+    APIChunkCountUnserializer *unserializer = [[APIChunkCountUnserializer alloc] init];
+    APIOperation *api = [[APIOperation alloc] initWithSerializer:[APIJSONSerializer new] unserializer:unserializer];
+    [api GET:@"http://stub.local/users" param:@{@"size":@200, @"chunks":@4} body:nil response:^(APIOperation *api, id responseObject) {
+        XCTAssert( [responseObject[@"results"] count] == 200 );
+        [expectation fulfill];
+    } fail:^(APIOperation *api, NSError *error) {
+        XCTFail( @"%@", error );
+    }];
+    [apiQueue addOperation: api ];
+    [self waitForExpectationsWithTimeout:5 handler:nil];
+
+    XCTAssert( unserializer.beginCount == 1 );
+    //  每段之間有間隔，不會被合併成一段
+    XCTAssert( unserializer.chunkCount > 1 );
+}
+
+- (void)testCallbackQueue
+{
+    XCTestExpectation *expectation = [self expectationWithDescription:@"response"];
+    NSOperationQueue *callbackQueue = [[NSOperationQueue alloc] init];
+    APIOperation *api = [[APIOperation alloc] init];
+    api.queue = callbackQueue;
+    [api GET:@"http://stub.local/users" param:nil body:nil response:^(APIOperation *api, id responseObject) {
+        XCTAssert( [NSOperationQueue currentQueue] == callbackQueue );
+        //  callback 執行完才算結束
+        XCTAssertFalse( api.isFinished );
+        [expectation fulfill];
+    } fail:^(APIOperation *api, NSError *error) {
+        XCTFail( @"%@", error );
+    }];
+    [apiQueue addOperation: api ];
+    [self waitForExpectationsWithTimeout:5 handler:nil];
+}
+
+- (void)testCancel
+{
+    __block BOOL called = NO;
+    APIOperation *api = [[APIOperation alloc] init];
+    [api GET:@"http://stub.local/users" param:@{@"latency":@2000} body:nil response:^(APIOperation *api, id responseObject) {
+        called = YES;
+    } fail:^(APIOperation *api, NSError *error) {
+        called = YES;
+    }];
+    [self keyValueObservingExpectationForObject:api keyPath:@"isFinished" expectedValue:@YES];
+    [apiQueue addOperation: api ];
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(0.1 * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+        [api cancel];
+    });
+    [self waitForExpectationsWithTimeout:1 handler:nil];
+    XCTAssertFalse( called );
+    XCTAssertFalse( api.isExecuting );
+}
+
+- (void)testCancelBeforeStart
+{
+    APIOperation *api = [[APIOperation alloc] init];
+    [api GET:@"http://stub.local/users" param:nil body:nil response:^(APIOperation *api, id responseObject) {
+        XCTFail( @"should not response" );
+    } fail:^(APIOperation *api, NSError *error) {
+        XCTFail( @"should not fail" );
+    }];
+    [api cancel];
+    [self keyValueObservingExpectationForObject:api keyPath:@"isFinished" expectedValue:@YES];
+    [apiQueue addOperation: api ];
+    [self waitForExpectationsWithTimeout:1 handler:nil];
+}
+
+//  建立 request 時的 exception 變成 fail，operation 要結束
+- (void)testInvalidRequestFinishes
+{
+    XCTestExpectation *expectation = [self expectationWithDescription:@"fail"];
+    APIOperation *api = [[APIOperation alloc] initWithSerializer:nil unserializer:nil];
+    [api POST:@"http://stub.local/users" param:nil body:@123 response:^(APIOperation *api, id responseObject) {
+        XCTFail( @"should fail" );
+    } fail:^(APIOperation *api, NSError *error) {
+        XCTAssertEqualObjects( error.domain, APIOperationErrorDomain );
+        XCTAssert( error.code == APIOperationErrorInvalidRequest );
+        [expectation fulfill];
+    }];
+    [apiQueue addOperation: api ];
+    [self waitForExpectationsWithTimeout:5 handler:nil];
+    
+    [apiQueue waitUntilAllOperationsAreFinished];
+    XCTAssertTrue( api.isFinished );
+    XCTAssertFalse( api.isExecuting );
+    XCTAssert( [APIStubURLProtocol requestCount] == 0 );
+}
+
+//  慢慢送出 2000 筆資料，第一批要在 response 收完前就出現在 table view
+- (void)testProgressiveBindArray
+{
+    UITableView *tableView = [[UITableView alloc] initWithFrame:(CGRect){0,0,320,480} style:UITableViewStylePlain];
+    KHTableDataBinding *dataBinder = [[KHTableDataBinding alloc] initWithView:tableView delegate:nil registerClass:nil];
+    NSMutableArray *userList = [dataBinder createBindArray];
+    
+    APIStreamArrayUnserializer *unserializer = [[APIStreamArrayUnserializer alloc] initWithKeyPath:@"results" modelClass:nil targetArray:userList];
+    __block NSInteger batchCount = 0;
+    __block NSInteger firstBatchRows = 0;
+    __block BOOL responded = NO;
+    __block BOOL firstBatchBeforeResponse = NO;
+    unserializer.didAppendBatch = ^(NSArray *models) {
+        if ( batchCount++ == 0 ) {
+            firstBatchRows = [tableView numberOfRowsInSection:0];
+            firstBatchBeforeResponse = !responded;
+        }
+    };
+    
+    XCTestExpectation *expectation = [self expectationWithDescription:@"response"];
+    APIOperation *api = [[APIOperation alloc] initWithSerializer:[APIJSONSerializer new] unserializer:unserializer];
+    api.queue = [NSOperationQueue mainQueue];
+    [api GET:@"http://stub.local/users" param:@{@"size":@2000, @"chunks":@40, @"interval":@25} body:nil response:^(APIOperation *api, id responseObject) {
+        responded = YES;
+        XCTAssert( [responseObject count] == 2000 );
+        [expectation fulfill];
+    } fail:^(APIOperation *api, NSError *error) {
+        XCTFail( @"%@", error );
+    }];
+    [apiQueue addOperation: api ];
+    [self waitForExpectationsWithTimeout:10 handler:nil];
+    
+    XCTAssert( unserializer.error == nil );
+    XCTAssert( firstBatchBeforeResponse );
+    XCTAssert( firstBatchRows > 0 && firstBatchRows < 2000 );
+    XCTAssert( batchCount > 1 );
+    XCTAssert( userList.count == 2000 );
+    XCTAssert( [tableView numberOfRowsInSection:0] == 2000 );
+    XCTAssertEqualObjects( userList[1999][@"name"], @"user 1999" );
+}
+
+//  資料格式錯誤，呼叫 fail block，也不存入 cache
+- (void)testMalformedStreamFails
+{
+    NSString *cacheDirectory = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]];
+    [APIOperation setResponseCache:[[APIResponseCache alloc] initWithDirectory:cacheDirectory capacity:1024*1024]];
+    [APIStubURLProtocol setCacheControl:@"max-age=60"];
+    
+    //  1 是元素格式錯誤，2 是 results 最後多一個 ','，各送兩次
+    for ( int i=0; i<4; i++ ) {
+        NSMutableArray *userList = [[NSMutableArray alloc] init];
+        APIStreamArrayUnserializer *unserializer = [[APIStreamArrayUnserializer alloc] initWithKeyPath:@"results" modelClass:nil targetArray:userList];
+        XCTestExpectation *expectation = [self expectationWithDescription:@"fail"];
+        APIOperation *api = [[APIOperation alloc] initWithSerializer:[APIJSONSerializer new] unserializer:unserializer];
+        [api GET:@"http://stub.local/users" param:@{@"size":@100, @"chunks":@4, @"malformed":@(i / 2 + 1)} body:nil response:^(APIOperation *api, id responseObject) {
+            XCTFail( @"malformed stream should fail" );
+        } fail:^(APIOperation *api, NSError *error) {
+            XCTAssertEqualObjects( error.domain, KHJSONArrayDecoderErrorDomain );
+            [expectation fulfill];
+        }];
+        [apiQueue addOperation: api ];
+        [self waitForExpectationsWithTimeout:5 handler:nil];
+        XCTAssertNotNil( unserializer.error );
+    }
+    //  沒有存入 cache，每次都要送 request
+    XCTAssert( [APIStubURLProtocol requestCount] == 4 );
+    
+    [APIOperation setResponseCache:nil];
+    [[NSFileManager defaultManager] removeItemAtPath:cacheDirectory error:nil];
+}
+
+//  重新收到 response 時只拿掉上次加入的 model，caller 自己加入的相等的 model 要留著
+- (void)testStreamRemovesOnlyOwnModels
+{
+    NSMutableArray *userList = [[NSMutableArray alloc] init];
+    APIStreamArrayUnserializer *unserializer = [[APIStreamArrayUnserializer alloc] initWithKeyPath:nil modelClass:nil targetArray:userList];
+    NSData *json = [@"[{\"id\":1},{\"id\":2}]" dataUsingEncoding:NSUTF8StringEncoding];
+    [unserializer unSerializeBegin:nil];
+    [unserializer unSerialize:nil didReceiveData:json];
+    XCTAssert( [[unserializer unSerializeDidFinish:nil] count] == 2 );
+    
+    XCTestExpectation *appended = [self expectationWithDescription:@"append"];
+    dispatch_async(dispatch_get_main_queue(), ^{
+        [appended fulfill];
+    });
+    [self waitForExpectationsWithTimeout:1 handler:nil];
+    XCTAssert( userList.count == 2 );
+    
+    NSDictionary *own = @{ @"id":@1 };
+    [userList addObject:[own mutableCopy]];
+    [unserializer unSerializeBegin:nil];
+    
+    XCTestExpectation *removed = [self expectationWithDescription:@"remove"];
+    dispatch_async(dispatch_get_main_queue(), ^{
+        [removed fulfill];
+    });
+    [self waitForExpectationsWithTimeout:1 handler:nil];
+    XCTAssert( userList.count == 1 );
+    XCTAssertEqualObjects( userList[0], own );
+}
+
+//  64 個 request，每個延遲 50ms
+//  同步的版本每個 request 佔一個 thread，非同步的版本全部一起送出，總時間接近單一個 request
+//  每個 request 的參數不同，不會被合併
+- (void)testConcurrentThroughput
+{
+    NSInteger requestCount = 64;
+    [self measureBlock:^{
+        dispatch_group_t group = dispatch_group_create();
+        CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+        for ( NSInteger i=0; i<requestCount; i++ ) {
+            dispatch_group_enter(group);
+            APIOperation *api = [[APIOperation alloc] init];
+            [api GET:@"http://stub.local/users" param:@{@"latency":@50, @"size":@20, @"n":@(i)} body:nil response:^(APIOperation *api, id responseObject) {
+                dispatch_group_leave(group);
+            } fail:^(APIOperation *api, NSError *error) {
+                dispatch_group_leave(group);
+            }];
+            [apiQueue addOperation: api ];
+        }
+        long timeout = dispatch_group_wait(group, dispatch_time(DISPATCH_TIME_NOW, (int64_t)(10 * NSEC_PER_SEC)));
+        XCTAssert( timeout == 0 );
+        CFAbsoluteTime elapsed = CFAbsoluteTimeGetCurrent() - start;
+        NSLog(@"%ld requests in %.3fs, %.1f req/s", (long)requestCount, elapsed, requestCount / elapsed );
+    }];
+}
+
+@end
@@ -0,0 +1,230 @@
+//
+//  APIResponseCacheTest.m
+//  KHDataBindDemo
+//
+//  Created by Calvin Huang on 2017/3/11.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import "APIOperation.h"
+#import "APIResponseCache.h"
+#import "APIStubURLProtocol.h"
+
+@interface APIResponseCacheTest : XCTestCase
+
+@end
+
+@implementation APIResponseCacheTest
+{
+    NSOperationQueue *apiQueue;
+    NSString *cacheDirectory;
+    APIResponseCache *cache;
+}
+
+- (void)setUp {
+    [super setUp];
+    NSURLSessionConfiguration *configuration = [NSURLSessionConfiguration ephemeralSessionConfiguration];
+    configuration.protocolClasses = @[[APIStubURLProtocol class]];
+    [APIOperation setSessionConfiguration:configuration];
+    [APIStubURLProtocol reset];
+    [[APILatencyTracker sharedTracker] reset];
+    
+    cacheDirectory = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]];
+    cache = [[APIResponseCache alloc] initWithDirectory:cacheDirectory capacity:1024*1024];
+    [APIOperation setResponseCache:cache];
+    apiQueue = [[NSOperationQueue alloc] init];
+}
+
+- (void)tearDown {
+    [apiQueue cancelAllOperations];
+    [APIOperation setResponseCache:nil];
+    [APIOperation setSessionConfiguration:nil];
+    [[NSFileManager defaultManager] removeItemAtPath:cacheDirectory error:nil];
+    [super tearDown];
+}
+
+//  執行一個 GET，等 operation 結束，回傳每次 response block 收到的 version 與是否來自 cache
+- (NSArray*)runGETWithPolicy:(APICachePolicy)policy
+{
+    NSMutableArray *responses = [[NSMutableArray alloc] init];
+    APIOperation *api = [[APIOperation alloc] init];
+    api.cachePolicy = policy;
+    api.queue = [NSOperationQueue mainQueue];
+    [api GET:@"http://stub.local/users" param:@{@"size":@3} body:nil response:^(APIOperation *api, id responseObject) {
+        XCTAssert( [responseObject[@"results"] count] == 3 );
+        [responses addObject:@{ @"version":responseObject[@"version"], @"fromCache":@(api.fromCache) }];
+    } fail:^(APIOperation *api, NSError *error) {
+        XCTFail( @"%@", error );
+    }];
+    [self keyValueObservingExpectationForObject:api keyPath:@"isFinished" expectedValue:@YES];
+    [apiQueue addOperation: api ];
+    [self waitForExpectationsWithTimeout:5 handler:nil];
+    return responses;
+}
+
+- (void)testFreshResponseFromCache
+{
+    [APIStubURLProtocol setETag:@"v1"];
+    [APIStubURLProtocol setCacheControl:@"max-age=60"];
+    
+    NSArray *first = [self runGETWithPolicy:APICachePolicyDefault];
+    XCTAssertEqualObjects( first, (@[ @{ @"version":@"v1", @"fromCache":@NO } ]) );
+    
+    NSArray *second = [self runGETWithPolicy:APICachePolicyDefault];
+    XCTAssertEqualObjects( second, (@[ @{ @"version":@"v1", @"fromCache":@YES } ]) );
+    XCTAssert( [APIStubURLProtocol requestCount] == 1 );
+    
+    //  不使用 cache
+    [self runGETWithPolicy:APICachePolicyIgnoreCache];
+    XCTAssert( [APIStubURLProtocol requestCount] == 2 );
+}
+
+- (void)testRevalidateNotModified
+{
+    [APIStubURLProtocol setETag:@"v1"];
+    [APIStubURLProtocol setCacheControl:@"no-cache"];
+    
+    [self runGETWithPolicy:APICachePolicyDefault];
+    
+    //  送出 If-None-Match，收到 304，回傳 cache 的內容
+    NSArray *second = [self runGETWithPolicy:APICachePolicyDefault];
+    XCTAssertEqualObjects( second, (@[ @{ @"version":@"v1", @"fromCache":@YES } ]) );
+    XCTAssert( [APIStubURLProtocol requestCount] == 2 );
+}
+
+- (void)testRevalidateChanged
+{
+    [APIStubURLProtocol setETag:@"v1"];
+    [APIStubURLProtocol setCacheControl:@"no-cache"];
+    [self runGETWithPolicy:APICachePolicyDefault];
+    
+    [APIStubURLProtocol setETag:@"v2"];
+    NSArray *second = [self runGETWithPolicy:APICachePolicyDefault];
+    XCTAssertEqualObjects( second, (@[ @{ @"version":@"v2", @"fromCache":@NO } ]) );
+    
+    //  新的內容有存起來
+    [APIStubURLProtocol setCacheControl:@"max-age=60"];
+    NSArray *third = [self runGETWithPolicy:APICachePolicyDefault];
+    XCTAssertEqualObjects( third[0][@"version"], @"v2" );
+}
+
+- (void)testStaleWhileRevalidate
+{
+    [APIStubURLProtocol setETag:@"v1"];
+    [APIStubURLProtocol setCacheControl:@"max-age=0"];
+    [self runGETWithPolicy:APICachePolicyDefault];
+    
+    //  先回傳舊的，重新驗證後內容有變，再回傳一次
+    [APIStubURLProtocol setETag:@"v2"];
+    NSArray *second = [self runGETWithPolicy:APICachePolicyStaleWhileRevalidate];
+    XCTAssertEqualObjects( second, (@[ @{ @"version":@"v1", @"fromCache":@YES }, @{ @"version":@"v2", @"fromCache":@NO } ]) );
+    
+    //  內容沒變，只回傳一次
+    NSArray *third = [self runGETWithPolicy:APICachePolicyStaleWhileRevalidate];
+    XCTAssertEqualObjects( third, (@[ @{ @"version":@"v2", @"fromCache":@YES } ]) );
+    XCTAssert( [APIStubURLProtocol requestCount] == 3 );
+}
+
+- (void)testStaleWhileRevalidateDirective
+{
+    [APIStubURLProtocol setETag:@"v1"];
+    [APIStubURLProtocol setCacheControl:@"max-age=0, stale-while-revalidate=60"];
+    [self runGETWithPolicy:APICachePolicyDefault];
+    
+    NSArray *second = [self runGETWithPolicy:APICachePolicyDefault];
+    XCTAssertEqualObjects( second, (@[ @{ @"version":@"v1", @"fromCache":@YES } ]) );
+    XCTAssert( [APIStubURLProtocol requestCount] == 2 );
+}
+
+- (void)testNoStore
+{
+    [APIStubURLProtocol setETag:@"v1"];
+    [APIStubURLProtocol setCacheControl:@"no-store"];
+    [self runGETWithPolicy:APICachePolicyDefault];
+    [self runGETWithPolicy:APICachePolicyDefault];
+    XCTAssert( [APIStubURLProtocol requestCount] == 2 );
+    XCTAssert( cache.currentSize == 0 );
+}
+
+//  同時送出相同的 GET，只會有一個 request
+- (void)testCoalesceIdenticalRequests
+{
+    [APIOperation setResponseCache:nil];
+    NSInteger count = 5;
+    __block NSInteger responded = 0;
+    XCTestExpectation *expectation = [self expectationWithDescription:@"response"];
+    for ( NSInteger i=0; i<count+1; i++ ) {
+        APIOperation *api = [[APIOperation alloc] init];
+        api.queue = [NSOperationQueue mainQueue];
+        //  最後一個參數不同
+        NSDictionary *param = i < count ? @{@"latency":@200} : @{@"latency":@200, @"n":@1};
+        [api GET:@"http://stub.local/users" param:param body:nil response:^(APIOperation *api, id responseObject) {
+            XCTAssert( [responseObject[@"results"] count] == 10 );
+            if ( ++responded == count + 1 ) {
+                [expectation fulfill];
+            }
+        } fail:^(APIOperation *api, NSError *error) {
+            XCTFail( @"%@", error );
+        }];
+        [apiQueue addOperation: api ];
+    }
+    [self waitForExpectationsWithTimeout:5 handler:nil];
+    XCTAssert( [APIStubURLProtocol requestCount] == 2 );
+}
+
+//  合併的 request，cancel 其中一個不影響其他的
+- (void)testCancelCoalescedRequest
+{
+    [APIOperation setResponseCache:nil];
+    XCTestExpectation *expectation = [self expectationWithDescription:@"response"];
+    APIOperation *api1 = [[APIOperation alloc] init];
+    [api1 GET:@"http://stub.local/users" param:@{@"latency":@200} body:nil response:^(APIOperation *api, id responseObject) {
+        XCTFail( @"cancelled" );
+    } fail:^(APIOperation *api, NSError *error) {
+        XCTFail( @"cancelled" );
+    }];
+    APIOperation *api2 = [[APIOperation alloc] init];
+    [api2 GET:@"http://stub.local/users" param:@{@"latency":@200} body:nil response:^(APIOperation *api, id responseObject) {
+        [expectation fulfill];
+    } fail:^(APIOperation *api, NSError *error) {
+        XCTFail( @"%@", error );
+    }];
+    [apiQueue addOperation: api1 ];
+    [apiQueue addOperation: api2 ];
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(0.05 * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+        [api1 cancel];
+    });
+    [self waitForExpectationsWithTimeout:5 handler:nil];
+    XCTAssert( api1.isFinished );
+    XCTAssert( [APIStubURLProtocol requestCount] == 1 );
+}
+
+- (void)testCapacityAndPersistence
+{
+    APIResponseCache *smallCache = [[APIResponseCache alloc] initWithDirectory:cacheDirectory capacity:1000];
+    NSHTTPURLResponse *response = [[NSHTTPURLResponse alloc] initWithURL:[NSURL URLWithString:@"http://stub.local/"] statusCode:200 HTTPVersion:@"HTTP/1.1" headerFields:@{ @"ETag":@"v1" }];
+    NSData *body = [NSMutableData dataWithLength:400];
+    
+    [smallCache storeResponse:response data:body forKey:@"a"];
+    [smallCache storeResponse:response data:body forKey:@"b"];
+    //  讀過 a，b 變成最久沒用到的
+    XCTAssert( [smallCache dataForEntry:[smallCache entryForKey:@"a"]] != nil );
+    [smallCache storeResponse:response data:body forKey:@"c"];
+    
+    XCTAssert( smallCache.currentSize <= 1000 );
+    XCTAssert( [smallCache entryForKey:@"a"] != nil );
+    XCTAssert( [smallCache entryForKey:@"b"] == nil );
+    XCTAssert( [smallCache entryForKey:@"c"] != nil );
+    
+    //  超過容量的不存
+    XCTAssert( [smallCache storeResponse:response data:[NSMutableData dataWithLength:2000] forKey:@"d"] == nil );
+    
+    //  重新開啟後還在
+    APIResponseCache *reopened = [[APIResponseCache alloc] initWithDirectory:cacheDirectory capacity:1000];
+    APICacheEntry *entry = [reopened entryForKey:@"c"];
+    XCTAssertEqualObjects( entry.etag, @"v1" );
+    XCTAssert( [[reopened dataForEntry:entry] length] == 400 );
+}
+
+@end
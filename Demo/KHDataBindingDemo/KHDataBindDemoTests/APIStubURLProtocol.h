@@ -0,0 +1,46 @@
+//
+//  APIStubURLProtocol.h
+//  KHDataBindDemo
+//
+//  Created by Calvin Huang on 2017/3/10.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ *  本機的假 server，http://stub.local/ 的 request 都由這裡回應
+ *
+ *  query 可以帶
+ *  latency   回應前的延遲 (ms)
+ *  chunks    body 拆成幾段送
+ *  interval  每段間隔 (ms)
+ *  size      results 陣列長度
+ *  encoding  gzip 或 deflate，body 壓縮後再拆段
+ *  malformed 1 的話，results 中間的元素格式錯誤，2 的話 results 最後多一個 ','
+ *
+ *  回應是 { "version": etag, "results": [ { "id":0, "name":"user 0" }, ... ] }
+ */
+@interface APIStubURLProtocol : NSURLProtocol
+
+//  有設定的話回應會帶 ETag，request 的 If-None-Match 相同時回 304
++ (void)setETag:(NSString*)etag;
++ (void)setCacheControl:(NSString*)cacheControl;
+
+//  依 request 的順序 (從 0 開始) 決定延遲秒數，有設定的話取代 query 的 latency
+//  延遲超過 request 的 timeoutInterval 的話，在 timeout 時以 NSURLErrorTimedOut 失敗
++ (void)setLatencyBlock:(NSTimeInterval(^)(NSInteger requestIndex))latencyBlock;
+//  依 request 的順序決定 status code，小於 0 表示連線中斷
++ (void)setStatusBlock:(NSInteger(^)(NSInteger requestIndex))statusBlock;
+
+//  最後收到的 request
++ (NSURLRequest*)lastRequest;
+//  最後收到的 request body，session 會把 HTTPBody 換成 stream，這裡讀出來
++ (NSData*)lastRequestBody;
+
+//  收到的 request 數 (不含 cancel 掉的)
++ (NSInteger)requestCount;
+
++ (void)reset;
+
+@end
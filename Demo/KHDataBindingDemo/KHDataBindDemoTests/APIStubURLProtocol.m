@@ -0,0 +1,246 @@
+//
+//  APIStubURLProtocol.m
+//  KHDataBindDemo
+//
+//  Created by Calvin Huang on 2017/3/10.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import "APIStubURLProtocol.h"
+#import "APICompression.h"
+
+static NSString *stubETag = nil;
+static NSString *stubCacheControl = nil;
+static NSInteger stubRequestCount = 0;
+static NSTimeInterval(^stubLatencyBlock)(NSInteger) = nil;
+static NSInteger(^stubStatusBlock)(NSInteger) = nil;
+static NSURLRequest *stubLastRequest = nil;
+static NSData *stubLastRequestBody = nil;
+
+@implementation APIStubURLProtocol
+{
+    NSArray *_chunks;
+    NSTimeInterval _interval;
+    NSInteger _sentChunk;
+    NSInteger _requestIndex;
+}
+
++ (void)setETag:(NSString*)etag
+{
+    @synchronized(self) {
+        stubETag = [etag copy];
+    }
+}
+
++ (void)setCacheControl:(NSString*)cacheControl
+{
+    @synchronized(self) {
+        stubCacheControl = [cacheControl copy];
+    }
+}
+
++ (void)setLatencyBlock:(NSTimeInterval(^)(NSInteger requestIndex))latencyBlock
+{
+    @synchronized(self) {
+        stubLatencyBlock = [latencyBlock copy];
+    }
+}
+
++ (void)setStatusBlock:(NSInteger(^)(NSInteger requestIndex))statusBlock
+{
+    @synchronized(self) {
+        stubStatusBlock = [statusBlock copy];
+    }
+}
+
++ (NSURLRequest*)lastRequest
+{
+    @synchronized(self) {
+        return stubLastRequest;
+    }
+}
+
++ (NSData*)lastRequestBody
+{
+    @synchronized(self) {
+        return stubLastRequestBody;
+    }
+}
+
++ (NSData*)bodyOfRequest:(NSURLRequest*)request
+{
+    if ( request.HTTPBody ) {
+        return request.HTTPBody;
+    }
+    NSInputStream *stream = request.HTTPBodyStream;
+    if ( stream == nil ) {
+        return nil;
+    }
+    NSMutableData *body = [[NSMutableData alloc] init];
+    uint8_t buffer[4096];
+    [stream open];
+    NSInteger length = 0;
+    while ( ( length = [stream read:buffer maxLength:sizeof(buffer)] ) > 0 ) {
+        [body appendBytes:buffer length:length];
+    }
+    [stream close];
+    return body;
+}
+
++ (NSInteger)requestCount
+{
+    @synchronized(self) {
+        return stubRequestCount;
+    }
+}
+
++ (void)reset
+{
+    @synchronized(self) {
+        stubETag = nil;
+        stubCacheControl = nil;
+        stubRequestCount = 0;
+        stubLatencyBlock = nil;
+        stubStatusBlock = nil;
+        stubLastRequest = nil;
+        stubLastRequestBody = nil;
+    }
+}
+
++ (BOOL)canInitWithRequest:(NSURLRequest *)request
+{
+    return [request.URL.host isEqualToString:@"stub.local"];
+}
+
++ (NSURLRequest *)canonicalRequestForRequest:(NSURLRequest *)request
+{
+    return request;
+}
+
++ (NSDictionary*)queryOfURL:(NSURL*)url
+{
+    NSMutableDictionary *query = [[NSMutableDictionary alloc] init];
+    for ( NSURLQueryItem *item in [NSURLComponents componentsWithURL:url resolvingAgainstBaseURL:NO].queryItems ) {
+        query[item.name] = item.value;
+    }
+    return query;
+}
+
+- (void)startLoading
+{
+    NSDictionary *query = [APIStubURLProtocol queryOfURL:self.request.URL];
+    NSInteger size = query[@"size"] ? [query[@"size"] integerValue] : 10;
+    NSInteger chunkCount = MAX( 1, [query[@"chunks"] integerValue] );
+    NSTimeInterval latency = [query[@"latency"] doubleValue] / 1000.0;
+
+    NSString *etag = nil;
+    @synchronized([APIStubURLProtocol class]) {
+        _requestIndex = stubRequestCount++;
+        etag = stubETag;
+        stubLastRequest = self.request;
+        stubLastRequestBody = [APIStubURLProtocol bodyOfRequest:self.request];
+        if ( stubLatencyBlock ) {
+            latency = stubLatencyBlock( _requestIndex );
+        }
+    }
+
+    NSData *body = [NSData data];
+    NSString *ifNoneMatch = [self.request valueForHTTPHeaderField:@"If-None-Match"];
+    if ( etag == nil || ![ifNoneMatch isEqualToString:etag] ) {
+        NSMutableArray *users = [[NSMutableArray alloc] initWithCapacity: size ];
+        for ( NSInteger i=0; i<size; i++ ) {
+            [users addObject:@{ @"id":@(i), @"name":[NSString stringWithFormat:@"user %ld", (long)i] }];
+        }
+        body = [NSJSONSerialization dataWithJSONObject:@{ @"version":etag ? etag : @"", @"results":users } options:0 error:nil];
+        NSInteger malformed = [query[@"malformed"] integerValue];
+        if ( malformed == 1 ) {
+            NSString *name = [NSString stringWithFormat:@"\"user %ld\"", (long)size / 2];
+            NSString *json = [[NSString alloc] initWithData:body encoding:NSUTF8StringEncoding];
+            json = [json stringByReplacingOccurrencesOfString:name withString:[name stringByAppendingString:@"x"]];
+            body = [json dataUsingEncoding:NSUTF8StringEncoding];
+        }
+        else if ( malformed == 2 ) {
+            //  results 的最後一個元素後面
+            NSMutableString *json = [[NSMutableString alloc] initWithData:body encoding:NSUTF8StringEncoding];
+            NSRange range = [json rangeOfString:@"}]" options:NSBackwardsSearch];
+            [json insertString:@"," atIndex:range.location + 1];
+            body = [json dataUsingEncoding:NSUTF8StringEncoding];
+        }
+        if ( [query[@"encoding"] isEqualToString:@"gzip"] ) {
+            body = [APICompression gzipData:body];
+        }
+        else if ( [query[@"encoding"] isEqualToString:@"deflate"] ) {
+            body = [APICompression deflateData:body];
+        }
+    }
+
+    NSMutableArray *chunks = [[NSMutableArray alloc] initWithCapacity: chunkCount ];
+    NSUInteger chunkLength = MAX( 1, (body.length + chunkCount - 1) / chunkCount );
+    for ( NSUInteger offset=0; offset<body.length; offset+=chunkLength ) {
+        [chunks addObject:[body subdataWithRange:NSMakeRange(offset, MIN(chunkLength, body.length - offset))]];
+    }
+    _chunks = chunks;
+    _interval = query[@"interval"] ? [query[@"interval"] doubleValue] / 1000.0 : 0.01;
+
+    //  client 的 method 要在 startLoading 的 thread 呼叫，所以用 performSelector:afterDelay:
+    //  延遲超過 request 的 timeout 時，跟真的連線一樣在 timeout 時失敗
+    NSTimeInterval timeout = self.request.timeoutInterval;
+    if ( timeout > 0 && latency > timeout ) {
+        [self performSelector:@selector(sendTimeout) withObject:nil afterDelay:timeout];
+        return;
+    }
+    [self performSelector:@selector(sendResponse) withObject:nil afterDelay:latency];
+}
+
+- (void)sendTimeout
+{
+    [self.client URLProtocol:self didFailWithError:[NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorTimedOut userInfo:nil]];
+}
+
+- (void)sendResponse
+{
+    NSMutableDictionary *headers = [[NSMutableDictionary alloc] initWithDictionary:@{ @"Content-Type":@"application/json" }];
+    NSString *encoding = [APIStubURLProtocol queryOfURL:self.request.URL][@"encoding"];
+    if ( encoding ) {
+        headers[@"Content-Encoding"] = encoding;
+    }
+    NSInteger statusCode = 200;
+    @synchronized([APIStubURLProtocol class]) {
+        if ( stubStatusBlock ) {
+            statusCode = stubStatusBlock( _requestIndex );
+        }
+        if ( stubETag ) {
+            headers[@"ETag"] = stubETag;
+            if ( [[self.request valueForHTTPHeaderField:@"If-None-Match"] isEqualToString:stubETag] ) {
+                statusCode = 304;
+            }
+        }
+        if ( stubCacheControl ) {
+            headers[@"Cache-Control"] = stubCacheControl;
+        }
+    }
+    if ( statusCode < 0 ) {
+        [self.client URLProtocol:self didFailWithError:[NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorNetworkConnectionLost userInfo:nil]];
+        return;
+    }
+    NSHTTPURLResponse *response = [[NSHTTPURLResponse alloc] initWithURL:self.request.URL statusCode:statusCode HTTPVersion:@"HTTP/1.1" headerFields:headers];
+    [self.client URLProtocol:self didReceiveResponse:response cacheStoragePolicy:NSURLCacheStorageNotAllowed];
+    [self sendChunk];
+}
+
+- (void)sendChunk
+{
+    if ( _sentChunk >= _chunks.count ) {
+        [self.client URLProtocolDidFinishLoading:self];
+        return;
+    }
+    [self.client URLProtocol:self didLoadData:_chunks[_sentChunk++]];
+    [self performSelector:@selector(sendChunk) withObject:nil afterDelay:_sentChunk < _chunks.count ? _interval : 0];
+}
+
+- (void)stopLoading
+{
+    [NSObject cancelPreviousPerformRequestsWithTarget:self];
+}
+
+@end
@@ -0,0 +1,181 @@
+//
+//  Base64UtilityTest.m
+//  KHDataBindDemo
+//
+//  Created by Calvin Huang on 2017/3/13.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import "Base64Utility.h"
+
+@interface Base64UtilityTest : XCTestCase
+
+@end
+
+@implementation Base64UtilityTest
+
+- (NSData*)randomDataWithLength:(NSUInteger)length
+{
+    NSMutableData *data = [[NSMutableData alloc] initWithLength: length ];
+    arc4random_buf( data.mutableBytes, length );
+    return data;
+}
+
+//  原本逐 byte format 的寫法
+- (NSString*)referenceHexFromData:(NSData*)data uppercase:(BOOL)uppercase
+{
+    NSMutableString *hex = [[NSMutableString alloc] init];
+    const uint8_t *bytes = data.bytes;
+    for ( NSUInteger i=0; i<data.length; i++ ) {
+        [hex appendFormat: uppercase ? @"%02X" : @"%02x", bytes[i]];
+    }
+    return hex;
+}
+
+#pragma mark - Fuzz
+
+//  長度涵蓋 SIMD 的整段與剩下的尾巴，起點也故意不對齊
+- (void)testHexFuzz
+{
+    for ( int round=0; round<2000; round++ ) {
+        NSUInteger length = arc4random_uniform( 300 );
+        NSUInteger offset = arc4random_uniform( 16 );
+        NSData *buffer = [self randomDataWithLength:length + offset];
+        NSData *data = [buffer subdataWithRange:NSMakeRange(offset, length)];
+        BOOL uppercase = arc4random_uniform( 2 );
+
+        NSString *hex = [Base64Utility hexStringFromData:data uppercase:uppercase];
+        XCTAssertEqualObjects( hex, [self referenceHexFromData:data uppercase:uppercase] );
+        XCTAssertEqualObjects( [Base64Utility dataFromHexString:hex], data );
+
+        //  塞一個不合法的字元
+        if ( length > 0 ) {
+            char *chars = strdup( hex.UTF8String );
+            chars[arc4random_uniform( (uint32_t)length * 2 )] = "gGz/:@` "[arc4random_uniform( 8 )];
+            uint8_t out[300];
+            XCTAssert( Base64UtilityHexDecode( chars, length * 2, out ) == -1, @"%s", chars );
+            free( chars );
+        }
+    }
+}
+
+- (void)testBase64Fuzz
+{
+    for ( int round=0; round<2000; round++ ) {
+        NSUInteger length = arc4random_uniform( 300 );
+        NSUInteger offset = arc4random_uniform( 16 );
+        NSData *buffer = [self randomDataWithLength:length + offset];
+        NSData *data = [buffer subdataWithRange:NSMakeRange(offset, length)];
+
+        NSString *base64 = [Base64Utility base64StringFromData:data];
+        XCTAssertEqualObjects( base64, [data base64EncodedStringWithOptions:0] );
+        XCTAssertEqualObjects( [Base64Utility dataFromBase64String:base64], data );
+
+        //  沒有 padding 也可以
+        NSString *unpadded = [base64 stringByTrimmingCharactersInSet:[NSCharacterSet characterSetWithCharactersInString:@"="]];
+        uint8_t out[300];
+        XCTAssert( Base64UtilityBase64Decode( unpadded.UTF8String, unpadded.length, out ) == (long)length );
+        XCTAssert( memcmp( out, data.bytes, length ) == 0 );
+
+        if ( unpadded.length > 0 ) {
+            char *chars = strdup( base64.UTF8String );
+            chars[arc4random_uniform( (uint32_t)unpadded.length )] = "-_ \n*.\x80"[arc4random_uniform( 7 )];
+            XCTAssert( Base64UtilityBase64Decode( chars, base64.length, out ) == -1, @"%s", chars );
+            free( chars );
+        }
+    }
+}
+
+#pragma mark - Wrapper
+
+- (void)testWrapperCompatibility
+{
+    XCTAssertEqualObjects( [Base64Utility stringFromByte:0xab], @"ab" );
+    XCTAssertEqualObjects( [Base64Utility stringFromByte:0x05], @"05" );
+    XCTAssertEqualObjects( [Base64Utility hexStringFromData:[NSData data]], @"" );
+
+    //  原本就會略過分隔字元
+    uint8_t bytes[] = { 0xde, 0xad, 0xbe, 0xef };
+    NSData *expect = [NSData dataWithBytes:bytes length:4];
+    XCTAssertEqualObjects( [Base64Utility dataFromHexString:@"DEADBEEF"], expect );
+    XCTAssertEqualObjects( [Base64Utility dataFromHexString:@"de ad be ef"], expect );
+    XCTAssertEqualObjects( [Base64Utility dataFromHexString:@"<deadbeef>"], expect );
+
+    XCTAssertEqualObjects( [Base64Utility md5:@"abc"], @"900150983CD24FB0D6963F7D28E17F72" );
+    XCTAssertEqualObjects( [Base64Utility md5Data:[@"abc" dataUsingEncoding:NSUTF8StringEncoding]], @"900150983CD24FB0D6963F7D28E17F72" );
+
+    XCTAssertEqualObjects( [Base64Utility base64Encode:@"中文 base64"], @"5Lit5paHIGJhc2U2NA==" );
+    XCTAssertEqualObjects( [Base64Utility base64Decode:@"5Lit5paHIGJhc2U2NA=="], @"中文 base64" );
+    XCTAssertNil( [Base64Utility base64Decode:@"5Lit*5paH"] );
+}
+
+//  nil 與空字串不能 crash，回傳空的結果
+- (void)testEmptyInput
+{
+    NSString *nilString = nil;
+    XCTAssertEqualObjects( [Base64Utility dataFromHexString:nilString], [NSData data] );
+    XCTAssertEqualObjects( [Base64Utility dataFromHexString:@""], [NSData data] );
+    XCTAssertEqualObjects( [Base64Utility dataFromBase64String:nilString], [NSData data] );
+    XCTAssertEqualObjects( [Base64Utility dataFromBase64String:@""], [NSData data] );
+    XCTAssertEqualObjects( [Base64Utility base64Decode:nilString], @"" );
+    XCTAssertEqualObjects( [Base64Utility base64StringFromData:[NSData data]], @"" );
+}
+
+//  wrapper 跟原本一樣要有 padding，C 的 decode 可以沒有
+- (void)testBase64PaddingStrictness
+{
+    XCTAssertEqualObjects( [Base64Utility dataFromBase64String:@"YWI="], [@"ab" dataUsingEncoding:NSUTF8StringEncoding] );
+    XCTAssertNil( [Base64Utility dataFromBase64String:@"YWI"] );
+    XCTAssertNil( [[NSData alloc] initWithBase64EncodedString:@"YWI" options:0] );
+    uint8_t out[3];
+    XCTAssert( Base64UtilityBase64Decode( "YWI", 3, out ) == 2 );
+}
+
+#pragma mark - Benchmark
+
+//  8MB 的資料，印出每種轉換的 MB/s
+- (void)testThroughput
+{
+    NSUInteger length = 8 * 1024 * 1024;
+    NSData *data = [self randomDataWithLength:length];
+    char *text = malloc( length * 2 );
+    uint8_t *back = malloc( length );
+    double megabytes = length / 1048576.0;
+
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    Base64UtilityHexEncode( data.bytes, length, text, NO );
+    NSLog(@"hex encode    %.0f MB/s", megabytes / ( CFAbsoluteTimeGetCurrent() - start ) );
+
+    start = CFAbsoluteTimeGetCurrent();
+    XCTAssert( Base64UtilityHexDecode( text, length * 2, back ) == (long)length );
+    NSLog(@"hex decode    %.0f MB/s", megabytes / ( CFAbsoluteTimeGetCurrent() - start ) );
+    XCTAssert( memcmp( back, data.bytes, length ) == 0 );
+
+    start = CFAbsoluteTimeGetCurrent();
+    size_t encoded = Base64UtilityBase64Encode( data.bytes, length, text );
+    NSLog(@"base64 encode %.0f MB/s", megabytes / ( CFAbsoluteTimeGetCurrent() - start ) );
+
+    start = CFAbsoluteTimeGetCurrent();
+    XCTAssert( Base64UtilityBase64Decode( text, encoded, back ) == (long)length );
+    NSLog(@"base64 decode %.0f MB/s", megabytes / ( CFAbsoluteTimeGetCurrent() - start ) );
+
+    //  比較：原本的寫法只跑 1/64 的資料
+    NSData *slice = [data subdataWithRange:NSMakeRange(0, length / 64)];
+    start = CFAbsoluteTimeGetCurrent();
+    [self referenceHexFromData:slice uppercase:NO];
+    NSLog(@"appendFormat  %.0f MB/s", megabytes / 64 / ( CFAbsoluteTimeGetCurrent() - start ) );
+
+    free( text );
+    free( back );
+
+    //  大量 digest 轉 hex 的情況
+    NSData *digest = [self randomDataWithLength:16];
+    [self measureBlock:^{
+        for ( int i=0; i<100000; i++ ) {
+            [Base64Utility hexStringFromData:digest];
+        }
+    }];
+}
+
+@end
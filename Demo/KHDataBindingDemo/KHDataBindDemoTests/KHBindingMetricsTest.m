@@ -0,0 +1,117 @@
+//
+//  KHBindingMetricsTest.m
+//  KHDataBindDemo
+//
+//  Created by Calvin Huang on 2017/3/12.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import <UIKit/UIKit.h>
+#import <XCTest/XCTest.h>
+#import <objc/runtime.h>
+#import "KHBindingMetrics.h"
+
+@interface KHBindingMetricsTest : XCTestCase
+
+@end
+
+@implementation KHBindingMetricsTest
+{
+    KHBindingMetrics *metrics;
+}
+
+- (void)setUp {
+    [super setUp];
+    metrics = [[KHBindingMetrics alloc] init];
+    metrics.signpostEnabled = NO;
+}
+
+- (void)tearDown {
+    [super tearDown];
+}
+
+//  測試用的 cell class，名稱一樣就回傳同一個
+- (Class)cellClassAtIndex:(NSInteger)index
+{
+    NSString *name = [NSString stringWithFormat:@"KHMetricsTestCell%ld", (long)index];
+    Class cls = NSClassFromString( name );
+    if ( cls == nil ) {
+        cls = objc_allocateClassPair( [UITableViewCell class], name.UTF8String, 0 );
+        objc_registerClassPair( cls );
+    }
+    return cls;
+}
+
+- (void)testCounter
+{
+    [metrics increment:KHBindingCounterSizeCacheHit];
+    [metrics increment:KHBindingCounterSizeCacheHit];
+    [metrics add:5 counter:KHBindingCounterUpdateDeferred];
+    XCTAssert( [metrics valueOfCounter:KHBindingCounterSizeCacheHit] == 2 );
+    XCTAssert( [metrics valueOfCounter:KHBindingCounterUpdateDeferred] == 5 );
+    XCTAssert( [metrics valueOfCounter:KHBindingCounterFullReload] == 0 );
+
+    //  多個 thread 同時計數
+    dispatch_apply( 1000, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t i) {
+        [self->metrics increment:KHBindingCounterMappingResolve];
+    });
+    XCTAssert( [metrics valueOfCounter:KHBindingCounterMappingResolve] == 1000 );
+
+    [metrics reset];
+    XCTAssert( [metrics valueOfCounter:KHBindingCounterSizeCacheHit] == 0 );
+}
+
+- (void)testInterval
+{
+    KHMetricsIntervalToken token = [metrics beginInterval:KHBindingIntervalOnLoad];
+    [NSThread sleepForTimeInterval:0.01];
+    [metrics endInterval:KHBindingIntervalOnLoad token:token cellClass:[UITableViewCell class]];
+
+    NSDictionary *snapshot = [metrics snapshot];
+    XCTAssertEqualObjects( snapshot[@"onLoadCount"], @1 );
+    XCTAssert( [snapshot[@"onLoadTime"] doubleValue] >= 0.01 );
+    XCTAssertEqualObjects( snapshot[@"cellConfigureCount"], @0 );
+    NSDictionary *cellStat = snapshot[@"cellClasses"][@"UITableViewCell"];
+    XCTAssertEqualObjects( cellStat[@"onLoadCount"], @1 );
+    XCTAssert( [cellStat[@"onLoadTime"] doubleValue] == [snapshot[@"onLoadTime"] doubleValue] );
+}
+
+//  每個 class 佔一個 slot，超過 64 個的記到 (other)
+- (void)testCellClassSlot
+{
+    for ( NSInteger i=0; i<70; i++ ) {
+        Class cls = [self cellClassAtIndex:i];
+        for ( NSInteger n=0; n<=i % 3; n++ ) {
+            KHMetricsIntervalToken token = [metrics beginInterval:KHBindingIntervalCellConfigure];
+            [metrics endInterval:KHBindingIntervalCellConfigure token:token cellClass:cls];
+        }
+    }
+    NSDictionary *classes = [metrics snapshot][@"cellClasses"];
+    XCTAssert( classes.count == 65 );
+    XCTAssertNotNil( classes[@"(other)"] );
+
+    //  先佔到 slot 的 class 計數正確
+    NSUInteger total = 0;
+    for ( NSString *className in classes ) {
+        total += [classes[className][@"cellConfigureCount"] unsignedIntegerValue];
+    }
+    XCTAssert( total == [[metrics snapshot][@"cellConfigureCount"] unsignedIntegerValue] );
+    XCTAssertEqualObjects( classes[@"KHMetricsTestCell2"][@"cellConfigureCount"], @3 );
+
+    //  reset 之後 class 還在，計數歸零
+    [metrics reset];
+    classes = [metrics snapshot][@"cellClasses"];
+    XCTAssertEqualObjects( classes[@"KHMetricsTestCell2"][@"cellConfigureCount"], @0 );
+    XCTAssertNil( classes[@"(other)"] );
+}
+
+- (void)testSnapshotKeys
+{
+    NSSet *keys = [NSSet setWithArray:[[metrics snapshot] allKeys]];
+    NSArray *expected = @[ @"sizeCacheHit", @"sizeCacheMiss", @"mappingResolve", @"fullReload", @"incrementalUpdate",
+                           @"imageCacheHit", @"imageCacheMiss", @"updateApplied", @"updateDeferred",
+                           @"cellConfigureCount", @"cellConfigureTime", @"onLoadCount", @"onLoadTime", @"cellClasses" ];
+    XCTAssertEqualObjects( keys, [NSSet setWithArray:expected] );
+}
+
+@end
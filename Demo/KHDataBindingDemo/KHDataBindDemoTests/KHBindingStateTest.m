@@ -0,0 +1,164 @@
+//
+//  KHBindingStateTest.m
+//  KHDataBindDemo
+//
+//  Created by Calvin Huang on 2017/3/12.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import <UIKit/UIKit.h>
+#import <XCTest/XCTest.h>
+#import "KHDataBinding.h"
+
+@interface KHBindingStateTest : XCTestCase
+
+@end
+
+@implementation KHBindingStateTest
+{
+    KHTableDataBinding *dataBinder;
+}
+
+- (void)setUp {
+    [super setUp];
+    UITableView *tableView = [[UITableView alloc] initWithFrame:(CGRect){0,0,320,480} style:UITableViewStylePlain];
+    dataBinder = [[KHTableDataBinding alloc] initWithView:tableView delegate:nil registerClass:nil];
+}
+
+- (void)tearDown {
+    [super tearDown];
+}
+
+- (NSMutableArray*)bindModelsWithCount:(NSInteger)count
+{
+    NSMutableArray *models = [dataBinder createBindArray];
+    for ( NSInteger i=0; i<count; i++ ) {
+        UITableViewCellModel *model = [[UITableViewCellModel alloc] init];
+        model.text = [NSString stringWithFormat:@"row %ld", (long)i];
+        [models addObject:model];
+    }
+    return models;
+}
+
+//  encode 之後 decode，內容一樣
+- (void)testEncodeDecode
+{
+    KHBindingState *state = [[KHBindingState alloc] init];
+    state.containerWidth = 375;
+    state.sectionIdentifiers = @[ @[ @"a", @"b" ], @[ @"c" ] ];
+    state.anchorIdentifier = @"b";
+    state.anchorOffset = 12.5;
+    state.imageURLs = @[ @"https://example.com/a.png" ];
+    [state setWidth:375 height:80 forIdentifier:@"a"];
+    [state setWidth:375 height:44 forIdentifier:@"b"];
+    [state setWidth:375 height:120 forIdentifier:@"a"];
+    XCTAssert( state.sizeCount == 2 );
+
+    NSError *error = nil;
+    KHBindingState *decoded = [[KHBindingState alloc] initWithData:[state encodedData] error:&error];
+    XCTAssertNil( error );
+    XCTAssert( decoded.containerWidth == 375 );
+    XCTAssertEqualObjects( decoded.sectionIdentifiers, state.sectionIdentifiers );
+    XCTAssertEqualObjects( decoded.anchorIdentifier, @"b" );
+    XCTAssert( decoded.anchorOffset == 12.5 );
+    XCTAssertEqualObjects( decoded.imageURLs, state.imageURLs );
+
+    double width = 0, height = 0;
+    XCTAssertTrue( [decoded getWidth:&width height:&height forIdentifier:@"a"] );
+    XCTAssert( width == 375 && height == 120 );
+    XCTAssertFalse( [decoded getWidth:&width height:&height forIdentifier:@"c"] );
+}
+
+- (void)testBadData
+{
+    NSError *error = nil;
+    XCTAssertNil( [[KHBindingState alloc] initWithData:[@"not a plist" dataUsingEncoding:NSUTF8StringEncoding] error:&error] );
+    XCTAssertEqualObjects( error.domain, KHBindingStateErrorDomain );
+}
+
+//  記下的 size 填入新的 binding，已經有 size 的不覆蓋
+- (void)testCaptureAndRestore
+{
+    dataBinder.stateIdentifierBlock = ^NSString *(UITableViewCellModel *model) {
+        return model.text;
+    };
+    NSMutableArray *models = [self bindModelsWithCount:5];
+    [dataBinder setCellHeight:80 model:models[0]];
+    [dataBinder setCellHeight:60 model:models[3]];
+
+    KHBindingState *state = [[KHBindingState alloc] initWithData:[[dataBinder captureState] encodedData] error:nil];
+    XCTAssert( state.sizeCount == 2 );
+    XCTAssert( [state.sectionIdentifiers[0] count] == 5 );
+
+    UITableView *tableView = [[UITableView alloc] initWithFrame:(CGRect){0,0,320,480} style:UITableViewStylePlain];
+    dataBinder = [[KHTableDataBinding alloc] initWithView:tableView delegate:nil registerClass:nil];
+    dataBinder.stateIdentifierBlock = ^NSString *(UITableViewCellModel *model) {
+        return model.text;
+    };
+    models = [self bindModelsWithCount:5];
+    [dataBinder setCellHeight:30 model:models[3]];
+
+    XCTAssert( [dataBinder restoreState:state] == 1 );
+    XCTAssert( [dataBinder getPairInfo:models[0]].cellSize.height == 80 );
+    XCTAssert( [dataBinder getPairInfo:models[3]].cellSize.height == 30 );
+    XCTAssert( [dataBinder getPairInfo:models[1]].cellSize.height == 0 );
+}
+
+//  compactPairStorage 時直接讀寫 slot 的 size，不產生 KHPairInfo
+- (void)testCaptureAndRestoreCompact
+{
+    NSString *(^identifierBlock)(UITableViewCellModel *) = ^NSString *(UITableViewCellModel *model) {
+        return model.text;
+    };
+    dataBinder.compactPairStorage = YES;
+    dataBinder.stateIdentifierBlock = identifierBlock;
+    NSMutableArray *models = [self bindModelsWithCount:5];
+    @autoreleasepool {
+        [dataBinder setCellHeight:80 model:models[0]];
+        [dataBinder setCellHeight:60 model:models[3]];
+    }
+    KHPairStore *store = dataBinder.pairStore;
+    KHBindingState *state = [dataBinder captureState];
+    XCTAssert( state.sizeCount == 2 );
+    XCTAssertNil( [store facadeAtSlot:[store slotOfModel:models[1]]] );
+
+    UITableView *tableView = [[UITableView alloc] initWithFrame:(CGRect){0,0,320,480} style:UITableViewStylePlain];
+    dataBinder = [[KHTableDataBinding alloc] initWithView:tableView delegate:nil registerClass:nil];
+    dataBinder.compactPairStorage = YES;
+    dataBinder.stateIdentifierBlock = identifierBlock;
+    models = [self bindModelsWithCount:5];
+    @autoreleasepool {
+        [dataBinder setCellHeight:30 model:models[3]];
+    }
+    store = dataBinder.pairStore;
+
+    XCTAssert( [dataBinder restoreState:state] == 1 );
+    NSUInteger slot = [store slotOfModel:models[0]];
+    XCTAssert( [store heightAtSlot:slot] == 80 );
+    XCTAssertNil( [store facadeAtSlot:slot] );
+    XCTAssert( [store heightAtSlot:[store slotOfModel:models[3]]] == 30 );
+    XCTAssert( [store heightAtSlot:[store slotOfModel:models[1]]] == 0 );
+}
+
+//  寬度不同的話不填 size
+- (void)testRestoreWithOtherWidth
+{
+    dataBinder.stateIdentifierBlock = ^NSString *(UITableViewCellModel *model) {
+        return model.text;
+    };
+    NSMutableArray *models = [self bindModelsWithCount:2];
+    KHBindingState *state = [[KHBindingState alloc] init];
+    state.containerWidth = 1024;
+    [state setWidth:1024 height:80 forIdentifier:@"row 0"];
+    XCTAssert( [dataBinder restoreState:state] == 0 );
+    XCTAssert( [dataBinder getPairInfo:models[0]].cellSize.height == 0 );
+}
+
+- (void)testIdentifierBlockRequired
+{
+    [self bindModelsWithCount:1];
+    XCTAssertThrows( [dataBinder captureState] );
+    XCTAssertThrows( [dataBinder restoreState:[[KHBindingState alloc] init]] );
+}
+
+@end
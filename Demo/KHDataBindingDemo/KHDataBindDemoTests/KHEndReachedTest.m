@@ -0,0 +1,135 @@
+//
+//  KHEndReachedTest.m
+//  KHDataBindDemo
+//
+//  Created by Calvin Huang on 2017/3/12.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import <UIKit/UIKit.h>
+#import <XCTest/XCTest.h>
+#import "KHDataBinding.h"
+
+@interface KHEndReachedTest : XCTestCase <KHDataBindingDelegate>
+
+@end
+
+@implementation KHEndReachedTest
+{
+    KHTableDataBinding *dataBinder;
+    NSMutableArray *models;
+    UIScrollView *scrollView;
+    CGFloat screenHeight;
+    NSInteger endReachedCount;
+    //  手動前進的時間，每次 scroll 一個 frame
+    CFTimeInterval clock;
+}
+
+- (void)setUp {
+    [super setUp];
+    UITableView *tableView = [[UITableView alloc] initWithFrame:(CGRect){0,0,320,480} style:UITableViewStylePlain];
+    dataBinder = [[KHTableDataBinding alloc] initWithView:tableView delegate:self registerClass:nil];
+    dataBinder.onEndReachedThresHold = 50;
+    models = [dataBinder createBindArray];
+    screenHeight = CGRectGetHeight([UIScreen mainScreen].bounds);
+    //  不是 binding 的 view，只拿來傳 offset 與 content size
+    scrollView = [[UIScrollView alloc] initWithFrame:(CGRect){0,0,320,screenHeight}];
+    scrollView.contentSize = CGSizeMake( 320, screenHeight * 20 );
+    endReachedCount = 0;
+    clock = 1000;
+    __weak KHEndReachedTest *weakSelf = self;
+    dataBinder.endReachedClock = ^CFTimeInterval{
+        KHEndReachedTest *strongSelf = weakSelf;
+        return strongSelf ? strongSelf->clock : 0;
+    };
+}
+
+- (void)tearDown {
+    [super tearDown];
+}
+
+- (void)onEndReached:(KHDataBinding *)dataBinding
+{
+    endReachedCount++;
+}
+
+- (void)scrollTo:(CGFloat)offset
+{
+    clock += 1.0 / 60;
+    scrollView.contentOffset = CGPointMake( 0, offset );
+    [dataBinder scrollViewDidScroll:scrollView];
+}
+
+- (CGFloat)bottomOffset
+{
+    return scrollView.contentSize.height - screenHeight;
+}
+
+//  觸發 onEndReached:，過一段時間資料才到
+- (void)loadPageWithLatency:(NSTimeInterval)latency
+{
+    [self scrollTo:[self bottomOffset]];
+    clock += latency;
+    UITableViewCellModel *model = [[UITableViewCellModel alloc] init];
+    [models addObject:model];
+    [self scrollTo:0];
+}
+
+- (void)testThresHold
+{
+    //  沒有 latency 的資料，就是 onEndReachedThresHold
+    XCTAssert( dataBinder.adaptiveThresHold == 50 );
+    [self loadPageWithLatency:0.05];
+    XCTAssert( dataBinder.endReachedLatencies.count == 1 );
+    XCTAssertEqualWithAccuracy( dataBinder.estimatedEndReachedLatency, 0.05, 1e-9 );
+
+    //  停一下再捲得很快，提前觸發，但不超過 kEndReachedMaxScreens 個畫面
+    clock += 0.6;
+    [self scrollTo:100];
+    [self scrollTo:100 + screenHeight * 4];
+    XCTAssert( dataBinder.adaptiveThresHold > 50 );
+    XCTAssert( dataBinder.adaptiveThresHold <= screenHeight * 6 + 0.5 );
+
+    dataBinder.adaptiveEndReached = NO;
+    XCTAssert( dataBinder.adaptiveThresHold == 50 );
+}
+
+//  快速捲動觸發之後慢下來，資料到之前不會再觸發一次
+- (void)testTriggerLatchesThresHold
+{
+    [self loadPageWithLatency:0.05];
+    XCTAssert( endReachedCount == 1 );
+
+    //  離底部 3 個畫面，快速捲動提前觸發
+    CGFloat offset = [self bottomOffset] - screenHeight * 3;
+    [self scrollTo:offset - screenHeight * 2];
+    [self scrollTo:offset];
+    XCTAssert( endReachedCount == 2 );
+
+    //  停下來，thresHold 回到 onEndReachedThresHold，再快速捲動
+    clock += 0.6;
+    [self scrollTo:offset];
+    XCTAssert( dataBinder.adaptiveThresHold == 50 );
+    [self scrollTo:offset + 10];
+    XCTAssert( endReachedCount == 2 );
+
+    //  捲回觸發的位置之外才會重設
+    [self scrollTo:0];
+    [self scrollTo:[self bottomOffset]];
+    XCTAssert( endReachedCount == 3 );
+}
+
+//  只保留最近 10 次的 latency
+- (void)testLatencyWindow
+{
+    for ( int i=0; i<12; i++ ) {
+        [self loadPageWithLatency:0.01];
+    }
+    XCTAssert( endReachedCount == 12 );
+    XCTAssert( dataBinder.endReachedLatencies.count == 10 );
+    for ( NSNumber *latency in dataBinder.endReachedLatencies ) {
+        XCTAssertEqualWithAccuracy( [latency doubleValue], 0.01, 1e-9 );
+    }
+}
+
+@end
@@ -0,0 +1,161 @@
+//
+//  KHGroupedArrayTest.m
+//  KHDataBindDemo
+//
+//  Created by Calvin Huang on 2017/3/12.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import <UIKit/UIKit.h>
+#import <XCTest/XCTest.h>
+#import "KHDataBinding.h"
+
+@interface KHGroupedArrayTest : XCTestCase
+
+@end
+
+@implementation KHGroupedArrayTest
+{
+    UITableView *tableView;
+    KHTableDataBinding *dataBinder;
+    id<NSCopying>(^firstLetter)(UITableViewCellModel *model);
+    NSComparator byKey;
+}
+
+- (void)setUp {
+    [super setUp];
+    tableView = [[UITableView alloc] initWithFrame:(CGRect){0,0,320,480} style:UITableViewStylePlain];
+    dataBinder = [[KHTableDataBinding alloc] initWithView:tableView delegate:nil registerClass:nil];
+    firstLetter = ^id<NSCopying>(UITableViewCellModel *model) {
+        return [model.text substringToIndex:1];
+    };
+    byKey = ^NSComparisonResult(NSString *a, NSString *b) {
+        return [a compare:b];
+    };
+}
+
+- (void)tearDown {
+    [super tearDown];
+}
+
+- (UITableViewCellModel*)modelWithText:(NSString*)text
+{
+    UITableViewCellModel *model = [[UITableViewCellModel alloc] init];
+    model.text = text;
+    return model;
+}
+
+//  group 依 key 排序，group 裡依 source 的順序，格式 "a:a1,a2|b:b1"
+- (NSString*)layoutOf:(KHGroupedArray*)groupedArray
+{
+    NSMutableArray *groups = [[NSMutableArray alloc] init];
+    for ( KHGroupSection *group in groupedArray.groups ) {
+        NSMutableArray *texts = [[NSMutableArray alloc] init];
+        for ( UITableViewCellModel *model in group ) {
+            [texts addObject:model.text];
+        }
+        [groups addObject:[NSString stringWithFormat:@"%@:%@", group.key, [texts componentsJoinedByString:@","]]];
+    }
+    return [groups componentsJoinedByString:@"|"];
+}
+
+//  加入的 model 建立或加入 group，移除後空的 group 會一起移除
+- (void)testInsertAndCollapse
+{
+    NSMutableArray *source = [[NSMutableArray alloc] init];
+    KHGroupedArray *grouped = [dataBinder createBindGroupedArray:source keyBlock:firstLetter keyComparator:byKey];
+    [source addObjectsFromArray:@[ [self modelWithText:@"b1"], [self modelWithText:@"a1"], [self modelWithText:@"b2"] ]];
+    XCTAssertEqualObjects( [self layoutOf:grouped], @"a:a1|b:b1,b2" );
+    XCTAssert( [tableView numberOfSections] == 2 );
+    XCTAssert( [tableView numberOfRowsInSection:1] == 2 );
+
+    //  插在中間，group 裡還是照 source 的順序
+    [source insertObject:[self modelWithText:@"b0"] atIndex:0];
+    [source insertObject:[self modelWithText:@"c1"] atIndex:2];
+    XCTAssertEqualObjects( [self layoutOf:grouped], @"a:a1|b:b0,b1,b2|c:c1" );
+    XCTAssert( [tableView numberOfSections] == 3 );
+
+    [source removeObjectAtIndex:3];
+    XCTAssertEqualObjects( [self layoutOf:grouped], @"b:b0,b1,b2|c:c1" );
+    XCTAssert( [tableView numberOfSections] == 2 );
+    XCTAssert( [dataBinder indexPathOfModel:source.lastObject].section == 0 );
+
+    [source removeAllObjects];
+    XCTAssert( grouped.groups.count == 0 );
+    XCTAssert( [tableView numberOfSections] == 0 );
+}
+
+//  key 改了之後 update:，model 移到新的 group，pairInfo 不變
+- (void)testRegroup
+{
+    NSMutableArray *source = [[NSMutableArray alloc] init];
+    KHGroupedArray *grouped = [dataBinder createBindGroupedArray:source keyBlock:firstLetter keyComparator:byKey];
+    UITableViewCellModel *model = [self modelWithText:@"a1"];
+    [source addObjectsFromArray:@[ model, [self modelWithText:@"b1"] ]];
+    KHPairInfo *pairInfo = [dataBinder getPairInfo:model];
+
+    model.text = @"c1";
+    [source update:model];
+    XCTAssertEqualObjects( [self layoutOf:grouped], @"b:b1|c:c1" );
+    XCTAssert( [dataBinder getPairInfo:model] == pairInfo );
+    XCTAssert( [dataBinder indexPathOfModel:model].section == 1 );
+    XCTAssert( [tableView numberOfSections] == 2 );
+
+    //  key 沒變，只更新 row
+    model.text = @"c2";
+    [source update:model];
+    XCTAssertEqualObjects( [self layoutOf:grouped], @"b:b1|c:c2" );
+}
+
+//  沒有 keyComparator 時 group 依建立的順序，section header 用 key
+- (void)testGroupOrderAndTitle
+{
+    NSMutableArray *source = [[NSMutableArray alloc] init];
+    KHGroupedArray *grouped = [dataBinder createBindGroupedArray:source keyBlock:firstLetter keyComparator:nil];
+    [source addObject:[self modelWithText:@"z1"]];
+    [source addObject:[self modelWithText:@"a1"]];
+    XCTAssertEqualObjects( [self layoutOf:grouped], @"z:z1|a:a1" );
+    XCTAssertEqualObjects( [tableView.dataSource tableView:tableView titleForHeaderInSection:1], @"a" );
+}
+
+//  group 的增減不影響後面綁定的 array，section 一直是對的
+- (void)testFollowingSectionsShift
+{
+    NSMutableArray *header = [dataBinder createBindArray];
+    NSMutableArray *source = [[NSMutableArray alloc] init];
+    KHGroupedArray *grouped = [dataBinder createBindGroupedArray:source keyBlock:firstLetter keyComparator:byKey];
+    NSMutableArray *footer = [dataBinder createBindArray];
+    [dataBinder setHeaderTitle:@"footer" atSection:footer.section];
+    XCTAssert( grouped.section == 1 && footer.section == 1 );
+
+    [source addObjectsFromArray:@[ [self modelWithText:@"a1"], [self modelWithText:@"b1"] ]];
+    XCTAssert( footer.section == 3 );
+    XCTAssert( [dataBinder getArray:3] == footer );
+    XCTAssertEqualObjects( [tableView.dataSource tableView:tableView titleForHeaderInSection:3], @"footer" );
+
+    [dataBinder deBindArray:header];
+    XCTAssert( grouped.section == 0 );
+    XCTAssert( [grouped groupForKey:@"b"].section == 1 );
+    XCTAssert( footer.section == 2 );
+
+    [source removeAllObjects];
+    XCTAssert( grouped.section == 0 && footer.section == 0 );
+    [source addObject:[self modelWithText:@"c1"]];
+    XCTAssert( [grouped groupForKey:@"c"].section == 0 && footer.section == 1 );
+}
+
+//  deBindArray: 之後，後面 array 的 section 要重新編號
+- (void)testDeBindRenumbersSections
+{
+    NSMutableArray *first = [dataBinder createBindArray];
+    NSMutableArray *second = [dataBinder createBindArray];
+    NSMutableArray *third = [dataBinder createBindArray];
+    [third addObject:[self modelWithText:@"t"]];
+
+    [dataBinder deBindArray:first];
+    XCTAssert( second.section == 0 );
+    XCTAssert( third.section == 1 );
+    XCTAssert( [dataBinder indexPathOfModel:third.firstObject].section == 1 );
+}
+
+@end
@@ -0,0 +1,126 @@
+//
+//  KHHitchRecorderTest.m
+//  KHDataBindDemo
+//
+//  Created by Calvin Huang on 2017/3/9.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import "KHHitchRecorder.h"
+
+@interface KHHitchRecorderTest : XCTestCase
+
+@end
+
+@implementation KHHitchRecorderTest
+{
+    KHHitchRecorder *recorder;
+}
+
+- (void)setUp {
+    [super setUp];
+    recorder = [[KHHitchRecorder alloc] init];
+    recorder.frameBudget = 1.0 / 60;
+}
+
+- (void)tearDown {
+    [super tearDown];
+}
+
+- (void)testOnTimeFramesAreNotHitches
+{
+    for ( int i=0; i<10; i++ ) {
+        [recorder recordEvent:KHHitchEventCellConfigure name:@"UserInfoCell" start:1.0 + i / 60.0 duration:0.002];
+        [recorder markFrameAtTime: 1.0 + i / 60.0 ];
+    }
+    //  第一個 frame 只是起點
+    XCTAssert( recorder.frameCount == 9 );
+    XCTAssert( recorder.hitches.count == 0 );
+}
+
+- (void)testHitchAttribution
+{
+    [recorder markFrameAtTime:1.0];
+
+    //  這個 frame 花了 50ms
+    [recorder recordEvent:KHHitchEventCellConfigure name:@"UserInfoCell" start:1.001 duration:0.030];
+    [recorder recordEvent:KHHitchEventOnLoad name:@"UserInfoCell" start:1.002 duration:0.025];
+    [recorder recordEvent:KHHitchEventCellConfigure name:@"UserInfoCell" start:1.031 duration:0.004];
+    [recorder recordEvent:KHHitchEventCellConfigure name:@"BannerCell" start:1.035 duration:0.004];
+    [recorder recordEvent:KHHitchEventKVORefresh name:@"BannerCell" start:1.040 duration:0.005];
+    [recorder recordEvent:KHHitchEventMutation name:@"arrayInsert:insertObject:index:" start:1.045 duration:0.001];
+    [recorder markFrameAtTime:1.050];
+
+    //  下一個 frame 正常
+    [recorder recordEvent:KHHitchEventCellConfigure name:@"BannerCell" start:1.051 duration:0.002];
+    [recorder markFrameAtTime:1.050 + 1.0 / 60];
+
+    XCTAssert( recorder.hitches.count == 1 );
+    KHHitchFrame *frame = recorder.hitches.firstObject;
+    XCTAssertEqualWithAccuracy( frame.start, 1.0, 0.0001 );
+    XCTAssertEqualWithAccuracy( frame.duration, 0.050, 0.0001 );
+    XCTAssert( frame.events.count == 6 );
+
+    NSArray *classes = [frame dequeuedCellClasses];
+    XCTAssert( [classes isEqualToArray:@[@"UserInfoCell", @"BannerCell"]] );
+
+    NSDictionary *onLoad = [frame onLoadDurationByCellClass];
+    XCTAssertEqualWithAccuracy( [onLoad[@"UserInfoCell"] doubleValue], 0.025, 0.0001 );
+    XCTAssertEqualWithAccuracy( [onLoad[@"BannerCell"] doubleValue], 0.005, 0.0001 );
+}
+
+- (void)testStopDoesNotCountGap
+{
+    [recorder markFrameAtTime:1.0];
+    [recorder stop];
+    [recorder markFrameAtTime:5.0];
+    [recorder markFrameAtTime:5.0 + 1.0 / 60];
+    XCTAssert( recorder.hitches.count == 0 );
+}
+
+- (void)testMaxHitches
+{
+    recorder.maxHitches = 3;
+    CFTimeInterval t = 1.0;
+    [recorder markFrameAtTime:t];
+    for ( int i=0; i<5; i++ ) {
+        t += 0.1;
+        [recorder markFrameAtTime:t];
+    }
+    XCTAssert( recorder.hitches.count == 3 );
+    XCTAssertEqualWithAccuracy( recorder.hitches.firstObject.start, 1.2, 0.0001 );
+}
+
+- (void)testTraceJSON
+{
+    [recorder markFrameAtTime:2.0];
+    [recorder recordEvent:KHHitchEventImageCompletion name:@"UserInfoCell" start:2.001 duration:0.040];
+    [recorder markFrameAtTime:2.050];
+
+    NSData *data = [recorder traceData];
+    XCTAssert( data != nil );
+    NSDictionary *trace = [NSJSONSerialization JSONObjectWithData:data options:0 error:nil];
+    NSArray *events = trace[@"traceEvents"];
+
+    //  2 個 thread name + 1 個 hitch + 1 個 event
+    XCTAssert( events.count == 4 );
+
+    NSDictionary *hitch = events[2];
+    XCTAssert( [hitch[@"name"] isEqualToString:@"Hitch"] );
+    XCTAssert( [hitch[@"ph"] isEqualToString:@"X"] );
+    XCTAssertEqualWithAccuracy( [hitch[@"ts"] doubleValue], 2000000, 1 );
+    XCTAssertEqualWithAccuracy( [hitch[@"dur"] doubleValue], 50000, 1 );
+    XCTAssert( [hitch[@"args"][@"dropped_frames"] integerValue] == 2 );
+
+    NSDictionary *image = events[3];
+    XCTAssert( [image[@"cat"] isEqualToString:@"ImageCompletion"] );
+    XCTAssert( [image[@"name"] isEqualToString:@"UserInfoCell"] );
+
+    NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:@"hitch_trace.json"];
+    NSError *error = nil;
+    XCTAssert( [recorder writeTraceToFile:path error:&error] );
+    XCTAssert( error == nil );
+}
+
+@end
@@ -0,0 +1,119 @@
+//
+//  KHJSONArrayDecoderTest.m
+//  KHDataBindDemo
+//
+//  Created by Calvin Huang on 2017/3/10.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import "KHJSONArrayDecoder.h"
+
+@interface KHJSONArrayDecoderTest : XCTestCase
+
+@end
+
+@implementation KHJSONArrayDecoderTest
+
+- (NSArray*)decode:(NSString*)json keyPath:(NSString*)keyPath chunkSize:(NSUInteger)chunkSize
+{
+    NSMutableArray *elements = [[NSMutableArray alloc] init];
+    KHJSONArrayDecoder *decoder = [[KHJSONArrayDecoder alloc] initWithKeyPath:keyPath];
+    decoder.elementBlock = ^(id element, NSUInteger index) {
+        XCTAssert( index == elements.count );
+        [elements addObject:element];
+    };
+    NSData *data = [json dataUsingEncoding:NSUTF8StringEncoding];
+    for ( NSUInteger offset=0; offset<data.length; offset+=chunkSize ) {
+        NSData *chunk = [data subdataWithRange:NSMakeRange(offset, MIN(chunkSize, data.length - offset))];
+        if ( ![decoder appendData:chunk error:nil] ) {
+            return nil;
+        }
+    }
+    return elements;
+}
+
+- (void)testRootArray
+{
+    NSString *json = @" [ {\"id\":1}, 2 , \"three\", [4,5], null, true ] ";
+    NSArray *expected = @[ @{@"id":@1}, @2, @"three", @[@4,@5], [NSNull null], @YES ];
+    XCTAssertEqualObjects( [self decode:json keyPath:nil chunkSize:1000], expected );
+}
+
+//  每一種切法都要得到一樣的結果
+- (void)testEverySplitSize
+{
+    NSString *json = @"{\"info\":{\"results\":[0]},\"page\":1,\"data\":{\"items\":[{\"name\":\"a]b\\\"}\",\"tags\":[\"x\",\"y\"]},{\"name\":\"c,d\"},{}]},\"items\":[9]}";
+    NSArray *expected = @[ @{@"name":@"a]b\"}", @"tags":@[@"x",@"y"]}, @{@"name":@"c,d"}, @{} ];
+    for ( NSUInteger size=1; size<=json.length; size++ ) {
+        XCTAssertEqualObjects( [self decode:json keyPath:@"data.items" chunkSize:size], expected, @"chunk size %lu", (unsigned long)size );
+    }
+}
+
+- (void)testEscapedKey
+{
+    NSString *json = @"{\"a\\u0062\":[1,2]}";
+    NSArray *expected = @[ @1, @2 ];
+    XCTAssertEqualObjects( [self decode:json keyPath:@"ab" chunkSize:3], expected );
+}
+
+- (void)testEmptyArray
+{
+    XCTAssertEqualObjects( [self decode:@"{\"results\":[]}" keyPath:@"results" chunkSize:2], @[] );
+    XCTAssertEqualObjects( [self decode:@"{\"other\":[1]}" keyPath:@"results" chunkSize:2], @[] );
+}
+
+- (void)testOnlyFirstArray
+{
+    KHJSONArrayDecoder *decoder = [[KHJSONArrayDecoder alloc] initWithKeyPath:@"results"];
+    XCTAssert( [decoder appendData:[@"{\"results\":[1,2],\"results\":[3]}" dataUsingEncoding:NSUTF8StringEncoding] error:nil] );
+    XCTAssert( decoder.elementCount == 2 );
+    XCTAssert( decoder.isArrayFinished );
+}
+
+- (void)testInvalidElement
+{
+    KHJSONArrayDecoder *decoder = [[KHJSONArrayDecoder alloc] initWithKeyPath:nil];
+    NSError *error = nil;
+    XCTAssertFalse( [decoder appendData:[@"[1,{\"a\":},3]" dataUsingEncoding:NSUTF8StringEncoding] error:&error] );
+    XCTAssert( [error.domain isEqualToString:KHJSONArrayDecoderErrorDomain] );
+    XCTAssert( decoder.elementCount == 1 );
+
+    //  之後的資料都不處理
+    XCTAssertFalse( [decoder appendData:[@"4]" dataUsingEncoding:NSUTF8StringEncoding] error:nil] );
+
+    //  reset 後可以重新開始
+    [decoder reset];
+    XCTAssert( [decoder appendData:[@"[4]" dataUsingEncoding:NSUTF8StringEncoding] error:nil] );
+    XCTAssert( decoder.elementCount == 1 );
+}
+
+//  ',' 後面直接接 ']' 是格式錯誤，每一種切法都一樣
+- (void)testTrailingComma
+{
+    NSString *json = @"{\"results\":[1,2,3,]}";
+    for ( NSUInteger size=1; size<=json.length; size++ ) {
+        XCTAssertNil( [self decode:json keyPath:@"results" chunkSize:size], @"chunk size %lu", (unsigned long)size );
+    }
+    XCTAssertNil( [self decode:@"[1,2,]" keyPath:nil chunkSize:1000] );
+    NSArray *expected = @[ @1, @2 ];
+    XCTAssertEqualObjects( [self decode:@"[1, 2 ]" keyPath:nil chunkSize:1], expected );
+}
+
+- (void)testPerformanceDecode
+{
+    NSMutableArray *users = [[NSMutableArray alloc] initWithCapacity: 10000 ];
+    for ( NSInteger i=0; i<10000; i++ ) {
+        [users addObject:@{ @"id":@(i), @"name":[NSString stringWithFormat:@"user %ld", (long)i], @"tags":@[@"a",@"b"] }];
+    }
+    NSData *data = [NSJSONSerialization dataWithJSONObject:@{ @"results":users } options:0 error:nil];
+    [self measureBlock:^{
+        KHJSONArrayDecoder *decoder = [[KHJSONArrayDecoder alloc] initWithKeyPath:@"results"];
+        for ( NSUInteger offset=0; offset<data.length; offset+=16384 ) {
+            [decoder appendData:[data subdataWithRange:NSMakeRange(offset, MIN(16384, data.length - offset))] error:nil];
+        }
+        XCTAssert( decoder.elementCount == 10000 );
+    }];
+}
+
+@end
@@ -0,0 +1,186 @@
+//
+//  KHMulticastBindingTest.m
+//  KHDataBindDemo
+//
+//  Created by Calvin Huang on 2017/3/12.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import <UIKit/UIKit.h>
+#import <XCTest/XCTest.h>
+#import "KHDataBinding.h"
+
+@interface KHMulticastBindingTest : XCTestCase
+
+@end
+
+@implementation KHMulticastBindingTest
+{
+    KHTableDataBinding *listBinder;
+    KHTableDataBinding *previewBinder;
+    KHMulticastBinding *multicast;
+}
+
+- (void)setUp {
+    [super setUp];
+    UITableView *listView = [[UITableView alloc] initWithFrame:(CGRect){0,0,320,480} style:UITableViewStylePlain];
+    UITableView *previewView = [[UITableView alloc] initWithFrame:(CGRect){0,0,320,100} style:UITableViewStylePlain];
+    listBinder = [[KHTableDataBinding alloc] initWithView:listView delegate:nil registerClass:nil];
+    previewBinder = [[KHTableDataBinding alloc] initWithView:previewView delegate:nil registerClass:nil];
+    multicast = [[KHMulticastBinding alloc] init];
+    [multicast addBinding:listBinder];
+    [multicast addBinding:previewBinder];
+}
+
+- (void)tearDown {
+    [super tearDown];
+}
+
+- (UITableViewCellModel*)modelWithText:(NSString*)text
+{
+    UITableViewCellModel *model = [[UITableViewCellModel alloc] init];
+    model.text = text;
+    return model;
+}
+
+//  兩個 binding 都收到變動，pairInfo 各自一份
+- (void)testFanOut
+{
+    NSMutableArray *models = [multicast createBindArray];
+    UITableViewCellModel *a = [self modelWithText:@"a"];
+    UITableViewCellModel *b = [self modelWithText:@"b"];
+    [models addObjectsFromArray:@[ a, b ]];
+    [models insertObject:[self modelWithText:@"c"] atIndex:0];
+
+    XCTAssert( multicast.modelCount == 3 );
+    for ( KHDataBinding *binder in @[ listBinder, previewBinder ] ) {
+        XCTAssert( [binder getArray:0] == models );
+        XCTAssertEqualObjects( [binder indexPathOfModel:a], [NSIndexPath indexPathForRow:1 inSection:0] );
+    }
+    XCTAssertNotNil( [listBinder getPairInfo:a] );
+    XCTAssert( [listBinder getPairInfo:a] != [previewBinder getPairInfo:a] );
+
+    //  size cache 分開
+    [listBinder setCellHeight:80 model:a];
+    [previewBinder setCellHeight:30 model:a];
+    XCTAssert( [listBinder getPairInfo:a].cellSize.height == 80 );
+    XCTAssert( [previewBinder getPairInfo:a].cellSize.height == 30 );
+
+    [models removeObject:a];
+    [models replaceObjectAtIndex:0 withObject:[self modelWithText:@"d"]];
+    XCTAssert( multicast.modelCount == 2 );
+    XCTAssertNil( [listBinder getPairInfo:a] );
+    XCTAssertNil( [previewBinder getPairInfo:a] );
+    XCTAssertNotNil( [previewBinder getPairInfo:models[0]] );
+}
+
+//  array 在每個 binding 的 section 不同，通知的 index path 要換成各自的 section
+- (void)testSectionPerBinding
+{
+    NSMutableArray *own = [listBinder createBindArrayFromNSArray:@[ [self modelWithText:@"own"] ]];
+    NSMutableArray *models = [multicast createBindArray];
+    UITableViewCellModel *a = [self modelWithText:@"a"];
+    [models addObject:a];
+
+    XCTAssert( [listBinder sectionOfArray:own] == 0 );
+    XCTAssert( [listBinder sectionOfArray:models] == 1 );
+    XCTAssert( [previewBinder sectionOfArray:models] == 0 );
+    XCTAssertEqualObjects( [listBinder indexPathOfModel:a], [NSIndexPath indexPathForRow:0 inSection:1] );
+    XCTAssertEqualObjects( [previewBinder indexPathOfModel:a], [NSIndexPath indexPathForRow:0 inSection:0] );
+
+    //  multicast 還是 array 的 kh_delegate
+    XCTAssert( models.kh_delegate == (id)multicast );
+    XCTAssert( own.kh_delegate == (id)listBinder );
+}
+
+//  之後加入的 binding 會綁定已經有的 array，移除後不再收到變動
+- (void)testAddAndRemoveBinding
+{
+    NSMutableArray *models = [multicast createBindArrayFromNSArray:@[ [self modelWithText:@"a"] ]];
+    UITableView *gridView = [[UITableView alloc] initWithFrame:(CGRect){0,0,320,480} style:UITableViewStylePlain];
+    KHTableDataBinding *gridBinder = [[KHTableDataBinding alloc] initWithView:gridView delegate:nil registerClass:nil];
+    [multicast addBinding:gridBinder];
+    XCTAssert( [gridBinder getArray:0] == models );
+    XCTAssertNotNil( [gridBinder getPairInfo:models[0]] );
+
+    [multicast removeBinding:gridBinder];
+    XCTAssert( gridBinder.sectionCount == 0 );
+    XCTAssertNil( gridBinder.multicastBinding );
+    [models addObject:[self modelWithText:@"b"]];
+    XCTAssertNil( [gridBinder getPairInfo:models[1]] );
+    XCTAssertNotNil( [listBinder getPairInfo:models[1]] );
+
+    KHMulticastBinding *other = [[KHMulticastBinding alloc] init];
+    XCTAssertThrows( [other addBinding:listBinder] );
+    XCTAssertThrows( [other bindArray:[listBinder createBindArray]] );
+}
+
+//  binding 自己的 array 先有這個 model，之後才共用，KVO 只能由 multicast 註冊一次
+- (void)testOwnModelSharedLater
+{
+    NSMutableArray *own = [listBinder createBindArray];
+    UITableViewCellModel *a = [self modelWithText:@"a"];
+    [own addObject:a];
+    NSMutableArray *models = [multicast createBindArray];
+    [models addObject:a];
+
+    listBinder.mutationRecorder = [[KHMutationRecorder alloc] init];
+    NSUInteger eventCount = listBinder.mutationRecorder.eventCount;
+    a.text = @"changed";
+    XCTAssert( listBinder.mutationRecorder.eventCount == eventCount + 1 );
+}
+
+//  加入 multicast 之前 binding 已經有共用的 model，它的 pairInfo 不能再自己註冊
+- (void)testAddBindingWithOwnModel
+{
+    UITableViewCellModel *a = [self modelWithText:@"a"];
+    [multicast createBindArrayFromNSArray:@[ a ]];
+    UITableView *gridView = [[UITableView alloc] initWithFrame:(CGRect){0,0,320,480} style:UITableViewStylePlain];
+    KHTableDataBinding *gridBinder = [[KHTableDataBinding alloc] initWithView:gridView delegate:nil registerClass:nil];
+    NSMutableArray *own = [gridBinder createBindArray];
+    [own addObject:a];
+    [multicast addBinding:gridBinder];
+
+    gridBinder.mutationRecorder = [[KHMutationRecorder alloc] init];
+    NSUInteger eventCount = gridBinder.mutationRecorder.eventCount;
+    a.text = @"changed";
+    XCTAssert( gridBinder.mutationRecorder.eventCount == eventCount + 1 );
+}
+
+//  同一個 model 在兩個共用的 array，全部移除後才解除 KVO
+- (void)testSharedModelCounted
+{
+    UITableViewCellModel *a = [self modelWithText:@"a"];
+    NSMutableArray *first = [multicast createBindArrayFromNSArray:@[ a ]];
+    NSMutableArray *second = [multicast createBindArrayFromNSArray:@[ a ]];
+    XCTAssert( multicast.modelCount == 1 );
+
+    [first removeObject:a];
+    XCTAssertTrue( [multicast containsModel:a] );
+    [second removeObject:a];
+    XCTAssertFalse( [multicast containsModel:a] );
+    XCTAssert( multicast.modelCount == 0 );
+}
+
+//  model 變動轉給每個 binding
+- (void)testModelChangeForwarded
+{
+    NSMutableArray *models = [multicast createBindArray];
+    UITableViewCellModel *a = [self modelWithText:@"a"];
+    [models addObject:a];
+    XCTAssertTrue( [multicast containsModel:a] );
+
+    a.text = @"changed";
+    XCTestExpectation *expectation = [self expectationWithDescription:@"update"];
+    dispatch_async( dispatch_get_main_queue(), ^{
+        [expectation fulfill];
+    });
+    [self waitForExpectationsWithTimeout:1 handler:nil];
+
+    [multicast deBindArray:models];
+    XCTAssert( multicast.modelCount == 0 );
+    XCTAssertNil( models.kh_delegate );
+    XCTAssert( listBinder.sectionCount == 0 && previewBinder.sectionCount == 0 );
+}
+
+@end
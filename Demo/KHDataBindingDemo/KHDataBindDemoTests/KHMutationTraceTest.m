@@ -0,0 +1,180 @@
+//
+//  KHMutationTraceTest.m
+//  KHDataBindDemo
+//
+//  Created by Calvin Huang on 2017/3/12.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import <UIKit/UIKit.h>
+#import <XCTest/XCTest.h>
+#import "KHDataBinding.h"
+
+@interface KHMutationTraceTest : XCTestCase
+
+@end
+
+@implementation KHMutationTraceTest
+{
+    UITableView *tableView;
+    KHTableDataBinding *dataBinder;
+}
+
+- (void)setUp {
+    [super setUp];
+    tableView = [[UITableView alloc] initWithFrame:(CGRect){0,0,320,480} style:UITableViewStylePlain];
+    dataBinder = [[KHTableDataBinding alloc] initWithView:tableView delegate:nil registerClass:nil];
+}
+
+- (void)tearDown {
+    [super tearDown];
+}
+
+- (UITableViewCellModel*)modelWithText:(NSString*)text
+{
+    UITableViewCellModel *model = [[UITableViewCellModel alloc] init];
+    model.text = text;
+    return model;
+}
+
+//  binding 上錄下來的變動，replay 後的內容跟原本的一樣
+- (void)testRecordAndReplay
+{
+    NSMutableArray *models = [dataBinder createBindArrayFromNSArray:@[ [self modelWithText:@"a"], [self modelWithText:@"b"] ]];
+    dataBinder.mutationRecorder = [[KHMutationRecorder alloc] init];
+
+    UITableViewCellModel *c = [self modelWithText:@"c"];
+    [models addObjectsFromArray:@[ c, [self modelWithText:@"d"] ]];
+    [models insertObject:[self modelWithText:@"e"] atIndex:1];
+    [models replaceObjectAtIndex:0 withObject:c];
+    [models removeObjectAtIndex:2];
+    [models update:c];
+    [models removeAllObjects];
+    [models addObject:[self modelWithText:@"f"]];
+    [dataBinder deBindArray:models];
+    //  解除綁定後的變動不會記錄
+    [models addObject:[self modelWithText:@"g"]];
+
+    KHMutationRecorder *recorder = dataBinder.mutationRecorder;
+    XCTAssert( recorder.eventCount == 9 );
+
+    NSError *error = nil;
+    KHMutationReplayer *replayer = [[KHMutationReplayer alloc] initWithData:[recorder traceData] error:&error];
+    XCTAssertNotNil( replayer );
+    XCTAssert( replayer.eventCount == recorder.eventCount );
+
+    NSMutableArray *snapshots = [[NSMutableArray alloc] init];
+    KHMutationReplayResult *result = [replayer replayWithBind:^(NSMutableArray *array) {
+        [snapshots addObject:array];
+    } deBind:^(NSMutableArray *array) {
+    } verify:nil];
+    XCTAssertNil( result.failure );
+    XCTAssert( result.eventCount == 9 );
+    XCTAssertEqualObjects( result.opCounts[@"removeAll"], @1 );
+    NSMutableArray *replayed = snapshots.firstObject;
+    XCTAssert( replayed.count == 1 );
+    //  f 是第六個出現的 model
+    XCTAssert( [replayed.firstObject modelID] == 6 );
+}
+
+//  replay 到 binding，每一步的 index 與 pairInfo 都跟 array 一致
+- (void)testReplayKeepsBindingConsistent
+{
+    KHMutationRecorder *recorder = [[KHMutationRecorder alloc] init];
+    NSMutableArray *source = [[NSMutableArray alloc] init];
+    [recorder recordArray:source];
+    for ( NSUInteger i=0; i<20; i++ ) {
+        [source addObject:[[NSObject alloc] init]];
+    }
+    [source replaceObjectAtIndex:5 withObject:[[NSObject alloc] init]];
+    [source removeObjectAtIndex:0];
+    [source removeAllObjects];
+    [source addObjectsFromArray:@[ [[NSObject alloc] init], [[NSObject alloc] init] ]];
+
+    KHTableDataBinding *binder = [[KHTableDataBinding alloc] initWithView:tableView delegate:nil registerClass:nil];
+    [binder setMappingModel:[KHMutationTraceModel class] :[UITableViewCell class]];
+    KHMutationReplayer *replayer = [[KHMutationReplayer alloc] initWithData:[recorder traceData] error:nil];
+    KHMutationReplayResult *result = [replayer replayWithBind:^(NSMutableArray *array) {
+        [binder bindArray:array];
+    } deBind:^(NSMutableArray *array) {
+        [binder deBindArray:array];
+    } verify:^NSString *(NSArray<NSMutableArray*> *sections) {
+        NSMutableArray *array = sections.firstObject;
+        for ( NSUInteger i=0; i<array.count; i++ ) {
+            if ( [binder getPairInfo:array[i]] == nil || [binder indexPathOfModel:array[i]].row != i ) {
+                return [NSString stringWithFormat:@"row %lu", (unsigned long)i];
+            }
+        }
+        return nil;
+    }];
+    XCTAssertNil( result.failure );
+    XCTAssert( result.failedEventIndex == NSNotFound );
+    XCTAssert( [result latencyPercentile:50] <= [result latencyPercentile:100] );
+}
+
+//  reset 之後的 trace 重新編 model id，一樣可以 replay
+- (void)testReplayAfterReset
+{
+    KHMutationRecorder *recorder = [[KHMutationRecorder alloc] init];
+    NSMutableArray *source = [[NSMutableArray alloc] init];
+    [recorder recordArray:source];
+    for ( NSUInteger i=0; i<10; i++ ) {
+        [source addObject:[[NSObject alloc] init]];
+    }
+    [source removeObjectAtIndex:0];
+
+    [recorder reset];
+    [source addObject:[[NSObject alloc] init]];
+    [recorder recordModelChange:source[3]];
+
+    NSError *error = nil;
+    KHMutationReplayer *replayer = [[KHMutationReplayer alloc] initWithData:[recorder traceData] error:&error];
+    XCTAssertNotNil( replayer, @"%@", error );
+    NSMutableArray *snapshots = [[NSMutableArray alloc] init];
+    KHMutationReplayResult *result = [replayer replayWithBind:^(NSMutableArray *array) {
+        [snapshots addObject:array];
+    } deBind:^(NSMutableArray *array) {
+    } verify:nil];
+    XCTAssertNil( result.failure );
+    NSMutableArray *replayed = snapshots.firstObject;
+    XCTAssert( replayed.count == source.count );
+    //  bind 的 snapshot 從 1 開始編號
+    XCTAssert( [replayed.firstObject modelID] == 1 );
+    XCTAssert( [replayed.lastObject modelID] == source.count );
+}
+
+//  格式不對的 trace
+- (void)testRejectsBadTrace
+{
+    NSError *error = nil;
+    XCTAssertNil( [[KHMutationReplayer alloc] initWithData:[@"not a trace" dataUsingEncoding:NSUTF8StringEncoding] error:&error] );
+    XCTAssertNotNil( error );
+
+    KHMutationRecorder *recorder = [[KHMutationRecorder alloc] init];
+    NSMutableArray *array = [[NSMutableArray alloc] init];
+    [recorder recordArray:array];
+    [array addObject:[[NSObject alloc] init]];
+    NSData *trace = [recorder traceData];
+    XCTAssertNil( [[KHMutationReplayer alloc] initWithData:[trace subdataWithRange:NSMakeRange(0, trace.length - 1)] error:nil] );
+}
+
+//  model id 跳太多的 trace 直接拒絕，不會先產生一大堆 model
+- (void)testRejectsModelIDAhead
+{
+    const uint8_t header[8] = { 'K', 'H', 'M', 'T', 1, 0, 0, 0 };
+    //  op, section id, 時間, model id
+    const uint8_t nextID[4] = { KHMutationTraceModelChange, 0, 0, 1 };
+    const uint8_t hugeID[8] = { KHMutationTraceModelChange, 0, 0, 0xff, 0xff, 0xff, 0xff, 0x0f };
+
+    NSMutableData *trace = [[NSMutableData alloc] initWithBytes:header length:sizeof(header)];
+    [trace appendBytes:nextID length:sizeof(nextID)];
+    KHMutationReplayer *replayer = [[KHMutationReplayer alloc] initWithData:trace error:nil];
+    XCTAssert( replayer.eventCount == 1 );
+
+    [trace appendBytes:hugeID length:sizeof(hugeID)];
+    NSError *error = nil;
+    XCTAssertNil( [[KHMutationReplayer alloc] initWithData:trace error:&error] );
+    XCTAssertNotNil( error );
+}
+
+@end
@@ -0,0 +1,150 @@
+//
+//  KHPagedArrayTest.m
+//  KHDataBindDemo
+//
+//  Created by Calvin Huang on 2017/3/12.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import <UIKit/UIKit.h>
+#import <XCTest/XCTest.h>
+#import "KHDataBinding.h"
+
+@interface KHPagedArrayTest : XCTestCase <KHPagedArrayDataSource>
+
+@end
+
+@implementation KHPagedArrayTest
+{
+    //  data source 收到的 fetch，依順序
+    NSMutableArray *fetchedPages;
+}
+
+- (void)setUp {
+    [super setUp];
+    fetchedPages = [[NSMutableArray alloc] init];
+}
+
+- (void)tearDown {
+    [super tearDown];
+}
+
+- (void)pagedArray:(KHPagedArray*)pagedArray fetchPage:(NSInteger)page range:(NSRange)range
+{
+    [fetchedPages addObject:@(page)];
+}
+
+- (NSArray*)modelsOfRange:(NSRange)range
+{
+    NSMutableArray *models = [[NSMutableArray alloc] init];
+    for ( NSUInteger i=range.location; i<NSMaxRange(range); i++ ) {
+        UITableViewCellModel *model = [[UITableViewCellModel alloc] init];
+        model.text = [NSString stringWithFormat:@"row %lu", (unsigned long)i];
+        [models addObject:model];
+    }
+    return models;
+}
+
+- (void)testPageMath
+{
+    KHPagedArray *pagedArray = [[KHPagedArray alloc] initWithTotalCount:105 pageSize:50];
+    XCTAssert( pagedArray.count == 105 );
+    XCTAssert( [pagedArray pageOfIndex:0] == 0 );
+    XCTAssert( [pagedArray pageOfIndex:49] == 0 );
+    XCTAssert( [pagedArray pageOfIndex:50] == 1 );
+    XCTAssert( [pagedArray pageOfIndex:104] == 2 );
+    XCTAssert( NSEqualRanges( [pagedArray rangeOfPage:1], NSMakeRange(50, 50) ) );
+    //  最後一頁不滿
+    XCTAssert( NSEqualRanges( [pagedArray rangeOfPage:2], NSMakeRange(100, 5) ) );
+    XCTAssert( [pagedArray rangeOfPage:3].length == 0 );
+    XCTAssertThrows( [pagedArray objectAtIndex:105] );
+}
+
+//  存取的那頁與前後 prefetchPageCount 頁會 fetch，fetch 中的不會再發一次
+- (void)testFetchAndPrefetch
+{
+    KHPagedArray *pagedArray = [[KHPagedArray alloc] initWithTotalCount:1000 pageSize:10];
+    pagedArray.dataSource = self;
+    pagedArray.prefetchPageCount = 1;
+
+    [pagedArray objectAtIndex:55];
+    XCTAssertEqualObjects( fetchedPages, (@[ @4, @5, @6 ]) );
+    [pagedArray objectAtIndex:56];
+    XCTAssert( fetchedPages.count == 3 );
+
+    //  第一頁沒有前一頁
+    [pagedArray objectAtIndex:0];
+    XCTAssertEqualObjects( [fetchedPages subarrayWithRange:NSMakeRange(3, fetchedPages.count - 3)], (@[ @0, @1 ]) );
+
+    //  失敗之後可以再 fetch
+    [fetchedPages removeAllObjects];
+    [pagedArray failPage:5];
+    [pagedArray objectAtIndex:55];
+    XCTAssertEqualObjects( fetchedPages, (@[ @5 ]) );
+
+    //  只取已載入的 model 與 placeholder 不會 fetch
+    [fetchedPages removeAllObjects];
+    XCTAssertNil( [pagedArray loadedObjectAtIndex:500] );
+    XCTAssertNotNil( [pagedArray placeholderAtIndex:500] );
+    XCTAssert( fetchedPages.count == 0 );
+}
+
+//  同一個 row 的 placeholder 是同一個，page 載入後換成 model
+- (void)testPlaceholderReplacement
+{
+    KHPagedArray *pagedArray = [[KHPagedArray alloc] initWithTotalCount:30 pageSize:10];
+    pagedArray.dataSource = self;
+
+    id placeholder = [pagedArray objectAtIndex:12];
+    XCTAssertTrue( [placeholder isKindOfClass:[KHPagedPlaceholder class]] );
+    XCTAssert( ((KHPagedPlaceholder*)placeholder).index == 12 );
+    XCTAssert( [pagedArray objectAtIndex:12] == placeholder );
+    XCTAssert( [pagedArray placeholderAtIndex:12] == placeholder );
+
+    NSArray *models = [self modelsOfRange:[pagedArray rangeOfPage:1]];
+    [pagedArray setObjects:models forPage:1];
+    XCTAssert( [pagedArray objectAtIndex:12] == models[2] );
+    XCTAssert( [pagedArray indexOfObjectIdenticalTo:models[2]] == 12 );
+    XCTAssert( [pagedArray placeholderAtIndex:12] != placeholder );
+}
+
+//  binding 取高度不會 fetch，cellForRow 才會
+- (void)testHeightDoesNotFetch
+{
+    UITableView *tableView = [[UITableView alloc] initWithFrame:(CGRect){0,0,320,480} style:UITableViewStylePlain];
+    KHTableDataBinding *dataBinder = [[KHTableDataBinding alloc] initWithView:tableView delegate:nil registerClass:nil];
+    KHPagedArray *pagedArray = [dataBinder createBindPagedArray:1000 pageSize:10 dataSource:self];
+    [fetchedPages removeAllObjects];
+
+    for ( NSInteger row=0; row<1000; row++ ) {
+        [dataBinder tableView:tableView heightForRowAtIndexPath:[NSIndexPath indexPathForRow:row inSection:0]];
+    }
+    XCTAssert( fetchedPages.count == 0 );
+
+    [dataBinder tableView:tableView cellForRowAtIndexPath:[NSIndexPath indexPathForRow:505 inSection:0]];
+    XCTAssertEqualObjects( fetchedPages, (@[ @49, @50, @51 ]) );
+    XCTAssertTrue( [pagedArray objectAtIndex:505] == [pagedArray placeholderAtIndex:505] );
+}
+
+//  畫面上的 page 被丟掉，row 要 reload 成 placeholder，不能留著沒有 pairInfo 的 model
+- (void)testEvictReloadsVisibleRows
+{
+    UITableView *tableView = [[UITableView alloc] initWithFrame:(CGRect){0,0,320,480} style:UITableViewStylePlain];
+    KHTableDataBinding *dataBinder = [[KHTableDataBinding alloc] initWithView:tableView delegate:nil registerClass:nil];
+    dataBinder.metricsEnabled = YES;
+    KHPagedArray *pagedArray = [dataBinder createBindPagedArray:100 pageSize:20 dataSource:self];
+    NSArray *models = [self modelsOfRange:[pagedArray rangeOfPage:0]];
+    [pagedArray setObjects:models forPage:0];
+    [tableView layoutIfNeeded];
+
+    NSIndexPath *index = [NSIndexPath indexPathForRow:0 inSection:0];
+    XCTAssert( [dataBinder getModelWithCell:[tableView cellForRowAtIndexPath:index]] == models[0] );
+    [dataBinder.metrics reset];
+
+    [pagedArray evictAllPages];
+    XCTAssert( [dataBinder.metrics valueOfCounter:KHBindingCounterIncrementalUpdate] == 1 );
+    XCTAssertNil( [dataBinder getPairInfo:models[0]] );
+    XCTAssert( [dataBinder getModelWithCell:[tableView cellForRowAtIndexPath:index]] != models[0] );
+}
+
+@end
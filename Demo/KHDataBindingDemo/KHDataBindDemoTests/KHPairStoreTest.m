@@ -0,0 +1,153 @@
+//
+//  KHPairStoreTest.m
+//  KHDataBindDemo
+//
+//  Created by Calvin Huang on 2017/3/12.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import <UIKit/UIKit.h>
+#import <XCTest/XCTest.h>
+#import "KHDataBinding.h"
+
+@interface KHPairStoreTest : XCTestCase
+
+@end
+
+@implementation KHPairStoreTest
+{
+    UITableView *tableView;
+    KHTableDataBinding *dataBinder;
+}
+
+- (void)setUp {
+    [super setUp];
+    tableView = [[UITableView alloc] initWithFrame:(CGRect){0,0,320,480} style:UITableViewStylePlain];
+    dataBinder = [[KHTableDataBinding alloc] initWithView:tableView delegate:nil registerClass:nil];
+    dataBinder.compactPairStorage = YES;
+}
+
+- (void)tearDown {
+    [super tearDown];
+}
+
+- (UITableViewCellModel*)modelWithText:(NSString*)text
+{
+    UITableViewCellModel *model = [[UITableViewCellModel alloc] init];
+    model.text = text;
+    return model;
+}
+
+//  大量加入、隨機移除後，剩下的 model 都還找得到 slot，移除的都找不到
+- (void)testAddRemoveKeepsTable
+{
+    KHPairStore *store = [[KHPairStore alloc] initWithCapacity: 0 ];
+    NSMutableArray *models = [[NSMutableArray alloc] init];
+    for ( NSUInteger i=0; i<5000; i++ ) {
+        NSObject *model = [[NSObject alloc] init];
+        [models addObject:model];
+        [store setWidth:i height:0 atSlot:[store addModel:model]];
+    }
+    NSMutableArray *removed = [[NSMutableArray alloc] init];
+    for ( NSUInteger i=0; i<models.count; i+=3 ) {
+        [store removeSlot:[store slotOfModel:models[i]]];
+        [removed addObject:models[i]];
+    }
+    XCTAssert( store.count == models.count - removed.count );
+    for ( NSUInteger i=0; i<models.count; i++ ) {
+        NSUInteger slot = [store slotOfModel:models[i]];
+        if ( i % 3 == 0 ) {
+            XCTAssert( slot == NSNotFound );
+        }
+        else {
+            XCTAssert( slot != NSNotFound && [store widthAtSlot:slot] == i );
+        }
+    }
+
+    //  移除的 slot 會被重複使用
+    size_t bytes = [store bytesUsed];
+    for ( id model in removed ) {
+        [store addModel:model];
+    }
+    XCTAssert( [store bytesUsed] == bytes );
+    XCTAssert( store.count == models.count );
+}
+
+//  綁定時不產生 KHPairInfo，取得的 facade 狀態寫在 store，有人拿著時是同一個物件
+- (void)testFacadeOnDemand
+{
+    NSMutableArray *models = [dataBinder createBindArray];
+    UITableViewCellModel *a = [self modelWithText:@"a"];
+    [models addObjectsFromArray:@[ a, [self modelWithText:@"b"] ]];
+
+    KHPairStore *store = dataBinder.pairStore;
+    NSUInteger slot = [store slotOfModel:a];
+    XCTAssert( store.count == 2 );
+    XCTAssertNil( [store facadeAtSlot:slot] );
+
+    KHPairInfo *pairInfo = [dataBinder getPairInfo:a];
+    XCTAssert( [dataBinder getPairInfo:a] == pairInfo );
+    XCTAssert( pairInfo.binder == dataBinder );
+    pairInfo.cellSize = (CGSize){ 320, 66 };
+    pairInfo.pairCellName = @"UITableViewCell";
+    [pairInfo setUserInfo:@"expanded" value:@YES];
+    pairInfo = nil;
+
+    //  facade 釋放後狀態還在
+    KHPairInfo *again = [dataBinder getPairInfo:a];
+    XCTAssert( again.cellSize.height == 66 );
+    XCTAssertEqualObjects( again.pairCellName, @"UITableViewCell" );
+    XCTAssertEqualObjects( [again getUserInfo:@"expanded"], @YES );
+    XCTAssertNil( [[dataBinder getPairInfo:models[1]] getUserInfo:@"expanded"] );
+}
+
+//  移除後 facade 保留原本的狀態，replace 之後狀態跟著新的 model
+- (void)testRemoveAndReplace
+{
+    NSMutableArray *models = [dataBinder createBindArray];
+    UITableViewCellModel *a = [self modelWithText:@"a"];
+    UITableViewCellModel *b = [self modelWithText:@"b"];
+    UITableViewCellModel *c = [self modelWithText:@"c"];
+    [models addObjectsFromArray:@[ a, b ]];
+    [dataBinder setCellHeight:50 model:a];
+    [dataBinder setCellHeight:60 model:b];
+
+    KHPairInfo *pairInfo = [dataBinder getPairInfo:a];
+    [models removeObject:a];
+    XCTAssertNil( [dataBinder getPairInfo:a] );
+    XCTAssert( pairInfo.model == nil );
+    XCTAssert( pairInfo.cellSize.height == 50 );
+
+    [models replaceObjectAtIndex:0 withObject:c];
+    XCTAssertNil( [dataBinder getPairInfo:b] );
+    XCTAssert( [dataBinder getPairInfo:c].cellSize.height == 60 );
+    XCTAssert( dataBinder.pairStore.count == 1 );
+}
+
+//  圖片網址跟 userInfo 分開放，改 flags 不會清掉，移除 slot 後就沒了
+- (void)testImageURLsOutsideUserInfo
+{
+    KHPairStore *store = [[KHPairStore alloc] initWithCapacity: 0 ];
+    NSObject *model = [[NSObject alloc] init];
+    NSUInteger slot = [store addModel:model];
+    [store setImageURLs:@[ @"https://example.com/a.png" ] atSlot:slot];
+    XCTAssertNil( [store userInfoAtSlot:slot] );
+
+    [store setFlags:KHPairFlagStale atSlot:slot];
+    XCTAssertEqualObjects( [store imageURLsAtSlot:slot], @[ @"https://example.com/a.png" ] );
+
+    [store removeSlot:slot];
+    slot = [store addModel:model];
+    XCTAssertNil( [store imageURLsAtSlot:slot] );
+}
+
+//  已經有 pair 之後不能切換
+- (void)testSwitchAfterBindThrows
+{
+    KHTableDataBinding *binder = [[KHTableDataBinding alloc] initWithView:tableView delegate:nil registerClass:nil];
+    NSMutableArray *models = [binder createBindArray];
+    [models addObject:[self modelWithText:@"a"]];
+    XCTAssertThrows( binder.compactPairStorage = YES );
+}
+
+@end
@@ -0,0 +1,222 @@
+//
+//  KHProjectedArrayTest.m
+//  KHDataBindDemo
+//
+//  Created by Calvin Huang on 2017/3/12.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import <UIKit/UIKit.h>
+#import <XCTest/XCTest.h>
+#import "KHDataBinding.h"
+
+@interface KHProjectedArrayTest : XCTestCase
+
+@end
+
+@implementation KHProjectedArrayTest
+{
+    UITableView *tableView;
+    KHTableDataBinding *dataBinder;
+    NSPredicate *shortText;
+    NSComparator byText;
+}
+
+- (void)setUp {
+    [super setUp];
+    tableView = [[UITableView alloc] initWithFrame:(CGRect){0,0,320,480} style:UITableViewStylePlain];
+    dataBinder = [[KHTableDataBinding alloc] initWithView:tableView delegate:nil registerClass:nil];
+    shortText = [NSPredicate predicateWithFormat:@"text.length <= 2"];
+    byText = ^NSComparisonResult(UITableViewCellModel *a, UITableViewCellModel *b) {
+        return [a.text compare:b.text];
+    };
+}
+
+- (void)tearDown {
+    [super tearDown];
+}
+
+- (UITableViewCellModel*)modelWithText:(NSString*)text
+{
+    UITableViewCellModel *model = [[UITableViewCellModel alloc] init];
+    model.text = text;
+    return model;
+}
+
+- (NSString*)textsOf:(KHProjectedArray*)projectedArray
+{
+    NSMutableArray *texts = [[NSMutableArray alloc] init];
+    for ( UITableViewCellModel *model in projectedArray ) {
+        [texts addObject:model.text];
+    }
+    return [texts componentsJoinedByString:@","];
+}
+
+//  插入的 model 只留下符合條件的，並放在排序的位置
+- (void)testFilterAndSortOnInsert
+{
+    NSMutableArray *source = [dataBinder createBindArray];
+    KHProjectedArray *projected = [dataBinder createBindProjectedArray:source predicate:shortText comparator:byText];
+    [source addObject:[self modelWithText:@"m"]];
+    [source addObjectsFromArray:@[ [self modelWithText:@"zz"], [self modelWithText:@"long"], [self modelWithText:@"a"] ]];
+    [source insertObject:[self modelWithText:@"b"] atIndex:0];
+
+    XCTAssertEqualObjects( [self textsOf:projected], @"a,b,m,zz" );
+    XCTAssert( [tableView numberOfRowsInSection:0] == 5 );
+    XCTAssert( [tableView numberOfRowsInSection:1] == 4 );
+}
+
+//  比較結果相同的照 source 的順序；沒有 comparator 也照 source 的順序
+- (void)testStableOrder
+{
+    NSMutableArray *source = [[NSMutableArray alloc] init];
+    UITableViewCellModel *first = [self modelWithText:@"a"];
+    UITableViewCellModel *second = [self modelWithText:@"a"];
+    KHProjectedArray *sorted = [dataBinder createBindProjectedArray:source predicate:nil comparator:byText];
+    KHProjectedArray *unsorted = [dataBinder createBindProjectedArray:source predicate:shortText comparator:nil];
+    [source addObject:first];
+    [source addObject:[self modelWithText:@"long"]];
+    [source addObject:second];
+    [source insertObject:[self modelWithText:@"c"] atIndex:1];
+
+    XCTAssert( sorted[0] == first && sorted[1] == second );
+    XCTAssertEqualObjects( [self textsOf:unsorted], @"a,c,a" );
+    XCTAssert( unsorted[2] == second );
+}
+
+//  插入到 source 前面的相同 key，增量插入跟整個重新排序的結果要一樣
+- (void)testTieBreakMatchesRefresh
+{
+    NSMutableArray *source = [[NSMutableArray alloc] init];
+    KHProjectedArray *sorted = [dataBinder createBindProjectedArray:source predicate:nil comparator:byText];
+    UITableViewCellModel *last = [self modelWithText:@"a"];
+    UITableViewCellModel *first = [self modelWithText:@"a"];
+    UITableViewCellModel *middle = [self modelWithText:@"a"];
+    [source addObject:last];
+    [source addObject:[self modelWithText:@"b"]];
+    [source insertObject:first atIndex:0];
+    [source insertObject:middle atIndex:1];
+    NSArray *incremental = [sorted objects];
+    XCTAssert( incremental[0] == first && incremental[1] == middle && incremental[2] == last );
+
+    [sorted refresh];
+    XCTAssertEqualObjects( [sorted objects], incremental );
+
+    //  candidates 的順序跟 source 相反，結果還是照 source 的順序
+    NSArray *candidates = [[source reverseObjectEnumerator] allObjects];
+    [sorted setPredicate:nil comparator:byText candidates:candidates];
+    XCTAssertEqualObjects( [sorted objects], incremental );
+
+    //  model 改了 key 再改回來，位置也照 source 的順序
+    middle.text = @"c";
+    [sorted refreshObject:middle];
+    XCTAssert( sorted[3] == middle );
+    middle.text = @"a";
+    [sorted refreshObject:middle];
+    XCTAssertEqualObjects( [sorted objects], incremental );
+}
+
+//  移除 source 的 model，或 model 改變後 update:，projection 會跟著改
+- (void)testRemoveAndUpdate
+{
+    NSMutableArray *source = [dataBinder createBindArray];
+    KHProjectedArray *projected = [dataBinder createBindProjectedArray:source predicate:shortText comparator:byText];
+    UITableViewCellModel *b = [self modelWithText:@"b"];
+    UITableViewCellModel *longText = [self modelWithText:@"long"];
+    [source addObjectsFromArray:@[ [self modelWithText:@"a"], b, [self modelWithText:@"c"], longText ]];
+
+    [source removeObjectAtIndex:0];
+    XCTAssertEqualObjects( [self textsOf:projected], @"b,c" );
+
+    //  移動
+    b.text = @"d";
+    [source update:b];
+    XCTAssertEqualObjects( [self textsOf:projected], @"c,d" );
+    XCTAssert( [dataBinder indexPathOfModel:b].section == 0 );
+
+    //  離開
+    b.text = @"long d";
+    [source update:b];
+    XCTAssertEqualObjects( [self textsOf:projected], @"c" );
+
+    //  加入
+    longText.text = @"a";
+    [source update:longText];
+    XCTAssertEqualObjects( [self textsOf:projected], @"a,c" );
+    XCTAssert( [tableView numberOfRowsInSection:1] == 2 );
+
+    [source removeAllObjects];
+    XCTAssert( projected.count == 0 );
+    XCTAssert( [tableView numberOfRowsInSection:1] == 0 );
+}
+
+//  source 跟 projection 都 bind 在同一個 binding，共用同一個 pairInfo
+- (void)testSharePairWithSource
+{
+    NSMutableArray *source = [dataBinder createBindArray];
+    KHProjectedArray *projected = [dataBinder createBindProjectedArray:source predicate:shortText comparator:byText];
+    UITableViewCellModel *model = [self modelWithText:@"a"];
+    [source addObject:model];
+    KHPairInfo *pairInfo = [dataBinder getPairInfo:model];
+    XCTAssert( pairInfo != nil );
+
+    //  離開 projection，但還在 source，pairInfo 要留著
+    model.text = @"long";
+    [source update:model];
+    XCTAssert( projected.count == 0 );
+    XCTAssert( [dataBinder getPairInfo:model] == pairInfo );
+
+    model.text = @"a";
+    [source update:model];
+    XCTAssert( [dataBinder getPairInfo:model] == pairInfo );
+
+    //  source 解除 bind，projection 還有這個 model
+    [dataBinder deBindArray:source];
+    XCTAssert( [dataBinder getPairInfo:model] == pairInfo );
+
+    [dataBinder deBindProjectedArray:projected];
+    XCTAssert( [dataBinder getPairInfo:model] == nil );
+}
+
+//  換條件只回報有差異的 row，留下來的 model 不重建 pairInfo
+- (void)testPredicateChangeKeepsPairs
+{
+    NSMutableArray *source = [[NSMutableArray alloc] init];
+    for ( int i=0; i<20; i++ ) {
+        [source addObject:[self modelWithText:[NSString stringWithFormat:@"%d", i]]];
+    }
+    KHProjectedArray *projected = [dataBinder createBindProjectedArray:source predicate:nil comparator:nil];
+    XCTAssert( projected.count == 20 );
+    KHPairInfo *pairInfo = [dataBinder getPairInfo:source[5]];
+
+    projected.predicate = [NSPredicate predicateWithFormat:@"text.length == 1"];
+    XCTAssert( projected.count == 10 );
+    XCTAssert( [dataBinder getPairInfo:source[5]] == pairInfo );
+    XCTAssert( [dataBinder getPairInfo:source[15]] == nil );
+    XCTAssert( [tableView numberOfRowsInSection:0] == 10 );
+
+    projected.comparator = ^NSComparisonResult(UITableViewCellModel *a, UITableViewCellModel *b) {
+        return [b.text compare:a.text];
+    };
+    XCTAssertEqualObjects( [self textsOf:projected], @"9,8,7,6,5,4,3,2,1,0" );
+    XCTAssert( [dataBinder getPairInfo:source[5]] == pairInfo );
+}
+
+//  多個 observer 都會收到 source 的修改
+- (void)testSourceObservers
+{
+    NSMutableArray *source = [[NSMutableArray alloc] init];
+    KHProjectedArray *all = [[KHProjectedArray alloc] initWithSource:source predicate:nil comparator:nil];
+    KHProjectedArray *filtered = [[KHProjectedArray alloc] initWithSource:source predicate:shortText comparator:nil];
+    [source addObject:[self modelWithText:@"a"]];
+    [source addObject:[self modelWithText:@"long"]];
+    XCTAssert( all.count == 2 );
+    XCTAssert( filtered.count == 1 );
+
+    [source kh_removeObserver:all];
+    [source removeObjectAtIndex:0];
+    XCTAssert( all.count == 2 );
+    XCTAssert( filtered.count == 0 );
+}
+
+@end
@@ -0,0 +1,254 @@
+//
+//  KHSearchIndexTest.m
+//  KHDataBindDemo
+//
+//  Created by Calvin Huang on 2017/3/12.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import <UIKit/UIKit.h>
+#import <XCTest/XCTest.h>
+#import "KHDataBinding.h"
+
+@interface KHSearchIndexTest : XCTestCase
+
+@end
+
+@implementation KHSearchIndexTest
+{
+    UITableView *tableView;
+    KHTableDataBinding *dataBinder;
+}
+
+- (void)setUp {
+    [super setUp];
+    tableView = [[UITableView alloc] initWithFrame:(CGRect){0,0,320,480} style:UITableViewStylePlain];
+    dataBinder = [[KHTableDataBinding alloc] initWithView:tableView delegate:nil registerClass:nil];
+}
+
+- (void)tearDown {
+    [super tearDown];
+}
+
+- (UITableViewCellModel*)modelWithText:(NSString*)text detail:(NSString*)detail
+{
+    UITableViewCellModel *model = [[UITableViewCellModel alloc] init];
+    model.text = text;
+    model.detail = detail;
+    return model;
+}
+
+- (KHSearchIndex*)builtIndexOf:(NSMutableArray*)source
+{
+    KHSearchIndex *searchIndex = [[KHSearchIndex alloc] initWithSource:source keyPaths:@[@"text", @"detail"]];
+    XCTestExpectation *expectation = [self expectationWithDescription:@"build"];
+    [searchIndex buildWithCompletion:^{
+        XCTAssert( [NSThread isMainThread] );
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:10 handler:nil];
+    return searchIndex;
+}
+
+- (NSString*)textsOf:(NSArray*)models
+{
+    NSMutableArray *texts = [[NSMutableArray alloc] init];
+    for ( UITableViewCellModel *model in models ) {
+        [texts addObject:model.text];
+    }
+    return [texts componentsJoinedByString:@","];
+}
+
+//  欄位開頭符合的排前面，其次是字的開頭，再來是字的中間，同一種比對前面的 key path 優先
+- (void)testRanking
+{
+    NSMutableArray *source = [[NSMutableArray alloc] init];
+    [source addObject:[self modelWithText:@"Malika Stone" detail:@"Oslo"]];
+    [source addObject:[self modelWithText:@"Bob Alison" detail:@"Paris"]];
+    [source addObject:[self modelWithText:@"Carol" detail:@"Alice Springs"]];
+    [source addObject:[self modelWithText:@"Álice Wong" detail:@"Rome"]];
+    [source addObject:[self modelWithText:@"Dave" detail:@"Berlin"]];
+    KHSearchIndex *searchIndex = [self builtIndexOf:source];
+    XCTAssert( searchIndex.count == 5 );
+
+    XCTAssertEqualObjects( [self textsOf:[searchIndex search:@"ali"]], @"Álice Wong,Carol,Bob Alison,Malika Stone" );
+    XCTAssertEqualObjects( [self textsOf:[searchIndex search:@"ALI" limit:2]], @"Álice Wong,Carol" );
+    XCTAssertEqualObjects( [self textsOf:[searchIndex search:@"a w"]], @"Álice Wong" );
+    XCTAssertEqualObjects( [self textsOf:[searchIndex search:@"li"]], @"" );
+    XCTAssert( [searchIndex search:@""].count == 0 );
+    XCTAssert( [searchIndex scoreOfObject:source[4] query:@"ali"] == 0 );
+}
+
+//  source 的增減與 model 的 KVO 都會更新 index
+- (void)testIncrementalUpdate
+{
+    NSMutableArray *source = [[NSMutableArray alloc] init];
+    UITableViewCellModel *bob = [self modelWithText:@"Bob" detail:nil];
+    [source addObject:bob];
+    KHSearchIndex *searchIndex = [self builtIndexOf:source];
+
+    UITableViewCellModel *alice = [self modelWithText:@"Alice" detail:nil];
+    [source addObject:alice];
+    XCTAssert( [searchIndex search:@"al"].firstObject == alice );
+
+    bob.text = @"Alfred";
+    XCTAssert( [searchIndex search:@"al"].count == 2 );
+    XCTAssert( [searchIndex search:@"bob"].count == 0 );
+
+    [source removeObject:alice];
+    XCTAssert( [searchIndex search:@"al"].firstObject == bob );
+    XCTAssert( searchIndex.count == 1 );
+
+    //  移除後就不再觀察
+    alice.text = @"Alicia";
+    XCTAssert( [searchIndex search:@"alicia"].count == 0 );
+}
+
+//  model 沒有的 key path 不會 crash，也不會註冊 KVO，其他欄位照常建立 index
+- (void)testMissingKeyPath
+{
+    NSMutableArray *source = [[NSMutableArray alloc] init];
+    UITableViewCellModel *bob = [self modelWithText:@"Bob" detail:nil];
+    [source addObject:bob];
+    KHSearchIndex *searchIndex = [[KHSearchIndex alloc] initWithSource:source keyPaths:@[@"noSuchKey", @"text"]];
+    XCTestExpectation *expectation = [self expectationWithDescription:@"build"];
+    [searchIndex buildWithCompletion:^{
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:10 handler:nil];
+
+    XCTAssert( searchIndex.count == 1 );
+    XCTAssert( [searchIndex search:@"bob"].firstObject == bob );
+
+    bob.text = @"Alfred";
+    XCTAssert( [searchIndex search:@"alf"].firstObject == bob );
+
+    UITableViewCellModel *alice = [self modelWithText:@"Alice" detail:nil];
+    [source addObject:alice];
+    XCTAssert( [searchIndex search:@"alice"].firstObject == alice );
+    XCTAssertNoThrow( [source removeObject:alice] );
+    XCTAssert( searchIndex.count == 1 );
+}
+
+//  build 期間的修改，build 完成後也查得到
+- (void)testChangesDuringBuild
+{
+    NSMutableArray *source = [[NSMutableArray alloc] init];
+    for ( int i=0; i<5000; i++ ) {
+        [source addObject:[self modelWithText:[NSString stringWithFormat:@"user %d", i] detail:nil]];
+    }
+    KHSearchIndex *searchIndex = [[KHSearchIndex alloc] initWithSource:source keyPaths:@[@"text"]];
+    XCTestExpectation *expectation = [self expectationWithDescription:@"build"];
+    [searchIndex buildWithCompletion:^{
+        [expectation fulfill];
+    }];
+    [source addObject:[self modelWithText:@"zelda" detail:nil]];
+    [source removeObjectAtIndex:0];
+    [self waitForExpectationsWithTimeout:10 handler:nil];
+
+    XCTAssert( searchIndex.isReady );
+    XCTAssert( searchIndex.count == 5000 );
+    XCTAssert( [searchIndex search:@"zelda"].count == 1 );
+    XCTAssert( [searchIndex search:@"user 0"].count == 0 );
+}
+
+//  query 的結果顯示在 projection，之後的變動也會反應
+- (void)testApplyQueryToProjection
+{
+    NSMutableArray *source = [[NSMutableArray alloc] init];
+    [source addObject:[self modelWithText:@"Bob Alison" detail:nil]];
+    [source addObject:[self modelWithText:@"Alice" detail:nil]];
+    [source addObject:[self modelWithText:@"Carol" detail:nil]];
+
+    XCTestExpectation *expectation = [self expectationWithDescription:@"build"];
+    KHSearchIndex *searchIndex = [dataBinder searchIndexForArray:source keyPaths:@[@"text"]];
+    [searchIndex buildWithCompletion:^{
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:10 handler:nil];
+    XCTAssert( [dataBinder searchIndexForArray:source keyPaths:nil] == searchIndex );
+    XCTAssert( [dataBinder searchIndexForArray:source keyPaths:@[@"text"]] == searchIndex );
+    XCTAssertThrows( [dataBinder searchIndexForArray:source keyPaths:@[@"detail"]] );
+
+    KHProjectedArray *results = [dataBinder createBindProjectedArray:source predicate:nil comparator:nil];
+    [searchIndex applyQuery:@"al" toProjectedArray:results];
+    XCTAssertEqualObjects( [self textsOf:results.objects], @"Alice,Bob Alison" );
+    XCTAssert( [tableView numberOfRowsInSection:0] == 2 );
+
+    [source addObject:[self modelWithText:@"Alan" detail:nil]];
+    XCTAssert( results.count == 3 );
+
+    UITableViewCellModel *carol = source[2];
+    carol.text = @"Alma";
+    XCTAssert( [results indexOfObjectIdenticalTo:carol] != NSNotFound );
+
+    [searchIndex applyQuery:nil toProjectedArray:results];
+    XCTAssert( results.count == 4 );
+}
+
+//  limit 只留分數最高的，跟沒有 limit 的結果前面一樣
+- (void)testLimitKeepsTopResults
+{
+    NSMutableArray *source = [[NSMutableArray alloc] init];
+    for ( int i=0; i<200; i++ ) {
+        NSString *text = i % 3 == 0 ? [NSString stringWithFormat:@"Gary %d", i] : [NSString stringWithFormat:@"Tom Gary%d", i];
+        NSString *detail = i % 5 == 0 ? @"Garden" : nil;
+        [source addObject:[self modelWithText:text detail:detail]];
+    }
+    KHSearchIndex *searchIndex = [self builtIndexOf:source];
+    for ( NSString *query in @[ @"g", @"ga", @"gar", @"gary 1" ] ) {
+        NSArray *all = [searchIndex search:query];
+        for ( NSNumber *limit in @[ @1, @7, @50, @500 ] ) {
+            NSArray *top = [searchIndex search:query limit:limit.unsignedIntegerValue];
+            NSUInteger count = MIN( limit.unsignedIntegerValue, all.count );
+            XCTAssertEqualObjects( top, [all subarrayWithRange:NSMakeRange(0, count)] );
+        }
+    }
+}
+
+//  80k 筆，text 是 "Alice Bob8" 這樣
+- (KHSearchIndex*)performanceIndex
+{
+    NSMutableArray *source = [[NSMutableArray alloc] initWithCapacity:80000];
+    NSArray *names = @[ @"Alice", @"Bob", @"Carol", @"Dave", @"Eve", @"Frank", @"Grace", @"Heidi" ];
+    for ( int i=0; i<80000; i++ ) {
+        NSString *text = [NSString stringWithFormat:@"%@ %@%d", names[i % names.count], names[(i / names.count) % names.count], i];
+        [source addObject:[self modelWithText:text detail:nil]];
+    }
+    return [self builtIndexOf:source];
+}
+
+//  一個字元的 prefix，符合的有 1/4
+- (void)testOneCharPrefixPerformance
+{
+    KHSearchIndex *searchIndex = [self performanceIndex];
+    [self measureBlock:^{
+        for ( int i=0; i<100; i++ ) {
+            [searchIndex search:@"g" limit:20];
+        }
+    }];
+}
+
+//  兩個字元的 prefix
+- (void)testTwoCharPrefixPerformance
+{
+    KHSearchIndex *searchIndex = [self performanceIndex];
+    [self measureBlock:^{
+        for ( int i=0; i<100; i++ ) {
+            [searchIndex search:@"gr" limit:20];
+        }
+    }];
+}
+
+//  80k 筆裡面查詢
+- (void)testSearchPerformance
+{
+    KHSearchIndex *searchIndex = [self performanceIndex];
+    [self measureBlock:^{
+        for ( int i=0; i<100; i++ ) {
+            [searchIndex search:@"grace 4711" limit:20];
+        }
+    }];
+}
+
+@end
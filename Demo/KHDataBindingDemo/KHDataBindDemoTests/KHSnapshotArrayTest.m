@@ -0,0 +1,183 @@
+//
+//  KHSnapshotArrayTest.m
+//  KHDataBindDemo
+//
+//  Created by Calvin Huang on 2017/3/12.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import <UIKit/UIKit.h>
+#import <XCTest/XCTest.h>
+#import "KHDataBinding.h"
+
+@interface KHSnapshotArrayTest : XCTestCase
+
+@end
+
+@implementation KHSnapshotArrayTest
+{
+    UITableView *tableView;
+    KHTableDataBinding *dataBinder;
+}
+
+- (void)setUp {
+    [super setUp];
+    tableView = [[UITableView alloc] initWithFrame:(CGRect){0,0,320,480} style:UITableViewStylePlain];
+    dataBinder = [[KHTableDataBinding alloc] initWithView:tableView delegate:nil registerClass:nil];
+}
+
+- (void)tearDown {
+    [super tearDown];
+}
+
+- (UITableViewCellModel*)modelWithText:(NSString*)text
+{
+    UITableViewCellModel *model = [[UITableViewCellModel alloc] init];
+    model.text = text;
+    return model;
+}
+
+- (void)waitForCommit:(KHSnapshotArray*)snapshotArray
+{
+    XCTestExpectation *expectation = [self expectationWithDescription:@"commit"];
+    [snapshotArray notifyWhenCommitted:^{
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:5 handler:nil];
+}
+
+//  背景加入的 model，換上畫面時 pairInfo 已建立，size 已經在背景算好
+- (void)testPreparePairOffMainThread
+{
+    KHSnapshotArray *users = [dataBinder createBindSnapshotArray];
+    users.sizeBlock = ^CGSize(id model) {
+        XCTAssertFalse( [NSThread isMainThread] );
+        return CGSizeMake(320, 60);
+    };
+    XCTestExpectation *expectation = [self expectationWithDescription:@"commit"];
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        for ( int i=0; i<100; i++ ) {
+            [users addObject:[self modelWithText:[NSString stringWithFormat:@"user %d", i]]];
+        }
+        [users notifyWhenCommitted:^{
+            [expectation fulfill];
+        }];
+    });
+    [self waitForExpectationsWithTimeout:5 handler:nil];
+
+    XCTAssert( users.count == 100 );
+    XCTAssert( [tableView numberOfRowsInSection:0] == 100 );
+    for ( UITableViewCellModel *model in users ) {
+        KHPairInfo *pairInfo = [dataBinder getPairInfo:model];
+        XCTAssert( pairInfo.binder == dataBinder );
+        XCTAssert( pairInfo.cellSize.height == 60 );
+    }
+    XCTAssert( [tableView.dataSource tableView:tableView heightForRowAtIndexPath:[NSIndexPath indexPathForRow:0 inSection:0]] == 60 );
+}
+
+//  cell mapping 會讀 binding 的對映表，只能在 main thread 執行
+- (void)testMappingOnMainThread
+{
+    __block NSInteger mappingCount = 0;
+    [dataBinder setMappingModel:[UITableViewCellModel class] block:^Class _Nullable(id _Nonnull model, NSIndexPath * _Nonnull index) {
+        XCTAssertTrue( [NSThread isMainThread] );
+        mappingCount++;
+        return [UITableViewCell class];
+    }];
+    KHSnapshotArray *users = [dataBinder createBindSnapshotArray];
+    XCTestExpectation *expectation = [self expectationWithDescription:@"commit"];
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        for ( int i=0; i<20; i++ ) {
+            [users addObject:[self modelWithText:[NSString stringWithFormat:@"user %d", i]]];
+        }
+        [users notifyWhenCommitted:^{
+            [expectation fulfill];
+        }];
+    });
+    [self waitForExpectationsWithTimeout:5 handler:nil];
+
+    XCTAssert( users.count == 20 );
+    [tableView.dataSource tableView:tableView heightForRowAtIndexPath:[NSIndexPath indexPathForRow:0 inSection:0]];
+    XCTAssert( mappingCount > 0 );
+    XCTAssertEqualObjects( [dataBinder getPairInfo:users[0]].pairCellName, @"UITableViewCell" );
+}
+
+//  多個 thread 一起修改，每個 thread 自己的順序不會亂
+- (void)testOrderAcrossThreads
+{
+    KHSnapshotArray *numbers = [dataBinder createBindSnapshotArray];
+    NSInteger threadCount = 4;
+    NSInteger perThread = 500;
+    dispatch_apply( threadCount, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t t) {
+        for ( NSInteger i=0; i<perThread; i++ ) {
+            [numbers addObject:[self modelWithText:[NSString stringWithFormat:@"%zu-%ld", t, (long)i]]];
+        }
+    });
+    [self waitForCommit:numbers];
+
+    XCTAssert( numbers.count == threadCount * perThread );
+    NSMutableDictionary *lastIndexDic = [[NSMutableDictionary alloc] init];
+    for ( UITableViewCellModel *model in numbers ) {
+        NSArray *parts = [model.text componentsSeparatedByString:@"-"];
+        NSInteger index = [parts[1] integerValue];
+        NSNumber *lastIndex = lastIndexDic[parts[0]];
+        XCTAssert( lastIndex == nil || [lastIndex integerValue] + 1 == index );
+        lastIndexDic[parts[0]] = @(index);
+    }
+}
+
+//  每次修改都是成對加入，main thread 任何時候看到的都要是偶數
+- (void)testNoHalfAppliedState
+{
+    KHSnapshotArray *pairs = [dataBinder createBindSnapshotArray];
+    __block BOOL done = NO;
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        for ( int i=0; i<300; i++ ) {
+            [pairs performChanges:^(NSMutableArray *pending) {
+                [pending addObject:[self modelWithText:@"a"]];
+                [pending addObject:[self modelWithText:@"b"]];
+                if ( pending.count > 100 ) {
+                    [pending removeObjectsInRange:NSMakeRange(0, 40)];
+                }
+            }];
+        }
+        [pairs notifyWhenCommitted:^{
+            done = YES;
+        }];
+    });
+
+    NSDate *timeout = [NSDate dateWithTimeIntervalSinceNow:5];
+    while ( !done && [timeout timeIntervalSinceNow] > 0 ) {
+        [[NSRunLoop currentRunLoop] runMode:NSDefaultRunLoopMode beforeDate:[NSDate dateWithTimeIntervalSinceNow:0.001]];
+        XCTAssert( pairs.count % 2 == 0 );
+        XCTAssert( [tableView numberOfRowsInSection:0] == pairs.count );
+    }
+    XCTAssert( done );
+}
+
+//  移除的 model 要一起移除 pairInfo，重新排序改用 reloadData
+- (void)testRemoveAndReorder
+{
+    NSMutableArray *models = [[NSMutableArray alloc] init];
+    for ( int i=0; i<10; i++ ) {
+        [models addObject:[self modelWithText:[NSString stringWithFormat:@"%d", i]]];
+    }
+    KHSnapshotArray *snapshotArray = [[KHSnapshotArray alloc] initWithArray:models];
+    [dataBinder bindSnapshotArray:snapshotArray];
+    XCTAssert( [dataBinder getPairInfo:models[3]] != nil );
+
+    [snapshotArray removeObjectAtIndex:3];
+    [snapshotArray performChanges:^(NSMutableArray *pending) {
+        [pending exchangeObjectAtIndex:0 withObjectAtIndex:1];
+    }];
+    [self waitForCommit:snapshotArray];
+
+    XCTAssert( snapshotArray.count == 9 );
+    XCTAssert( snapshotArray[0] == models[1] );
+    XCTAssert( [dataBinder getPairInfo:models[3]] == nil );
+    XCTAssert( [dataBinder getPairInfo:models[0]] != nil );
+    XCTAssert( [snapshotArray indexOfObjectIdenticalTo:models[3]] == NSNotFound );
+    XCTAssert( [dataBinder indexPathOfModel:models[4]].row == 3 );
+}
+
+@end
@@ -0,0 +1,176 @@
+//
+//  KHUpdateRoutingTest.m
+//  KHDataBindDemo
+//
+//  Created by Calvin Huang on 2017/3/12.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import <UIKit/UIKit.h>
+#import <XCTest/XCTest.h>
+#import "KHDataBinding.h"
+
+@interface KHUpdateRoutingTest : XCTestCase
+
+@end
+
+@implementation KHUpdateRoutingTest
+{
+    UITableView *tableView;
+    KHTableDataBinding *dataBinder;
+    NSMutableArray *models;
+}
+
+- (void)setUp {
+    [super setUp];
+    tableView = [[UITableView alloc] initWithFrame:(CGRect){0,0,320,480} style:UITableViewStylePlain];
+    dataBinder = [[KHTableDataBinding alloc] initWithView:tableView delegate:nil registerClass:nil];
+    dataBinder.metricsEnabled = YES;
+    models = [dataBinder createBindArray];
+    for ( int i=0; i<200; i++ ) {
+        UITableViewCellModel *model = [[UITableViewCellModel alloc] init];
+        model.text = [NSString stringWithFormat:@"%d", i];
+        [models addObject:model];
+    }
+    //  載入畫面上的 cell
+    [tableView layoutIfNeeded];
+    [dataBinder.metrics reset];
+}
+
+- (void)tearDown {
+    [super tearDown];
+}
+
+- (NSDictionary*)snapshot
+{
+    return [dataBinder.metrics snapshot];
+}
+
+//  畫面上的 row 直接更新目前的 cell，不 reload
+- (void)testVisibleUpdateAppliedInPlace
+{
+    NSIndexPath *index = [NSIndexPath indexPathForRow:0 inSection:0];
+    UITableViewCell *cell = [tableView cellForRowAtIndexPath:index];
+    XCTAssertNotNil( cell );
+
+    UITableViewCellModel *model = models[0];
+    model.text = @"changed";
+    [models update:model];
+
+    XCTAssert( [tableView cellForRowAtIndexPath:index] == cell );
+    XCTAssertEqualObjects( cell.textLabel.text, @"changed" );
+    XCTAssert( [[self snapshot][@"updateApplied"] integerValue] == 1 );
+    XCTAssert( [[self snapshot][@"incrementalUpdate"] integerValue] == 0 );
+    XCTAssert( [[self snapshot][@"fullReload"] integerValue] == 0 );
+}
+
+//  不在畫面上的 row 只標記 stale
+- (void)testOffscreenUpdateDeferred
+{
+    UITableViewCellModel *model = models[150];
+    XCTAssertNil( [tableView cellForRowAtIndexPath:[NSIndexPath indexPathForRow:150 inSection:0]] );
+    [models update:model];
+
+    XCTAssertTrue( [dataBinder getPairInfo:model].stale );
+    XCTAssert( [[self snapshot][@"updateDeferred"] integerValue] == 1 );
+    XCTAssert( [[self snapshot][@"updateApplied"] integerValue] == 0 );
+
+    //  顯示時才處理
+    [tableView scrollToRowAtIndexPath:[NSIndexPath indexPathForRow:150 inSection:0] atScrollPosition:UITableViewScrollPositionTop animated:NO];
+    [tableView layoutIfNeeded];
+    XCTAssertFalse( [dataBinder getPairInfo:model].stale );
+}
+
+//  不在畫面上的 model 內容改了，之前的 size 不能用，取 size 時重新計算
+- (void)testOffscreenUpdateRemeasures
+{
+    UITableViewCellModel *model = models[150];
+    NSIndexPath *index = [NSIndexPath indexPathForRow:150 inSection:0];
+    [dataBinder setCellHeight:120 model:model];
+    XCTAssert( [dataBinder tableView:tableView heightForRowAtIndexPath:index] == 120 );
+
+    model.text = @"longer text";
+    [models update:model];
+    XCTAssert( [dataBinder getPairInfo:model].cellSize.height == 120 );
+    XCTAssert( [dataBinder tableView:tableView heightForRowAtIndexPath:index] != 120 );
+    XCTAssertFalse( [dataBinder getPairInfo:model].stale );
+}
+
+//  updateAll 只處理畫面上的 index path
+- (void)testUpdateAllTouchesVisibleOnly
+{
+    NSUInteger visibleCount = [tableView indexPathsForVisibleRows].count;
+    XCTAssert( visibleCount > 0 && visibleCount < models.count );
+    [models updateAll];
+
+    XCTAssert( [[self snapshot][@"updateApplied"] integerValue] == visibleCount );
+    XCTAssert( [[self snapshot][@"updateDeferred"] integerValue] == models.count - visibleCount );
+    XCTAssertFalse( [dataBinder getPairInfo:models[0]].stale );
+}
+
+//  updateAll 不走訪不在畫面上的 row，取 size 時依 section 的 generation 重新計算
+- (void)testUpdateAllRemeasuresLazily
+{
+    UITableViewCellModel *last = models.lastObject;
+    NSIndexPath *lastIndex = [NSIndexPath indexPathForRow:models.count - 1 inSection:0];
+    [dataBinder setCellHeight:120 model:last];
+    [models updateAll];
+
+    //  還沒取 size 前不會動到
+    XCTAssertFalse( [dataBinder getPairInfo:last].stale );
+    XCTAssert( [dataBinder getPairInfo:last].cellSize.height == 120 );
+    XCTAssert( [dataBinder tableView:tableView heightForRowAtIndexPath:lastIndex] != 120 );
+
+    //  updateAll 之後才設定的 size 不受影響
+    [dataBinder setCellHeight:130 model:last];
+    XCTAssert( [dataBinder tableView:tableView heightForRowAtIndexPath:lastIndex] == 130 );
+
+    //  updateAll 之後才加入的 model
+    UITableViewCellModel *model = [[UITableViewCellModel alloc] init];
+    [models addObject:model];
+    [dataBinder setCellHeight:140 model:model];
+    XCTAssert( [dataBinder tableView:tableView heightForRowAtIndexPath:[NSIndexPath indexPathForRow:models.count - 1 inSection:0]] == 140 );
+}
+
+//  畫面上的 row 高度改了，不 reload cell，只重新取高度
+- (void)testVisibleUpdateResizes
+{
+    NSIndexPath *index = [NSIndexPath indexPathForRow:0 inSection:0];
+    UITableViewCell *cell = [tableView cellForRowAtIndexPath:index];
+    UITableViewCellModel *model = models[0];
+    [dataBinder setCellHeight:120 model:model];
+    [models update:model];
+
+    XCTAssert( [tableView cellForRowAtIndexPath:index] == cell );
+    XCTAssert( [tableView rectForRowAtIndexPath:index].size.height == 120 );
+    XCTAssert( [[self snapshot][@"incrementalUpdate"] integerValue] == 1 );
+}
+
+//  replace 成高度不同的 model，畫面上的 row 也要換成新的高度
+- (void)testVisibleReplaceResizes
+{
+    NSIndexPath *index = [NSIndexPath indexPathForRow:1 inSection:0];
+    UITableViewCell *cell = [tableView cellForRowAtIndexPath:index];
+    UITableViewCellModel *model = [[UITableViewCellModel alloc] init];
+    model.text = @"tall";
+    [dataBinder setCellHeight:90 model:model];
+    [models replaceObjectAtIndex:1 withObject:model];
+
+    XCTAssert( [tableView cellForRowAtIndexPath:index] == cell );
+    XCTAssertEqualObjects( cell.textLabel.text, @"tall" );
+    XCTAssert( [tableView rectForRowAtIndexPath:index].size.height == 90 );
+}
+
+//  cell 的種類換了，畫面上的 row 還是要 reload
+- (void)testCellChangeReloads
+{
+    UITableViewCellModel *model = models[0];
+    model.cellStyle = UITableViewCellStyleSubtitle;
+    [models update:model];
+
+    XCTAssert( [[self snapshot][@"incrementalUpdate"] integerValue] == 1 );
+    UITableViewCell *cell = [tableView cellForRowAtIndexPath:[NSIndexPath indexPathForRow:0 inSection:0]];
+    XCTAssertEqualObjects( cell.reuseIdentifier, @"UITableViewCellStyleSubtitle" );
+}
+
+@end
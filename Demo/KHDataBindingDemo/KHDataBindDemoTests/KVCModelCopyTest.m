@@ -0,0 +1,131 @@
+//
+//  KVCModelCopyTest.m
+//  KHDataBindDemo
+//
+//  Created by Calvin Huang on 2017/3/12.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import <UIKit/UIKit.h>
+#import <XCTest/XCTest.h>
+#import "KVCModel.h"
+
+@interface KHTestCopyUser : KVCModel
+@property (nonatomic) NSString *name;
+@property (nonatomic) NSInteger age;
+@end
+
+@implementation KHTestCopyUser
+@end
+
+@interface KHTestCopyPost : KVCModel
+@property (nonatomic) NSString *title;
+@property (nonatomic) NSInteger likeCount;
+@property (nonatomic) double score;
+@property (nonatomic) CGSize imageSize;
+@property (nonatomic) UIImage *image;
+@property (nonatomic) KHTestCopyUser *owner;
+@property (nonatomic) NSArray *followers;
+@property (nonatomic) KHTestCopyUser *classof_followers;
+@property (nonatomic) NSArray *tags;
+@end
+
+@implementation KHTestCopyPost
+@end
+
+@interface KHTestCopyRowUser : KVCModel
+@property (nonatomic) NSString *displayName;
+@property (nonatomic) NSInteger age;
+@end
+
+@implementation KHTestCopyRowUser
+@end
+
+@interface KHTestCopyRow : KVCModel
+@property (nonatomic) NSString *title;
+@property (nonatomic) NSInteger likeCount;
+@property (nonatomic) double score;
+@property (nonatomic) CGSize imageSize;
+@property (nonatomic) UIImage *image;
+@property (nonatomic) KHTestCopyRowUser *owner;
+@property (nonatomic) NSArray *followers;
+@property (nonatomic) KHTestCopyRowUser *classof_followers;
+@property (nonatomic) NSArray *tags;
+@end
+
+@implementation KHTestCopyRow
+@end
+
+
+@interface KVCModelCopyTest : XCTestCase
+
+@end
+
+@implementation KVCModelCopyTest
+{
+    KHTestCopyPost *post;
+}
+
+- (void)setUp {
+    [super setUp];
+    post = [KVCModel objectWithDictionary:@{ @"title":@"hello",
+                                             @"likeCount":@42,
+                                             @"score":@3.5,
+                                             @"owner":@{ @"name":@"gevin", @"age":@30 },
+                                             @"followers":@[ @{ @"name":@"amy", @"age":@20 }, @{ @"name":@"bob" } ],
+                                             @"tags":@[ @"a", @"b" ] }
+                              objectClass:[KHTestCopyPost class]];
+    post.imageSize = (CGSize){ 320, 180 };
+    UIGraphicsBeginImageContext( (CGSize){ 2, 2 } );
+    post.image = UIGraphicsGetImageFromCurrentImageContext();
+    UIGraphicsEndImageContext();
+}
+
+- (void)tearDown {
+    [super tearDown];
+}
+
+//  數值保留原本的值，值物件共用，巢狀的 model 是新的 object
+- (void)testCopySameClass
+{
+    KHTestCopyPost *copied = [KVCModel objectWithModel:post objectClass:[KHTestCopyPost class]];
+    XCTAssertEqualObjects( copied.title, @"hello" );
+    XCTAssert( copied.likeCount == 42 && copied.score == 3.5 );
+    XCTAssert( CGSizeEqualToSize( copied.imageSize, post.imageSize ) );
+    XCTAssert( copied.image == post.image );
+    XCTAssert( copied.owner != post.owner );
+    XCTAssertEqualObjects( copied.owner.name, @"gevin" );
+    XCTAssert( copied.owner.age == 30 );
+    XCTAssert( copied.followers.count == 2 && copied.followers.firstObject != post.followers.firstObject );
+    XCTAssertEqualObjects( [copied.followers.lastObject name], @"bob" );
+    XCTAssertEqualObjects( copied.tags, post.tags );
+}
+
+//  不同的 class 用 keyCorrespond 對映，巢狀與 classof_ 的 array 轉成目標的 class
+- (void)testCopyWithCorrespond
+{
+    NSDictionary *correspond = @{ @"displayName":@"name" };
+    KHTestCopyRow *row = [KVCModel objectWithModel:post objectClass:[KHTestCopyRow class] keyCorrespond:correspond];
+    XCTAssertTrue( [row.owner isKindOfClass:[KHTestCopyRowUser class]] );
+    XCTAssertEqualObjects( row.owner.displayName, @"gevin" );
+    XCTAssertTrue( [row.followers.firstObject isKindOfClass:[KHTestCopyRowUser class]] );
+    XCTAssertEqualObjects( [row.followers.firstObject displayName], @"amy" );
+    XCTAssert( row.likeCount == 42 );
+
+    NSArray *rows = [KVCModel convertModels:@[ post, post ] toClass:[KHTestCopyRow class] keyCorrespond:correspond];
+    XCTAssert( rows.count == 2 && rows.firstObject != rows.lastObject );
+    XCTAssertEqualObjects( [rows.lastObject owner].displayName, @"gevin" );
+}
+
+//  nil 的值不會蓋掉目標原本的值
+- (void)testInjectSkipsNil
+{
+    KHTestCopyPost *source = [[KHTestCopyPost alloc] init];
+    source.likeCount = 7;
+    KHTestCopyPost *target = [KVCModel objectWithModel:post objectClass:[KHTestCopyPost class]];
+    [KVCModel injectWithModel:source toObject:target];
+    XCTAssertEqualObjects( target.title, @"hello" );
+    XCTAssert( target.likeCount == 7 );
+}
+
+@end
@@ -0,0 +1,166 @@
+//
+//  KVCModelLazyTest.m
+//  KHDataBindDemo
+//
+//  Created by Calvin Huang on 2017/3/12.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import "KVCModel.h"
+
+//  eager 與 lazy 的 class 宣告一樣的 property，只差在 decodesLazily
+#define KH_TEST_OWNER_PROPERTIES \
+@property (nonatomic) NSString *name; \
+@property (nonatomic) NSInteger level;
+
+#define KH_TEST_POST_PROPERTIES( ownerClass ) \
+@property (nonatomic) NSString *title; \
+@property (nonatomic,copy) NSString *subtitle; \
+@property (nonatomic) NSInteger likeCount; \
+@property (nonatomic) double score; \
+@property (nonatomic) BOOL pinned; \
+@property (nonatomic) NSNumber *views; \
+@property (nonatomic) NSArray *tags; \
+@property (nonatomic) NSMutableArray *mutableTags; \
+@property (nonatomic) ownerClass *owner; \
+@property (nonatomic) NSArray *followers; \
+@property (nonatomic) ownerClass *classof_followers; \
+@property (nonatomic,readonly) NSString *identifier;
+
+@interface KHTestEagerOwner : KVCModel
+KH_TEST_OWNER_PROPERTIES
+@end
+
+@implementation KHTestEagerOwner
+@end
+
+@interface KHTestEagerPost : KVCModel
+KH_TEST_POST_PROPERTIES( KHTestEagerOwner )
+@end
+
+@implementation KHTestEagerPost
+@end
+
+@interface KHTestLazyOwner : KVCModel
+KH_TEST_OWNER_PROPERTIES
+@end
+
+@implementation KHTestLazyOwner
++ (BOOL)decodesLazily { return YES; }
+@end
+
+@interface KHTestLazyPost : KVCModel
+KH_TEST_POST_PROPERTIES( KHTestLazyOwner )
+@end
+
+@implementation KHTestLazyPost
++ (BOOL)decodesLazily { return YES; }
+@end
+
+
+@interface KVCModelLazyTest : XCTestCase
+
+@end
+
+@implementation KVCModelLazyTest
+{
+    NSDictionary *postDic;
+    NSInteger kvoCount;
+}
+
+- (void)setUp {
+    [super setUp];
+    postDic = @{ @"title":@"hello",
+                 @"sub":@"world",
+                 @"likeCount":@42,
+                 @"score":@"3.5",
+                 @"pinned":@YES,
+                 @"views":@1000,
+                 @"tags":@[ @"a", @"b" ],
+                 @"mutableTags":@[ @"c" ],
+                 @"owner":@{ @"name":@"gevin", @"level":@3 },
+                 @"followers":@[ @{ @"name":@"amy", @"level":@1 }, @{ @"name":@"bob" } ],
+                 @"identifier":@"post-1",
+                 @"unused":[NSNull null] };
+}
+
+- (void)tearDown {
+    [super tearDown];
+}
+
+- (void)observeValueForKeyPath:(NSString *)keyPath ofObject:(id)object change:(NSDictionary<NSKeyValueChangeKey,id> *)change context:(void *)context
+{
+    kvoCount++;
+}
+
+//  lazy 轉換的結果跟直接轉換一樣
+- (void)testLazyMatchesEager
+{
+    NSDictionary *correspond = @{ @"subtitle":@"sub" };
+    KHTestEagerPost *eager = [KVCModel objectWithDictionary:postDic objectClass:[KHTestEagerPost class] keyCorrespond:correspond];
+    KHTestLazyPost *lazy = [KVCModel objectWithDictionary:postDic objectClass:[KHTestLazyPost class] keyCorrespond:correspond];
+    XCTAssertFalse( [eager hasLazyProperties] );
+    XCTAssertTrue( [lazy hasLazyProperties] );
+
+    XCTAssertEqualObjects( lazy.subtitle, eager.subtitle );
+    XCTAssert( lazy.likeCount == eager.likeCount && lazy.score == eager.score && lazy.pinned == eager.pinned );
+    XCTAssertEqualObjects( lazy.identifier, @"post-1" );
+    XCTAssertTrue( [lazy.owner isKindOfClass:[KHTestLazyOwner class]] );
+    XCTAssertTrue( [lazy.followers.firstObject isKindOfClass:[KHTestLazyOwner class]] );
+    XCTAssertNoThrow( [lazy.mutableTags addObject:@"d"] );
+    [lazy.mutableTags removeLastObject];
+
+    XCTAssertEqualObjects( [KVCModel dictionaryWithObj:lazy], [KVCModel dictionaryWithObj:eager] );
+    XCTAssertFalse( [lazy hasLazyProperties] );
+
+    //  array 也一樣
+    NSArray *eagerArray = [KVCModel convertArray:@[ postDic, postDic ] toClass:[KHTestEagerPost class] keyCorrespond:nil];
+    NSArray *lazyArray = [KVCModel convertArray:@[ postDic, postDic ] toClass:[KHTestLazyPost class] keyCorrespond:nil];
+    XCTAssertEqualObjects( [KVCModel convertDictionarys:lazyArray keyCorrespond:nil], [KVCModel convertDictionarys:eagerArray keyCorrespond:nil] );
+}
+
+//  只有讀過的 property 會轉換，巢狀的 object 也是 lazy
+- (void)testDecodeOnAccess
+{
+    KHTestLazyPost *lazy = [KVCModel objectWithDictionary:postDic objectClass:[KHTestLazyPost class]];
+    XCTAssertEqualObjects( lazy.title, @"hello" );
+    XCTAssertTrue( [lazy hasLazyProperties] );
+
+    KHTestLazyOwner *owner = lazy.owner;
+    XCTAssertTrue( [owner hasLazyProperties] );
+    XCTAssertEqualObjects( owner.name, @"gevin" );
+    XCTAssert( owner.level == 3 );
+    XCTAssertFalse( [owner hasLazyProperties] );
+
+    [lazy decodeLazyProperties];
+    XCTAssertFalse( [lazy hasLazyProperties] );
+    XCTAssert( lazy.followers.count == 2 );
+}
+
+//  先用 setter 設定的值，不會被 dictionary 的值蓋掉
+- (void)testSetterWins
+{
+    KHTestLazyPost *lazy = [KVCModel objectWithDictionary:postDic objectClass:[KHTestLazyPost class]];
+    lazy.title = @"changed";
+    lazy.likeCount = 7;
+    lazy.owner = nil;
+    XCTAssertEqualObjects( lazy.title, @"changed" );
+    XCTAssert( lazy.likeCount == 7 );
+    XCTAssertNil( lazy.owner );
+}
+
+//  轉換時不送 KVO，之後的修改照常送
+- (void)testNoKVOWhileDecoding
+{
+    KHTestLazyPost *lazy = [KVCModel objectWithDictionary:postDic objectClass:[KHTestLazyPost class]];
+    [lazy addObserver:self forKeyPath:@"title" options:NSKeyValueObservingOptionNew context:NULL];
+    kvoCount = 0;
+    XCTAssertEqualObjects( lazy.title, @"hello" );
+    XCTAssert( kvoCount == 0 );
+    lazy.title = @"changed";
+    XCTAssert( kvoCount == 1 );
+    [lazy removeObserver:self forKeyPath:@"title"];
+}
+
+@end
@@ -114,6 +114,20 @@
     
 }
 
+//  kh_delegate 清掉後就不會再呼叫
+- (void)testClearDelegate
+{
+    array.kh_delegate = self;
+    [array addObject: [NSObject new] ];
+    XCTAssert( delegateCall == 1 );
+    
+    array.kh_delegate = nil;
+    delegateCall = 0;
+    [array addObject: [NSObject new] ];
+    XCTAssert( delegateCall == 0 );
+    XCTAssert( array.count == 2 );
+}
+
 - (void)testReplace
 {
     
@@ -0,0 +1,108 @@
+//
+//  KHBindingCore.h
+//
+//  Created by Calvin Huang on 2017/3/10.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "KHPlatform.h"
+#import "NSMutableArray+KHSwizzle.h"
+#import "KHPairStore.h"
+
+/**
+ *  Data binding 中與 UIKit 無關的部分
+ *
+ *  section array 的管理、model 的 pair 物件、model 與 cell 的對映
+ *  KHDataBinding 用它來管理 _sectionArray、_pairDic、_cellClassDic
+ *  不需要 UIKit，可以在 Linux 上用 GNUstep 編譯，見 Benchmark/
+ */
+
+NS_ASSUME_NONNULL_BEGIN
+
+//  pair 物件要有 model
+@protocol KHBindingPair <NSObject>
+
+@property (nonatomic,assign,nullable) id model;
+
+@optional
+
+//  compactPairs 用，pair 改成讀寫 store 的 slot
+//  moveState 是 YES 時，把 pair 目前的狀態寫進 slot，用在別的 thread 先建好的 pair
+- (void)attachPairStore:(KHPairStore*)store slot:(NSUInteger)slot moveState:(BOOL)moveState;
+
+//  slot 移除前呼叫，pair 把 slot 的狀態複製回自己
+- (void)detachPairStore;
+
+@end
+
+
+@interface KHBindingCore : NSObject
+
+//  綁定的 array，index 就是 section
+@property (nonatomic,readonly) NSMutableArray *sectionArray;
+
+//  key: [NSValue valueWithNonretainedObject:model] / value: pair，compactPairs 時是空的
+@property (nonatomic,readonly) NSMutableDictionary *pairDic;
+
+//  pair 的狀態改放在 pairStore，pair 物件只在 pairOfModel: 時產生，預設 NO
+//  pairFactory 產生的物件要實作 attachPairStore:slot:moveState: 與 detachPairStore
+//  已經有 pair 時不能切換，會丟 exception
+@property (nonatomic) BOOL compactPairs;
+@property (nullable,nonatomic,readonly) KHPairStore *pairStore;
+
+//  key: model class name / value: cell class name，或是 mapping block
+@property (nonatomic,readonly) NSMutableDictionary *cellClassDic;
+
+//  產生 pair 物件
+@property (nonatomic,copy) id<KHBindingPair> _Nonnull(^pairFactory)(void);
+
+#pragma mark - Section
+
+//  把 array 加到最後一個 section，設定 kh_delegate 與 section，已經綁定過就回傳 NO
+//  array 可以是 NSMutableArray、KHPagedArray、KHSnapshotArray、KHProjectedArray 或 KHGroupSection
+- (BOOL)addSection:(id)array delegate:(nullable id)delegate;
+
+//  加入由 KHMulticastBinding 通知變動的 array，不設定它的 kh_delegate 與 section，已經綁定過就回傳 NO
+- (BOOL)addSharedSection:(id)array;
+
+//  移除 section，後面 array 的 section 會往前移，沒有綁定過就回傳 NO
+- (BOOL)removeSection:(id)array;
+
+//  把 array 插入到某個 section，後面 array 的 section 會往後移，已經綁定過就回傳 NO
+- (BOOL)insertSection:(id)array atIndex:(NSInteger)section delegate:(nullable id)delegate;
+
+- (NSInteger)sectionOfArray:(id)array;
+
+//  取得某 model 的 index
+- (nullable NSIndexPath*)indexPathOfModel:(id)model;
+
+#pragma mark - Pair
+
+- (nullable id)pairOfModel:(id)model;
+
+//  取得或建立 model 的 pair
+- (id)addPair:(id)model;
+
+//  建立 model 的 pair，不需要 pair 物件時用這個，compactPairs 時只會佔一個 slot
+- (void)registerPair:(id)model;
+
+//  目前 pair 的數量
+- (NSUInteger)pairCount;
+
+//  回傳被移除的 pair
+- (nullable id)removePair:(id)model;
+
+- (void)replacePair:(id)oldModel new:(id)newModel;
+
+#pragma mark - Mapping
+
+- (void)setMappingModelName:(NSString*)modelName cellName:(NSString*)cellName;
+- (void)setMappingModelName:(NSString*)modelName block:(Class _Nullable(^)(id model, NSIndexPath *index))mappingBlock;
+
+//  用 model 來找對應的 cell class name，找不到會丟 exception
+- (nullable NSString*)cellNameForModel:(id)model index:(nullable NSIndexPath*)index;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,287 @@
+//
+//  KHBindingCore.m
+//
+//  Created by Calvin Huang on 2017/3/10.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import "KHBindingCore.h"
+
+@implementation KHBindingCore
+{
+    //  addSharedSection: 加入的 array，kh_delegate 與 section 不是這個 core 的，比對 pointer
+    NSHashTable *_sharedSections;
+}
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self) {
+        _sharedSections = [[NSHashTable alloc] initWithOptions:NSPointerFunctionsStrongMemory|NSPointerFunctionsObjectPointerPersonality capacity: 1 ];
+        _sectionArray = [[NSMutableArray alloc] initWithCapacity: 10 ];
+        _pairDic = [[NSMutableDictionary alloc] initWithCapacity: 5 ];
+        _cellClassDic = [[NSMutableDictionary alloc] initWithCapacity: 5 ];
+    }
+    return self;
+}
+
+#pragma mark - Section
+
+- (BOOL)addSection:(id)array delegate:(id)delegate
+{
+    //  Gevin note: 不知道為何，containsObject: 把兩個空 array 視為同一個，所以要比對 pointer
+    if ( [self sectionOfArray:array] != NSNotFound ) {
+        return NO;
+    }
+    [array setKh_delegate:delegate];
+    [array setSection:_sectionArray.count];
+    [_sectionArray addObject: array ];
+    return YES;
+}
+
+- (BOOL)addSharedSection:(id)array
+{
+    if ( [self sectionOfArray:array] != NSNotFound ) {
+        return NO;
+    }
+    [_sharedSections addObject:array];
+    [_sectionArray addObject: array ];
+    return YES;
+}
+
+- (BOOL)removeSection:(id)array
+{
+    NSInteger section = [self sectionOfArray:array];
+    if ( section == NSNotFound ) {
+        return NO;
+    }
+    if ( [_sharedSections containsObject:array] ) {
+        [_sharedSections removeObject:array];
+    }
+    else {
+        [array setKh_delegate:nil];
+        [array setSection:0];
+    }
+    [_sectionArray removeObjectAtIndex:section];
+    [self renumberSectionsFrom:section];
+    return YES;
+}
+
+- (BOOL)insertSection:(id)array atIndex:(NSInteger)section delegate:(id)delegate
+{
+    if ( [self sectionOfArray:array] != NSNotFound ) {
+        return NO;
+    }
+    [array setKh_delegate:delegate];
+    [_sectionArray insertObject:array atIndex:section];
+    [self renumberSectionsFrom:section];
+    return YES;
+}
+
+//  section 之後的 array 位置都變了，重新設定 section
+- (void)renumberSectionsFrom:(NSInteger)section
+{
+    for ( NSInteger i=section; i<_sectionArray.count; i++ ) {
+        if ( ![_sharedSections containsObject:_sectionArray[i]] ) {
+            [_sectionArray[i] setSection:i];
+        }
+    }
+}
+
+- (NSInteger)sectionOfArray:(id)array
+{
+    return [_sectionArray indexOfObjectIdenticalTo:array];
+}
+
+- (NSIndexPath*)indexPathOfModel:(id)model
+{
+    for ( NSInteger i=0 ; i<_sectionArray.count ; i++ ) {
+        //  KHPagedArray 也有實作 indexOfObjectIdenticalTo:，只會找已載入的 page，不會觸發 fetch
+        //  KHSnapshotArray 找的是畫面上的 snapshot
+        NSArray *arr = _sectionArray[i];
+        NSUInteger row = [arr indexOfObjectIdenticalTo:model];
+        if ( row != NSNotFound ) {
+            return [NSIndexPath indexPathForRow:row inSection:i];
+        }
+    }
+    return nil;
+}
+
+#pragma mark - Pair
+
+- (void)setCompactPairs:(BOOL)compactPairs
+{
+    if ( _compactPairs == compactPairs ) {
+        return;
+    }
+    if ( [self pairCount] > 0 ) {
+        NSException *exception = [NSException exceptionWithName:NSInternalInconsistencyException
+                                                          reason:@"compactPairs must be set before any pair is added"
+                                                        userInfo:nil];
+        @throw exception;
+    }
+    _compactPairs = compactPairs;
+    _pairStore = compactPairs ? [[KHPairStore alloc] initWithCapacity: 64 ] : nil;
+}
+
+- (NSUInteger)pairCount
+{
+    return _pairStore ? _pairStore.count : _pairDic.count;
+}
+
+//  slot 的 pair 物件，還沒有的話才產生，store 只 weak 記住它
+- (id)facadeOfSlot:(NSUInteger)slot
+{
+    id<KHBindingPair> pair = [_pairStore facadeAtSlot:slot];
+    if ( !pair ) {
+        pair = _pairFactory();
+        if ( ![pair respondsToSelector:@selector(attachPairStore:slot:moveState:)] ) {
+            NSException *exception = [NSException exceptionWithName:NSInternalInconsistencyException
+                                                              reason:[NSString stringWithFormat:@"%@ doesn't implement attachPairStore:slot:moveState:", NSStringFromClass([pair class])]
+                                                            userInfo:nil];
+            @throw exception;
+        }
+        [pair attachPairStore:_pairStore slot:slot moveState:NO];
+        [_pairStore setFacade:pair atSlot:slot];
+    }
+    return pair;
+}
+
+- (id)pairOfModel:(id)model
+{
+    if ( _pairStore ) {
+        NSUInteger slot = [_pairStore slotOfModel:model];
+        return slot != NSNotFound ? [self facadeOfSlot:slot] : nil;
+    }
+    NSValue *myKey = [NSValue valueWithNonretainedObject:model];
+    return _pairDic[myKey];
+}
+
+- (id)addPair:(id)model
+{
+    if ( _pairStore ) {
+        return [self facadeOfSlot:[_pairStore addModel:model]];
+    }
+    //  防呆，避免加入兩次 pair
+    id<KHBindingPair> pair = [self pairOfModel:model];
+    if ( !pair ) {
+        pair = _pairFactory();
+        NSValue *myKey = [NSValue valueWithNonretainedObject:model];
+        _pairDic[myKey] = pair;
+        pair.model = model;
+    }
+    return pair;
+}
+
+- (void)registerPair:(id)model
+{
+    if ( _pairStore ) {
+        [_pairStore addModel:model];
+        return;
+    }
+    [self addPair:model];
+}
+
+- (id)removePair:(id)model
+{
+    if ( _pairStore ) {
+        NSUInteger slot = [_pairStore slotOfModel:model];
+        if ( slot == NSNotFound ) {
+            return nil;
+        }
+        //  沒有人拿著 facade 的話就不用產生了
+        id<KHBindingPair> pair = [_pairStore facadeAtSlot:slot];
+        [pair detachPairStore];
+        pair.model = nil;
+        [_pairStore removeSlot:slot];
+        return pair;
+    }
+    NSValue *myKey = [NSValue valueWithNonretainedObject:model];
+    id<KHBindingPair> pair = _pairDic[myKey];
+    if ( pair ) {
+        pair.model = nil;
+        [_pairDic removeObjectForKey:myKey];
+    }
+    return pair;
+}
+
+- (void)replacePair:(id)oldModel new:(id)newModel
+{
+    if ( _pairStore ) {
+        NSUInteger slot = [_pairStore slotOfModel:oldModel];
+        if ( slot == NSNotFound ) {
+            return;
+        }
+        NSUInteger newSlot = [_pairStore slotOfModel:newModel];
+        if ( newSlot != NSNotFound && newSlot != slot ) {
+            [self removePair:newModel];
+        }
+        //  facade 要換 KVO 的對象，由它自己換 slot 的 model
+        id<KHBindingPair> pair = [_pairStore facadeAtSlot:slot];
+        if ( pair ) {
+            pair.model = newModel;
+        }
+        else {
+            [_pairStore moveSlot:slot toModel:newModel];
+        }
+        return;
+    }
+    NSValue *oldKey = [NSValue valueWithNonretainedObject:oldModel];
+    id<KHBindingPair> pair = _pairDic[oldKey];
+    [_pairDic removeObjectForKey:oldKey];
+    pair.model = newModel;
+    if ( pair ) {
+        NSValue *newKey = [NSValue valueWithNonretainedObject:newModel];
+        _pairDic[newKey] = pair;
+    }
+}
+
+#pragma mark - Mapping
+
+- (void)setMappingModelName:(NSString*)modelName cellName:(NSString*)cellName
+{
+    _cellClassDic[modelName] = cellName;
+}
+
+- (void)setMappingModelName:(NSString*)modelName block:(Class _Nullable(^)(id model, NSIndexPath *index))mappingBlock
+{
+    _cellClassDic[modelName] = [mappingBlock copy];
+}
+
+- (NSString*)cellNameForModel:(id)model index:(NSIndexPath*)index
+{
+    NSString *modelName = NSStringFromClass( [model class] );
+    
+    /* Gevin note:
+        NSString 我透過 [cellClass mappingModelClass]; 取出 class 轉成字串，會得到 NSString
+        但是透過 NSString 的實體，取得 class 轉成字串，卻會是 __NSCFConstantString
+        2017-02-13 : 改直接用 class 做檢查
+     
+     */
+    if ( [model isKindOfClass: [NSString class] ] ) {
+        modelName = @"NSString";
+    }
+    else if( [model isKindOfClass:[NSDictionary class]] ){
+        modelName = @"NSDictionary";
+    }
+    else if( [model isKindOfClass:[NSArray class]] ){
+        modelName = @"NSArray";
+    }
+    
+    id obj = _cellClassDic[modelName];
+    //  _cellClassDic 記錄的 不是字串，就是 block，若兩個都沒有
+    if ( [obj isKindOfClass:[NSString class]]) {
+        return obj;
+    }
+    else if( obj != nil ){
+        Class _Nullable(^mappingBlock)(id _Nonnull model, NSIndexPath* _Nonnull index) = obj;
+        Class cellClass = mappingBlock( model, index );
+        NSString *cellName = NSStringFromClass(cellClass);
+        return cellName;
+    }
+    else{
+        @throw [NSException exceptionWithName:@"Invalid Model Class" reason:[NSString stringWithFormat: @"Can't find any CellName map with this class %@", modelName ] userInfo:nil];
+    }
+}
+
+@end
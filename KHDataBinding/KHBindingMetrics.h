@@ -0,0 +1,76 @@
+//
+//  KHBindingMetrics.h
+//
+//  Created by Calvin Huang on 2017/3/8.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ *  Data binding 的效能計數
+ *
+ *  用 dataBinding.metricsEnabled = YES 開啟，沒開的時候 binding 不會建立這個物件，也不會有額外的開銷
+ *  計數都是 atomic 變數，不需要 lock，可以在任何 thread 讀取 snapshot
+ *  iOS 12 以上，cell 設定與 onLoad: 會以 os_signpost interval 送出，可在 Instruments 看到
+ */
+
+NS_ASSUME_NONNULL_BEGIN
+
+typedef NS_ENUM(NSInteger, KHBindingCounter) {
+    KHBindingCounterSizeCacheHit = 0,
+    KHBindingCounterSizeCacheMiss,
+    KHBindingCounterMappingResolve,
+    KHBindingCounterFullReload,
+    KHBindingCounterIncrementalUpdate,
+    KHBindingCounterImageCacheHit,
+    KHBindingCounterImageCacheMiss,
+    //  model 更新時 row 在畫面上，直接對 cell 呼叫 onLoad:
+    KHBindingCounterUpdateApplied,
+    //  model 更新時 row 不在畫面上，只標記 stale
+    KHBindingCounterUpdateDeferred,
+    KHBindingCounterCount
+};
+
+typedef NS_ENUM(NSInteger, KHBindingInterval) {
+    //  cellForRowAtIndexPath: / cellForItemAtIndexPath:
+    KHBindingIntervalCellConfigure = 0,
+    //  -[cell onLoad:]
+    KHBindingIntervalOnLoad,
+    KHBindingIntervalCount
+};
+
+//  beginInterval: 的回傳值，傳給 endInterval:
+typedef struct {
+    uint64_t start;
+    uint64_t signpostID;
+} KHMetricsIntervalToken;
+
+@interface KHBindingMetrics : NSObject
+
+//  是否送出 os_signpost，預設 YES
+@property (nonatomic) BOOL signpostEnabled;
+
+- (void)increment:(KHBindingCounter)counter;
+- (void)add:(uint64_t)amount counter:(KHBindingCounter)counter;
+
+- (KHMetricsIntervalToken)beginInterval:(KHBindingInterval)interval;
+- (void)endInterval:(KHBindingInterval)interval token:(KHMetricsIntervalToken)token cellClass:(nullable Class)cellClass;
+
+- (uint64_t)valueOfCounter:(KHBindingCounter)counter;
+
+//  目前的計數，時間單位是秒
+//  { sizeCacheHit, sizeCacheMiss, mappingResolve, fullReload, incrementalUpdate, imageCacheHit, imageCacheMiss,
+//    updateApplied, updateDeferred,
+//    cellConfigureCount, cellConfigureTime, onLoadCount, onLoadTime,
+//    cellClasses: { className: { cellConfigureCount, cellConfigureTime, onLoadCount, onLoadTime } } }
+- (NSDictionary<NSString*,id>*)snapshot;
+
+- (void)reset;
+
+//  mach_absolute_time 轉成秒
++ (NSTimeInterval)secondsFromMachTime:(uint64_t)machTime;
+
+@end
+
+NS_ASSUME_NONNULL_END
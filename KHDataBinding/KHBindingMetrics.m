@@ -0,0 +1,245 @@
+//
+//  KHBindingMetrics.m
+//
+//  Created by Calvin Huang on 2017/3/8.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import "KHBindingMetrics.h"
+#import <objc/runtime.h>
+#import <mach/mach_time.h>
+#include <stdatomic.h>
+
+#if __has_include(<os/signpost.h>)
+#import <os/signpost.h>
+#define KH_HAS_SIGNPOST 1
+#else
+#define KH_HAS_SIGNPOST 0
+#endif
+
+//  cell class 的 slot 數量，超過的 class 都記到最後一個 slot
+#define KH_METRICS_CLASS_SLOTS 64
+
+typedef struct {
+    _Atomic(uint64_t) count;
+    _Atomic(uint64_t) time;     // mach time
+} KHIntervalCounter;
+
+typedef struct {
+    _Atomic(uintptr_t) cls;
+    KHIntervalCounter intervals[KHBindingIntervalCount];
+} KHCellClassSlot;
+
+static NSString *const kIntervalCountKeys[KHBindingIntervalCount] = { @"cellConfigureCount", @"onLoadCount" };
+static NSString *const kIntervalTimeKeys[KHBindingIntervalCount] = { @"cellConfigureTime", @"onLoadTime" };
+static NSString *const kCounterKeys[KHBindingCounterCount] = {
+    @"sizeCacheHit",
+    @"sizeCacheMiss",
+    @"mappingResolve",
+    @"fullReload",
+    @"incrementalUpdate",
+    @"imageCacheHit",
+    @"imageCacheMiss",
+    @"updateApplied",
+    @"updateDeferred",
+};
+
+@implementation KHBindingMetrics
+{
+    _Atomic(uint64_t) _counters[KHBindingCounterCount];
+    KHIntervalCounter _intervals[KHBindingIntervalCount];
+
+    //  open addressing，slot 一旦被某個 class 佔用就不會再改，所以查找不需要 lock
+    KHCellClassSlot _classSlots[KH_METRICS_CLASS_SLOTS+1];
+
+#if KH_HAS_SIGNPOST
+    os_log_t _signpostLog;
+#endif
+}
+
++ (NSTimeInterval)secondsFromMachTime:(uint64_t)machTime
+{
+    static mach_timebase_info_data_t timebase;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        mach_timebase_info(&timebase);
+    });
+    return (double)machTime * timebase.numer / timebase.denom / NSEC_PER_SEC;
+}
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self) {
+        _signpostEnabled = YES;
+        [self reset];
+#if KH_HAS_SIGNPOST
+        if (@available(iOS 12.0, macOS 10.14, *)) {
+            _signpostLog = os_log_create("com.gevinchen.KHDataBinding", "KHDataBinding");
+        }
+#endif
+    }
+    return self;
+}
+
+#pragma mark - Counter
+
+- (void)increment:(KHBindingCounter)counter
+{
+    atomic_fetch_add_explicit( &_counters[counter], 1, memory_order_relaxed );
+}
+
+- (void)add:(uint64_t)amount counter:(KHBindingCounter)counter
+{
+    atomic_fetch_add_explicit( &_counters[counter], amount, memory_order_relaxed );
+}
+
+- (uint64_t)valueOfCounter:(KHBindingCounter)counter
+{
+    return atomic_load_explicit( &_counters[counter], memory_order_relaxed );
+}
+
+#pragma mark - Interval
+
+- (KHMetricsIntervalToken)beginInterval:(KHBindingInterval)interval
+{
+    KHMetricsIntervalToken token = { mach_absolute_time(), 0 };
+#if KH_HAS_SIGNPOST
+    if ( _signpostEnabled ) {
+        if (@available(iOS 12.0, macOS 10.14, *)) {
+            os_signpost_id_t spid = os_signpost_id_generate( _signpostLog );
+            token.signpostID = spid;
+            //  os_signpost 的 name 必須是字串常數，所以用 switch
+            switch (interval) {
+                case KHBindingIntervalCellConfigure:
+                    os_signpost_interval_begin( _signpostLog, spid, "CellConfigure" );
+                    break;
+                case KHBindingIntervalOnLoad:
+                    os_signpost_interval_begin( _signpostLog, spid, "OnLoad" );
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+#endif
+    return token;
+}
+
+- (void)endInterval:(KHBindingInterval)interval token:(KHMetricsIntervalToken)token cellClass:(Class)cellClass
+{
+    uint64_t elapsed = mach_absolute_time() - token.start;
+
+    atomic_fetch_add_explicit( &_intervals[interval].count, 1, memory_order_relaxed );
+    atomic_fetch_add_explicit( &_intervals[interval].time, elapsed, memory_order_relaxed );
+
+    if ( cellClass ) {
+        KHCellClassSlot *slot = [self slotForClass:cellClass];
+        atomic_fetch_add_explicit( &slot->intervals[interval].count, 1, memory_order_relaxed );
+        atomic_fetch_add_explicit( &slot->intervals[interval].time, elapsed, memory_order_relaxed );
+    }
+
+#if KH_HAS_SIGNPOST
+    if ( token.signpostID != 0 ) {
+        if (@available(iOS 12.0, macOS 10.14, *)) {
+            const char *className = cellClass ? class_getName(cellClass) : "";
+            switch (interval) {
+                case KHBindingIntervalCellConfigure:
+                    os_signpost_interval_end( _signpostLog, token.signpostID, "CellConfigure", "%{public}s", className );
+                    break;
+                case KHBindingIntervalOnLoad:
+                    os_signpost_interval_end( _signpostLog, token.signpostID, "OnLoad", "%{public}s", className );
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+#endif
+}
+
+- (KHCellClassSlot*)slotForClass:(Class)cellClass
+{
+    uintptr_t key = (uintptr_t)cellClass;
+    NSUInteger start = (key >> 4) % KH_METRICS_CLASS_SLOTS;
+    for ( NSUInteger i=0; i<KH_METRICS_CLASS_SLOTS; i++ ) {
+        KHCellClassSlot *slot = &_classSlots[ (start + i) % KH_METRICS_CLASS_SLOTS ];
+        uintptr_t current = atomic_load_explicit( &slot->cls, memory_order_acquire );
+        if ( current == key ) {
+            return slot;
+        }
+        if ( current == 0 ) {
+            uintptr_t expected = 0;
+            if ( atomic_compare_exchange_strong( &slot->cls, &expected, key ) || expected == key ) {
+                return slot;
+            }
+        }
+    }
+    //  slot 滿了
+    return &_classSlots[KH_METRICS_CLASS_SLOTS];
+}
+
+#pragma mark - Snapshot
+
+- (NSDictionary*)snapshot
+{
+    NSMutableDictionary *snapshot = [[NSMutableDictionary alloc] initWithCapacity: KHBindingCounterCount + KHBindingIntervalCount * 2 + 1 ];
+    for ( NSInteger i=0; i<KHBindingCounterCount; i++ ) {
+        snapshot[kCounterKeys[i]] = @( atomic_load_explicit( &_counters[i], memory_order_relaxed ) );
+    }
+    [self fillIntervals:_intervals toDictionary:snapshot];
+
+    NSMutableDictionary *classes = [[NSMutableDictionary alloc] init];
+    for ( NSInteger i=0; i<=KH_METRICS_CLASS_SLOTS; i++ ) {
+        KHCellClassSlot *slot = &_classSlots[i];
+        uintptr_t cls = atomic_load_explicit( &slot->cls, memory_order_acquire );
+        NSString *className = nil;
+        if ( i == KH_METRICS_CLASS_SLOTS ) {
+            if ( atomic_load_explicit( &slot->intervals[0].count, memory_order_relaxed ) == 0 &&
+                 atomic_load_explicit( &slot->intervals[1].count, memory_order_relaxed ) == 0 ) {
+                continue;
+            }
+            className = @"(other)";
+        }
+        else if ( cls == 0 ) {
+            continue;
+        }
+        else{
+            className = NSStringFromClass( (__bridge Class)(void*)cls );
+        }
+        NSMutableDictionary *classDic = [[NSMutableDictionary alloc] initWithCapacity: KHBindingIntervalCount * 2 ];
+        [self fillIntervals:slot->intervals toDictionary:classDic];
+        classes[className] = classDic;
+    }
+    snapshot[@"cellClasses"] = classes;
+    return snapshot;
+}
+
+- (void)fillIntervals:(KHIntervalCounter*)intervals toDictionary:(NSMutableDictionary*)dic
+{
+    for ( NSInteger i=0; i<KHBindingIntervalCount; i++ ) {
+        dic[kIntervalCountKeys[i]] = @( atomic_load_explicit( &intervals[i].count, memory_order_relaxed ) );
+        uint64_t time = atomic_load_explicit( &intervals[i].time, memory_order_relaxed );
+        dic[kIntervalTimeKeys[i]] = @( [KHBindingMetrics secondsFromMachTime:time] );
+    }
+}
+
+- (void)reset
+{
+    for ( NSInteger i=0; i<KHBindingCounterCount; i++ ) {
+        atomic_store_explicit( &_counters[i], 0, memory_order_relaxed );
+    }
+    for ( NSInteger i=0; i<KHBindingIntervalCount; i++ ) {
+        atomic_store_explicit( &_intervals[i].count, 0, memory_order_relaxed );
+        atomic_store_explicit( &_intervals[i].time, 0, memory_order_relaxed );
+    }
+    //  class slot 不清掉 class，只歸零計數，讓查找維持 lock free
+    for ( NSInteger i=0; i<=KH_METRICS_CLASS_SLOTS; i++ ) {
+        for ( NSInteger j=0; j<KHBindingIntervalCount; j++ ) {
+            atomic_store_explicit( &_classSlots[i].intervals[j].count, 0, memory_order_relaxed );
+            atomic_store_explicit( &_classSlots[i].intervals[j].time, 0, memory_order_relaxed );
+        }
+    }
+}
+
+@end
@@ -0,0 +1,64 @@
+//
+//  KHBindingState.h
+//
+//  Created by Calvin Huang on 2017/3/12.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "KHPlatform.h"
+
+//  binding 狀態的快照
+//
+//  記憶體不足或重新啟動後，列表畫面要回到原本的樣子需要這些資料：
+//  每個 section 的 model identity、以 model identity 為 key 的 cell size（在某個 container 寬度量測的）、
+//  捲動的錨點（第一個顯示的 model 與超出它的距離）、畫面上 cell 的圖片網址
+//  model 本身不存，資料還是由 app 自己還原，identity 由 KHDataBinding.stateIdentifierBlock 提供
+//
+//  KHDataBinding 用 captureState 建立，restoreState: 套用
+//  檔案是 binary property list，size 以 float32 成對存放：
+//
+//  { version, width, sections: [[id]], sizeIdentifiers: [id], sizes: <float32 width, height ...>, anchor, anchorOffset, imageURLs }
+//
+//  呼叫 writeToFile:completion: 之後不要再修改，encode 是在背景執行的
+
+NS_ASSUME_NONNULL_BEGIN
+
+extern NSString *const KHBindingStateErrorDomain;
+
+@interface KHBindingState : NSObject
+
+//  size 量測時 container 的寬度，restore 時寬度不同的話，size 不會使用
+@property (nonatomic) double containerWidth;
+
+//  每個 section 的 model identity，依 section 順序
+@property (nonatomic,copy) NSArray<NSArray<NSString*>*> *sectionIdentifiers;
+
+//  第一個顯示的 model，與畫面頂端超出它的距離 (point)
+@property (nullable,nonatomic,copy) NSString *anchorIdentifier;
+@property (nonatomic) double anchorOffset;
+
+//  畫面上 cell 使用的圖片網址
+@property (nonatomic,copy) NSArray<NSString*> *imageURLs;
+
+//  記錄 size 的 model 數
+@property (nonatomic,readonly) NSUInteger sizeCount;
+
+- (void)setWidth:(double)width height:(double)height forIdentifier:(NSString*)identifier;
+
+//  沒有記錄的話回傳 NO
+- (BOOL)getWidth:(double*)width height:(double*)height forIdentifier:(NSString*)identifier;
+
+- (NSData*)encodedData;
+
+//  格式不對的話回傳 nil
+- (nullable instancetype)initWithData:(NSData*)data error:(NSError* _Nullable * _Nullable)error;
+
++ (nullable instancetype)stateWithContentsOfFile:(NSString*)path error:(NSError* _Nullable * _Nullable)error;
+
+//  在背景 encode 並寫入，completion 在 main thread 呼叫
+- (void)writeToFile:(NSString*)path completion:(nullable void(^)(NSError* _Nullable error))completion;
+
+@end
+
+NS_ASSUME_NONNULL_END
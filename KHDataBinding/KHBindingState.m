@@ -0,0 +1,171 @@
+//
+//  KHBindingState.m
+//
+//  Created by Calvin Huang on 2017/3/12.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import "KHBindingState.h"
+
+NSString *const KHBindingStateErrorDomain = @"KHBindingState";
+
+static const NSInteger KHBindingStateVersion = 1;
+
+@implementation KHBindingState
+{
+    //  依加入順序的 identity，與 _sizes 裡的 float pair 一一對應
+    NSMutableArray *_sizeIdentifiers;
+    //  key: identity / value: _sizeIdentifiers 的 index
+    NSMutableDictionary *_sizeIndexes;
+    //  float32 width, height，little endian
+    NSMutableData *_sizes;
+}
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self) {
+        _sectionIdentifiers = @[];
+        _imageURLs = @[];
+        _sizeIdentifiers = [[NSMutableArray alloc] init];
+        _sizeIndexes = [[NSMutableDictionary alloc] init];
+        _sizes = [[NSMutableData alloc] init];
+    }
+    return self;
+}
+
+#pragma mark - Size
+
+- (NSUInteger)sizeCount
+{
+    return _sizeIdentifiers.count;
+}
+
+- (void)setWidth:(double)width height:(double)height forIdentifier:(NSString*)identifier
+{
+    NSNumber *index = _sizeIndexes[identifier];
+    NSSwappedFloat pair[2] = { NSSwapHostFloatToLittle( (float)width ), NSSwapHostFloatToLittle( (float)height ) };
+    if ( index ) {
+        [_sizes replaceBytesInRange:NSMakeRange( [index unsignedIntegerValue] * sizeof(pair), sizeof(pair) ) withBytes:pair];
+        return;
+    }
+    _sizeIndexes[identifier] = @(_sizeIdentifiers.count);
+    [_sizeIdentifiers addObject:[identifier copy]];
+    [_sizes appendBytes:pair length:sizeof(pair)];
+}
+
+- (BOOL)getWidth:(double*)width height:(double*)height forIdentifier:(NSString*)identifier
+{
+    NSNumber *index = _sizeIndexes[identifier];
+    if ( index == nil ) {
+        return NO;
+    }
+    NSSwappedFloat pair[2];
+    [_sizes getBytes:pair range:NSMakeRange( [index unsignedIntegerValue] * sizeof(pair), sizeof(pair) )];
+    if ( width ) *width = NSSwapLittleFloatToHost( pair[0] );
+    if ( height ) *height = NSSwapLittleFloatToHost( pair[1] );
+    return YES;
+}
+
+#pragma mark - Encode
+
+- (NSData*)encodedData
+{
+    NSMutableDictionary *plist = [@{ @"version":@(KHBindingStateVersion),
+                                     @"width":@(_containerWidth),
+                                     @"sections":_sectionIdentifiers,
+                                     @"sizeIdentifiers":_sizeIdentifiers,
+                                     @"sizes":_sizes,
+                                     @"anchorOffset":@(_anchorOffset),
+                                     @"imageURLs":_imageURLs } mutableCopy];
+    if ( _anchorIdentifier ) {
+        plist[@"anchor"] = _anchorIdentifier;
+    }
+    //  binary plist 相同的字串只存一次，section 與 size 的 identity 不會重複佔空間
+    return [NSPropertyListSerialization dataWithPropertyList:plist format:NSPropertyListBinaryFormat_v1_0 options:0 error:nil];
+}
+
+- (instancetype)initWithData:(NSData*)data error:(NSError**)error
+{
+    self = [self init];
+    if (self) {
+        NSString *reason = [self parseData:data];
+        if ( reason ) {
+            if ( error ) {
+                *error = [NSError errorWithDomain:KHBindingStateErrorDomain code:1 userInfo:@{ NSLocalizedDescriptionKey:reason }];
+            }
+            return nil;
+        }
+    }
+    return self;
+}
+
+//  有問題的話回傳原因
+- (NSString*)parseData:(NSData*)data
+{
+    id plist = data ? [NSPropertyListSerialization propertyListWithData:data options:NSPropertyListImmutable format:NULL error:nil] : nil;
+    if ( ![plist isKindOfClass:[NSDictionary class]] ) {
+        return @"not a binding state";
+    }
+    if ( [plist[@"version"] integerValue] != KHBindingStateVersion ) {
+        return [NSString stringWithFormat:@"unsupported binding state version %@", plist[@"version"]];
+    }
+    NSArray *sections = plist[@"sections"];
+    NSArray *sizeIdentifiers = plist[@"sizeIdentifiers"];
+    NSData *sizes = plist[@"sizes"];
+    NSArray *imageURLs = plist[@"imageURLs"];
+    if ( ![sections isKindOfClass:[NSArray class]] || ![sizeIdentifiers isKindOfClass:[NSArray class]] ||
+         ![sizes isKindOfClass:[NSData class]] || ![imageURLs isKindOfClass:[NSArray class]] ) {
+        return @"binding state is missing fields";
+    }
+    if ( sizes.length != sizeIdentifiers.count * 2 * sizeof(NSSwappedFloat) ) {
+        return @"size count doesn't match identifiers";
+    }
+    _containerWidth = [plist[@"width"] doubleValue];
+    _sectionIdentifiers = sections;
+    _anchorIdentifier = plist[@"anchor"];
+    _anchorOffset = [plist[@"anchorOffset"] doubleValue];
+    _imageURLs = imageURLs;
+    [_sizeIdentifiers addObjectsFromArray:sizeIdentifiers];
+    [_sizes setData:sizes];
+    for ( NSUInteger i=0; i<sizeIdentifiers.count; i++ ) {
+        _sizeIndexes[sizeIdentifiers[i]] = @(i);
+    }
+    return nil;
+}
+
++ (instancetype)stateWithContentsOfFile:(NSString*)path error:(NSError**)error
+{
+    NSData *data = [NSData dataWithContentsOfFile:path options:0 error:error];
+    if ( data == nil ) {
+        return nil;
+    }
+    return [[KHBindingState alloc] initWithData:data error:error];
+}
+
+//  同一個 queue，連續寫同一個檔案時，後寫的會蓋掉先寫的
++ (dispatch_queue_t)writeQueue
+{
+    static dispatch_queue_t queue;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        queue = dispatch_queue_create( "KHBindingState.write", DISPATCH_QUEUE_SERIAL );
+    });
+    return queue;
+}
+
+- (void)writeToFile:(NSString*)path completion:(void(^)(NSError*))completion
+{
+    NSString *filePath = [path copy];
+    dispatch_async( [KHBindingState writeQueue], ^{
+        NSError *error = nil;
+        [[self encodedData] writeToFile:filePath options:NSDataWritingAtomic error:&error];
+        if ( completion ) {
+            dispatch_async( dispatch_get_main_queue(), ^{
+                completion( error );
+            });
+        }
+    });
+}
+
+@end
@@ -7,6 +7,7 @@
 
 #import <UIKit/UIKit.h>
 #import "KVCModel.h"
+#import "KHBindingCore.h"
 
 @class KHDataBinding;
 
@@ -17,11 +18,14 @@ NS_ASSUME_NONNULL_BEGIN
  *  model 與 KHPairInfo 設定之後就固定，不會再變動，cell 會一直變，每當 reuse 就會重新設定 cell  
  *
  *  之後，當 model 有資料變動，才知道要更新哪一個 cell instance
+ *
+ *  KHDataBinding.compactPairStorage 開啟時，KHPairInfo 只是 KHPairStore 某個 slot 的 facade，
+ *  狀態都讀寫 slot，只在有 cell 時才對 model 註冊 KVO
  */
 extern NSString* const kCellSize;
 extern NSString* const kCellHeight;
 
-@interface KHPairInfo : NSObject
+@interface KHPairInfo : NSObject <KHBindingPair>
 {
     //  用來標記說下個 run loop 要執行更新
     BOOL needUpdate;
@@ -38,6 +42,12 @@ extern NSString* const kCellHeight;
 @property (nonatomic) CGSize cellSize;
 @property (nonatomic) BOOL enabledObserveModel;
 @property (nonatomic) NSString* pairCellName;
+//  model 在 row 不在畫面上時更新過，下次取得 size 時重新計算 size
+@property (nonatomic) BOOL stale;
+//  上次確認 size 時 binder 的 updateAll 次數，比 section 最後一次 updateAll 舊的話，size 要重新計算
+@property (nonatomic) NSUInteger updateGeneration;
+//  最近透過 loadImageURL: 載入的圖片網址，KHDataBinding 的 captureState 會記下畫面上 cell 的網址
+@property (nullable,nonatomic,readonly) NSArray<NSString*> *imageURLs;
 
 
 /**
@@ -59,9 +69,16 @@ extern NSString* const kCellHeight;
 - (id)getUserInfo:(id)key;
 
 //  建立 KVO，讓 model 屬性變動後，立即更新到 cell
+//  model 在 binder.multicastBinding 的 array 裡的話，KVO 由它註冊，這裡不會註冊
 - (void)observeModel;
 - (void)deObserveModel;
 
+//  KHMulticastBinding 開始或停止共用 model 時呼叫，重新決定 KVO 要不要由這裡註冊
+- (void)updateModelObserver;
+
+//  model 屬性變動，KVO 或 KHMulticastBinding 呼叫，下個 run loop 更新 cell
+- (void)modelDidChange:(id)model;
+
 //  取得目前的 index
 - (NSIndexPath*)indexPath;
 
@@ -12,12 +12,33 @@
 NSString* const kCellSize = @"kCellSize";
 NSString* const kCellHeight = @"kCellHeight";
 
+//  一個 cell 通常只有幾張圖，只留最近的幾個
+static const NSUInteger kPairImageURLLimit = 4;
+
 static int linkerIDGen = 0;
 @implementation KHPairInfo
 {
     int linkerID;
+    
+    //  compactPairs 時，狀態放在 store 的 slot，自己的 ivar 不用
+    KHPairStore *_pairStore;
+    NSUInteger _slot;
+    
+    //  目前有沒有對 model 註冊 KVO
+    BOOL _observing;
+
+    //  最近載入的圖片網址，不放 userInfo，compactPairs 時放在 store 的 slot
+    NSArray<NSString*> *_imageURLs;
 }
 
+@synthesize binder = _binder;
+@synthesize cell = _cell;
+@synthesize model = _model;
+@synthesize cellSize = _cellSize;
+@synthesize enabledObserveModel = _enabledObserveModel;
+@synthesize pairCellName = _pairCellName;
+@synthesize stale = _stale;
+@synthesize updateGeneration = _updateGeneration;
 
 - (instancetype)init
 {
@@ -35,8 +56,110 @@ static int linkerIDGen = 0;
     [self deObserveModel];
 }
 
+#pragma mark - Pair Store
+
+- (void)attachPairStore:(KHPairStore*)store slot:(NSUInteger)slot moveState:(BOOL)moveState
+{
+    if ( moveState ) {
+        [store setCell:_cell atSlot:slot];
+        [store setWidth:_cellSize.width height:_cellSize.height atSlot:slot];
+        [store setCellName:_pairCellName atSlot:slot];
+        [store setFlags:( _enabledObserveModel ? KHPairFlagObserveModel : 0 ) | ( _stale ? KHPairFlagStale : 0 ) atSlot:slot];
+        [store setGeneration:(uint32_t)_updateGeneration atSlot:slot];
+        for ( id key in _userInfo ) {
+            [store setUserInfo:_userInfo[key] forKey:key atSlot:slot];
+        }
+        [store setImageURLs:_imageURLs atSlot:slot];
+    }
+    _pairStore = store;
+    _slot = slot;
+    _model = nil;
+    _cell = nil;
+    _pairCellName = nil;
+    _userInfo = nil;
+    _imageURLs = nil;
+    //  只有顯示中的 cell 才需要 KVO
+    if ( [store cellAtSlot:slot] ) {
+        [self observeModel];
+    }
+}
+
+- (void)detachPairStore
+{
+    if ( !_pairStore ) {
+        return;
+    }
+    _model = [_pairStore modelAtSlot:_slot];
+    _cell = [_pairStore cellAtSlot:_slot];
+    _cellSize = (CGSize){ [_pairStore widthAtSlot:_slot], [_pairStore heightAtSlot:_slot] };
+    _pairCellName = [_pairStore cellNameAtSlot:_slot];
+    _enabledObserveModel = ( [_pairStore flagsAtSlot:_slot] & KHPairFlagObserveModel ) != 0;
+    _stale = ( [_pairStore flagsAtSlot:_slot] & KHPairFlagStale ) != 0;
+    _updateGeneration = [_pairStore generationAtSlot:_slot];
+    _binder = _pairStore.owner;
+    _userInfo = [[_pairStore userInfoAtSlot:_slot] mutableCopy];
+    _imageURLs = [_pairStore imageURLsAtSlot:_slot];
+    _pairStore = nil;
+}
+
+#pragma mark - Property
+
+- (KHDataBinding*)binder
+{
+    return _pairStore ? _pairStore.owner : _binder;
+}
+
+- (void)setBinder:(KHDataBinding*)binder
+{
+    _binder = binder;
+    if ( _pairStore && binder ) {
+        _pairStore.owner = binder;
+    }
+}
+
+- (id)cell
+{
+    return _pairStore ? [_pairStore cellAtSlot:_slot] : _cell;
+}
+
+- (void)setCell:(id)cell
+{
+    if ( !_pairStore ) {
+        _cell = cell;
+        return;
+    }
+    [_pairStore setCell:cell atSlot:_slot];
+    if ( cell ) {
+        [self observeModel];
+    }
+    else {
+        [self deObserveModel];
+    }
+}
+
+- (id)model
+{
+    return _pairStore ? [_pairStore modelAtSlot:_slot] : _model;
+}
+
 - (void)setModel:(id)model
 {
+    if ( _pairStore && model == nil ) {
+        [self detachPairStore];
+    }
+    if ( _pairStore ) {
+        //  換 slot 的 model，KVO 跟著換
+        if ( model == [_pairStore modelAtSlot:_slot] ) {
+            return;
+        }
+        BOOL observing = _observing;
+        [self deObserveModel];
+        [_pairStore moveSlot:_slot toModel:model];
+        if ( observing ) {
+            [self observeModel];
+        }
+        return;
+    }
     if ( _model ) {
         [self deObserveModel];
     }
@@ -46,6 +169,103 @@ static int linkerIDGen = 0;
     }
 }
 
+- (CGSize)cellSize
+{
+    return _pairStore ? (CGSize){ [_pairStore widthAtSlot:_slot], [_pairStore heightAtSlot:_slot] } : _cellSize;
+}
+
+- (void)setCellSize:(CGSize)cellSize
+{
+    if ( _pairStore ) {
+        [_pairStore setWidth:cellSize.width height:cellSize.height atSlot:_slot];
+        return;
+    }
+    _cellSize = cellSize;
+}
+
+- (BOOL)enabledObserveModel
+{
+    return _pairStore ? ( [_pairStore flagsAtSlot:_slot] & KHPairFlagObserveModel ) != 0 : _enabledObserveModel;
+}
+
+- (void)setEnabledObserveModel:(BOOL)enabledObserveModel
+{
+    if ( _pairStore ) {
+        KHPairFlags flags = [_pairStore flagsAtSlot:_slot];
+        flags = enabledObserveModel ? flags | KHPairFlagObserveModel : flags & ~KHPairFlagObserveModel;
+        [_pairStore setFlags:flags atSlot:_slot];
+        return;
+    }
+    _enabledObserveModel = enabledObserveModel;
+}
+
+- (BOOL)stale
+{
+    return _pairStore ? ( [_pairStore flagsAtSlot:_slot] & KHPairFlagStale ) != 0 : _stale;
+}
+
+- (void)setStale:(BOOL)stale
+{
+    if ( _pairStore ) {
+        KHPairFlags flags = [_pairStore flagsAtSlot:_slot];
+        [_pairStore setFlags:stale ? flags | KHPairFlagStale : flags & ~KHPairFlagStale atSlot:_slot];
+        return;
+    }
+    _stale = stale;
+}
+
+- (NSUInteger)updateGeneration
+{
+    return _pairStore ? [_pairStore generationAtSlot:_slot] : _updateGeneration;
+}
+
+- (void)setUpdateGeneration:(NSUInteger)updateGeneration
+{
+    if ( _pairStore ) {
+        [_pairStore setGeneration:(uint32_t)updateGeneration atSlot:_slot];
+        return;
+    }
+    _updateGeneration = updateGeneration;
+}
+
+- (NSString*)pairCellName
+{
+    return _pairStore ? [_pairStore cellNameAtSlot:_slot] : _pairCellName;
+}
+
+- (void)setPairCellName:(NSString*)pairCellName
+{
+    if ( _pairStore ) {
+        [_pairStore setCellName:pairCellName atSlot:_slot];
+        return;
+    }
+    _pairCellName = pairCellName;
+}
+
+- (NSArray<NSString*>*)imageURLs
+{
+    return _pairStore ? [_pairStore imageURLsAtSlot:_slot] : _imageURLs;
+}
+
+- (void)recordImageURL:(NSString*)urlString
+{
+    NSArray *urls = self.imageURLs;
+    if ( [urls containsObject:urlString] ) {
+        return;
+    }
+    NSMutableArray *newURLs = urls ? [urls mutableCopy] : [[NSMutableArray alloc] initWithCapacity: 1 ];
+    [newURLs addObject:[urlString copy]];
+    if ( newURLs.count > kPairImageURLLimit ) {
+        [newURLs removeObjectAtIndex:0];
+    }
+    if ( _pairStore ) {
+        [_pairStore setImageURLs:newURLs atSlot:_slot];
+        return;
+    }
+    _imageURLs = [newURLs copy];
+}
+
+#pragma mark - User Info
 
 /**
  記錄額外的資料，有一些可能不會在 model 上的資料
@@ -56,6 +276,10 @@ static int linkerIDGen = 0;
  */
 - (void)setUserInfo:(id)key value:(id)valueObj
 {
+    if ( _pairStore ) {
+        [_pairStore setUserInfo:valueObj forKey:key atSlot:_slot];
+        return;
+    }
     if ( _userInfo == nil ) {
         _userInfo = [NSMutableDictionary dictionaryWithCapacity:10];
     }
@@ -71,51 +295,96 @@ static int linkerIDGen = 0;
  */
 - (id)getUserInfo:(id)key
 {
+    if ( _pairStore ) {
+        return [_pairStore userInfoForKey:key atSlot:_slot];
+    }
     if ( _userInfo ) {
         return _userInfo[key];
     }
     return nil;
 }
 
+#pragma mark - Observe
 
 - (void)observeModel
 {
+    id model = self.model;
+    if ( _observing || model == nil ) {
+        return;
+    }
+    //  同一個 model 只由 multicastBinding 註冊一次，變動時它會呼叫 modelDidChange:
+    if ( [self.binder.multicastBinding containsModel:model] ) {
+        return;
+    }
+    _observing = YES;
     // 解析 property
     unsigned int numOfProperties;
-    objc_property_t *properties = class_copyPropertyList( [self.model class], &numOfProperties );
+    objc_property_t *properties = class_copyPropertyList( [model class], &numOfProperties );
     for ( unsigned int pi = 0; pi < numOfProperties; pi++ ) {
         //  取出 property name
         objc_property_t property = properties[pi];
         NSString *propertyName = [[NSString alloc] initWithCString:property_getName(property) encoding:NSUTF8StringEncoding];
-        [self.model addObserver:self forKeyPath:propertyName options:NSKeyValueObservingOptionNew context:NULL]; //NSKeyValueObservingOptionOld
+        [model addObserver:self forKeyPath:propertyName options:NSKeyValueObservingOptionNew context:NULL]; //NSKeyValueObservingOptionOld
+    }
+    free( properties );
+}
+
+- (void)updateModelObserver
+{
+    id model = self.model;
+    if ( model == nil ) {
+        return;
+    }
+    if ( [self.binder.multicastBinding containsModel:model] ) {
+        [self deObserveModel];
+    }
+    else if ( !_pairStore || [_pairStore cellAtSlot:_slot] ) {
+        //  compactPairStorage 只有顯示中的 cell 才需要 KVO
+        [self observeModel];
     }
-    
 }
 
 - (void)deObserveModel
 {
+    id model = self.model;
+    if ( !_observing || model == nil ) {
+        return;
+    }
+    _observing = NO;
     // 解析 property
     unsigned int numOfProperties;
-    objc_property_t *properties = class_copyPropertyList( [self.model class], &numOfProperties );
+    objc_property_t *properties = class_copyPropertyList( [model class], &numOfProperties );
     for ( unsigned int pi = 0; pi < numOfProperties; pi++ ) {
         //  取出 property name
         objc_property_t property = properties[pi];
         NSString *propertyName = [[NSString alloc] initWithCString:property_getName(property) encoding:NSUTF8StringEncoding];
-        [self.model removeObserver:self forKeyPath:propertyName];
+        [model removeObserver:self forKeyPath:propertyName];
     }
+    free( properties );
 }
 
 - (void)observeValueForKeyPath:(NSString *)keyPath ofObject:(id)object change:(NSDictionary<NSString *,id> *)change context:(void *)context
 {
 //    NSLog(@"%d : kvo >> [%@] %@ value: %@", linkerID, NSStringFromClass([object class]),keyPath, change[@"new"] );
+    [self modelDidChange:object];
+}
+
+- (void)modelDidChange:(id)object
+{
     //  note:
     //  這邊的用意是，不希望連續呼叫太多次的 onload，所以用gcd，讓更新在下一個 run loop 執行
     //  如果連續修改多個 property 就不會連續呼叫多次 onload 而影響效能
+    if( self.enabledObserveModel ){
+        [self.binder.mutationRecorder recordModelChange:object];
+    }
     if( self.enabledObserveModel && !needUpdate ){
         needUpdate = YES;
         dispatch_async( dispatch_get_main_queue(), ^{
             if(self.cell){
+                KHHitchRecorder *recorder = self.binder.hitchRecorder;
+                CFTimeInterval hitchStart = [recorder now];
                 [self.cell onLoad: self.model ];
+                [recorder recordEvent:KHHitchEventKVORefresh cellClass:[self.cell class] start:hitchStart];
             }
             needUpdate = NO;
         });
@@ -125,7 +394,7 @@ static int linkerIDGen = 0;
 //  取得目前的 index
 - (NSIndexPath*)indexPath
 {
-    NSIndexPath *index = [self.binder indexPathOfModel:_model];
+    NSIndexPath *index = [self.binder indexPathOfModel:self.model];
     return index;
 }
 
@@ -138,18 +407,23 @@ static int linkerIDGen = 0;
         return;
     }
     
+    [self recordImageURL:urlString];
     [[KHImageDownloader instance] loadImageURL:urlString cellLinker:self completed:completedHandle ];
 }
 
 //  從網路下載圖片，下載完後，直接把圖片填入到傳入的 imageView 裡
 - (void)loadImageURL:(nonnull NSString*)urlString imageView:(nullable UIImageView*)imageView placeHolder:(nullable UIImage*)placeHolderImage brokenImage:(nullable UIImage*)brokenImage animation:(BOOL)animated
 {
+    if ( urlString.length > 0 ) {
+        [self recordImageURL:urlString];
+    }
     //  若圖片下載過了，就直接呈現
     UIImage *image = [[KHImageDownloader instance] getImageFromCache:urlString];
     if( image == nil ){
         imageView.image = placeHolderImage;
     }
     else{
+        [self.binder.metrics increment:KHBindingCounterImageCacheHit];
         imageView.image = image;
         return;
     }
@@ -11,6 +11,16 @@
 #import "KHCell.h"
 #import "NSMutableArray+KHSwizzle.h"
 #import "KHImageDownloader.h"
+#import "KHPagedArray.h"
+#import "KHSnapshotArray.h"
+#import "KHProjectedArray.h"
+#import "KHGroupedArray.h"
+#import "KHSearchIndex.h"
+#import "KHBindingMetrics.h"
+#import "KHHitchRecorder.h"
+#import "KHMutationTrace.h"
+#import "KHMulticastBinding.h"
+#import "KHBindingState.h"
 
 /**
  *  Data binding
@@ -36,7 +46,7 @@
 @end
 
 
-@interface KHDataBinding : NSObject < KHArrayObserveDelegate >
+@interface KHDataBinding : NSObject < KHArrayObserveDelegate, KHPagedArrayObserveDelegate, KHSnapshotArrayObserveDelegate, KHProjectedArrayObserveDelegate, KHGroupedArrayObserveDelegate >
 {
     //  記錄 CKHObserverArray
     NSMutableArray *_sectionArray;
@@ -56,7 +66,10 @@
     NSAttributedString *refreshTitle2;
     NSInteger refreshState;
 
+    //  metricsEnabled 才會建立
+    KHBindingMetrics *_metrics;
     
+    KHHitchRecorder *_hitchRecorder;
 }
 // pull down to refresh
 @property (nonatomic,copy,nullable) NSString *headTitle;
@@ -70,8 +83,47 @@
 @property (nonatomic) BOOL isLoading;
 @property (nonatomic) BOOL isNeedAnimation;
 @property (nonatomic) CGFloat onEndReachedThresHold;
+
+//  依實際量到的 onEndReached: 到資料插入的時間，與目前捲動速度，自動把觸發點提前，預設 YES
+//  觸發的距離不會小於 onEndReachedThresHold
+@property (nonatomic) BOOL adaptiveEndReached;
+//  目前實際使用的觸發距離 (point)
+@property (nonatomic,readonly) CGFloat adaptiveThresHold;
+//  最近幾次從 onEndReached: 到最後一個 section 插入資料的時間 (秒)，舊的在前
+@property (nonatomic,readonly,nonnull) NSArray<NSNumber*> *endReachedLatencies;
+//  用來計算觸發距離的 latency 估計值 (秒)
+@property (nonatomic,readonly) NSTimeInterval estimatedEndReachedLatency;
+//  目前往下捲動的速度 (point/秒)
+@property (nonatomic,readonly) CGFloat scrollVelocity;
+//  latency 與捲動速度用的時間 (秒)，nil 時用 CACurrentMediaTime()，測試時可以換成手動前進的時間，回傳值要大於 0
+@property (nonatomic,copy,nullable) CFTimeInterval(^endReachedClock)(void);
 @property (nonatomic) NSTimeInterval lastUpdate;
 
+//  開啟效能計數，預設 NO，關閉時 metrics 為 nil
+@property (nonatomic) BOOL metricsEnabled;
+@property (nullable,nonatomic,readonly) KHBindingMetrics *metrics;
+
+//  設定後，捲動時會記錄掉 frame 的當下 binding 做了什麼，預設 nil
+@property (nullable,nonatomic,strong) KHHitchRecorder *hitchRecorder;
+
+//  設定後，綁定的 NSMutableArray 的每個變動與 model 的 KVO 都會記錄成 trace，預設 nil
+//  已經綁定的 array 會先記下目前的內容
+@property (nullable,nonatomic,strong) KHMutationRecorder *mutationRecorder;
+
+//  pairInfo 的狀態改放在連續的 struct array，KHPairInfo 只在 getPairInfo: 時產生，預設 NO
+//  要在綁定任何 array 之前設定，之後設定會丟 exception
+@property (nonatomic) BOOL compactPairStorage;
+
+//  compactPairStorage 時，pair 狀態的 storage，沒開啟的話是 nil
+@property (nullable,nonatomic,readonly) KHPairStore *pairStore;
+
+//  加入的 KHMulticastBinding，由它的 addBinding: / removeBinding: 設定，不要直接修改
+//  它的 array 綁定到這個 binding 時，共用 model 的 KVO，變動通知也由它轉過來
+@property (nullable,nonatomic,weak) KHMulticastBinding *multicastBinding;
+
+//  model 的 identity，captureState 與 restoreState: 用它找回同一個 model，回傳 nil 的 model 不記錄
+@property (nullable,nonatomic,copy) NSString* _Nullable(^stateIdentifierBlock)(id _Nonnull model);
+
 @property (nullable,nonatomic,weak) id delegate;
 
 - (nonnull instancetype)initWithView:(UIView* _Nonnull)view delegate:(id _Nullable)delegate registerClass:(NSArray<Class>* _Nullable)cellClasses;
@@ -95,12 +147,58 @@
 //  解綁定一個array
 - (void)deBindArray:(NSMutableArray* _Nonnull)array;
 
-//  取得一個已綁定的 array
+//  生成一個已綁定的 paged array，總數已知，資料依 page 向 dataSource 取得
+- (nonnull KHPagedArray*)createBindPagedArray:(NSUInteger)totalCount pageSize:(NSUInteger)pageSize dataSource:(id<KHPagedArrayDataSource> _Nullable)dataSource;
+
+//  綁定一個 paged array
+- (void)bindPagedArray:(KHPagedArray* _Nonnull)pagedArray;
+
+//  解綁定一個 paged array
+- (void)deBindPagedArray:(KHPagedArray* _Nonnull)pagedArray;
+
+//  生成一個已綁定的 snapshot array，可以在任何 thread 修改，pair 在背景準備好後，於 main thread 一次換上
+- (nonnull KHSnapshotArray*)createBindSnapshotArray;
+
+//  綁定一個 snapshot array
+- (void)bindSnapshotArray:(KHSnapshotArray* _Nonnull)snapshotArray;
+
+//  解綁定一個 snapshot array
+- (void)deBindSnapshotArray:(KHSnapshotArray* _Nonnull)snapshotArray;
+
+//  生成一個已綁定的 projection，顯示 source 裡符合 predicate 的 model，依 comparator 排序，source 變動時只更新有變的 row
+//  與 source 共用 pairInfo，source 不一定要綁定
+- (nonnull KHProjectedArray*)createBindProjectedArray:(NSMutableArray* _Nonnull)source predicate:(NSPredicate* _Nullable)predicate comparator:(NSComparator _Nullable)comparator;
+
+//  綁定一個 projection
+- (void)bindProjectedArray:(KHProjectedArray* _Nonnull)projectedArray;
+
+//  解綁定一個 projection
+- (void)deBindProjectedArray:(KHProjectedArray* _Nonnull)projectedArray;
+
+//  生成一個已綁定的 grouped array，source 依 keyBlock 回傳的 key 分成多個 section，source 變動時 section 與 row 一起局部更新
+//  group 佔用從 groupedArray.section 開始連續的 section，source 不一定要綁定
+- (nonnull KHGroupedArray*)createBindGroupedArray:(NSMutableArray* _Nonnull)source keyBlock:(id<NSCopying> _Nonnull(^ _Nonnull)(id _Nonnull model))keyBlock keyComparator:(NSComparator _Nullable)keyComparator;
+
+//  綁定一個 grouped array
+- (void)bindGroupedArray:(KHGroupedArray* _Nonnull)groupedArray;
+
+//  解綁定一個 grouped array
+- (void)deBindGroupedArray:(KHGroupedArray* _Nonnull)groupedArray;
+
+//  取得 array 的 search index，沒有的話建立一個並在背景 build，deBindArray: 時一起移除
+//  keyPaths 是 nil 的話，用 model class 裡所有 NSString 的 property，已經有 index 的話直接回傳
+//  已經有 index 而 keyPaths 不同會丟 exception，要換 keyPaths 先 deBindArray:
+- (nonnull KHSearchIndex*)searchIndexForArray:(NSMutableArray* _Nonnull)array keyPaths:(NSArray<NSString*>* _Nullable)keyPaths;
+
+//  取得一個已綁定的 array，若該 section 綁的是 KHPagedArray、KHSnapshotArray、KHProjectedArray 或 KHGroupSection，回傳的會是該物件
 - (nullable NSMutableArray*)getArray:(NSInteger)section;
 
 //  取得有幾個 section (array)
 - (NSInteger)sectionCount;
 
+//  array 在這個 binding 的 section，沒有綁定的話回傳 NSNotFound
+- (NSInteger)sectionOfArray:(id _Nonnull)array;
+
 //  override by subclass，把 cell 註冊至 tableView 或 collectionView
 - (void)registerCell:(NSString* _Nonnull)cellName;
 
@@ -139,6 +237,21 @@
 
 
 
+#pragma mark - State Restoration
+
+//  記下每個 section 的 model identity、cell size、捲動位置與畫面上的圖片網址
+//  沒有設定 stateIdentifierBlock 會丟 exception
+- (nonnull KHBindingState*)captureState;
+
+//  captureState 之後在背景寫入，completion 在 main thread 呼叫
+- (void)saveStateToFile:(NSString* _Nonnull)path completion:(void(^ _Nullable)(NSError* _Nullable error))completion;
+
+//  array 綁定並填入資料之後呼叫
+//  container 寬度相同的話，記錄的 size 直接填入還沒有 size 的 pairInfo，捲回先前的位置不用量測 cell，並預先下載畫面上的圖片
+//  回傳填入 size 的 model 數
+- (NSUInteger)restoreState:(KHBindingState* _Nonnull)state;
+
+
 #pragma mark - UIControl Handle
 
 //  設定當 cell 裡的 ui control 被按下發出事件時，觸發的 method
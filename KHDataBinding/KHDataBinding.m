@@ -127,22 +127,81 @@
 
 @end
 
+//  記錄幾次 end reached latency
+static const NSUInteger kEndReachedLatencyWindow = 10;
+//  latency 估計值乘上這個倍數，讓資料確定在 user 捲到底前就到
+static const CGFloat kEndReachedSafetyFactor = 1.2;
+//  觸發距離最多幾個畫面高，避免 fling 的瞬間速度讓它太早觸發
+static const CGFloat kEndReachedMaxScreens = 6;
+
 @interface KHDataBinding()
 
 @property (nonatomic, assign) BOOL hasCalledOnEndReached;
 
+//  觸發 onEndReached: 時的 thresHold，捲回這個距離之外才能再觸發
+@property (nonatomic, assign) CGFloat endReachedTriggerThresHold;
+
+//  呼叫 onEndReached: 的時間，0 表示沒有在等資料
+@property (nonatomic, assign) CFTimeInterval endReachedTime;
+
+@property (nonatomic, assign) CGFloat lastScrollOffset;
+@property (nonatomic, assign) CFTimeInterval lastScrollTime;
+
+//  metrics 與 hitch 的記錄，見 Instrumentation
+- (void)loadModel:(id)model cell:(id)cell;
+- (void)recordMutation:(SEL)selector block:(void(^)(void))block;
+
+//  model 更新時依 row 是否在畫面上處理，見 Update Routing
+- (void)routeUpdateOfModel:(id)model index:(NSIndexPath*)index;
+- (void)routeUpdateAllOfArray:(NSMutableArray*)array;
+- (void)resolveStalePairInfo:(KHPairInfo*)pairInfo model:(id)model index:(NSIndexPath*)index;
+
+//  不會觸發 KHPagedArray 載入，見 State Restoration
+- (nullable id)loadedModelAtIndexPath:(NSIndexPath*)index;
+
 @end
 
 @implementation KHDataBinding
+{
+    NSMutableArray *_endReachedLatencies;
+    
+    //  section、pair、mapping 的管理，_sectionArray、_pairDic、_cellClassDic 都是它的
+    KHBindingCore *_core;
+    
+    //  已綁定的 grouped array，依綁定的順序，也就是 section 的順序
+    NSMutableArray *_groupedArrays;
+    
+    //  key: array（比對 pointer）/ value: KHSearchIndex
+    NSMapTable *_searchIndexes;
+    
+    //  updateAll 的次數，pair 記下確認 size 時的值
+    NSUInteger _updateGeneration;
+    //  key: array（比對 pointer，weak）/ value: 那個 section 最後一次 updateAll 時的 _updateGeneration
+    NSMapTable *_sectionGenerations;
+}
 
 - (instancetype)init
 {
     self = [super init];
     if (self) {
         _isNeedAnimation = YES;
-        _sectionArray = [[NSMutableArray alloc] initWithCapacity: 10 ];
-        _pairDic   = [[NSMutableDictionary alloc] initWithCapacity: 5 ];
-        _cellClassDic = [[NSMutableDictionary alloc] initWithCapacity: 5 ];
+        _adaptiveEndReached = YES;
+        _endReachedLatencies = [[NSMutableArray alloc] initWithCapacity: kEndReachedLatencyWindow ];
+        _core = [[KHBindingCore alloc] init];
+        _groupedArrays = [[NSMutableArray alloc] init];
+        _searchIndexes = [[NSMapTable alloc] initWithKeyOptions:NSPointerFunctionsStrongMemory|NSPointerFunctionsObjectPointerPersonality
+                                                   valueOptions:NSPointerFunctionsStrongMemory
+                                                       capacity:1];
+        _sectionGenerations = [[NSMapTable alloc] initWithKeyOptions:NSPointerFunctionsWeakMemory|NSPointerFunctionsObjectPointerPersonality
+                                                        valueOptions:NSPointerFunctionsStrongMemory
+                                                            capacity:1];
+        weakRef(self);
+        _core.pairFactory = ^id<KHBindingPair>{
+            return [weak_self createNewPairInfo];
+        };
+        _sectionArray = _core.sectionArray;
+        _pairDic   = _core.pairDic;
+        _cellClassDic = _core.cellClassDic;
         
         //  init UIRefreshControl
         _refreshHeadControl = [[UIRefreshControl alloc] init];
@@ -184,48 +243,47 @@
 - (KHPairInfo*)createNewPairInfo
 {
     KHPairInfo *pairInfo = [[KHPairInfo alloc] init];
+    //  pairInfo 設定 model 時就要知道 binder，才能判斷 KVO 是不是由 multicastBinding 處理
+    pairInfo.binder = self;
+    //  之後才建立的 pair，先前的 updateAll 跟它無關
+    pairInfo.updateGeneration = _updateGeneration;
     return pairInfo;
 }
 
 - (KHPairInfo *) addPairInfo:(id)object
 {
-    //  防呆，避免加入兩次 pairInfo
-    KHPairInfo *pairInfo = [self getPairInfo:object];
-    if ( !pairInfo ) {
-        pairInfo = [self createNewPairInfo];
-        NSValue *myKey = [NSValue valueWithNonretainedObject:object];
-        _pairDic[myKey] = pairInfo;
-    }
+    //  防呆，已經有 pairInfo 的話，core 會直接回傳
+    KHPairInfo *pairInfo = [_core addPair:object];
     pairInfo.binder = self;
-    pairInfo.model = object;
     return pairInfo;
 }
 
+//  不需要回傳 pairInfo 的地方用這個，compactPairStorage 時不會產生 KHPairInfo
+- (void) registerPairInfo:(id)object
+{
+    if ( _core.compactPairs ) {
+        [_core registerPair:object];
+        return;
+    }
+    [self addPairInfo:object];
+}
+
 - (void) removePairInfo:(id)object
 {
-    NSValue *myKey = [NSValue valueWithNonretainedObject:object];
-    KHPairInfo *pairInfo = _pairDic[myKey];
-    pairInfo.model = nil;
+    KHPairInfo *pairInfo = [_core removePair:object];
     pairInfo.cell = nil;
     pairInfo.binder = nil;
-    [_pairDic removeObjectForKey:myKey];
 }
 
 - (void) replacePairInfo:(id)oldObject new:(id)newObject
 {
-    NSValue *oldKey = [NSValue valueWithNonretainedObject:oldObject];
-    KHPairInfo *pairInfo = _pairDic[oldKey];
-    [_pairDic removeObjectForKey:oldKey];
-    pairInfo.model = newObject;
-    NSValue *newKey = [NSValue valueWithNonretainedObject:newObject];
-    _pairDic[newKey] = pairInfo;
+    [_core replacePair:oldObject new:newObject];
 }
 
 //  取得某個 model 的 cell 介接物件
 - (nullable KHPairInfo*)getPairInfo:(id _Nonnull)model
 {
-    NSValue *myKey = [NSValue valueWithNonretainedObject:model];
-    return _pairDic[myKey];
+    return [_core pairOfModel:model];
 }
 
 //  連結 model 與 cell
@@ -235,6 +293,13 @@
     KHPairInfo *pairInfo = [self getPairInfo: model ];
     
     //  斷開先前有 reference 到這個 cell 的 pairInfo  
+    KHPairStore *pairStore = _core.pairStore;
+    if ( pairStore ) {
+        NSUInteger slot = [pairStore slotOfCell:cell];
+        if ( slot != NSNotFound ) {
+            [pairStore setCell:nil atSlot:slot];
+        }
+    }
     for ( NSValue *mykey in _pairDic ) {
         KHPairInfo *tmp_pair = _pairDic[mykey];
         
@@ -274,38 +339,241 @@
 
 - (void)bindArray:(NSMutableArray* _Nonnull)array
 {
-    for ( NSArray *marray in _sectionArray ) {
-        if ( marray == array ) {
-            return;
-        }
+    //  multicastBinding 的 array，變動通知由它轉過來，不能換掉它的 kh_delegate
+    BOOL shared = _multicastBinding != nil && array.kh_delegate == (id)_multicastBinding;
+    if ( shared ? ![_core addSharedSection:array] : ![_core addSection:array delegate:self] ) {
+        return;
+    }
+    //  若 array 裡有資料，那就要建立 proxy
+    for ( id object in array ) {
+        [self registerPairInfo: object ];
     }
-    //  Gevin note: 不知道為何，containsObject: 把兩個空 array 視為同一個
-//    if( ![_sectionArray containsObject:array] ){
-        array.kh_delegate = self;
-        array.section = _sectionArray.count;
-        [_sectionArray addObject: array ];
-        //  若 array 裡有資料，那就要建立 proxy
+    [_mutationRecorder recordArray:array];
+}
+
+- (void)deBindArray:(NSMutableArray* _Nonnull)array
+{
+    if ( [self removeBoundSection:array] ) {
+        [_mutationRecorder stopRecordingArray:array];
+        [_searchIndexes removeObjectForKey:array];
+        //  還有 projection 或 grouped array 以它為 source 的話，它們顯示的 model 要留著 pairInfo
+        NSHashTable *boundModels = [self hasDerivedSectionOfSource:array] ? [self boundModels] : nil;
+        //  移除 proxy
         for ( id object in array ) {
-            [self addPairInfo: object ];
+            if ( ![boundModels containsObject:object] ) {
+                [self removePairInfo: object ];
+            }
         }
-//    }
+    }
 }
 
-- (void)deBindArray:(NSMutableArray* _Nonnull)array
+- (nonnull KHPagedArray*)createBindPagedArray:(NSUInteger)totalCount pageSize:(NSUInteger)pageSize dataSource:(id<KHPagedArrayDataSource> _Nullable)dataSource
 {
-    BOOL find = NO;
-    for ( NSArray *marray in _sectionArray ) {
-        if ( marray == array ) {
-            find = YES;
-            break;
+    KHPagedArray *pagedArray = [[KHPagedArray alloc] initWithTotalCount:totalCount pageSize:pageSize];
+    pagedArray.dataSource = dataSource;
+    [self bindPagedArray:pagedArray];
+    return pagedArray;
+}
+
+- (void)bindPagedArray:(KHPagedArray* _Nonnull)pagedArray
+{
+    if ( ![_core addSection:pagedArray delegate:self] ) {
+        return;
+    }
+    //  只有已載入的 model 才建立 pairInfo
+    for ( id object in pagedArray ) {
+        [self registerPairInfo: object ];
+    }
+}
+
+- (void)deBindPagedArray:(KHPagedArray* _Nonnull)pagedArray
+{
+    if ( ![self removeBoundSection:pagedArray] ) {
+        return;
+    }
+    for ( id object in pagedArray ) {
+        [self removePairInfo: object ];
+    }
+}
+
+- (nonnull KHSnapshotArray*)createBindSnapshotArray
+{
+    KHSnapshotArray *snapshotArray = [[KHSnapshotArray alloc] initWithArray:nil];
+    [self bindSnapshotArray:snapshotArray];
+    return snapshotArray;
+}
+
+- (void)bindSnapshotArray:(KHSnapshotArray* _Nonnull)snapshotArray
+{
+    if ( ![_core addSection:snapshotArray delegate:self] ) {
+        return;
+    }
+    //  已經換上畫面的 model 直接在這裡建立 pairInfo，之後的修改由背景準備
+    for ( id object in snapshotArray ) {
+        [self registerPairInfo: object ];
+    }
+}
+
+- (void)deBindSnapshotArray:(KHSnapshotArray* _Nonnull)snapshotArray
+{
+    if ( ![self removeBoundSection:snapshotArray] ) {
+        return;
+    }
+    for ( id object in snapshotArray ) {
+        [self removePairInfo: object ];
+    }
+}
+
+- (nonnull KHProjectedArray*)createBindProjectedArray:(NSMutableArray* _Nonnull)source predicate:(NSPredicate* _Nullable)predicate comparator:(NSComparator _Nullable)comparator
+{
+    KHProjectedArray *projectedArray = [[KHProjectedArray alloc] initWithSource:source predicate:predicate comparator:comparator];
+    [self bindProjectedArray:projectedArray];
+    return projectedArray;
+}
+
+- (void)bindProjectedArray:(KHProjectedArray* _Nonnull)projectedArray
+{
+    if ( ![_core addSection:projectedArray delegate:self] ) {
+        return;
+    }
+    //  source 有綁定的話，這裡拿到的是同一個 pairInfo
+    for ( id object in projectedArray ) {
+        [self registerPairInfo: object ];
+    }
+}
+
+- (void)deBindProjectedArray:(KHProjectedArray* _Nonnull)projectedArray
+{
+    if ( ![self removeBoundSection:projectedArray] ) {
+        return;
+    }
+    [self removePairInfoOfObjects:projectedArray.objects source:projectedArray.source];
+}
+
+- (nonnull KHGroupedArray*)createBindGroupedArray:(NSMutableArray* _Nonnull)source keyBlock:(id<NSCopying> _Nonnull(^ _Nonnull)(id _Nonnull model))keyBlock keyComparator:(NSComparator _Nullable)keyComparator
+{
+    KHGroupedArray *groupedArray = [[KHGroupedArray alloc] initWithSource:source keyBlock:keyBlock keyComparator:keyComparator];
+    [self bindGroupedArray:groupedArray];
+    return groupedArray;
+}
+
+- (void)bindGroupedArray:(KHGroupedArray* _Nonnull)groupedArray
+{
+    if ( [_groupedArrays indexOfObjectIdenticalTo:groupedArray] != NSNotFound ) {
+        return;
+    }
+    groupedArray.kh_delegate = self;
+    groupedArray.section = _sectionArray.count;
+    [_groupedArrays addObject:groupedArray];
+    for ( KHGroupSection *group in groupedArray.groups ) {
+        [_core addSection:group delegate:self];
+        for ( id object in group ) {
+            [self registerPairInfo: object ];
         }
     }
-    if ( find ) {
-        array.kh_delegate = nil;
-        array.section = 0;
-        [_sectionArray removeObject: array ];
-        //  移除 proxy
+}
+
+- (void)deBindGroupedArray:(KHGroupedArray* _Nonnull)groupedArray
+{
+    if ( [_groupedArrays indexOfObjectIdenticalTo:groupedArray] == NSNotFound ) {
+        return;
+    }
+    NSMutableArray *objects = [[NSMutableArray alloc] init];
+    for ( KHGroupSection *group in groupedArray.groups ) {
+        [self removeBoundSection:group];
+        [objects addObjectsFromArray:group.objects];
+    }
+    groupedArray.kh_delegate = nil;
+    [_groupedArrays removeObjectIdenticalTo:groupedArray];
+    [self removePairInfoOfObjects:objects source:groupedArray.source];
+}
+
+- (nonnull KHSearchIndex*)searchIndexForArray:(NSMutableArray* _Nonnull)array keyPaths:(NSArray<NSString*>* _Nullable)keyPaths
+{
+    KHSearchIndex *searchIndex = [_searchIndexes objectForKey:array];
+    if ( !searchIndex ) {
+        searchIndex = [[KHSearchIndex alloc] initWithSource:array keyPaths:keyPaths];
+        [_searchIndexes setObject:searchIndex forKey:array];
+        [searchIndex buildWithCompletion:nil];
+    }
+    //  已經有 index 的話 keyPaths 是 nil 表示直接取用，不同的 keyPaths 不會重建，要先 deBindArray:
+    else if ( keyPaths && ![keyPaths isEqualToArray:searchIndex.keyPaths] ) {
+        NSException *exception = [NSException exceptionWithName:NSInvalidArgumentException
+                                                          reason:[NSString stringWithFormat:@"search index of array is built with key paths %@, not %@", searchIndex.keyPaths, keyPaths]
+                                                        userInfo:nil];
+        @throw exception;
+    }
+    return searchIndex;
+}
+
+#pragma mark - Section (Private)
+
+/*
+ *  所有的 deBind 都從這裡移除 section，grouped array 的 section 也要跟著調整
+ *  core 只會重新編號已綁定的 array，沒有 group 的 grouped array 不在 core 裡，所以這裡自己算
+ */
+- (BOOL)removeBoundSection:(id)array
+{
+    NSInteger section = [_core sectionOfArray:array];
+    if ( ![_core removeSection:array] ) {
+        return NO;
+    }
+    for ( KHGroupedArray *groupedArray in _groupedArrays ) {
+        if ( groupedArray.section > section ) {
+            groupedArray.section--;
+        }
+    }
+    return YES;
+}
+
+//  groupedArray 新增了 group，在它之後綁定的 grouped array 都往後移
+- (void)insertGroup:(KHGroupSection*)group atSection:(NSInteger)section groupedArray:(KHGroupedArray*)groupedArray
+{
+    [_core insertSection:group atIndex:section delegate:self];
+    NSUInteger position = [_groupedArrays indexOfObjectIdenticalTo:groupedArray];
+    for ( NSUInteger i=position+1; i<_groupedArrays.count; i++ ) {
+        KHGroupedArray *following = _groupedArrays[i];
+        following.section++;
+    }
+}
+
+#pragma mark - Projection (Private)
+
+//  有沒有 projection 或 grouped array 以 source 為來源
+- (BOOL)hasDerivedSectionOfSource:(NSMutableArray*)source
+{
+    for ( id array in _sectionArray ) {
+        if ( [array isKindOfClass:[KHProjectedArray class]] && ((KHProjectedArray*)array).source == source ) {
+            return YES;
+        }
+        if ( [array isKindOfClass:[KHGroupSection class]] && ((KHGroupSection*)array).groupedArray.source == source ) {
+            return YES;
+        }
+    }
+    return NO;
+}
+
+//  目前所有 section 裡的 model，比對 pointer
+- (NSHashTable*)boundModels
+{
+    NSHashTable *models = [[NSHashTable alloc] initWithOptions:NSPointerFunctionsObjectPointerPersonality capacity: [_core pairCount] ];
+    for ( id array in _sectionArray ) {
         for ( id object in array ) {
+            [models addObject:object];
+        }
+    }
+    return models;
+}
+
+//  projection 或 grouped array 不再顯示的 model，source 有綁定的話 pairInfo 由 source 管理，沒有的話，其他 section 都沒用到才移除
+- (void)removePairInfoOfObjects:(NSArray*)objects source:(NSMutableArray*)source
+{
+    if ( objects.count == 0 || [_core sectionOfArray:source] != NSNotFound ) {
+        return;
+    }
+    NSHashTable *boundModels = [self boundModels];
+    for ( id object in objects ) {
+        if ( ![boundModels containsObject:object] ) {
             [self removePairInfo: object ];
         }
     }
@@ -321,6 +589,11 @@
     return _sectionArray.count;
 }
 
+- (NSInteger)sectionOfArray:(id)array
+{
+    return [_core sectionOfArray:array];
+}
+
 //  override by subclass，把 cell 註冊至 tableView 或 collectionView
 - (void)registerCell:(NSString* _Nonnull)cellName
 {
@@ -330,54 +603,20 @@
 //  設定對映
 - (void)setMappingModel:(Class _Nonnull)modelClass :(Class _Nonnull)cellClass
 {
-    NSString *modelName = NSStringFromClass(modelClass);
-    NSString *cellName = NSStringFromClass(cellClass);
-    _cellClassDic[modelName] = cellName;
+    [_core setMappingModelName:NSStringFromClass(modelClass) cellName:NSStringFromClass(cellClass)];
 }
 
 //  設定對映，使用 block 處理
 - (void)setMappingModel:(Class _Nonnull)modelClass block:( Class _Nullable(^ _Nonnull)(id _Nonnull model, NSIndexPath* _Nonnull index))mappingBlock
 {
-    NSString *modelName = NSStringFromClass(modelClass);
-    _cellClassDic[modelName] = [mappingBlock copy];
+    [_core setMappingModelName:NSStringFromClass(modelClass) block:mappingBlock];
 }
 
 //  用  model 來找對應的 cell class
 - (nullable NSString*)getMappingCellNameWith:(id _Nonnull)model index:(NSIndexPath* _Nullable)index
 {
-    NSString *modelName = NSStringFromClass( [model class] );
-    
-    /* Gevin note:
-        NSString 我透過 [cellClass mappingModelClass]; 取出 class 轉成字串，會得到 NSString
-        但是透過 NSString 的實體，取得 class 轉成字串，卻會是 __NSCFConstantString
-        2017-02-13 : 改直接用 class 做檢查
-     
-     */
-    if ( [model isKindOfClass: [NSString class] ] ) {
-        modelName = @"NSString";
-    }
-    else if( [model isKindOfClass:[NSDictionary class]] ){
-        modelName = @"NSDictionary";
-    }
-    else if( [model isKindOfClass:[NSArray class]] ){
-        modelName = @"NSArray";
-    }
-    
-    id obj = _cellClassDic[modelName];
-    //  _cellClassDic 記錄的 不是字串，就是 block，若兩個都沒有
-    if ( [obj isKindOfClass:[NSString class]]) {
-        return obj;
-    }
-    else if( obj != nil ){
-        Class _Nullable(^mappingBlock)(id _Nonnull model, NSIndexPath* _Nonnull index) = obj;
-        Class cellClass = mappingBlock( model, index );
-        NSString *cellName = NSStringFromClass(cellClass);
-        return cellName;
-    }
-    else{
-        @throw [NSException exceptionWithName:@"Invalid Model Class" reason:[NSString stringWithFormat: @"Can't find any CellName map with this class %@", modelName ] userInfo:nil];
-    }
-//    return cellName;
+    [_metrics increment:KHBindingCounterMappingResolve];
+    return [_core cellNameForModel:model index:index];
 }
 
 //  透過 model 取得 cell
@@ -390,6 +629,11 @@
 //  透過 cell 取得 model
 - (nullable id)getModelWithCell:(id _Nonnull)cell
 {
+    KHPairStore *pairStore = _core.pairStore;
+    if ( pairStore ) {
+        NSUInteger slot = [pairStore slotOfCell:cell];
+        return slot != NSNotFound ? [pairStore modelAtSlot:slot] : nil;
+    }
     for ( NSValue *myKey in _pairDic ) {
         KHPairInfo *pairInfo = _pairDic[myKey];
         if ( pairInfo.cell == cell ) {
@@ -403,17 +647,7 @@
 //  取得某 model 的 index
 - (nullable NSIndexPath*)indexPathOfModel:(id _Nonnull)model_
 {
-    for ( NSInteger i=0 ; i<_sectionArray.count ; i++ ) {
-        NSArray *arr = _sectionArray[i];
-        for ( NSInteger j=0 ; j<arr.count ; j++ ) {
-            id model = arr[j];
-            if ( model == model_ ) {
-                NSIndexPath *index = [NSIndexPath indexPathForRow:j inSection:i];
-                return index;
-            }
-        }
-    }
-    return nil;
+    return [_core indexPathOfModel:model_];
 }
 
 //  取得某 cell 的 index
@@ -521,6 +755,50 @@
     }
 }
 
+- (void)setCompactPairStorage:(BOOL)compactPairStorage
+{
+    _core.compactPairs = compactPairStorage;
+    _core.pairStore.owner = self;
+    _core.pairStore.generation = (uint32_t)_updateGeneration;
+}
+
+- (BOOL)compactPairStorage
+{
+    return _core.compactPairs;
+}
+
+- (KHPairStore*)pairStore
+{
+    return _core.pairStore;
+}
+
+- (void)setMutationRecorder:(KHMutationRecorder *)mutationRecorder
+{
+    //  只記錄 NSMutableArray 的 section，其他型別的 array 不走 KHArrayObserveDelegate
+    for ( id array in _core.sectionArray ) {
+        if ( [array isKindOfClass:[NSMutableArray class]] ) {
+            [_mutationRecorder stopRecordingArray:array];
+        }
+    }
+    _mutationRecorder = mutationRecorder;
+    for ( id array in _core.sectionArray ) {
+        if ( [array isKindOfClass:[NSMutableArray class]] ) {
+            [_mutationRecorder recordArray:array];
+        }
+    }
+}
+
+- (void)setMetricsEnabled:(BOOL)metricsEnabled
+{
+    _metricsEnabled = metricsEnabled;
+    if ( _metricsEnabled && _metrics == nil ) {
+        _metrics = [[KHBindingMetrics alloc] init];
+    }
+    else if( !_metricsEnabled ){
+        _metrics = nil;
+    }
+}
+
 #pragma mark - Getters
 
 // Lazy load, if not assigning any view, initialize a UIActivityIndiicatorView as default loading indicator.
@@ -545,6 +823,72 @@
     refreshScrollView = scrollView;
 }
 
+#pragma mark - End Reached
+
+- (NSArray<NSNumber*>*)endReachedLatencies
+{
+    return [_endReachedLatencies copy];
+}
+
+- (NSTimeInterval)estimatedEndReachedLatency
+{
+    if ( _endReachedLatencies.count == 0 ) {
+        return 0;
+    }
+    //  取 90 percentile，偶爾一次比較慢也能照顧到
+    NSArray *sorted = [_endReachedLatencies sortedArrayUsingSelector:@selector(compare:)];
+    NSUInteger idx = (NSUInteger)floor( (sorted.count - 1) * 0.9 + 0.5 );
+    return [sorted[idx] doubleValue];
+}
+
+- (CGFloat)adaptiveThresHold
+{
+    if ( !self.adaptiveEndReached ) {
+        return self.onEndReachedThresHold;
+    }
+    //  資料到之前 user 會再捲多遠
+    CGFloat distance = MAX( self.scrollVelocity, 0 ) * self.estimatedEndReachedLatency * kEndReachedSafetyFactor;
+    CGFloat maxDistance = CGRectGetHeight([UIScreen mainScreen].bounds) * kEndReachedMaxScreens;
+    return MAX( self.onEndReachedThresHold, MIN( distance, maxDistance ) );
+}
+
+- (CFTimeInterval)endReachedNow
+{
+    return _endReachedClock ? _endReachedClock() : CACurrentMediaTime();
+}
+
+//  在最後一個 section 插入資料時呼叫，記錄從 onEndReached: 到現在花了多久
+- (void)recordEndReachedLatencyIfNeeded:(NSMutableArray*)array
+{
+    if ( self.endReachedTime <= 0 || array != _sectionArray.lastObject ) {
+        return;
+    }
+    NSTimeInterval latency = [self endReachedNow] - self.endReachedTime;
+    self.endReachedTime = 0;
+    [_endReachedLatencies addObject:@(latency)];
+    if ( _endReachedLatencies.count > kEndReachedLatencyWindow ) {
+        [_endReachedLatencies removeObjectAtIndex:0];
+    }
+}
+
+//  往下捲的速度，用 exponential moving average 消除抖動
+- (void)updateScrollVelocity:(UIScrollView *)scrollView
+{
+    CFTimeInterval now = [self endReachedNow];
+    CGFloat offset = scrollView.contentOffset.y;
+    CFTimeInterval elapsed = now - self.lastScrollTime;
+    if ( self.lastScrollTime > 0 && elapsed > 0 && elapsed < 0.5 ) {
+        CGFloat velocity = ( offset - self.lastScrollOffset ) / elapsed;
+        _scrollVelocity = _scrollVelocity * 0.7 + velocity * 0.3;
+    }
+    else{
+        //  停了一陣子才又開始捲，之前的速度已經沒有參考價值
+        _scrollVelocity = 0;
+    }
+    self.lastScrollOffset = offset;
+    self.lastScrollTime = now;
+}
+
 #pragma mark - UIScrollViewDelegate
 - (void)scrollViewDidScroll:(UIScrollView *)scrollView
 {
@@ -556,16 +900,22 @@
         totalOffset += screenHeight;
     }
     
+    [self updateScrollVelocity:scrollView];
+    CGFloat thresHold = self.adaptiveThresHold;
+    
     if (!self.hasCalledOnEndReached) {
-        if (totalOffset + self.onEndReachedThresHold >= contentSizeHeight) {
+        if (totalOffset + thresHold >= contentSizeHeight) {
             if ([self.delegate respondsToSelector:@selector(onEndReached:)]) {
+                self.endReachedTime = [self endReachedNow];
                 [self.delegate onEndReached:self];
             }
             
             self.hasCalledOnEndReached = YES;
+            self.endReachedTriggerThresHold = thresHold;
         }
     } else {
-        if (totalOffset + self.onEndReachedThresHold < contentSizeHeight) {
+        //  速度變慢 thresHold 會跟著變小，要用觸發當下的 thresHold 判斷，不然資料到之前又會再觸發一次
+        if (totalOffset + self.endReachedTriggerThresHold < contentSizeHeight) {
             self.hasCalledOnEndReached = NO;
         }
     }
@@ -586,6 +936,24 @@
     }
 }
 
+- (void)scrollViewWillBeginDragging:(UIScrollView *)scrollView
+{
+    //  只在捲動時取樣 frame
+    [_hitchRecorder start];
+}
+
+- (void)scrollViewDidEndDragging:(UIScrollView *)scrollView willDecelerate:(BOOL)decelerate
+{
+    if ( !decelerate ) {
+        [_hitchRecorder stop];
+    }
+}
+
+- (void)scrollViewDidEndDecelerating:(UIScrollView *)scrollView
+{
+    [_hitchRecorder stop];
+}
+
 - (void)refreshHead:(id)sender
 {
     //  override by subclass
@@ -688,16 +1056,354 @@
 }
 
 
+#pragma mark - Instrumentation (Private)
+
+//  cell 的 onLoad: 都從這裡呼叫，記錄 metrics 與 hitch
+- (void)loadModel:(id)model cell:(id)cell
+{
+    KHMetricsIntervalToken onLoadToken = [_metrics beginInterval:KHBindingIntervalOnLoad];
+    CFTimeInterval onLoadStart = [_hitchRecorder now];
+    [cell onLoad:model];
+    [_hitchRecorder recordEvent:KHHitchEventOnLoad cellClass:[cell class] start:onLoadStart];
+    [_metrics endInterval:KHBindingIntervalOnLoad token:onLoadToken cellClass:[cell class]];
+}
+
+//  subclass 的 array 變動都包在這裡，記錄從 model 變動到 view 更新完的時間，沒有 hitchRecorder 時直接執行
+- (void)recordMutation:(SEL)selector block:(void(^)(void))block
+{
+    if ( _hitchRecorder == nil ) {
+        block();
+        return;
+    }
+    CFTimeInterval start = [_hitchRecorder now];
+    block();
+    [_hitchRecorder recordMutation:selector start:start];
+}
+
+#pragma mark - Update Routing (Private)
+
+//  index 在畫面上的話回傳 cell，override by subclass
+- (nullable id)visibleCellAtIndexPath:(NSIndexPath*)index
+{
+    return nil;
+}
+
+//  override by subclass
+- (nonnull NSArray<NSIndexPath*>*)visibleIndexPaths
+{
+    return @[];
+}
+
+//  cell class 換了的 row 要重新 dequeue，override by subclass
+- (void)reloadIndexPaths:(NSArray<NSIndexPath*>*)indexPaths
+{
+}
+
+//  畫面上 cell 的大小跟 model 現在的 size 不同，例如 replace 成另一個 model，或 update 前改了 cell size，override by subclass
+- (BOOL)needsResizeAtIndexPath:(NSIndexPath*)index cell:(id)cell
+{
+    return NO;
+}
+
+//  重新排版 size 改變的 row，不 reload cell，override by subclass
+- (void)resizeIndexPaths:(NSArray<NSIndexPath*>*)indexPaths
+{
+}
+
+//  model 目前對映的 reuse identifier，override by subclass
+- (nullable NSString*)reuseIdentifierOfModel:(id)model index:(NSIndexPath*)index
+{
+    return [self getMappingCellNameWith:model index:index];
+}
+
+//  compactPairStorage 時直接改 slot 的 flag，不產生 KHPairInfo
+- (void)markStaleModel:(id)model
+{
+    KHPairStore *pairStore = _core.pairStore;
+    if ( pairStore ) {
+        NSUInteger slot = [pairStore slotOfModel:model];
+        if ( slot != NSNotFound ) {
+            [pairStore setFlags:[pairStore flagsAtSlot:slot] | KHPairFlagStale atSlot:slot];
+        }
+        return;
+    }
+    [self getPairInfo:model].stale = YES;
+}
+
+//  取 size 時才處理 stale，model 的內容改了，先前的 size 跟 cell 對映都不能用，重新計算
+//  個別 update 的 model 有 stale flag，updateAll 的 section 比對 generation
+- (void)resolveStalePairInfo:(KHPairInfo*)pairInfo model:(id)model index:(NSIndexPath*)index
+{
+    BOOL stale = pairInfo.stale;
+    if ( !stale && pairInfo.updateGeneration < _updateGeneration ) {
+        NSNumber *sectionGeneration = [_sectionGenerations objectForKey:_sectionArray[index.section]];
+        stale = pairInfo.updateGeneration < [sectionGeneration unsignedIntegerValue];
+    }
+    if ( !stale ) {
+        return;
+    }
+    pairInfo.stale = NO;
+    pairInfo.updateGeneration = _updateGeneration;
+    pairInfo.pairCellName = nil;
+    pairInfo.cellSize = CGSizeZero;
+}
+
+//  直接對畫面上的 cell 呼叫 onLoad:，不 dequeue 也不做 reload 動畫
+//  cell 的 class 跟 model 目前的對映不同的話回傳 NO，要 reload 那個 row
+- (BOOL)applyUpdateOfModel:(id)model cell:(id)cell index:(NSIndexPath*)index
+{
+    KHPairInfo *pairInfo = [self getPairInfo:model];
+    NSString *identifier = [self reuseIdentifierOfModel:model index:index];
+    if ( identifier && ![identifier isEqualToString:[cell reuseIdentifier]] ) {
+        pairInfo.pairCellName = nil;
+        pairInfo.cellSize = CGSizeZero;
+        return NO;
+    }
+    if ( pairInfo.cell != cell ) {
+        [self pairedModel:model cell:cell];
+    }
+    [self loadModel:model cell:cell];
+    return YES;
+}
+
+//  row 在畫面上的話直接更新 cell，不在的話只標記 stale，等它顯示時再重新計算 size
+- (void)routeUpdateOfModel:(id)model index:(NSIndexPath*)index
+{
+    id cell = [self visibleCellAtIndexPath:index];
+    if ( cell == nil ) {
+        [self markStaleModel:model];
+        [_metrics increment:KHBindingCounterUpdateDeferred];
+        return;
+    }
+    [_metrics increment:KHBindingCounterUpdateApplied];
+    if ( ![self applyUpdateOfModel:model cell:cell index:index] ) {
+        [_metrics increment:KHBindingCounterIncrementalUpdate];
+        [self reloadIndexPaths:@[index]];
+    }
+    else if ( [self needsResizeAtIndexPath:index cell:cell] ) {
+        [_metrics increment:KHBindingCounterIncrementalUpdate];
+        [self resizeIndexPaths:@[index]];
+    }
+}
+
+//  只更新畫面上的 row，其他的 row 不走訪，記下 section 的 generation，取 size 時再比對
+- (void)routeUpdateAllOfArray:(NSMutableArray*)array
+{
+    _updateGeneration++;
+    [_sectionGenerations setObject:@(_updateGeneration) forKey:array];
+    _core.pairStore.generation = (uint32_t)_updateGeneration;
+    
+    //  multicastBinding 的 array，array.section 不是這個 binding 的
+    NSInteger section = [_core sectionOfArray:array];
+    NSUInteger visibleCount = 0;
+    NSMutableArray *reloadIndexPaths = [[NSMutableArray alloc] init];
+    NSMutableArray *resizeIndexPaths = [[NSMutableArray alloc] init];
+    for ( NSIndexPath *index in [self visibleIndexPaths] ) {
+        if ( index.section != section || index.row >= array.count ) {
+            continue;
+        }
+        id cell = [self visibleCellAtIndexPath:index];
+        if ( cell == nil ) {
+            continue;
+        }
+        visibleCount++;
+        //  畫面上的 row 跟 update: 一樣，size 由 needsResizeAtIndexPath: 確認
+        [self getPairInfo:array[index.row]].updateGeneration = _updateGeneration;
+        if ( ![self applyUpdateOfModel:array[index.row] cell:cell index:index] ) {
+            [reloadIndexPaths addObject:index];
+        }
+        else if ( [self needsResizeAtIndexPath:index cell:cell] ) {
+            [resizeIndexPaths addObject:index];
+        }
+    }
+    [_metrics add:visibleCount counter:KHBindingCounterUpdateApplied];
+    [_metrics add:array.count - visibleCount counter:KHBindingCounterUpdateDeferred];
+    if ( reloadIndexPaths.count > 0 ) {
+        [_metrics increment:KHBindingCounterIncrementalUpdate];
+        [self reloadIndexPaths:reloadIndexPaths];
+    }
+    if ( resizeIndexPaths.count > 0 ) {
+        [_metrics increment:KHBindingCounterIncrementalUpdate];
+        [self resizeIndexPaths:resizeIndexPaths];
+    }
+}
+
+#pragma mark - State Restoration (Private)
+
+//  index 超出範圍或 page 還沒載入的話回傳 nil
+- (nullable id)loadedModelAtIndexPath:(NSIndexPath*)index
+{
+    if ( index.section >= _sectionArray.count ) {
+        return nil;
+    }
+    id array = _sectionArray[index.section];
+    if ( index.row >= [array count] ) {
+        return nil;
+    }
+    if ( [array isKindOfClass:[KHPagedArray class]] ) {
+        return [(KHPagedArray*)array loadedObjectAtIndex:index.row];
+    }
+    return array[index.row];
+}
+
+//  量測 size 時 container 的寬度，override by subclass
+- (CGFloat)containerWidth
+{
+    return [UIScreen mainScreen].bounds.size.width;
+}
+
+//  畫面上第一個 row，offset 是畫面頂端超出它的距離，override by subclass
+- (nullable NSIndexPath*)anchorIndexPathWithOffset:(CGFloat*)offset
+{
+    return nil;
+}
+
+//  override by subclass
+- (void)scrollToAnchorIndexPath:(NSIndexPath*)index offset:(CGFloat)offset
+{
+}
+
+- (void)checkStateIdentifierBlock
+{
+    if ( _stateIdentifierBlock == nil ) {
+        NSException *exception = [NSException exceptionWithName:NSInternalInconsistencyException
+                                                          reason:@"stateIdentifierBlock must be set to capture or restore state"
+                                                        userInfo:nil];
+        @throw exception;
+    }
+}
+
+//  compactPairStorage 時直接讀寫 slot，不為每個 model 產生 KHPairInfo
+- (CGSize)stateSizeOfModel:(id)model
+{
+    KHPairStore *pairStore = _core.pairStore;
+    if ( pairStore ) {
+        NSUInteger slot = [pairStore slotOfModel:model];
+        if ( slot == NSNotFound ) {
+            return CGSizeZero;
+        }
+        return (CGSize){ [pairStore widthAtSlot:slot], [pairStore heightAtSlot:slot] };
+    }
+    return [self getPairInfo:model].cellSize;
+}
+
+//  只填還沒量測過的 size，回傳有沒有填
+- (BOOL)restoreStateSize:(CGSize)size model:(id)model
+{
+    KHPairStore *pairStore = _core.pairStore;
+    if ( pairStore ) {
+        NSUInteger slot = [pairStore slotOfModel:model];
+        if ( slot == NSNotFound || [pairStore heightAtSlot:slot] > 0 ) {
+            return NO;
+        }
+        [pairStore setWidth:size.width height:size.height atSlot:slot];
+        [pairStore setGeneration:(uint32_t)_updateGeneration atSlot:slot];
+        return YES;
+    }
+    KHPairInfo *pairInfo = [self getPairInfo:model];
+    if ( pairInfo == nil || pairInfo.cellSize.height > 0 ) {
+        return NO;
+    }
+    pairInfo.cellSize = size;
+    pairInfo.updateGeneration = _updateGeneration;
+    return YES;
+}
+
+#pragma mark - State Restoration (Public)
+
+- (nonnull KHBindingState*)captureState
+{
+    [self checkStateIdentifierBlock];
+    KHBindingState *state = [[KHBindingState alloc] init];
+    state.containerWidth = [self containerWidth];
+    
+    NSMutableArray *sections = [[NSMutableArray alloc] initWithCapacity: _sectionArray.count ];
+    for ( id array in _sectionArray ) {
+        NSMutableArray *identifiers = [[NSMutableArray alloc] initWithCapacity: [array count] ];
+        for ( id model in array ) {
+            NSString *identifier = _stateIdentifierBlock( model );
+            if ( identifier == nil ) {
+                continue;
+            }
+            [identifiers addObject:identifier];
+            //  只記量測過的 size
+            CGSize cellSize = [self stateSizeOfModel:model];
+            if ( cellSize.height > 0 ) {
+                [state setWidth:cellSize.width height:cellSize.height forIdentifier:identifier];
+            }
+        }
+        [sections addObject:identifiers];
+    }
+    state.sectionIdentifiers = sections;
+    
+    CGFloat offset = 0;
+    NSIndexPath *anchor = [self anchorIndexPathWithOffset:&offset];
+    id anchorModel = anchor ? [self loadedModelAtIndexPath:anchor] : nil;
+    if ( anchorModel ) {
+        state.anchorIdentifier = _stateIdentifierBlock( anchorModel );
+        state.anchorOffset = offset;
+    }
+    
+    NSMutableOrderedSet *imageURLs = [[NSMutableOrderedSet alloc] init];
+    for ( NSIndexPath *index in [self visibleIndexPaths] ) {
+        id model = [self loadedModelAtIndexPath:index];
+        NSArray *urls = model ? [self getPairInfo:model].imageURLs : nil;
+        if ( urls ) {
+            [imageURLs addObjectsFromArray:urls];
+        }
+    }
+    state.imageURLs = [imageURLs array];
+    return state;
+}
+
+- (void)saveStateToFile:(NSString* _Nonnull)path completion:(void(^ _Nullable)(NSError* _Nullable error))completion
+{
+    //  走訪 model 要在 main thread，encode 與寫檔在背景
+    [[self captureState] writeToFile:path completion:completion];
+}
+
+- (NSUInteger)restoreState:(KHBindingState* _Nonnull)state
+{
+    [self checkStateIdentifierBlock];
+    //  寬度不同的話 size 不能用，還是要找回捲動位置
+    BOOL sameWidth = fabs( state.containerWidth - [self containerWidth] ) < 0.5;
+    NSUInteger restoredCount = 0;
+    id anchorModel = nil;
+    //  KHPagedArray 只會走訪已載入的 model
+    for ( id array in _sectionArray ) {
+        for ( id model in array ) {
+            NSString *identifier = _stateIdentifierBlock( model );
+            if ( identifier == nil ) {
+                continue;
+            }
+            if ( anchorModel == nil && state.anchorIdentifier && [identifier isEqualToString:state.anchorIdentifier] ) {
+                anchorModel = model;
+            }
+            double width, height;
+            if ( sameWidth && [state getWidth:&width height:&height forIdentifier:identifier] ) {
+                if ( [self restoreStateSize:(CGSize){ width, height } model:model] ) {
+                    restoredCount++;
+                }
+            }
+        }
+    }
+    
+    [[KHImageDownloader instance] prefetchImageURLs:state.imageURLs];
+    NSIndexPath *anchor = anchorModel ? [self indexPathOfModel:anchorModel] : nil;
+    if ( anchor ) {
+        [self scrollToAnchorIndexPath:anchor offset:state.anchorOffset];
+    }
+    return restoredCount;
+}
+
 #pragma mark - Array Observe
 
 
 //  插入
 -(void)arrayInsert:(NSMutableArray*)array insertObject:(id)object index:(NSIndexPath*)index
 {
-    KHPairInfo *pairInfo = [self getPairInfo: object ];
-    if ( !pairInfo ) {
-        [self addPairInfo:object];
-    }
+    [self registerPairInfo:object];
+    [self recordEndReachedLatencyIfNeeded:array];
 }
 
 //  插入 多項
@@ -705,11 +1411,9 @@
 {
     for ( id model in objects ) {
 //        [self addPairInfo:model];
-        KHPairInfo *pairInfo = [self getPairInfo: model ];
-        if ( !pairInfo ) {
-            [self addPairInfo:model];
-        }
+        [self registerPairInfo:model];
     }
+    [self recordEndReachedLatencyIfNeeded:array];
 }
 
 //  刪除
@@ -729,7 +1433,15 @@
 //  取代
 -(void)arrayReplace:(NSMutableArray*)array newObject:(id)newObj replacedObject:(id)oldObj index:(NSIndexPath*)index
 {
+    //  pairInfo 沿用舊的，但 size 是舊 model 的，新 model 先前有設定 size 就用那個，沒有的話之後重新計算
+    KHPairInfo *newPairInfo = newObj != oldObj ? [self getPairInfo:newObj] : nil;
+    CGSize newSize = newPairInfo ? newPairInfo.cellSize : CGSizeZero;
     [self replacePairInfo:oldObj new:newObj];
+    if ( newObj != oldObj ) {
+        KHPairInfo *pairInfo = [self getPairInfo:newObj];
+        pairInfo.cellSize = newSize;
+        pairInfo.pairCellName = newPairInfo.pairCellName;
+    }
 }
 
 //  更新
@@ -744,9 +1456,142 @@
     // override by subclass
 }
 
+#pragma mark - Paged Array Observe
+
+//  page 載入
+- (void)pagedArray:(KHPagedArray*)pagedArray didLoadObjects:(NSArray*)objects indexes:(NSArray*)indexes
+{
+    for ( id model in objects ) {
+        [self registerPairInfo:model];
+    }
+}
+
+//  page 移出 memory
+- (void)pagedArray:(KHPagedArray*)pagedArray didEvictObjects:(NSArray*)objects indexes:(NSArray*)indexes
+{
+    for ( id model in objects ) {
+        [self removePairInfo:model];
+    }
+}
+
+//  總數變動
+- (void)pagedArrayDidChangeCount:(KHPagedArray*)pagedArray
+{
+    // override by subclass
+}
+
+#pragma mark - Snapshot Array Observe
+
+//  snapshot 已換上，在 main thread 建立 pairInfo、註冊 KVO，畫面由 subclass 一次更新
+- (void)snapshotArray:(KHSnapshotArray*)snapshotArray didCommitChange:(KHSnapshotChange*)change
+{
+    for ( id model in change.removedObjects ) {
+        [self removePairInfo:model];
+    }
+    
+    NSArray *insertedObjects = change.insertedObjects;
+    NSArray *preparedSizes = change.preparedSizes;
+    KHPairStore *pairStore = _core.pairStore;
+    for ( NSUInteger i=0; i<insertedObjects.count; i++ ) {
+        id model = insertedObjects[i];
+        //  model 在別的 section 已經有 pairInfo 的話，保留原本的 size
+        BOOL isNewPair = pairStore ? [pairStore slotOfModel:model] == NSNotFound : [_core pairOfModel:model] == nil;
+        [self registerPairInfo:model];
+        if ( !isNewPair || i >= preparedSizes.count ) {
+            continue;
+        }
+        CGSize size = [preparedSizes[i] CGSizeValue];
+        if ( pairStore ) {
+            [pairStore setWidth:size.width height:size.height atSlot:[pairStore slotOfModel:model]];
+        }
+        else{
+            KHPairInfo *pairInfo = [_core pairOfModel:model];
+            pairInfo.cellSize = size;
+        }
+    }
+    
+    if ( insertedObjects.count > 0 ) {
+        [self recordEndReachedLatencyIfNeeded:(NSMutableArray*)snapshotArray];
+    }
+}
+
+#pragma mark - Projected Array Observe
+
+//  projection 的 row 增減
+- (void)projectedArray:(KHProjectedArray*)projectedArray didChange:(KHSnapshotChange*)change
+{
+    [self removePairInfoOfObjects:change.removedObjects source:projectedArray.source];
+    for ( id model in change.insertedObjects ) {
+        //  與 source 共用，已經有 pairInfo 的話 core 會直接回傳
+        [self registerPairInfo:model];
+    }
+}
+
+//  排序位置改變
+- (void)projectedArray:(KHProjectedArray*)projectedArray didMoveObject:(id)object fromIndex:(NSUInteger)fromIndex toIndex:(NSUInteger)toIndex
+{
+    // override by subclass
+}
+
+//  model 改變，位置不變
+- (void)projectedArray:(KHProjectedArray*)projectedArray didUpdateObject:(id)object index:(NSUInteger)index
+{
+    // override by subclass
+}
+
+#pragma mark - Grouped Array Observe
+
+//  group 增減，先移除 section 再依 index 由小到大插入，跟 view 的 batch update 順序一樣
+- (void)groupedArray:(KHGroupedArray*)groupedArray didChange:(KHGroupedChange*)change
+{
+    for ( KHGroupSection *group in change.removedGroups ) {
+        [self removeBoundSection:group];
+    }
+    NSInteger firstSection = groupedArray.section;
+    __block NSUInteger i = 0;
+    [change.insertedGroupIndexes enumerateIndexesUsingBlock:^(NSUInteger idx, BOOL *stop) {
+        [self insertGroup:change.insertedGroups[i++] atSection:firstSection + idx groupedArray:groupedArray];
+    }];
+    
+    [self removePairInfoOfObjects:change.removedObjects source:groupedArray.source];
+    for ( id model in change.insertedObjects ) {
+        [self registerPairInfo:model];
+    }
+}
+
+//  model 改變，group 不變
+- (void)groupedArray:(KHGroupedArray*)groupedArray didUpdateObject:(id)object indexPath:(NSIndexPath*)indexPath
+{
+    // override by subclass
+}
+
 @end
 
 
+//  iOS 11 之後 safe area 的 inset 不在 contentInset，要用 adjustedContentInset
+static UIEdgeInsets KHAdjustedContentInset( UIScrollView *scrollView )
+{
+    if (@available(iOS 11.0, *)) {
+        return scrollView.adjustedContentInset;
+    }
+    return scrollView.contentInset;
+}
+
+//  group section 增減時，依 section 存放的 header / footer 資料也要跟著移動，removed 是修改前的，inserted 是修改後的
+static void KHShiftSectionList( NSMutableArray *list, NSIndexSet *removedSections, NSIndexSet *insertedSections )
+{
+    if ( list == nil ) {
+        return;
+    }
+    [list removeObjectsAtIndexes:[removedSections indexesPassingTest:^BOOL(NSUInteger idx, BOOL *stop) {
+        return idx < list.count;
+    }]];
+    [insertedSections enumerateIndexesUsingBlock:^(NSUInteger idx, BOOL *stop) {
+        if ( idx <= list.count ) {
+            [list insertObject:[NSNull null] atIndex:idx];
+        }
+    }];
+}
 
 
 #pragma mark - KHTableDataBinding
@@ -787,6 +1632,22 @@
 
 @end
 
+//  UITableViewCellModel 的 cell 用 style 當 reuse identifier
+static NSString *KHTableCellStyleIdentifier(UITableViewCellStyle style)
+{
+    switch (style) {
+        case UITableViewCellStyleDefault:
+            return @"UITableViewCellStyleDefault";
+        case UITableViewCellStyleSubtitle:
+            return @"UITableViewCellStyleSubtitle";
+        case UITableViewCellStyleValue1:
+            return @"UITableViewCellStyleValue1";
+        case UITableViewCellStyleValue2:
+            return @"UITableViewCellStyleValue2";
+    }
+    return nil;
+}
+
 @interface KHTableDataBinding()
 
 @property (nonatomic, strong) NSMutableDictionary *defaultHeightAndModelMapping;
@@ -794,6 +1655,10 @@
 @end
 
 @implementation KHTableDataBinding
+{
+    //  key: placeholder 對映的 cell name / value: 高度
+    NSMutableDictionary *_placeholderHeights;
+}
 
 - (instancetype)init
 {
@@ -843,9 +1708,12 @@
     _footerViews = [[NSMutableArray alloc] init];
     
     _defaultHeightAndModelMapping = [[NSMutableDictionary alloc] init];
+    _placeholderHeights = [[NSMutableDictionary alloc] init];
 
     // 預設 UITableViewCellModel 配 UITableViewCell
     [self setMappingModel:[UITableViewCellModel class] :[UITableViewCell class]];
+    // paged array 還沒載入的 row 也用 UITableViewCell 顯示
+    [self setMappingModel:[KHPagedPlaceholder class] :[UITableViewCell class]];
 }
 
 
@@ -876,7 +1744,63 @@
 {
     [super bindArray:array];
     
-    //  先填 null
+    [self fillHeaderFooterNull];
+    if ( array.count > 0 ) {
+        [_metrics increment:KHBindingCounterFullReload];
+        [self.tableView reloadData];
+    }
+}
+
+- (void)bindPagedArray:(KHPagedArray *)pagedArray
+{
+    [super bindPagedArray:pagedArray];
+    
+    [self fillHeaderFooterNull];
+    if ( pagedArray.count > 0 ) {
+        [_metrics increment:KHBindingCounterFullReload];
+        [self.tableView reloadData];
+    }
+}
+
+- (void)bindSnapshotArray:(KHSnapshotArray *)snapshotArray
+{
+    [super bindSnapshotArray:snapshotArray];
+    
+    [self fillHeaderFooterNull];
+    if ( snapshotArray.count > 0 ) {
+        [_metrics increment:KHBindingCounterFullReload];
+        [self.tableView reloadData];
+    }
+}
+
+- (void)bindProjectedArray:(KHProjectedArray *)projectedArray
+{
+    [super bindProjectedArray:projectedArray];
+    
+    [self fillHeaderFooterNull];
+    if ( projectedArray.count > 0 ) {
+        [_metrics increment:KHBindingCounterFullReload];
+        [self.tableView reloadData];
+    }
+}
+
+- (void)bindGroupedArray:(KHGroupedArray *)groupedArray
+{
+    [super bindGroupedArray:groupedArray];
+    
+    [self fillHeaderFooterNull];
+    if ( groupedArray.groups.count > 0 ) {
+        [_metrics increment:KHBindingCounterFullReload];
+        [self.tableView reloadData];
+    }
+}
+
+
+#pragma mark - Private
+
+//  header footer 的資料要跟 section 數量一樣，沒有的先填 null
+- (void)fillHeaderFooterNull
+{
     for ( NSInteger i=0; i<self.sectionCount; i++) {
         if ( i == _headerTitles.count ) {
             [_headerTitles addObject:[NSNull null]];
@@ -891,15 +1815,14 @@
             [_footerViews addObject:[NSNull null]];
         }
     }
-    if ( array.count > 0 ) {
-        [self.tableView reloadData];
-    }
 }
 
-
-#pragma mark - Private
-
-
+//  group section 沒有設定 header title 的話，用 group 的 title
+- (NSString*)groupTitleOfSection:(NSInteger)section
+{
+    id array = _sectionArray[section];
+    return [array isKindOfClass:[KHGroupSection class]] ? ((KHGroupSection*)array).title : nil;
+}
 
 
 #pragma mark - Public
@@ -923,6 +1846,8 @@
         pairInfo = [self addPairInfo:model];
     }
     pairInfo.cellSize = (CGSize){ screenWidth ,cellHeight};
+    //  指定的 size 是最新的，先前的 updateAll 不會讓它失效
+    pairInfo.updateGeneration = _updateGeneration;
 }
 
 
@@ -1099,6 +2024,7 @@
 {
     // WillSet...
     if (self.isLoading != isLoading) {
+        [_metrics increment:KHBindingCounterFullReload];
         [self.tableView reloadData];
     }
     
@@ -1119,6 +2045,7 @@
 
 - (void)reloadData
 {
+    [_metrics increment:KHBindingCounterFullReload];
     [self.tableView reloadData];
 }
 
@@ -1189,12 +2116,24 @@
 
 - (CGFloat)tableView:(UITableView *)tableView heightForRowAtIndexPath:(NSIndexPath *)indexPath
 {
-    NSMutableArray* array = _sectionArray[indexPath.section];
-    id model = array[indexPath.row];
+    //  不用 array[row]，paged array 會因為取高度把每一頁都 fetch，fetch 只在 cellForRow 觸發
+    id model = [self loadedModelAtIndexPath:indexPath];
+    if ( model == nil ) {
+        return [self placeholderHeightAtIndexPath:indexPath];
+    }
     
     KHPairInfo *pairInfo = [self getPairInfo: model ];
+    
+    if ( pairInfo == nil ) {
+        NSNumber *defaultHeight = self.defaultHeightAndModelMapping[[model class]];
+        return defaultHeight ? [defaultHeight floatValue] : 44;
+    }
+    
+    [self resolveStalePairInfo:pairInfo model:model index:indexPath];
+    
     //    float cellHeight = pairInfo.cellSize.height;
     if( pairInfo.cellSize.height <= 0 ){
+        [_metrics increment:KHBindingCounterSizeCacheMiss];
         if ( pairInfo.pairCellName == nil ) {
             pairInfo.pairCellName = [self getMappingCellNameWith:model index:indexPath ];
         }
@@ -1213,6 +2152,9 @@
             pairInfo.cellSize = cell.frame.size;
         }
     }
+    else{
+        [_metrics increment:KHBindingCounterSizeCacheHit];
+    }
     
     //    float height = [cellHeight floatValue];
     //    NSLog(@" %ld cell height %f", indexPath.row,height );
@@ -1222,13 +2164,51 @@
     return pairInfo.cellSize.height;
 }
 
+//  paged array 還沒載入的 row，每個 cell 對映只量一次
+- (CGFloat)placeholderHeightAtIndexPath:(NSIndexPath *)indexPath
+{
+    NSNumber *defaultHeight = self.defaultHeightAndModelMapping[[KHPagedPlaceholder class]];
+    if ( defaultHeight ) {
+        return [defaultHeight floatValue];
+    }
+    id array = _sectionArray[indexPath.section];
+    if ( ![array isKindOfClass:[KHPagedArray class]] ) {
+        return 44;
+    }
+    KHPagedPlaceholder *placeholder = [(KHPagedArray*)array placeholderAtIndex:indexPath.row];
+    NSString *cellName = [self getMappingCellNameWith:placeholder index:indexPath ];
+    if ( cellName == nil ) {
+        return 44;
+    }
+    NSNumber *height = _placeholderHeights[cellName];
+    if ( height == nil ) {
+        UITableViewCell *cell = [_tableView dequeueReusableCellWithIdentifier: cellName ];
+        if ( !cell ) {
+            [self registerCell: cellName ];
+            cell = [_tableView dequeueReusableCellWithIdentifier: cellName ];
+        }
+        height = @( cell.frame.size.height > 0 ? cell.frame.size.height : 44 );
+        _placeholderHeights[cellName] = height;
+    }
+    return [height floatValue];
+}
+
 - (CGFloat)tableView:(UITableView *)tableView estimatedHeightForRowAtIndexPath:(NSIndexPath *)indexPath
 {
     //    NSLog(@" %ld estimated cell height 44", indexPath.row );
-    //    NSMutableArray* array = _sectionArray[indexPath.section];
-    //    KHCellModel *model = array[indexPath.row];
-    //    return model.estimatedCellHeight;
-    return 44; //   for UITableViewAutomaticDimension
+    //  已經有 size 的 row 用實際高度估計，restoreState: 填好 size 後，捲動位置不用量測就是準的
+    id model = [self loadedModelAtIndexPath:indexPath];
+    CGFloat height = 0;
+    KHPairStore *pairStore = self.pairStore;
+    if ( pairStore ) {
+        //  每個 row 都會呼叫，直接讀 slot，不建立 facade
+        NSUInteger slot = [pairStore slotOfModel:model];
+        height = slot != NSNotFound ? [pairStore heightAtSlot:slot] : 0;
+    }
+    else if ( model ) {
+        height = [self getPairInfo: model ].cellSize.height;
+    }
+    return height > 0 ? height : 44; //   for UITableViewAutomaticDimension
 }
 
 
@@ -1236,6 +2216,9 @@
 // Cell gets various attributes set automatically based on table (separators) and data source (accessory views, editing controls)
 - (UITableViewCell *)tableView:(UITableView *)tableView cellForRowAtIndexPath:(NSIndexPath *)indexPath
 {
+    KHMetricsIntervalToken configureToken = [_metrics beginInterval:KHBindingIntervalCellConfigure];
+    CFTimeInterval hitchStart = [_hitchRecorder now];
+    
     _firstReload = YES;
     
     NSMutableArray *modelArray = _sectionArray[indexPath.section];
@@ -1268,21 +2251,7 @@
     if ( [model isKindOfClass:[UITableViewCellModel class]] ) {
         UITableViewCellModel *cellModel = model;
         
-        NSString *identifier = nil;
-        switch (cellModel.cellStyle) {
-            case UITableViewCellStyleDefault:
-                identifier = @"UITableViewCellStyleDefault";
-                break;
-            case UITableViewCellStyleSubtitle:
-                identifier = @"UITableViewCellStyleSubtitle";
-                break;
-            case UITableViewCellStyleValue1:
-                identifier = @"UITableViewCellStyleValue1";
-                break;
-            case UITableViewCellStyleValue2:
-                identifier = @"UITableViewCellStyleValue2";
-                break;
-        }
+        NSString *identifier = KHTableCellStyleIdentifier( cellModel.cellStyle );
         // 若取不到 cell ，在 ios 7 好像會發生例外，在ios8 就直接取回nil
         cell = [_tableView dequeueReusableCellWithIdentifier: identifier ];
         if ( !cell ){
@@ -1318,7 +2287,10 @@
     }
     
     //  把 model 載入 cell
-    [cell onLoad:model];
+    [self loadModel:model cell:cell];
+    
+    [_hitchRecorder recordEvent:KHHitchEventCellConfigure cellClass:[cell class] start:hitchStart];
+    [_metrics endInterval:KHBindingIntervalCellConfigure token:configureToken cellClass:[cell class]];
     
     return cell;
 }
@@ -1359,7 +2331,7 @@
     
     // 沒有 view 就看有沒有 title，有 title 就用 header height + 21
     id titleobj = _headerTitles[section];
-    if( titleobj != [NSNull null] ){
+    if( titleobj != [NSNull null] || [self groupTitleOfSection:section] ){
         return _headerHeight;
     }
     
@@ -1398,7 +2370,7 @@
     }
     
     id titleobj = _headerTitles[section];
-    return titleobj == [NSNull null] ? nil : titleobj;
+    return titleobj == [NSNull null] ? [self groupTitleOfSection:section] : titleobj;
 }
 
 - (UIView*)tableView:(UITableView *)tableView viewForHeaderInSection:(NSInteger)section
@@ -1426,113 +2398,387 @@
         
         return footer;
     }
-    
-    id view = _footerViews[section];
-    return view == [NSNull null] ? nil : (UIView *)view ;
+    
+    id view = _footerViews[section];
+    return view == [NSNull null] ? nil : (UIView *)view ;
+}
+
+
+/**
+ * 顯示 headerView 之前，可以在這裡對 headerView 做一些顯示上的調整，例如改變字色或是背景色
+ */
+- (void)tableView:(UITableView *)tableView willDisplayHeaderView:(UIView *)view forSection:(NSInteger)section{
+    UITableViewHeaderFooterView* thfv = (UITableViewHeaderFooterView*)view;
+    if( _headerBgColor ) thfv.contentView.backgroundColor = _headerBgColor;
+    if( _headerTextColor ) thfv.textLabel.textColor = _headerTextColor;
+    if(_headerFont) thfv.textLabel.font = _headerFont;
+}
+
+- (void)tableView:(UITableView *)tableView willDisplayFooterView:(UIView *)view forSection:(NSInteger)section
+{
+    UITableViewHeaderFooterView* thfv = (UITableViewHeaderFooterView*)view;
+    if( _footerBgColor ) thfv.contentView.backgroundColor = _footerBgColor;
+    if( _footerTextColor ) thfv.textLabel.textColor = _footerTextColor;
+    if( _footerFont ) thfv.textLabel.font = _footerFont;
+}
+
+
+
+
+#pragma mark - Array Observe
+
+//  插入
+-(void)arrayInsert:(NSMutableArray*)array insertObject:(id)object index:(NSIndexPath*)index
+{
+    [self recordMutation:_cmd block:^{
+        [super arrayInsert:array insertObject:object index:index];
+    
+        if (_firstReload && self.isNeedAnimation){
+            [_metrics increment:KHBindingCounterIncrementalUpdate];
+            [_tableView insertRowsAtIndexPaths:@[index] withRowAnimation:UITableViewRowAnimationBottom];
+        }
+        else{
+            [_metrics increment:KHBindingCounterFullReload];
+            [_tableView reloadData];
+        }
+    }];
+}
+
+//  插入 多項
+-(void)arrayInsertSome:(NSMutableArray *)array insertObjects:(NSArray *)objects indexes:(NSArray *)indexes
+{
+    [self recordMutation:_cmd block:^{
+        [super arrayInsertSome:array insertObjects:objects indexes:indexes ];
+    
+        if (_firstReload && self.isNeedAnimation){
+            [_metrics increment:KHBindingCounterIncrementalUpdate];
+            [_tableView insertRowsAtIndexPaths:indexes withRowAnimation:UITableViewRowAnimationBottom];
+        }
+        else{
+            [_metrics increment:KHBindingCounterFullReload];
+            [_tableView reloadData];
+        }
+    }];
+}
+
+//  刪除
+-(void)arrayRemove:(NSMutableArray*)array removeObject:(id)object index:(NSIndexPath*)index
+{
+    [self recordMutation:_cmd block:^{
+        [super arrayRemove:array removeObject:object index:index];
+    
+        if (_firstReload && self.isNeedAnimation) {
+            [_metrics increment:KHBindingCounterIncrementalUpdate];
+            [_tableView deleteRowsAtIndexPaths:@[index] withRowAnimation:UITableViewRowAnimationTop];
+        } else {
+            [_metrics increment:KHBindingCounterFullReload];
+            [_tableView reloadData];
+        }
+    }];
+}
+
+//  刪除全部
+-(void)arrayRemoveSome:(NSMutableArray *)array removeObjects:(NSArray *)objects indexs:(NSArray *)indexs
+{
+    [self recordMutation:_cmd block:^{
+        [super arrayRemoveSome:array removeObjects:objects indexs:indexs ];
+    
+        if(_firstReload && self.isNeedAnimation){
+            [_metrics increment:KHBindingCounterIncrementalUpdate];
+            [_tableView deleteRowsAtIndexPaths:indexs withRowAnimation:UITableViewRowAnimationTop];
+        } else{
+            [_metrics increment:KHBindingCounterFullReload];
+            [_tableView reloadData];
+        }
+    }];
+}
+
+//  取代
+-(void)arrayReplace:(NSMutableArray*)array newObject:(id)newObj replacedObject:(id)oldObj index:(NSIndexPath*)index
+{
+    [self recordMutation:_cmd block:^{
+        [super arrayReplace:array newObject:newObj replacedObject:oldObj index:index];
+    
+        if (_firstReload){
+            [self routeUpdateOfModel:newObj index:index];
+        } else{
+            [_metrics increment:KHBindingCounterFullReload];
+            [_tableView reloadData];
+        }
+    }];
+}
+
+//  更新
+- (void)arrayUpdate:(NSMutableArray *)array update:(id)object index:(NSIndexPath *)index
+{
+    [self recordMutation:_cmd block:^{
+        [super arrayUpdate:array update:object index:index];
+        if (_firstReload) {
+            [self routeUpdateOfModel:object index:index];
+        } else{
+            [_metrics increment:KHBindingCounterFullReload];
+            [_tableView reloadData];
+        }
+    }];
+}
+
+//  更新全部
+- (void)arrayUpdateAll:(NSMutableArray *)array
+{
+    [self recordMutation:_cmd block:^{
+        [super arrayUpdateAll:array];
+        if (_firstReload) {
+            [self routeUpdateAllOfArray:array];
+        } else{
+            [_metrics increment:KHBindingCounterFullReload];
+            [_tableView reloadData];
+        }
+    }];
+}
+
+#pragma mark - Update Routing
+
+- (nullable id)visibleCellAtIndexPath:(NSIndexPath*)index
+{
+    return [_tableView cellForRowAtIndexPath: index ];
+}
+
+- (nonnull NSArray<NSIndexPath*>*)visibleIndexPaths
+{
+    return [_tableView indexPathsForVisibleRows] ?: @[];
+}
+
+- (void)reloadIndexPaths:(NSArray<NSIndexPath*>*)indexPaths
+{
+    [_tableView reloadRowsAtIndexPaths:indexPaths withRowAnimation:UITableViewRowAnimationNone];
+}
+
+//  用 heightForRow 取得 model 現在的高度，新的 model 會在這裡量好
+- (BOOL)needsResizeAtIndexPath:(NSIndexPath*)index cell:(id)cell
+{
+    CGFloat height = [self tableView:_tableView heightForRowAtIndexPath:index];
+    return fabs( height - [_tableView rectForRowAtIndexPath:index].size.height ) >= 0.5;
+}
+
+//  空的 beginUpdates / endUpdates 只會重新取高度，cell 不會 reload
+- (void)resizeIndexPaths:(NSArray<NSIndexPath*>*)indexPaths
+{
+    if ( self.isNeedAnimation ) {
+        [_tableView beginUpdates];
+        [_tableView endUpdates];
+    }
+    else{
+        [UIView performWithoutAnimation:^{
+            [_tableView beginUpdates];
+            [_tableView endUpdates];
+        }];
+    }
 }
 
+//  UITableViewCellModel 用的是系統 cell，identifier 是 cell style
+- (nullable NSString*)reuseIdentifierOfModel:(id)model index:(NSIndexPath*)index
+{
+    if ( [model isKindOfClass:[UITableViewCellModel class]] ) {
+        return KHTableCellStyleIdentifier( ((UITableViewCellModel*)model).cellStyle );
+    }
+    return [super reuseIdentifierOfModel:model index:index];
+}
 
-/**
- * 顯示 headerView 之前，可以在這裡對 headerView 做一些顯示上的調整，例如改變字色或是背景色
- */
-- (void)tableView:(UITableView *)tableView willDisplayHeaderView:(UIView *)view forSection:(NSInteger)section{
-    UITableViewHeaderFooterView* thfv = (UITableViewHeaderFooterView*)view;
-    if( _headerBgColor ) thfv.contentView.backgroundColor = _headerBgColor;
-    if( _headerTextColor ) thfv.textLabel.textColor = _headerTextColor;
-    if(_headerFont) thfv.textLabel.font = _headerFont;
+#pragma mark - State Restoration
+
+- (CGFloat)containerWidth
+{
+    CGFloat width = _tableView.bounds.size.width;
+    return width > 0 ? width : [super containerWidth];
 }
 
-- (void)tableView:(UITableView *)tableView willDisplayFooterView:(UIView *)view forSection:(NSInteger)section
+- (nullable NSIndexPath*)anchorIndexPathWithOffset:(CGFloat*)offset
 {
-    UITableViewHeaderFooterView* thfv = (UITableViewHeaderFooterView*)view;
-    if( _footerBgColor ) thfv.contentView.backgroundColor = _footerBgColor;
-    if( _footerTextColor ) thfv.textLabel.textColor = _footerTextColor;
-    if( _footerFont ) thfv.textLabel.font = _footerFont;
+    NSArray *visibleRows = [[_tableView indexPathsForVisibleRows] sortedArrayUsingSelector:@selector(compare:)];
+    NSIndexPath *anchor = visibleRows.firstObject;
+    if ( anchor && offset ) {
+        CGFloat top = _tableView.contentOffset.y + KHAdjustedContentInset( _tableView ).top;
+        *offset = top - [_tableView rectForRowAtIndexPath: anchor ].origin.y;
+    }
+    return anchor;
 }
 
+//  estimatedHeight 用的是 restore 的 size，row 的位置不用量測
+- (void)scrollToAnchorIndexPath:(NSIndexPath*)index offset:(CGFloat)offset
+{
+    [self reloadData];
+    UIEdgeInsets inset = KHAdjustedContentInset( _tableView );
+    CGFloat y = [_tableView rectForRowAtIndexPath: index ].origin.y + offset - inset.top;
+    CGFloat maxY = _tableView.contentSize.height + inset.bottom - _tableView.bounds.size.height;
+    y = MAX( -inset.top, MIN( y, maxY ) );
+    [_tableView setContentOffset:(CGPoint){ _tableView.contentOffset.x, y } animated:NO];
+}
 
+#pragma mark - Paged Array Observe
 
+//  page 載入，只 reload 畫面上正在顯示 placeholder 的 row
+- (void)pagedArray:(KHPagedArray*)pagedArray didLoadObjects:(NSArray*)objects indexes:(NSArray*)indexes
+{
+    [super pagedArray:pagedArray didLoadObjects:objects indexes:indexes];
+    [self reloadVisiblePageIndexes:indexes section:pagedArray.section];
+}
 
-#pragma mark - Array Observe
+//  page 移出 memory，畫面上的 row 顯示的 model 已經沒有 pairInfo 與 KVO，改顯示 placeholder
+- (void)pagedArray:(KHPagedArray*)pagedArray didEvictObjects:(NSArray*)objects indexes:(NSArray*)indexes
+{
+    [super pagedArray:pagedArray didEvictObjects:objects indexes:indexes];
+    [self reloadVisiblePageIndexes:indexes section:pagedArray.section];
+}
 
-//  插入
--(void)arrayInsert:(NSMutableArray*)array insertObject:(id)object index:(NSIndexPath*)index
+//  indexes 是同一個 page 的，連續的
+- (void)reloadVisiblePageIndexes:(NSArray*)indexes section:(NSInteger)section
 {
-    [super arrayInsert:array insertObject:object index:index];
-    
-    if (_firstReload && self.isNeedAnimation){
-        [_tableView insertRowsAtIndexPaths:@[index] withRowAnimation:UITableViewRowAnimationBottom];
+    if ( !_firstReload || indexes.count == 0 ) {
+        return;
     }
-    else{
-        [_tableView reloadData];
+    NSInteger firstRow = ((NSIndexPath*)indexes.firstObject).row;
+    NSInteger lastRow = ((NSIndexPath*)indexes.lastObject).row;
+    NSMutableArray *reloadIndexes = [[NSMutableArray alloc] init];
+    for ( NSIndexPath *index in [_tableView indexPathsForVisibleRows] ) {
+        if ( index.section == section && index.row >= firstRow && index.row <= lastRow ) {
+            [reloadIndexes addObject:index];
+        }
+    }
+    if ( reloadIndexes.count > 0 ) {
+        [_metrics increment:KHBindingCounterIncrementalUpdate];
+        [_tableView reloadRowsAtIndexPaths:reloadIndexes withRowAnimation:UITableViewRowAnimationNone];
     }
 }
 
-//  插入 多項
--(void)arrayInsertSome:(NSMutableArray *)array insertObjects:(NSArray *)objects indexes:(NSArray *)indexes
+- (void)pagedArrayDidChangeCount:(KHPagedArray*)pagedArray
 {
-    [super arrayInsertSome:array insertObjects:objects indexes:indexes ];
-    
-    if (_firstReload && self.isNeedAnimation){
-        [_tableView insertRowsAtIndexPaths:indexes withRowAnimation:UITableViewRowAnimationBottom];
+    [super pagedArrayDidChangeCount:pagedArray];
+    [_metrics increment:KHBindingCounterFullReload];
+    [_tableView reloadData];
+}
+
+#pragma mark - Snapshot Array Observe
+
+//  snapshot 與 projection 共用，刪除與插入在同一次 update 裡完成，重新排序的話整個 reload
+- (void)applySnapshotChange:(KHSnapshotChange*)change section:(NSInteger)section
+{
+    if ( _firstReload && self.isNeedAnimation && !change.isReordered ) {
+        [_metrics increment:KHBindingCounterIncrementalUpdate];
+        [_tableView beginUpdates];
+        [_tableView deleteRowsAtIndexPaths:[change removedIndexPathsInSection:section] withRowAnimation:UITableViewRowAnimationTop];
+        [_tableView insertRowsAtIndexPaths:[change insertedIndexPathsInSection:section] withRowAnimation:UITableViewRowAnimationBottom];
+        [_tableView endUpdates];
     }
     else{
+        [_metrics increment:KHBindingCounterFullReload];
         [_tableView reloadData];
     }
 }
 
-//  刪除
--(void)arrayRemove:(NSMutableArray*)array removeObject:(id)object index:(NSIndexPath*)index
+//  snapshot 換上後
+- (void)snapshotArray:(KHSnapshotArray*)snapshotArray didCommitChange:(KHSnapshotChange*)change
 {
-    [super arrayRemove:array removeObject:object index:index];
-    
-    if (_firstReload && self.isNeedAnimation) {
-        [_tableView deleteRowsAtIndexPaths:@[index] withRowAnimation:UITableViewRowAnimationTop];
-    } else {
-        [_tableView reloadData];
-    }
+    [self recordMutation:_cmd block:^{
+        [super snapshotArray:snapshotArray didCommitChange:change];
+        [self applySnapshotChange:change section:snapshotArray.section];
+    }];
 }
 
-//  刪除全部
--(void)arrayRemoveSome:(NSMutableArray *)array removeObjects:(NSArray *)objects indexs:(NSArray *)indexs
+#pragma mark - Projected Array Observe
+
+//  projection 的 row 增減
+- (void)projectedArray:(KHProjectedArray*)projectedArray didChange:(KHSnapshotChange*)change
 {
-    [super arrayRemoveSome:array removeObjects:objects indexs:indexs ];
-    
-    if(_firstReload && self.isNeedAnimation){
-        [_tableView deleteRowsAtIndexPaths:indexs withRowAnimation:UITableViewRowAnimationTop];
-    } else{
-        [_tableView reloadData];
-    }
+    [self recordMutation:_cmd block:^{
+        [super projectedArray:projectedArray didChange:change];
+        [self applySnapshotChange:change section:projectedArray.section];
+    }];
 }
 
-//  取代
--(void)arrayReplace:(NSMutableArray*)array newObject:(id)newObj replacedObject:(id)oldObj index:(NSIndexPath*)index
+//  排序位置改變
+- (void)projectedArray:(KHProjectedArray*)projectedArray didMoveObject:(id)object fromIndex:(NSUInteger)fromIndex toIndex:(NSUInteger)toIndex
 {
-    [super arrayReplace:array newObject:newObj replacedObject:oldObj index:index];
+    [self recordMutation:_cmd block:^{
+        [super projectedArray:projectedArray didMoveObject:object fromIndex:fromIndex toIndex:toIndex];
     
-    if (_firstReload && self.isNeedAnimation){
-        [_tableView reloadRowsAtIndexPaths:@[index] withRowAnimation:UITableViewRowAnimationFade];
-    } else{
-        [_tableView reloadData];
-    }
+        if ( _firstReload && self.isNeedAnimation ) {
+            NSInteger section = projectedArray.section;
+            [_metrics increment:KHBindingCounterIncrementalUpdate];
+            [_tableView moveRowAtIndexPath:[NSIndexPath indexPathForRow:fromIndex inSection:section] toIndexPath:[NSIndexPath indexPathForRow:toIndex inSection:section]];
+        }
+        else{
+            [_metrics increment:KHBindingCounterFullReload];
+            [_tableView reloadData];
+        }
+    }];
 }
 
-//  更新
-- (void)arrayUpdate:(NSMutableArray *)array update:(id)object index:(NSIndexPath *)index
+//  model 改變，位置不變
+- (void)projectedArray:(KHProjectedArray*)projectedArray didUpdateObject:(id)object index:(NSUInteger)index
 {
-    [super arrayUpdate:array update:object index:index];
-    if (_firstReload && self.isNeedAnimation) {
-        [_tableView reloadRowsAtIndexPaths:@[index] withRowAnimation:UITableViewRowAnimationAutomatic];
-    } else{
-        [_tableView reloadData];
-    }
+    [self recordMutation:_cmd block:^{
+        [super projectedArray:projectedArray didUpdateObject:object index:index];
+    
+        if ( _firstReload && self.isNeedAnimation ) {
+            [_metrics increment:KHBindingCounterIncrementalUpdate];
+            [_tableView reloadRowsAtIndexPaths:@[[NSIndexPath indexPathForRow:index inSection:projectedArray.section]] withRowAnimation:UITableViewRowAnimationAutomatic];
+        }
+        else{
+            [_metrics increment:KHBindingCounterFullReload];
+            [_tableView reloadData];
+        }
+    }];
+}
+
+#pragma mark - Grouped Array Observe
+
+//  section 與 row 的增減在同一次 update 裡完成
+- (void)groupedArray:(KHGroupedArray*)groupedArray didChange:(KHGroupedChange*)change
+{
+    [self recordMutation:_cmd block:^{
+        NSInteger firstSection = groupedArray.section;
+        NSIndexSet *removedSections = [change removedSectionsFrom:firstSection];
+        NSIndexSet *insertedSections = [change insertedSectionsFrom:firstSection];
+        [super groupedArray:groupedArray didChange:change];
+    
+        KHShiftSectionList( _headerTitles, removedSections, insertedSections );
+        KHShiftSectionList( _headerViews, removedSections, insertedSections );
+        KHShiftSectionList( _footerTitles, removedSections, insertedSections );
+        KHShiftSectionList( _footerViews, removedSections, insertedSections );
+        [self fillHeaderFooterNull];
+    
+        if ( _firstReload && self.isNeedAnimation && !change.isReloaded ) {
+            [_metrics increment:KHBindingCounterIncrementalUpdate];
+            [_tableView beginUpdates];
+            [_tableView deleteSections:removedSections withRowAnimation:UITableViewRowAnimationTop];
+            [_tableView insertSections:insertedSections withRowAnimation:UITableViewRowAnimationBottom];
+            [_tableView deleteRowsAtIndexPaths:[change removedIndexPathsFrom:firstSection] withRowAnimation:UITableViewRowAnimationTop];
+            [_tableView insertRowsAtIndexPaths:[change insertedIndexPathsFrom:firstSection] withRowAnimation:UITableViewRowAnimationBottom];
+            [_tableView endUpdates];
+        }
+        else{
+            [_metrics increment:KHBindingCounterFullReload];
+            [_tableView reloadData];
+        }
+    }];
 }
 
-//  更新全部
-- (void)arrayUpdateAll:(NSMutableArray *)array
+//  model 改變，group 不變
+- (void)groupedArray:(KHGroupedArray*)groupedArray didUpdateObject:(id)object indexPath:(NSIndexPath*)indexPath
 {
-    [super arrayUpdateAll:array];
-    [_tableView reloadData];
+    [self recordMutation:_cmd block:^{
+        [super groupedArray:groupedArray didUpdateObject:object indexPath:indexPath];
+    
+        NSIndexPath *viewIndexPath = [NSIndexPath indexPathForRow:indexPath.row inSection:groupedArray.section + indexPath.section];
+        if ( _firstReload && self.isNeedAnimation ) {
+            [_metrics increment:KHBindingCounterIncrementalUpdate];
+            [_tableView reloadRowsAtIndexPaths:@[viewIndexPath] withRowAnimation:UITableViewRowAnimationAutomatic];
+        }
+        else{
+            [_metrics increment:KHBindingCounterFullReload];
+            [_tableView reloadData];
+        }
+    }];
 }
 
 @end
@@ -1586,6 +2832,9 @@
 @implementation KHCollectionDataBinding
 {
     UICollectionViewCell *_prototype_cell;
+    
+    //  key: placeholder 對映的 cell name / value: size
+    NSMutableDictionary *_placeholderSizes;
 }
 
 - (instancetype)init
@@ -1632,6 +2881,43 @@
 {
     [super bindArray:array];
     if ( array.count > 0 ) {
+        [_metrics increment:KHBindingCounterFullReload];
+        [self.collectionView reloadData];
+    }
+}
+
+- (void)bindPagedArray:(KHPagedArray *)pagedArray
+{
+    [super bindPagedArray:pagedArray];
+    if ( pagedArray.count > 0 ) {
+        [_metrics increment:KHBindingCounterFullReload];
+        [self.collectionView reloadData];
+    }
+}
+
+- (void)bindSnapshotArray:(KHSnapshotArray *)snapshotArray
+{
+    [super bindSnapshotArray:snapshotArray];
+    if ( snapshotArray.count > 0 ) {
+        [_metrics increment:KHBindingCounterFullReload];
+        [self.collectionView reloadData];
+    }
+}
+
+- (void)bindProjectedArray:(KHProjectedArray *)projectedArray
+{
+    [super bindProjectedArray:projectedArray];
+    if ( projectedArray.count > 0 ) {
+        [_metrics increment:KHBindingCounterFullReload];
+        [self.collectionView reloadData];
+    }
+}
+
+- (void)bindGroupedArray:(KHGroupedArray *)groupedArray
+{
+    [super bindGroupedArray:groupedArray];
+    if ( groupedArray.groups.count > 0 ) {
+        [_metrics increment:KHBindingCounterFullReload];
         [self.collectionView reloadData];
     }
 }
@@ -1663,6 +2949,8 @@
     }
 //    pairInfo.data[kCellSize] = [NSValue valueWithCGSize:cellSize];
     pairInfo.cellSize = cellSize;
+    //  指定的 size 是最新的，先前的 updateAll 不會讓它失效
+    pairInfo.updateGeneration = _updateGeneration;
 }
 
 
@@ -1696,6 +2984,7 @@
 
 - (void)reloadData
 {
+    [_metrics increment:KHBindingCounterFullReload];
     [self.collectionView reloadData];
 }
 
@@ -1794,6 +3083,7 @@
 {
     // WillSet...
     if (self.isLoading != isLoading) {
+        [_metrics increment:KHBindingCounterFullReload];
         [self.collectionView reloadData];
     }
     
@@ -1929,6 +3219,9 @@
 // The cell that is returned must be retrieved from a call to -dequeueReusableCellWithReuseIdentifier:forIndexPath:
 - (UICollectionViewCell *)collectionView:(UICollectionView *)collectionView cellForItemAtIndexPath:(NSIndexPath *)indexPath
 {
+    KHMetricsIntervalToken configureToken = [_metrics beginInterval:KHBindingIntervalCellConfigure];
+    CFTimeInterval hitchStart = [_hitchRecorder now];
+    
     _firstReload = YES;
 //    NSLog(@"DataBinder >> %ld cell config", indexPath.row );
     NSMutableArray *modelArray = _sectionArray[indexPath.section];
@@ -1971,7 +3264,10 @@
     pairInfo.cellSize = cell.frame.size;
     
     //  把 model 載入 cell
-    [cell onLoad:model];
+    [self loadModel:model cell:cell];
+    
+    [_hitchRecorder recordEvent:KHHitchEventCellConfigure cellClass:[cell class] start:hitchStart];
+    [_metrics endInterval:KHBindingIntervalCellConfigure token:configureToken cellClass:[cell class]];
     
     return cell;
 }
@@ -2042,12 +3338,17 @@
 //  ◆ 注意：這邊跟 TableView 不同，當 reuse cell 的時候，並不會再呼叫一次，操你媽的
 - (CGSize)collectionView:(UICollectionView *)collectionView layout:(UICollectionViewLayout*)collectionViewLayout sizeForItemAtIndexPath:(NSIndexPath *)indexPath
 {
-    NSArray *arr = [self getArray:indexPath.section];
-    id model = arr[indexPath.row];
+    //  flow layout 每次 reload 都會取全部 item 的 size，不用 arr[row]，不然 paged array 每一頁都會被 fetch
+    id model = [self loadedModelAtIndexPath:indexPath];
+    if ( model == nil ) {
+        return [self placeholderSizeAtIndexPath:indexPath];
+    }
     KHPairInfo *pairInfo = [self getPairInfo: model ];
+    [self resolveStalePairInfo:pairInfo model:model index:indexPath];
     CGSize cellSize = pairInfo.cellSize;
     
     if ( cellSize.width == 0 && cellSize.height == 0 ) {
+        [_metrics increment:KHBindingCounterSizeCacheMiss];
         NSString *cellName = [self getMappingCellNameWith:model index:indexPath ];
         UINib *nib = [UINib nibWithNibName:cellName bundle:[NSBundle mainBundle]];
         NSArray *arr = [nib instantiateWithOwner:nil options:nil];
@@ -2062,11 +3363,44 @@
         
         pairInfo.cellSize = cellSize;
     }
+    else{
+        [_metrics increment:KHBindingCounterSizeCacheHit];
+    }
     
 //    CGSize size = [cellSizeValue CGSizeValue];
 //    NSLog(@"DataBinder >> %i cell size %@", indexPath.row, NSStringFromCGSize(_prototype_cell.frame.size));
     
-    return pairInfo.cellSize;
+    return cellSize;
+}
+
+//  paged array 還沒載入的 item 沒有 pairInfo，每個 cell 對映只量一次
+- (CGSize)placeholderSizeAtIndexPath:(NSIndexPath *)indexPath
+{
+    NSValue *defaultSize = self.defaultSizeAndModelMapping[[KHPagedPlaceholder class]];
+    if ( defaultSize ) {
+        return [defaultSize CGSizeValue];
+    }
+    id array = _sectionArray[indexPath.section];
+    if ( ![array isKindOfClass:[KHPagedArray class]] ) {
+        return CGSizeZero;
+    }
+    KHPagedPlaceholder *placeholder = [(KHPagedArray*)array placeholderAtIndex:indexPath.row];
+    NSString *cellName = [self getMappingCellNameWith:placeholder index:indexPath ];
+    if ( cellName == nil ) {
+        return CGSizeZero;
+    }
+    NSValue *size = _placeholderSizes[cellName];
+    if ( size == nil ) {
+        [_metrics increment:KHBindingCounterSizeCacheMiss];
+        UINib *nib = [UINib nibWithNibName:cellName bundle:[NSBundle mainBundle]];
+        UICollectionViewCell *cell = [nib instantiateWithOwner:nil options:nil].firstObject;
+        size = [NSValue valueWithCGSize:cell.frame.size];
+        if ( _placeholderSizes == nil ) {
+            _placeholderSizes = [[NSMutableDictionary alloc] init];
+        }
+        _placeholderSizes[cellName] = size;
+    }
+    return [size CGSizeValue];
 }
 
 //- (UIEdgeInsets)collectionView:(UICollectionView *)collectionView layout:(UICollectionViewLayout*)collectionViewLayout insetForSectionAtIndex:(NSInteger)section;
@@ -2150,81 +3484,365 @@
 //  插入
 -(void)arrayInsert:(NSMutableArray*)array insertObject:(id)object index:(NSIndexPath*)index
 {
-    [super arrayInsert:array insertObject:object index:index];
-    if (_firstReload && self.isNeedAnimation) {
-        [_collectionView insertItemsAtIndexPaths:@[index]];
-    }
-    else{
-        [_collectionView reloadData];
-    }
+    [self recordMutation:_cmd block:^{
+        [super arrayInsert:array insertObject:object index:index];
+        if (_firstReload && self.isNeedAnimation) {
+            [_metrics increment:KHBindingCounterIncrementalUpdate];
+            [_collectionView insertItemsAtIndexPaths:@[index]];
+        }
+        else{
+            [_metrics increment:KHBindingCounterFullReload];
+            [_collectionView reloadData];
+        }
+    }];
 }
 
 //  插入 多項
 -(void)arrayInsertSome:(NSMutableArray *)array insertObjects:(NSArray *)objects indexes:(NSArray *)indexes
 {
-    [super arrayInsertSome:array insertObjects:objects indexes:indexes];
-    if (_firstReload && self.isNeedAnimation){
-        [_collectionView insertItemsAtIndexPaths:indexes];
-    }
-    else{
-        [_collectionView reloadData];
-    }
+    [self recordMutation:_cmd block:^{
+        [super arrayInsertSome:array insertObjects:objects indexes:indexes];
+        if (_firstReload && self.isNeedAnimation){
+            [_metrics increment:KHBindingCounterIncrementalUpdate];
+            [_collectionView insertItemsAtIndexPaths:indexes];
+        }
+        else{
+            [_metrics increment:KHBindingCounterFullReload];
+            [_collectionView reloadData];
+        }
+    }];
 }
 
 //  刪除
 -(void)arrayRemove:(NSMutableArray*)array removeObject:(id)object index:(NSIndexPath*)index
 {
-    [super arrayRemove:array removeObject:object index:index];
-    if (_firstReload && self.isNeedAnimation) {
-        [_collectionView deleteItemsAtIndexPaths:@[index]];
-    } else {
-        [_collectionView reloadData];
-    }
+    [self recordMutation:_cmd block:^{
+        [super arrayRemove:array removeObject:object index:index];
+        if (_firstReload && self.isNeedAnimation) {
+            [_metrics increment:KHBindingCounterIncrementalUpdate];
+            [_collectionView deleteItemsAtIndexPaths:@[index]];
+        } else {
+            [_metrics increment:KHBindingCounterFullReload];
+            [_collectionView reloadData];
+        }
+    }];
 }
 
 //  刪除全部
 -(void)arrayRemoveSome:(NSMutableArray *)array removeObjects:(NSArray *)objects indexs:(NSArray *)indexs
 {
-    [super arrayRemoveSome:array removeObjects:objects indexs:indexs];
-    if (_firstReload && self.isNeedAnimation) {
-        [_collectionView deleteItemsAtIndexPaths:indexs];
-    } else {
-        [_collectionView reloadData];
-    }
+    [self recordMutation:_cmd block:^{
+        [super arrayRemoveSome:array removeObjects:objects indexs:indexs];
+        if (_firstReload && self.isNeedAnimation) {
+            [_metrics increment:KHBindingCounterIncrementalUpdate];
+            [_collectionView deleteItemsAtIndexPaths:indexs];
+        } else {
+            [_metrics increment:KHBindingCounterFullReload];
+            [_collectionView reloadData];
+        }
+    }];
 }
 
 //  取代
 -(void)arrayReplace:(NSMutableArray*)array newObject:(id)newObj replacedObject:(id)oldObj index:(NSIndexPath*)index
 {
-    [super arrayReplace:array newObject:newObj replacedObject:oldObj index:index];
-    if (_firstReload && self.isNeedAnimation) {
-        [_collectionView reloadItemsAtIndexPaths:@[index]];
-    } else {
-        [_collectionView reloadData];
-    }
+    [self recordMutation:_cmd block:^{
+        [super arrayReplace:array newObject:newObj replacedObject:oldObj index:index];
+        if (_firstReload) {
+            [self routeUpdateOfModel:newObj index:index];
+        } else {
+            [_metrics increment:KHBindingCounterFullReload];
+            [_collectionView reloadData];
+        }
+    }];
 }
 
 //  更新
 -(void)arrayUpdate:(NSMutableArray*)array update:(id)object index:(NSIndexPath*)index
 {
-    [super arrayUpdate:array update:object index:index];
-    if (_firstReload && self.isNeedAnimation) {
-        [_collectionView reloadItemsAtIndexPaths:@[index]];
-    } else {
-        [_collectionView reloadData];
-    }
+    [self recordMutation:_cmd block:^{
+        [super arrayUpdate:array update:object index:index];
+        if (_firstReload) {
+            [self routeUpdateOfModel:object index:index];
+        } else {
+            [_metrics increment:KHBindingCounterFullReload];
+            [_collectionView reloadData];
+        }
+    }];
 }
 
 -(void)arrayUpdateAll:(NSMutableArray *)array
 {
-    [super arrayUpdateAll:array];
-    if (_firstReload && self.isNeedAnimation) {
-        [_collectionView reloadSections:[NSIndexSet indexSetWithIndex:array.section]];
+    [self recordMutation:_cmd block:^{
+        [super arrayUpdateAll:array];
+        if (_firstReload) {
+            [self routeUpdateAllOfArray:array];
+        } else {
+            [_metrics increment:KHBindingCounterFullReload];
+            [_collectionView reloadData];
+        }
+    }];
+}
+
+#pragma mark - Update Routing
+
+- (nullable id)visibleCellAtIndexPath:(NSIndexPath*)index
+{
+    return [_collectionView cellForItemAtIndexPath: index ];
+}
+
+- (nonnull NSArray<NSIndexPath*>*)visibleIndexPaths
+{
+    return [_collectionView indexPathsForVisibleItems] ?: @[];
+}
+
+- (void)reloadIndexPaths:(NSArray<NSIndexPath*>*)indexPaths
+{
+    [_collectionView reloadItemsAtIndexPaths:indexPaths];
+}
+
+//  只有 flow layout 的 size 是由 binding 決定
+- (BOOL)needsResizeAtIndexPath:(NSIndexPath*)index cell:(id)cell
+{
+    UICollectionViewLayout *layout = _collectionView.collectionViewLayout;
+    if ( ![layout isKindOfClass:[UICollectionViewFlowLayout class]] ) {
+        return NO;
+    }
+    CGSize size = [self collectionView:_collectionView layout:layout sizeForItemAtIndexPath:index];
+    return !CGSizeEqualToSize( size, ((UICollectionViewCell*)cell).frame.size );
+}
+
+//  重新排版，cell 不會 reload
+- (void)resizeIndexPaths:(NSArray<NSIndexPath*>*)indexPaths
+{
+    [_collectionView.collectionViewLayout invalidateLayout];
+}
+
+#pragma mark - State Restoration
+
+- (BOOL)isHorizontalLayout
+{
+    return [_collectionView.collectionViewLayout isKindOfClass:[UICollectionViewFlowLayout class]] &&
+           ((UICollectionViewFlowLayout*)_collectionView.collectionViewLayout).scrollDirection == UICollectionViewScrollDirectionHorizontal;
+}
+
+//  橫向捲動時，size 量測依的是高度
+- (CGFloat)containerWidth
+{
+    CGFloat width = [self isHorizontalLayout] ? _collectionView.bounds.size.height : _collectionView.bounds.size.width;
+    return width > 0 ? width : [super containerWidth];
+}
+
+- (nullable NSIndexPath*)anchorIndexPathWithOffset:(CGFloat*)offset
+{
+    BOOL horizontal = [self isHorizontalLayout];
+    UIEdgeInsets inset = KHAdjustedContentInset( _collectionView );
+    CGFloat top = horizontal ? _collectionView.contentOffset.x + inset.left : _collectionView.contentOffset.y + inset.top;
+    //  同一行有好幾個 item，取最上面，再來最左邊的
+    NSIndexPath *anchor = nil;
+    CGRect anchorFrame = CGRectZero;
+    for ( NSIndexPath *index in [_collectionView indexPathsForVisibleItems] ) {
+        CGRect frame = [_collectionView layoutAttributesForItemAtIndexPath: index ].frame;
+        CGFloat end = horizontal ? CGRectGetMaxX( frame ) : CGRectGetMaxY( frame );
+        if ( end <= top ) {
+            continue;
+        }
+        if ( anchor == nil || [index compare:anchor] == NSOrderedAscending ) {
+            anchor = index;
+            anchorFrame = frame;
+        }
+    }
+    if ( anchor && offset ) {
+        *offset = top - ( horizontal ? anchorFrame.origin.x : anchorFrame.origin.y );
+    }
+    return anchor;
+}
+
+//  sizeForItem 用的是 restore 的 size，layout 一次就知道 item 的位置
+- (void)scrollToAnchorIndexPath:(NSIndexPath*)index offset:(CGFloat)offset
+{
+    [self reloadData];
+    [_collectionView layoutIfNeeded];
+    CGRect frame = [_collectionView layoutAttributesForItemAtIndexPath: index ].frame;
+    UIEdgeInsets inset = KHAdjustedContentInset( _collectionView );
+    CGSize contentSize = _collectionView.collectionViewLayout.collectionViewContentSize;
+    CGPoint contentOffset = _collectionView.contentOffset;
+    if ( [self isHorizontalLayout] ) {
+        CGFloat x = frame.origin.x + offset - inset.left;
+        CGFloat maxX = contentSize.width + inset.right - _collectionView.bounds.size.width;
+        contentOffset.x = MAX( -inset.left, MIN( x, maxX ) );
     } else {
+        CGFloat y = frame.origin.y + offset - inset.top;
+        CGFloat maxY = contentSize.height + inset.bottom - _collectionView.bounds.size.height;
+        contentOffset.y = MAX( -inset.top, MIN( y, maxY ) );
+    }
+    [_collectionView setContentOffset:contentOffset animated:NO];
+}
+
+#pragma mark - Paged Array Observe
+
+//  page 載入，只 reload 畫面上正在顯示 placeholder 的 item
+- (void)pagedArray:(KHPagedArray*)pagedArray didLoadObjects:(NSArray*)objects indexes:(NSArray*)indexes
+{
+    [super pagedArray:pagedArray didLoadObjects:objects indexes:indexes];
+    [self reloadVisiblePageIndexes:indexes section:pagedArray.section];
+}
+
+//  page 移出 memory，畫面上的 item 顯示的 model 已經沒有 pairInfo 與 KVO，改顯示 placeholder
+- (void)pagedArray:(KHPagedArray*)pagedArray didEvictObjects:(NSArray*)objects indexes:(NSArray*)indexes
+{
+    [super pagedArray:pagedArray didEvictObjects:objects indexes:indexes];
+    [self reloadVisiblePageIndexes:indexes section:pagedArray.section];
+}
+
+//  indexes 是同一個 page 的，連續的
+- (void)reloadVisiblePageIndexes:(NSArray*)indexes section:(NSInteger)section
+{
+    if ( !_firstReload || indexes.count == 0 ) {
+        return;
+    }
+    NSInteger firstRow = ((NSIndexPath*)indexes.firstObject).row;
+    NSInteger lastRow = ((NSIndexPath*)indexes.lastObject).row;
+    NSMutableArray *reloadIndexes = [[NSMutableArray alloc] init];
+    for ( NSIndexPath *index in [_collectionView indexPathsForVisibleItems] ) {
+        if ( index.section == section && index.row >= firstRow && index.row <= lastRow ) {
+            [reloadIndexes addObject:index];
+        }
+    }
+    if ( reloadIndexes.count > 0 ) {
+        [_metrics increment:KHBindingCounterIncrementalUpdate];
+        [_collectionView reloadItemsAtIndexPaths:reloadIndexes];
+    }
+}
+
+- (void)pagedArrayDidChangeCount:(KHPagedArray*)pagedArray
+{
+    [super pagedArrayDidChangeCount:pagedArray];
+    [_metrics increment:KHBindingCounterFullReload];
+    [_collectionView reloadData];
+}
+
+#pragma mark - Snapshot Array Observe
+
+//  snapshot 與 projection 共用，刪除與插入在同一次 batch update 裡完成，重新排序的話整個 reload
+- (void)applySnapshotChange:(KHSnapshotChange*)change section:(NSInteger)section
+{
+    if ( _firstReload && self.isNeedAnimation && !change.isReordered ) {
+        [_metrics increment:KHBindingCounterIncrementalUpdate];
+        [_collectionView performBatchUpdates:^{
+            [_collectionView deleteItemsAtIndexPaths:[change removedIndexPathsInSection:section]];
+            [_collectionView insertItemsAtIndexPaths:[change insertedIndexPathsInSection:section]];
+        } completion:nil];
+    }
+    else{
+        [_metrics increment:KHBindingCounterFullReload];
         [_collectionView reloadData];
     }
 }
 
+//  snapshot 換上後
+- (void)snapshotArray:(KHSnapshotArray*)snapshotArray didCommitChange:(KHSnapshotChange*)change
+{
+    [self recordMutation:_cmd block:^{
+        [super snapshotArray:snapshotArray didCommitChange:change];
+        [self applySnapshotChange:change section:snapshotArray.section];
+    }];
+}
+
+#pragma mark - Projected Array Observe
+
+//  projection 的 item 增減
+- (void)projectedArray:(KHProjectedArray*)projectedArray didChange:(KHSnapshotChange*)change
+{
+    [self recordMutation:_cmd block:^{
+        [super projectedArray:projectedArray didChange:change];
+        [self applySnapshotChange:change section:projectedArray.section];
+    }];
+}
+
+//  排序位置改變
+- (void)projectedArray:(KHProjectedArray*)projectedArray didMoveObject:(id)object fromIndex:(NSUInteger)fromIndex toIndex:(NSUInteger)toIndex
+{
+    [self recordMutation:_cmd block:^{
+        [super projectedArray:projectedArray didMoveObject:object fromIndex:fromIndex toIndex:toIndex];
+    
+        if ( _firstReload && self.isNeedAnimation ) {
+            NSInteger section = projectedArray.section;
+            [_metrics increment:KHBindingCounterIncrementalUpdate];
+            [_collectionView moveItemAtIndexPath:[NSIndexPath indexPathForRow:fromIndex inSection:section] toIndexPath:[NSIndexPath indexPathForRow:toIndex inSection:section]];
+        }
+        else{
+            [_metrics increment:KHBindingCounterFullReload];
+            [_collectionView reloadData];
+        }
+    }];
+}
+
+//  model 改變，位置不變
+- (void)projectedArray:(KHProjectedArray*)projectedArray didUpdateObject:(id)object index:(NSUInteger)index
+{
+    [self recordMutation:_cmd block:^{
+        [super projectedArray:projectedArray didUpdateObject:object index:index];
+    
+        if ( _firstReload && self.isNeedAnimation ) {
+            [_metrics increment:KHBindingCounterIncrementalUpdate];
+            [_collectionView reloadItemsAtIndexPaths:@[[NSIndexPath indexPathForRow:index inSection:projectedArray.section]]];
+        }
+        else{
+            [_metrics increment:KHBindingCounterFullReload];
+            [_collectionView reloadData];
+        }
+    }];
+}
+
+#pragma mark - Grouped Array Observe
+
+//  section 與 item 的增減在同一次 batch update 裡完成
+- (void)groupedArray:(KHGroupedArray*)groupedArray didChange:(KHGroupedChange*)change
+{
+    [self recordMutation:_cmd block:^{
+        NSInteger firstSection = groupedArray.section;
+        NSIndexSet *removedSections = [change removedSectionsFrom:firstSection];
+        NSIndexSet *insertedSections = [change insertedSectionsFrom:firstSection];
+        [super groupedArray:groupedArray didChange:change];
+    
+        KHShiftSectionList( _headerModelList, removedSections, insertedSections );
+        KHShiftSectionList( _footerModelList, removedSections, insertedSections );
+    
+        if ( _firstReload && self.isNeedAnimation && !change.isReloaded ) {
+            [_metrics increment:KHBindingCounterIncrementalUpdate];
+            [_collectionView performBatchUpdates:^{
+                [_collectionView deleteSections:removedSections];
+                [_collectionView insertSections:insertedSections];
+                [_collectionView deleteItemsAtIndexPaths:[change removedIndexPathsFrom:firstSection]];
+                [_collectionView insertItemsAtIndexPaths:[change insertedIndexPathsFrom:firstSection]];
+            } completion:nil];
+        }
+        else{
+            [_metrics increment:KHBindingCounterFullReload];
+            [_collectionView reloadData];
+        }
+    }];
+}
+
+//  model 改變，group 不變
+- (void)groupedArray:(KHGroupedArray*)groupedArray didUpdateObject:(id)object indexPath:(NSIndexPath*)indexPath
+{
+    [self recordMutation:_cmd block:^{
+        [super groupedArray:groupedArray didUpdateObject:object indexPath:indexPath];
+    
+        NSIndexPath *viewIndexPath = [NSIndexPath indexPathForRow:indexPath.row inSection:groupedArray.section + indexPath.section];
+        if ( _firstReload && self.isNeedAnimation ) {
+            [_metrics increment:KHBindingCounterIncrementalUpdate];
+            [_collectionView reloadItemsAtIndexPaths:@[viewIndexPath]];
+        }
+        else{
+            [_metrics increment:KHBindingCounterFullReload];
+            [_collectionView reloadData];
+        }
+    }];
+}
+
 
 
 @end
@@ -0,0 +1,129 @@
+//
+//  KHGroupedArray.h
+//
+//  Created by Calvin Huang on 2017/3/12.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "NSMutableArray+KHSwizzle.h"
+
+//  依 key 把一個 source array 分成好幾個 section
+//
+//  KHGroupedArray 依 keyBlock 回傳的 key 把 source NSMutableArray 分組，每個 group 是一個 KHGroupSection，綁定成一個 section
+//  group 從 section 開始佔連續的 section
+//  用 kh_addObserver: 觀察 source，source 的每個變動都逐步套用：
+//
+//  insert  : 依 key 找 model 的 group，沒有的話建立
+//  remove  : 移除 row，沒有 row 的 group 也移除
+//  update  : -[NSMutableArray update:] 或 regroupObject: 重新讀 key，key 改了的話 model 移到別的 group
+//
+//  source 的一次變動回報成一個 KHGroupedChange，畫面在同一次 batch 裡增刪 section 與 row
+//  group 裡的 row 依 source 的順序
+//  group 依 keyComparator 排序，沒有 keyComparator 的話依建立的順序
+//
+//  所有 method 都只能在 main thread 呼叫，跟綁定的 NSMutableArray 一樣
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class KHGroupedArray;
+
+//  KHGroupedArray 的一個 section
+@interface KHGroupSection : NSObject <NSFastEnumeration>
+
+@property (nullable,nonatomic,weak) id kh_delegate;
+@property (nonatomic) NSInteger section;
+
+@property (nullable,nonatomic,readonly,weak) KHGroupedArray *groupedArray;
+@property (nonatomic,readonly) id key;
+
+//  section header 的文字，有 titleBlock 用 titleBlock，key 是 NSString 就用 key
+@property (nullable,nonatomic,readonly) NSString *title;
+
+@property (nonatomic,readonly) NSUInteger count;
+
+- (id)objectAtIndex:(NSUInteger)index;
+- (id)objectAtIndexedSubscript:(NSUInteger)index;
+- (NSUInteger)indexOfObjectIdenticalTo:(id)anObject;
+
+- (NSArray*)objects;
+
+@end
+
+
+//  source 一次變動的差異，group 的 index 是相對於 grouped array 的第一個 section
+@interface KHGroupedChange : NSObject
+
+//  移除的 group，index 是變動前的
+@property (nonatomic,readonly) NSArray<KHGroupSection*> *removedGroups;
+@property (nonatomic,readonly) NSIndexSet *removedGroupIndexes;
+
+//  建立的 group，index 是變動後的
+@property (nonatomic,readonly) NSArray<KHGroupSection*> *insertedGroups;
+@property (nonatomic,readonly) NSIndexSet *insertedGroupIndexes;
+
+//  留下來的 group 裡的 row，移除的是變動前的 index，插入的是變動後的
+@property (nonatomic,readonly) NSArray<NSIndexPath*> *removedRows;
+@property (nonatomic,readonly) NSArray<NSIndexPath*> *insertedRows;
+
+//  離開 / 加入 source 的 model，用來移除與建立 pair
+@property (nonatomic,readonly) NSArray *removedObjects;
+@property (nonatomic,readonly) NSArray *insertedObjects;
+
+//  所有 group 都重建了，只能 reloadData
+@property (nonatomic,readonly) BOOL isReloaded;
+
+- (BOOL)isEmpty;
+
+//  index / row 換成畫面上的 section
+- (NSIndexSet*)removedSectionsFrom:(NSInteger)firstSection;
+- (NSIndexSet*)insertedSectionsFrom:(NSInteger)firstSection;
+- (NSArray<NSIndexPath*>*)removedIndexPathsFrom:(NSInteger)firstSection;
+- (NSArray<NSIndexPath*>*)insertedIndexPathsFrom:(NSInteger)firstSection;
+
+@end
+
+
+//  KHDataBinding 實作這個，讓 section、pairInfo 與畫面跟著 group 同步
+@protocol KHGroupedArrayObserveDelegate
+
+- (void)groupedArray:(KHGroupedArray*)groupedArray didChange:(KHGroupedChange*)change;
+
+//  model 變動，但還在同一個 group 的同一個 row
+- (void)groupedArray:(KHGroupedArray*)groupedArray didUpdateObject:(id)object indexPath:(NSIndexPath*)indexPath;
+
+@end
+
+
+@interface KHGroupedArray : NSObject <KHArrayObserveDelegate>
+
+@property (nullable,nonatomic,weak) id<KHGroupedArrayObserveDelegate> kh_delegate;
+
+//  第一個 group 的 section，沒有 group 時是下一個 group 會放的 section
+@property (nonatomic) NSInteger section;
+
+@property (nonatomic,readonly) NSMutableArray *source;
+
+@property (nonatomic,readonly) NSArray<KHGroupSection*> *groups;
+
+//  key 的排序，nil 表示依 group 建立的順序
+@property (nullable,nonatomic,readonly) NSComparator keyComparator;
+
+//  section header 的文字
+@property (nullable,nonatomic,copy) NSString* _Nullable(^titleBlock)(id key);
+
+//  keyBlock 回傳的 key 會當成 dictionary key，要實作 isEqual: 與 hash，不可以回傳 nil
+- (instancetype)initWithSource:(NSMutableArray*)source keyBlock:(id<NSCopying>(^)(id model))keyBlock keyComparator:(nullable NSComparator)keyComparator;
+
+- (nullable KHGroupSection*)groupForKey:(id)key;
+- (nullable KHGroupSection*)groupOfObject:(id)model;
+
+//  model 的 key 可能改了，重新分組
+- (void)regroupObject:(id)model;
+
+//  全部重新分組
+- (void)refresh;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,497 @@
+//
+//  KHGroupedArray.m
+//
+//  Created by Calvin Huang on 2017/3/12.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import "KHGroupedArray.h"
+
+@interface KHGroupSection ()
+
+@property (nonatomic,readwrite,weak) KHGroupedArray *groupedArray;
+@property (nonatomic,readwrite) id key;
+@property (nonatomic,readwrite) NSString *title;
+
+//  由 KHGroupedArray 修改
+@property (nonatomic,readonly) NSMutableArray *mutableObjects;
+
+@end
+
+@implementation KHGroupSection
+{
+    //  for in 走訪時的快照，要留著，不然走訪到一半就被釋放了
+    NSArray *_enumerationSnapshot;
+}
+
+- (instancetype)initWithKey:(id)key groupedArray:(KHGroupedArray*)groupedArray
+{
+    self = [super init];
+    if (self) {
+        _key = key;
+        _groupedArray = groupedArray;
+        _mutableObjects = [[NSMutableArray alloc] init];
+        if ( groupedArray.titleBlock ) {
+            _title = groupedArray.titleBlock( key );
+        }
+        else if ( [key isKindOfClass:[NSString class]] ) {
+            _title = key;
+        }
+    }
+    return self;
+}
+
+- (NSUInteger)count
+{
+    return _mutableObjects.count;
+}
+
+- (id)objectAtIndex:(NSUInteger)index
+{
+    return [_mutableObjects objectAtIndex:index];
+}
+
+- (id)objectAtIndexedSubscript:(NSUInteger)index
+{
+    return [_mutableObjects objectAtIndex:index];
+}
+
+- (NSUInteger)indexOfObjectIdenticalTo:(id)anObject
+{
+    return [_mutableObjects indexOfObjectIdenticalTo:anObject];
+}
+
+- (NSArray*)objects
+{
+    return [_mutableObjects copy];
+}
+
+- (NSUInteger)countByEnumeratingWithState:(NSFastEnumerationState *)state objects:(id __unsafe_unretained [])buffer count:(NSUInteger)len
+{
+    if ( state->state == 0 ) {
+        _enumerationSnapshot = [_mutableObjects copy];
+    }
+    return [_enumerationSnapshot countByEnumeratingWithState:state objects:buffer count:len];
+}
+
+@end
+
+
+@interface KHGroupedChange ()
+
+@property (nonatomic) NSMutableArray *removedGroups;
+@property (nonatomic) NSMutableIndexSet *removedGroupIndexes;
+@property (nonatomic) NSMutableArray *insertedGroups;
+@property (nonatomic) NSMutableIndexSet *insertedGroupIndexes;
+@property (nonatomic) NSMutableArray *removedRows;
+@property (nonatomic) NSMutableArray *insertedRows;
+@property (nonatomic) NSMutableArray *removedObjects;
+@property (nonatomic) NSMutableArray *insertedObjects;
+@property (nonatomic) BOOL isReloaded;
+
+@end
+
+@implementation KHGroupedChange
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self) {
+        _removedGroups = [[NSMutableArray alloc] init];
+        _removedGroupIndexes = [[NSMutableIndexSet alloc] init];
+        _insertedGroups = [[NSMutableArray alloc] init];
+        _insertedGroupIndexes = [[NSMutableIndexSet alloc] init];
+        _removedRows = [[NSMutableArray alloc] init];
+        _insertedRows = [[NSMutableArray alloc] init];
+        _removedObjects = [[NSMutableArray alloc] init];
+        _insertedObjects = [[NSMutableArray alloc] init];
+    }
+    return self;
+}
+
+- (BOOL)isEmpty
+{
+    return _removedGroups.count == 0 && _insertedGroups.count == 0 && _removedRows.count == 0 && _insertedRows.count == 0 && !_isReloaded;
+}
+
+- (NSIndexSet*)removedSectionsFrom:(NSInteger)firstSection
+{
+    return [self indexes:_removedGroupIndexes shiftedBy:firstSection];
+}
+
+- (NSIndexSet*)insertedSectionsFrom:(NSInteger)firstSection
+{
+    return [self indexes:_insertedGroupIndexes shiftedBy:firstSection];
+}
+
+- (NSArray<NSIndexPath*>*)removedIndexPathsFrom:(NSInteger)firstSection
+{
+    return [self indexPaths:_removedRows shiftedBy:firstSection];
+}
+
+- (NSArray<NSIndexPath*>*)insertedIndexPathsFrom:(NSInteger)firstSection
+{
+    return [self indexPaths:_insertedRows shiftedBy:firstSection];
+}
+
+- (NSIndexSet*)indexes:(NSIndexSet*)indexes shiftedBy:(NSInteger)firstSection
+{
+    NSMutableIndexSet *shifted = [indexes mutableCopy];
+    [shifted shiftIndexesStartingAtIndex:0 by:firstSection];
+    return shifted;
+}
+
+- (NSArray*)indexPaths:(NSArray*)indexPaths shiftedBy:(NSInteger)firstSection
+{
+    NSMutableArray *shifted = [[NSMutableArray alloc] initWithCapacity: indexPaths.count ];
+    for ( NSIndexPath *indexPath in indexPaths ) {
+        [shifted addObject:[NSIndexPath indexPathForRow:indexPath.row inSection:indexPath.section + firstSection]];
+    }
+    return shifted;
+}
+
+@end
+
+
+@implementation KHGroupedArray
+{
+    id<NSCopying>(^_keyBlock)(id model);
+
+    NSMutableArray *_groups;
+
+    //  key: group key / value: KHGroupSection
+    NSMutableDictionary *_groupDic;
+
+    //  key: model（比對 pointer）/ value: model 所在的 KHGroupSection，不用每次都重算 key
+    NSMapTable *_groupOfModel;
+}
+
+- (instancetype)initWithSource:(NSMutableArray*)source keyBlock:(id<NSCopying>(^)(id model))keyBlock keyComparator:(NSComparator)keyComparator
+{
+    self = [super init];
+    if (self) {
+        _source = source;
+        _keyBlock = [keyBlock copy];
+        _keyComparator = [keyComparator copy];
+        _groups = [[NSMutableArray alloc] init];
+        _groupDic = [[NSMutableDictionary alloc] init];
+        _groupOfModel = [[NSMapTable alloc] initWithKeyOptions:NSPointerFunctionsStrongMemory|NSPointerFunctionsObjectPointerPersonality
+                                                  valueOptions:NSPointerFunctionsStrongMemory
+                                                      capacity:source.count];
+        [self buildGroups];
+        [source kh_addObserver:self];
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    [_source kh_removeObserver:self];
+}
+
+#pragma mark - Access
+
+- (NSArray<KHGroupSection*>*)groups
+{
+    return [_groups copy];
+}
+
+- (KHGroupSection*)groupForKey:(id)key
+{
+    return _groupDic[key];
+}
+
+- (KHGroupSection*)groupOfObject:(id)model
+{
+    return [_groupOfModel objectForKey:model];
+}
+
+#pragma mark - Regroup
+
+- (void)regroupObject:(id)model
+{
+    KHGroupSection *group = [_groupOfModel objectForKey:model];
+    if ( !group ) {
+        return;
+    }
+    id key = _keyBlock( model );
+    if ( [key isEqual:group.key] ) {
+        NSIndexPath *indexPath = [NSIndexPath indexPathForRow:[group indexOfObjectIdenticalTo:model] inSection:[_groups indexOfObjectIdenticalTo:group]];
+        [self.kh_delegate groupedArray:self didUpdateObject:model indexPath:indexPath];
+        return;
+    }
+
+    //  換 group，同一次 change 裡從舊的 group 移除，加到新的 group
+    NSUInteger sourceIndex = [_source indexOfObjectIdenticalTo:model];
+    KHGroupedChange *change = [[KHGroupedChange alloc] init];
+    [self removeObjects:@[model] leavingSource:NO change:change];
+    [self insertObjects:@[model] sourceIndexes:@[@(sourceIndex)] enteringSource:NO change:change];
+    [self notifyChange:change];
+}
+
+- (void)refresh
+{
+    KHGroupedChange *change = [[KHGroupedChange alloc] init];
+    [change.removedGroups addObjectsFromArray:_groups];
+    [change.removedGroupIndexes addIndexesInRange:NSMakeRange(0, _groups.count)];
+
+    [self buildGroups];
+
+    [change.insertedGroups addObjectsFromArray:_groups];
+    [change.insertedGroupIndexes addIndexesInRange:NSMakeRange(0, _groups.count)];
+    change.isReloaded = YES;
+    [self notifyChange:change];
+}
+
+#pragma mark - Group
+
+- (void)buildGroups
+{
+    [_groups removeAllObjects];
+    [_groupDic removeAllObjects];
+    [_groupOfModel removeAllObjects];
+    for ( id model in _source ) {
+        id key = _keyBlock( model );
+        KHGroupSection *group = _groupDic[key] ?: [self createGroupForKey:key];
+        [group.mutableObjects addObject:model];
+        [_groupOfModel setObject:group forKey:model];
+    }
+}
+
+- (KHGroupSection*)createGroupForKey:(id)key
+{
+    KHGroupSection *group = [[KHGroupSection alloc] initWithKey:key groupedArray:self];
+    _groupDic[key] = group;
+    [_groups insertObject:group atIndex:[self groupIndexOfKey:key]];
+    return group;
+}
+
+//  binary search，key 相同的排在最後面，沒有 keyComparator 就加在最後
+- (NSUInteger)groupIndexOfKey:(id)key
+{
+    NSUInteger low = 0;
+    NSUInteger high = _groups.count;
+    if ( _keyComparator == nil ) {
+        return high;
+    }
+    while ( low < high ) {
+        NSUInteger mid = low + ( high - low ) / 2;
+        if ( _keyComparator( ((KHGroupSection*)_groups[mid]).key, key ) == NSOrderedDescending ) {
+            high = mid;
+        }
+        else{
+            low = mid + 1;
+        }
+    }
+    return low;
+}
+
+//  依 source 的順序找 row：往前找到第一個同 group 的 model，排在它後面
+- (NSUInteger)rowOfSourceIndex:(NSUInteger)sourceIndex inGroup:(KHGroupSection*)group
+{
+    for ( NSInteger i=(NSInteger)sourceIndex-1; i>=0; i-- ) {
+        id model = _source[i];
+        if ( [_groupOfModel objectForKey:model] != group ) {
+            continue;
+        }
+        if ( group.mutableObjects.lastObject == model ) {
+            return group.count;
+        }
+        return [group indexOfObjectIdenticalTo:model] + 1;
+    }
+    return 0;
+}
+
+#pragma mark - Change
+
+//  row 與 group index 都是修改前的，要在 insert 之前呼叫
+- (void)removeObjects:(NSArray*)models leavingSource:(BOOL)leavingSource change:(KHGroupedChange*)change
+{
+    NSArray *oldGroups = [_groups copy];
+    NSMapTable *rowsOfGroup = [NSMapTable strongToStrongObjectsMapTable];
+    for ( id model in models ) {
+        KHGroupSection *group = [_groupOfModel objectForKey:model];
+        if ( !group ) {
+            continue;
+        }
+        NSMutableIndexSet *rows = [rowsOfGroup objectForKey:group];
+        if ( !rows ) {
+            rows = [[NSMutableIndexSet alloc] init];
+            [rowsOfGroup setObject:rows forKey:group];
+        }
+        [rows addIndex:[group indexOfObjectIdenticalTo:model]];
+    }
+
+    for ( KHGroupSection *group in rowsOfGroup ) {
+        NSIndexSet *rows = [rowsOfGroup objectForKey:group];
+        [group.mutableObjects removeObjectsAtIndexes:rows];
+
+        NSUInteger groupIndex = [oldGroups indexOfObjectIdenticalTo:group];
+        if ( group.count == 0 ) {
+            [change.removedGroups addObject:group];
+            [change.removedGroupIndexes addIndex:groupIndex];
+            [_groups removeObjectIdenticalTo:group];
+            [_groupDic removeObjectForKey:group.key];
+            continue;
+        }
+        [rows enumerateIndexesUsingBlock:^(NSUInteger idx, BOOL *stop) {
+            [change.removedRows addObject:[NSIndexPath indexPathForRow:idx inSection:groupIndex]];
+        }];
+    }
+
+    for ( id model in models ) {
+        KHGroupSection *group = [_groupOfModel objectForKey:model];
+        //  同一個 model 在 source 裡有兩個以上時，還留著的就不移除
+        if ( !group || [group indexOfObjectIdenticalTo:model] != NSNotFound ) {
+            continue;
+        }
+        [_groupOfModel removeObjectForKey:model];
+        if ( leavingSource ) {
+            [change.removedObjects addObject:model];
+        }
+    }
+}
+
+//  sourceIndexes 是 model 在 source 的位置，依遞增排列，row 與 group index 都是修改後的
+- (void)insertObjects:(NSArray*)models sourceIndexes:(NSArray*)sourceIndexes enteringSource:(BOOL)enteringSource change:(KHGroupedChange*)change
+{
+    NSMutableArray *createdGroups = [[NSMutableArray alloc] init];
+    NSMapTable *insertedOfGroup = [NSMapTable strongToStrongObjectsMapTable];
+    NSUInteger sourceCount = _source.count;
+    for ( NSUInteger i=0; i<models.count; i++ ) {
+        id model = models[i];
+        id key = _keyBlock( model );
+        KHGroupSection *group = _groupDic[key];
+        if ( !group ) {
+            group = [self createGroupForKey:key];
+            [createdGroups addObject:group];
+        }
+        //  後面都是這次加入的，最常見的是加在最後面，不用往前找
+        NSUInteger sourceIndex = [sourceIndexes[i] unsignedIntegerValue];
+        BOOL appending = sourceIndex + ( models.count - i ) == sourceCount;
+        NSUInteger row = appending ? group.count : [self rowOfSourceIndex:sourceIndex inGroup:group];
+        [group.mutableObjects insertObject:model atIndex:row];
+        [_groupOfModel setObject:group forKey:model];
+
+        NSHashTable *inserted = [insertedOfGroup objectForKey:group];
+        if ( !inserted ) {
+            inserted = [[NSHashTable alloc] initWithOptions:NSPointerFunctionsObjectPointerPersonality capacity: 1 ];
+            [insertedOfGroup setObject:inserted forKey:group];
+        }
+        [inserted addObject:model];
+        if ( enteringSource ) {
+            [change.insertedObjects addObject:model];
+        }
+    }
+
+    //  全部插完再找 index，不用每插一個就調整之前的 row
+    for ( KHGroupSection *group in createdGroups ) {
+        [change.insertedGroupIndexes addIndex:[_groups indexOfObjectIdenticalTo:group]];
+    }
+    [change.insertedGroups removeAllObjects];
+    [change.insertedGroupIndexes enumerateIndexesUsingBlock:^(NSUInteger idx, BOOL *stop) {
+        [change.insertedGroups addObject:_groups[idx]];
+    }];
+
+    for ( KHGroupSection *group in insertedOfGroup ) {
+        if ( [createdGroups indexOfObjectIdenticalTo:group] != NSNotFound ) {
+            continue;
+        }
+        NSUInteger groupIndex = [_groups indexOfObjectIdenticalTo:group];
+        NSHashTable *inserted = [insertedOfGroup objectForKey:group];
+        NSUInteger remaining = inserted.count;
+        for ( NSUInteger row=0; row<group.count && remaining > 0; row++ ) {
+            if ( [inserted containsObject:group.mutableObjects[row]] ) {
+                [change.insertedRows addObject:[NSIndexPath indexPathForRow:row inSection:groupIndex]];
+                remaining--;
+            }
+        }
+    }
+}
+
+- (void)removeAllGroupsWithChange:(KHGroupedChange*)change
+{
+    [change.removedGroups addObjectsFromArray:_groups];
+    [change.removedGroupIndexes addIndexesInRange:NSMakeRange(0, _groups.count)];
+    for ( id model in _groupOfModel ) {
+        [change.removedObjects addObject:model];
+    }
+    [_groups removeAllObjects];
+    [_groupDic removeAllObjects];
+    [_groupOfModel removeAllObjects];
+}
+
+- (void)notifyChange:(KHGroupedChange*)change
+{
+    if ( [change isEmpty] ) {
+        return;
+    }
+    [self.kh_delegate groupedArray:self didChange:change];
+}
+
+#pragma mark - Source Observe
+
+//  插入
+-(void)arrayInsert:(NSMutableArray*)array insertObject:(id)object index:(NSIndexPath*)index
+{
+    KHGroupedChange *change = [[KHGroupedChange alloc] init];
+    [self insertObjects:@[object] sourceIndexes:@[@(index.row)] enteringSource:YES change:change];
+    [self notifyChange:change];
+}
+
+//  插入多項
+-(void)arrayInsertSome:(NSMutableArray *)array insertObjects:(NSArray *)objects indexes:(NSArray *)indexes
+{
+    NSMutableArray *sourceIndexes = [[NSMutableArray alloc] initWithCapacity: indexes.count ];
+    for ( NSIndexPath *index in indexes ) {
+        [sourceIndexes addObject:@(index.row)];
+    }
+    KHGroupedChange *change = [[KHGroupedChange alloc] init];
+    [self insertObjects:objects sourceIndexes:sourceIndexes enteringSource:YES change:change];
+    [self notifyChange:change];
+}
+
+//  刪除
+-(void)arrayRemove:(NSMutableArray*)array removeObject:(id)object index:(NSIndexPath*)index
+{
+    KHGroupedChange *change = [[KHGroupedChange alloc] init];
+    [self removeObjects:@[object] leavingSource:YES change:change];
+    [self notifyChange:change];
+}
+
+//  刪除多項
+-(void)arrayRemoveSome:(NSMutableArray *)array removeObjects:(NSArray *)objects indexs:(NSArray *)indexs
+{
+    KHGroupedChange *change = [[KHGroupedChange alloc] init];
+    //  source 全部清掉了
+    if ( array.count == 0 ) {
+        [self removeAllGroupsWithChange:change];
+    }
+    else{
+        [self removeObjects:objects leavingSource:YES change:change];
+    }
+    [self notifyChange:change];
+}
+
+//  取代
+-(void)arrayReplace:(NSMutableArray*)array newObject:(id)newObj replacedObject:(id)oldObj index:(NSIndexPath*)index
+{
+    KHGroupedChange *change = [[KHGroupedChange alloc] init];
+    [self removeObjects:@[oldObj] leavingSource:YES change:change];
+    [self insertObjects:@[newObj] sourceIndexes:@[@(index.row)] enteringSource:YES change:change];
+    [self notifyChange:change];
+}
+
+//  更新
+- (void)arrayUpdate:(NSMutableArray *)array update:(id)object index:(NSIndexPath *)index
+{
+    [self regroupObject:object];
+}
+
+//  更新全部
+- (void)arrayUpdateAll:(NSMutableArray *)array
+{
+    [self refresh];
+}
+
+@end
@@ -0,0 +1,105 @@
+//
+//  KHHitchRecorder.h
+//
+//  Created by Calvin Huang on 2017/3/9.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ *  Scroll hitch recorder
+ *
+ *  在捲動時，用 CADisplayLink 取樣每個 frame 的時間，超過 frame budget 的 frame 視為 hitch，
+ *  並把那個 frame 裡 binding 做的事記下來 (cell 設定、onLoad:、KVO 更新、圖片下載完成、array 變動)，
+ *  輸出成 Chrome trace event JSON，可用 chrome://tracing 或 Perfetto 開啟
+ *
+ *  dataBinding.hitchRecorder = [[KHHitchRecorder alloc] init];
+ *  binding 會在開始拖動時 start，停止捲動時 stop
+ *
+ *  markFrameAtTime: 與 recordEvent:name:start:duration: 可以直接餵時間，不需要 UIKit，方便測試
+ *  所有 method 都要在 main thread 呼叫
+ */
+
+NS_ASSUME_NONNULL_BEGIN
+
+typedef NS_ENUM(NSInteger, KHHitchEventType) {
+    //  cellForRowAtIndexPath: / cellForItemAtIndexPath:
+    KHHitchEventCellConfigure = 0,
+    //  -[cell onLoad:]
+    KHHitchEventOnLoad,
+    //  KHPairInfo 因為 model property 變動而呼叫的 onLoad:
+    KHHitchEventKVORefresh,
+    //  圖片下載完成的 callback
+    KHHitchEventImageCompletion,
+    //  bind array 變動的 callback
+    KHHitchEventMutation,
+};
+
+@interface KHHitchEvent : NSObject
+
+@property (nonatomic,readonly) KHHitchEventType type;
+//  cell class name，或是 mutation 的 selector
+@property (nonatomic,readonly,nullable) NSString *name;
+@property (nonatomic,readonly) CFTimeInterval start;
+@property (nonatomic,readonly) CFTimeInterval duration;
+
+@end
+
+
+@interface KHHitchFrame : NSObject
+
+//  上一個 frame 的時間
+@property (nonatomic,readonly) CFTimeInterval start;
+@property (nonatomic,readonly) CFTimeInterval duration;
+@property (nonatomic,readonly) NSArray<KHHitchEvent*> *events;
+
+//  這個 frame 裡 dequeue 過的 cell class，不重覆
+- (NSArray<NSString*>*)dequeuedCellClasses;
+
+//  每個 cell class 的 onLoad: 總時間 (包含 KVO 更新)
+- (NSDictionary<NSString*,NSNumber*>*)onLoadDurationByCellClass;
+
+@end
+
+
+@interface KHHitchRecorder : NSObject
+
+//  一個 frame 的時間，預設依螢幕更新率，60Hz 為 1/60
+@property (nonatomic) CFTimeInterval frameBudget;
+//  frame 時間超過 frameBudget * hitchRatio 才算 hitch，預設 1.5，也就是至少掉了半個 frame 以上
+@property (nonatomic) double hitchRatio;
+//  最多保留幾個 hitch，超過時丟掉最舊的，預設 500
+@property (nonatomic) NSUInteger maxHitches;
+
+@property (nonatomic,readonly) BOOL isRecording;
+//  取樣過的 frame 數
+@property (nonatomic,readonly) NSUInteger frameCount;
+@property (nonatomic,readonly) NSArray<KHHitchFrame*> *hitches;
+
+//  用 CADisplayLink 開始/停止取樣
+- (void)start;
+- (void)stop;
+
+//  目前時間，與 CADisplayLink.timestamp 同一個時基
+- (CFTimeInterval)now;
+
+//  一個 frame 結束，在這之前記錄的 event 都算在這個 frame
+- (void)markFrameAtTime:(CFTimeInterval)timestamp;
+
+- (void)recordEvent:(KHHitchEventType)type name:(nullable NSString*)name start:(CFTimeInterval)start duration:(CFTimeInterval)duration;
+
+//  binding 用，從 start 到現在
+- (void)recordEvent:(KHHitchEventType)type cellClass:(nullable Class)cellClass start:(CFTimeInterval)start;
+- (void)recordMutation:(SEL)selector start:(CFTimeInterval)start;
+
+- (void)reset;
+
+//  Chrome trace event format，{ "traceEvents": [...], "displayTimeUnit": "ms" }
+- (NSDictionary<NSString*,id>*)traceEventObject;
+- (nullable NSData*)traceData;
+- (BOOL)writeTraceToFile:(NSString*)path error:(NSError* _Nullable * _Nullable)error;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,266 @@
+//
+//  KHHitchRecorder.m
+//
+//  Created by Calvin Huang on 2017/3/9.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import "KHHitchRecorder.h"
+#import <UIKit/UIKit.h>
+#import <QuartzCore/QuartzCore.h>
+
+static NSString *const kHitchEventTypeNames[] = { @"CellConfigure", @"OnLoad", @"KVORefresh", @"ImageCompletion", @"Mutation" };
+
+@interface KHHitchEvent()
+
+@property (nonatomic) KHHitchEventType type;
+@property (nonatomic,nullable) NSString *name;
+@property (nonatomic) CFTimeInterval start;
+@property (nonatomic) CFTimeInterval duration;
+
+@end
+
+@implementation KHHitchEvent
+
+@end
+
+
+@interface KHHitchFrame()
+
+@property (nonatomic) CFTimeInterval start;
+@property (nonatomic) CFTimeInterval duration;
+@property (nonatomic) NSArray<KHHitchEvent*> *events;
+
+@end
+
+@implementation KHHitchFrame
+
+- (NSArray<NSString*>*)dequeuedCellClasses
+{
+    NSMutableOrderedSet *classes = [[NSMutableOrderedSet alloc] init];
+    for ( KHHitchEvent *event in _events ) {
+        if ( event.type == KHHitchEventCellConfigure && event.name ) {
+            [classes addObject:event.name];
+        }
+    }
+    return [classes array];
+}
+
+- (NSDictionary<NSString*,NSNumber*>*)onLoadDurationByCellClass
+{
+    NSMutableDictionary *durations = [[NSMutableDictionary alloc] init];
+    for ( KHHitchEvent *event in _events ) {
+        if ( (event.type == KHHitchEventOnLoad || event.type == KHHitchEventKVORefresh) && event.name ) {
+            durations[event.name] = @( [durations[event.name] doubleValue] + event.duration );
+        }
+    }
+    return durations;
+}
+
+@end
+
+
+//  CADisplayLink 會 retain target，透過這個 proxy 避免 retain cycle
+@interface KHHitchDisplayLinkProxy : NSObject
+
+@property (nonatomic,weak) KHHitchRecorder *recorder;
+
+@end
+
+@implementation KHHitchDisplayLinkProxy
+
+- (void)onDisplayLink:(CADisplayLink*)link
+{
+    [self.recorder markFrameAtTime:link.timestamp];
+}
+
+@end
+
+
+@implementation KHHitchRecorder
+{
+    NSMutableArray *_hitches;
+
+    //  目前這個 frame 裡記錄的 event
+    NSMutableArray *_pendingEvents;
+
+    //  上一個 frame 的時間，0 表示還沒開始
+    CFTimeInterval _lastFrameTime;
+
+    CADisplayLink *_displayLink;
+}
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self) {
+        _frameBudget = 1.0 / 60;
+        if ( [[UIScreen mainScreen] respondsToSelector:@selector(maximumFramesPerSecond)] ) {
+            NSInteger fps = [UIScreen mainScreen].maximumFramesPerSecond;
+            if ( fps > 0 ) _frameBudget = 1.0 / fps;
+        }
+        _hitchRatio = 1.5;
+        _maxHitches = 500;
+        _hitches = [[NSMutableArray alloc] initWithCapacity: 20 ];
+        _pendingEvents = [[NSMutableArray alloc] initWithCapacity: 20 ];
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    [_displayLink invalidate];
+}
+
+- (NSArray<KHHitchFrame*>*)hitches
+{
+    return [_hitches copy];
+}
+
+#pragma mark - Sampling
+
+- (void)start
+{
+    if ( _displayLink ) {
+        return;
+    }
+    KHHitchDisplayLinkProxy *proxy = [[KHHitchDisplayLinkProxy alloc] init];
+    proxy.recorder = self;
+    _displayLink = [CADisplayLink displayLinkWithTarget:proxy selector:@selector(onDisplayLink:)];
+    [_displayLink addToRunLoop:[NSRunLoop mainRunLoop] forMode:NSRunLoopCommonModes];
+    _isRecording = YES;
+}
+
+- (void)stop
+{
+    [_displayLink invalidate];
+    _displayLink = nil;
+    _isRecording = NO;
+
+    //  停止期間的空檔不能算成一個很長的 frame
+    _lastFrameTime = 0;
+    [_pendingEvents removeAllObjects];
+}
+
+- (CFTimeInterval)now
+{
+    return CACurrentMediaTime();
+}
+
+- (void)markFrameAtTime:(CFTimeInterval)timestamp
+{
+    if ( _lastFrameTime <= 0 || timestamp <= _lastFrameTime ) {
+        _lastFrameTime = timestamp;
+        [_pendingEvents removeAllObjects];
+        return;
+    }
+
+    _frameCount++;
+    CFTimeInterval duration = timestamp - _lastFrameTime;
+    if ( duration > _frameBudget * _hitchRatio ) {
+        KHHitchFrame *frame = [[KHHitchFrame alloc] init];
+        frame.start = _lastFrameTime;
+        frame.duration = duration;
+        frame.events = [_pendingEvents copy];
+        [_hitches addObject:frame];
+        if ( _hitches.count > _maxHitches ) {
+            [_hitches removeObjectsInRange:NSMakeRange(0, _hitches.count - _maxHitches)];
+        }
+    }
+    _lastFrameTime = timestamp;
+    [_pendingEvents removeAllObjects];
+}
+
+#pragma mark - Event
+
+- (void)recordEvent:(KHHitchEventType)type name:(NSString*)name start:(CFTimeInterval)start duration:(CFTimeInterval)duration
+{
+    //  還沒取到第一個 frame 前的 event 沒有 frame 可以歸屬
+    if ( _lastFrameTime <= 0 ) {
+        return;
+    }
+    KHHitchEvent *event = [[KHHitchEvent alloc] init];
+    event.type = type;
+    event.name = name;
+    event.start = start;
+    event.duration = duration;
+    [_pendingEvents addObject:event];
+}
+
+- (void)recordEvent:(KHHitchEventType)type cellClass:(Class)cellClass start:(CFTimeInterval)start
+{
+    if ( _lastFrameTime <= 0 ) {
+        return;
+    }
+    [self recordEvent:type name:cellClass ? NSStringFromClass(cellClass) : nil start:start duration:[self now] - start];
+}
+
+- (void)recordMutation:(SEL)selector start:(CFTimeInterval)start
+{
+    if ( _lastFrameTime <= 0 ) {
+        return;
+    }
+    [self recordEvent:KHHitchEventMutation name:NSStringFromSelector(selector) start:start duration:[self now] - start];
+}
+
+- (void)reset
+{
+    [_hitches removeAllObjects];
+    [_pendingEvents removeAllObjects];
+    _frameCount = 0;
+    _lastFrameTime = 0;
+}
+
+#pragma mark - Trace
+
+- (NSDictionary*)traceEventObject
+{
+    NSMutableArray *traceEvents = [[NSMutableArray alloc] initWithCapacity: _hitches.count * 4 + 2 ];
+    [traceEvents addObject:@{ @"name":@"thread_name", @"ph":@"M", @"pid":@1, @"tid":@1, @"args":@{ @"name":@"Frames" } }];
+    [traceEvents addObject:@{ @"name":@"thread_name", @"ph":@"M", @"pid":@1, @"tid":@2, @"args":@{ @"name":@"KHDataBinding" } }];
+
+    for ( KHHitchFrame *frame in _hitches ) {
+        NSMutableDictionary *onLoadMs = [[NSMutableDictionary alloc] init];
+        [[frame onLoadDurationByCellClass] enumerateKeysAndObjectsUsingBlock:^(NSString *key, NSNumber *duration, BOOL *stop) {
+            onLoadMs[key] = @( [duration doubleValue] * 1000 );
+        }];
+        [traceEvents addObject:@{ @"name":@"Hitch",
+                                  @"cat":@"frame",
+                                  @"ph":@"X",
+                                  @"ts":@( frame.start * 1000000 ),
+                                  @"dur":@( frame.duration * 1000000 ),
+                                  @"pid":@1,
+                                  @"tid":@1,
+                                  @"args":@{ @"budget_ms":@( _frameBudget * 1000 ),
+                                             @"dropped_frames":@( MAX( 0, (NSInteger)lround( frame.duration / _frameBudget ) - 1 ) ),
+                                             @"dequeued":[frame dequeuedCellClasses],
+                                             @"onLoad_ms":onLoadMs } }];
+        for ( KHHitchEvent *event in frame.events ) {
+            NSString *category = kHitchEventTypeNames[event.type];
+            [traceEvents addObject:@{ @"name":event.name ? event.name : category,
+                                      @"cat":category,
+                                      @"ph":@"X",
+                                      @"ts":@( event.start * 1000000 ),
+                                      @"dur":@( event.duration * 1000000 ),
+                                      @"pid":@1,
+                                      @"tid":@2 }];
+        }
+    }
+    return @{ @"traceEvents":traceEvents, @"displayTimeUnit":@"ms" };
+}
+
+- (NSData*)traceData
+{
+    return [NSJSONSerialization dataWithJSONObject:[self traceEventObject] options:0 error:nil];
+}
+
+- (BOOL)writeTraceToFile:(NSString*)path error:(NSError**)error
+{
+    NSData *data = [NSJSONSerialization dataWithJSONObject:[self traceEventObject] options:0 error:error];
+    if ( data == nil ) {
+        return NO;
+    }
+    return [data writeToFile:path options:NSDataWritingAtomic error:error];
+}
+
+@end
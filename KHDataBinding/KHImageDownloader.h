@@ -27,7 +27,10 @@ NS_ASSUME_NONNULL_BEGIN
 +(KHImageDownloader*)instance;
 
 //  下載圖片
-- (void)loadImageURL:(NSString *)urlString cellLinker:(KHPairInfo*)cellLinker completed:(void (^)(UIImage *,NSError*))completed;
+- (void)loadImageURL:(NSString *)urlString cellLinker:(nullable KHPairInfo*)cellLinker completed:(void (^)(UIImage *,NSError*))completed;
+
+//  預先下載圖片到 cache，已經在 cache 或下載中的會略過
+- (void)prefetchImageURLs:(NSArray<NSString*>*)urlStrings;
 
 - (void)removeCache:(NSString*)key;
 
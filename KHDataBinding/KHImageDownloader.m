@@ -88,6 +88,11 @@ static KHImageDownloader *sharedInstance;
             cellLinker = linker;
         }
         
+        //  第一個要求下載的 linker 是記在 proxy
+        id owner = linker ? linker : info[@"proxy"];
+        KHPairInfo *ownerLinker = owner != [NSNull null] ? owner : nil;
+        KHHitchRecorder *recorder = ownerLinker.binder.hitchRecorder;
+        CFTimeInterval hitchStart = [recorder now];
         
         if ( !error ){
             //  若有 cellProxy，就要比對目前的 cell 跟 model 還有沒有對映，有的話才讓 cell 載入圖片
@@ -108,6 +113,8 @@ static KHImageDownloader *sharedInstance;
         }else{
             completed(nil,error);
         }
+        
+        [recorder recordEvent:KHHitchEventImageCompletion cellClass:[ownerLinker.cell class] start:hitchStart];
     }
 }
 
@@ -130,6 +137,7 @@ static KHImageDownloader *sharedInstance;
     // @todo: 這邊要加一個功能，可以把cell 記下來，然後最後圖片下載完後，再通知每一個cell顯示圖片
     BOOL isDownloading = [self isDownloading:urlString ];
     if (isDownloading) {
+        [cellLinker.binder.metrics increment:KHBindingCounterImageCacheMiss];
         NSDictionary *infoDic = @{@"url":urlString,
                                   @"linker":cellLinker ? cellLinker : [NSNull null],
                                   @"handler":completed};
@@ -141,11 +149,13 @@ static KHImageDownloader *sharedInstance;
     //  先看 cache 有沒有，有的話就直接用
     UIImage *image = [self getImageFromCache:urlString];
     if (image) {
+        [cellLinker.binder.metrics increment:KHBindingCounterImageCacheHit];
         completed(image, nil);
         if(cellLinker.cell) [(UIView*)cellLinker.cell setNeedsLayout];
     }
     else {
         // cache 裡找不到就下載
+        [cellLinker.binder.metrics increment:KHBindingCounterImageCacheMiss];
         if( self.debugLog ) NSLog(@"<KHImageDownloader> download %@", urlString );
         
         //  標記說，這個url正在下載，不要再重覆下載
@@ -181,6 +191,16 @@ static KHImageDownloader *sharedInstance;
     }
 }
 
+- (void)prefetchImageURLs:(NSArray<NSString*>*)urlStrings
+{
+    for ( NSString *urlString in urlStrings ) {
+        if ( urlString.length == 0 || [self isDownloading:urlString] || _imageCache[urlString] ) {
+            continue;
+        }
+        [self loadImageURL:urlString cellLinker:nil completed:^(UIImage *image, NSError *error) {}];
+    }
+}
+
 - (void)removeCache:(NSString*)key
 {
     //  清除 mem cache
@@ -0,0 +1,50 @@
+//
+//  KHJSONArrayDecoder.h
+//
+//  Created by Calvin Huang on 2017/3/10.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ *  逐段解析 JSON 裡的一個陣列
+ *
+ *  資料可以任意切段餵進來，陣列裡每個元素一收完整就呼叫 elementBlock，不用等整份 JSON 收完
+ *  例如 { "info": {...}, "results": [ {...}, {...} ] }，keyPath 設 @"results"
+ *  keyPath 為 nil 表示最外層就是陣列，多層用 . 分隔，例如 @"data.items"
+ *
+ *  陣列以外的資料只掃過不保留，記憶體只會存目前還沒收完的那個元素
+ *  只處理第一個符合 keyPath 的陣列
+ */
+
+NS_ASSUME_NONNULL_BEGIN
+
+extern NSString *const KHJSONArrayDecoderErrorDomain;
+
+typedef void(^KHJSONArrayElementBlock)(id element, NSUInteger index);
+
+@interface KHJSONArrayDecoder : NSObject
+
+@property (nonatomic,readonly,nullable) NSString *keyPath;
+
+//  每解出一個元素就呼叫，在 appendData: 的 thread 執行
+@property (nonatomic,copy,nullable) KHJSONArrayElementBlock elementBlock;
+
+//  已解出的元素數
+@property (nonatomic,readonly) NSUInteger elementCount;
+
+//  目標陣列已經結束
+@property (nonatomic,readonly) BOOL isArrayFinished;
+
+- (instancetype)initWithKeyPath:(nullable NSString*)keyPath;
+
+//  元素格式錯誤或巢狀太深時回傳 NO，之後的資料都不再處理
+- (BOOL)appendData:(NSData*)data error:(NSError* _Nullable * _Nullable)error;
+
+//  重新開始解析一份新的 JSON
+- (void)reset;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,281 @@
+//
+//  KHJSONArrayDecoder.m
+//
+//  Created by Calvin Huang on 2017/3/10.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import "KHJSONArrayDecoder.h"
+
+NSString *const KHJSONArrayDecoderErrorDomain = @"KHJSONArrayDecoder";
+
+//  最多巢狀幾層
+#define KH_JSON_MAX_DEPTH 256
+
+static inline BOOL kh_isJSONSpace( char c )
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+@implementation KHJSONArrayDecoder
+{
+    NSArray *_pathComponents;
+
+    //  還沒處理完的資料，只保留目前元素或 key 還沒收完的部分
+    NSMutableData *_buffer;
+
+    //  每一層是 { 還是 [
+    char _stack[KH_JSON_MAX_DEPTH];
+    //  object 那層目前是不是在等 key
+    BOOL _expectKey[KH_JSON_MAX_DEPTH];
+    NSInteger _depth;
+    //  object 每層目前的 key，只記 keyPath 用得到的層數
+    NSMutableArray *_keys;
+
+    BOOL _inString;
+    BOOL _escape;
+    BOOL _stringHasEscape;
+    //  正在讀的 key 在 _buffer 的起點，-1 表示沒有
+    NSInteger _keyStart;
+
+    //  目標陣列那層的 depth，-1 表示不在目標陣列裡
+    NSInteger _targetDepth;
+    //  目前元素在 _buffer 的起點，-1 表示沒有
+    NSInteger _elementStart;
+    //  目標陣列裡剛讀到 ','，下一個元素還沒開始，這時候不能是 ']'
+    BOOL _afterComma;
+
+    NSError *_failError;
+}
+
+- (instancetype)init
+{
+    return [self initWithKeyPath:nil];
+}
+
+- (instancetype)initWithKeyPath:(NSString*)keyPath
+{
+    self = [super init];
+    if (self) {
+        _keyPath = [keyPath copy];
+        _pathComponents = keyPath.length > 0 ? [keyPath componentsSeparatedByString:@"."] : @[];
+        _buffer = [[NSMutableData alloc] initWithCapacity: 4096 ];
+        _keys = [[NSMutableArray alloc] initWithCapacity: _pathComponents.count ];
+        [self reset];
+    }
+    return self;
+}
+
+- (void)reset
+{
+    [_buffer setLength: 0 ];
+    [_keys removeAllObjects];
+    for ( NSUInteger i=0; i<_pathComponents.count; i++ ) {
+        [_keys addObject:[NSNull null]];
+    }
+    _depth = 0;
+    _inString = NO;
+    _escape = NO;
+    _stringHasEscape = NO;
+    _keyStart = -1;
+    _targetDepth = -1;
+    _elementStart = -1;
+    _afterComma = NO;
+    _elementCount = 0;
+    _isArrayFinished = NO;
+    _failError = nil;
+}
+
+#pragma mark - Parse
+
+- (BOOL)appendData:(NSData*)data error:(NSError**)error
+{
+    if ( _failError ) {
+        if ( error ) *error = _failError;
+        return NO;
+    }
+    //  目標陣列結束後的資料都不需要
+    if ( _isArrayFinished ) {
+        return YES;
+    }
+
+    NSUInteger scanStart = _buffer.length;
+    [_buffer appendData:data];
+    const char *bytes = _buffer.bytes;
+    NSUInteger length = _buffer.length;
+
+    for ( NSUInteger i=scanStart; i<length; i++ ) {
+        char c = bytes[i];
+
+        if ( _inString ) {
+            if ( _escape ) {
+                _escape = NO;
+            }
+            else if ( c == '\\' ) {
+                _escape = YES;
+                _stringHasEscape = YES;
+            }
+            else if ( c == '"' ) {
+                _inString = NO;
+                if ( _keyStart >= 0 ) {
+                    _keys[_depth-1] = [self keyWithBytes:bytes + _keyStart length:i + 1 - _keyStart];
+                    _keyStart = -1;
+                }
+            }
+            continue;
+        }
+
+        if ( kh_isJSONSpace(c) ) {
+            continue;
+        }
+
+        //  目標陣列裡，新元素的第一個字
+        if ( _depth == _targetDepth && _elementStart < 0 ) {
+            if ( c == ',' ) {
+                return [self failWithReason:@"unexpected ',' in array" error:error];
+            }
+            if ( c == ']' && _afterComma ) {
+                return [self failWithReason:@"unexpected ']' after ','" error:error];
+            }
+            if ( c != ']' ) {
+                _elementStart = i;
+                _afterComma = NO;
+            }
+        }
+
+        switch ( c ) {
+            case '"':
+                _inString = YES;
+                _stringHasEscape = NO;
+                if ( _targetDepth < 0 && _depth > 0 && _depth <= _pathComponents.count && _stack[_depth-1] == '{' && _expectKey[_depth-1] ) {
+                    _keyStart = i;
+                }
+                break;
+
+            case '{':
+            case '[':
+            {
+                if ( _depth >= KH_JSON_MAX_DEPTH ) {
+                    return [self failWithReason:@"nesting too deep" error:error];
+                }
+                BOOL isTarget = ( c == '[' && _targetDepth < 0 && [self matchKeyPath] );
+                _stack[_depth] = c;
+                _expectKey[_depth] = ( c == '{' );
+                if ( _depth < _keys.count ) {
+                    _keys[_depth] = [NSNull null];
+                }
+                _depth++;
+                if ( isTarget ) {
+                    _targetDepth = _depth;
+                    _elementStart = -1;
+                }
+                break;
+            }
+
+            case '}':
+            case ']':
+                if ( _depth == 0 ) {
+                    return [self failWithReason:@"unbalanced bracket" error:error];
+                }
+                if ( _depth == _targetDepth ) {
+                    if ( _elementStart >= 0 && ![self decodeElementFrom:_elementStart to:i error:error] ) {
+                        return NO;
+                    }
+                    _elementStart = -1;
+                    _targetDepth = -1;
+                    _isArrayFinished = YES;
+                    [_buffer setLength: 0 ];
+                    return YES;
+                }
+                _depth--;
+                break;
+
+            case ':':
+                if ( _depth > 0 && _stack[_depth-1] == '{' ) {
+                    _expectKey[_depth-1] = NO;
+                }
+                break;
+
+            case ',':
+                if ( _depth == _targetDepth ) {
+                    if ( ![self decodeElementFrom:_elementStart to:i error:error] ) {
+                        return NO;
+                    }
+                    _elementStart = -1;
+                    _afterComma = YES;
+                }
+                else if ( _depth > 0 && _stack[_depth-1] == '{' ) {
+                    _expectKey[_depth-1] = YES;
+                }
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    //  丟掉已經處理完的資料
+    NSInteger keep = length;
+    if ( _elementStart >= 0 ) keep = MIN( keep, _elementStart );
+    if ( _keyStart >= 0 ) keep = MIN( keep, _keyStart );
+    if ( keep > 0 ) {
+        [_buffer replaceBytesInRange:NSMakeRange(0, keep) withBytes:NULL length:0];
+        if ( _elementStart >= 0 ) _elementStart -= keep;
+        if ( _keyStart >= 0 ) _keyStart -= keep;
+    }
+    return YES;
+}
+
+- (BOOL)matchKeyPath
+{
+    NSUInteger count = _pathComponents.count;
+    if ( _depth != count ) {
+        return NO;
+    }
+    for ( NSUInteger i=0; i<count; i++ ) {
+        if ( _stack[i] != '{' || ![_keys[i] isEqual:_pathComponents[i]] ) {
+            return NO;
+        }
+    }
+    return YES;
+}
+
+- (id)keyWithBytes:(const char*)bytes length:(NSUInteger)length
+{
+    //  沒有跳脫字元就直接取引號中間
+    if ( !_stringHasEscape ) {
+        NSString *key = [[NSString alloc] initWithBytes:bytes + 1 length:length - 2 encoding:NSUTF8StringEncoding];
+        return key ? key : [NSNull null];
+    }
+    NSData *data = [NSData dataWithBytes:bytes length:length];
+    id key = [NSJSONSerialization JSONObjectWithData:data options:NSJSONReadingAllowFragments error:nil];
+    return key ? key : [NSNull null];
+}
+
+- (BOOL)decodeElementFrom:(NSUInteger)start to:(NSUInteger)end error:(NSError**)error
+{
+    const char *bytes = _buffer.bytes;
+    while ( end > start && kh_isJSONSpace( bytes[end-1] ) ) {
+        end--;
+    }
+    NSData *elementData = [NSData dataWithBytesNoCopy:(void*)(bytes + start) length:end - start freeWhenDone:NO];
+    NSError *jsonError = nil;
+    id element = [NSJSONSerialization JSONObjectWithData:elementData options:NSJSONReadingAllowFragments error:&jsonError];
+    if ( element == nil ) {
+        return [self failWithReason:[NSString stringWithFormat:@"invalid element at index %lu", (unsigned long)_elementCount] error:error];
+    }
+    NSUInteger index = _elementCount++;
+    if ( _elementBlock ) {
+        _elementBlock( element, index );
+    }
+    return YES;
+}
+
+- (BOOL)failWithReason:(NSString*)reason error:(NSError**)error
+{
+    _failError = [NSError errorWithDomain:KHJSONArrayDecoderErrorDomain code:1 userInfo:@{ NSLocalizedDescriptionKey:reason }];
+    if ( error ) *error = _failError;
+    return NO;
+}
+
+@end
@@ -0,0 +1,66 @@
+//
+//  KHMulticastBinding.h
+//
+//  Created by Calvin Huang on 2017/3/12.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "KHPlatform.h"
+#import "NSMutableArray+KHSwizzle.h"
+
+@class KHDataBinding;
+
+//  一份 model array 給多個 binding 顯示
+//
+//  綁定的 NSMutableArray 只有一個 kh_delegate，同一個 array 沒辦法同時綁到 table 跟 collection
+//  KHMulticastBinding 當 array 的 kh_delegate，把每個變動轉給加入的每個 binding，index path 換成 array 在那個 binding 的 section
+//
+//  KHMulticastBinding *multicast = [[KHMulticastBinding alloc] init];
+//  [multicast addBinding:tableBinding];
+//  [multicast addBinding:collectionBinding];
+//  NSMutableArray *models = [multicast createBindArray];
+//
+//  model 的 index 與 KVO 放在這裡，不管有幾個 binding，每個 model 只註冊一次，變動時轉給每個 binding 的 KHPairInfo
+//  model 在共用的 array 出現幾次會記下來，全部移除後才解除 KVO，binding 還有這個 model 的話改由它的 KHPairInfo 註冊
+//  binding 自己的 array 先有的 model，開始共用時它的 KHPairInfo 會解除 KVO，不會註冊兩次
+//  每個 binding 還是有自己的 KHPairInfo，cell、算好的 size、userInfo 都是各自的
+//
+//  只有 NSMutableArray 可以共用，KHPagedArray、KHSnapshotArray、KHProjectedArray、KHGroupedArray 不行
+//  binding 也可以綁定自己的 array，共用的 array 跟 bindArray: 一樣排在下一個 section
+//  所有 method 都只能在 main thread 呼叫
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface KHMulticastBinding : NSObject <KHArrayObserveDelegate>
+
+//  依加入的順序
+@property (nonatomic,readonly) NSArray<KHDataBinding*> *bindings;
+
+//  已綁定的 array，依綁定的順序
+@property (nonatomic,readonly) NSArray<NSMutableArray*> *sharedArrays;
+
+//  共用的 model 數，也就是對 model 註冊 KVO 的數量
+@property (nonatomic,readonly) NSUInteger modelCount;
+
+//  加入 binding，已經綁定的 array 會綁定到它的最後面
+//  一個 binding 只能加入一個 KHMulticastBinding，加入別的會丟 exception
+- (void)addBinding:(KHDataBinding*)binding;
+
+//  從 binding 解綁定所有共用的 array
+- (void)removeBinding:(KHDataBinding*)binding;
+
+//  生成一個綁定到所有 binding 的 array
+- (NSMutableArray*)createBindArray;
+- (NSMutableArray*)createBindArrayFromNSArray:(nullable NSArray*)array;
+
+//  array 已經綁定到別的 binding 的話會丟 exception
+- (void)bindArray:(NSMutableArray*)array;
+- (void)deBindArray:(NSMutableArray*)array;
+
+//  model 有沒有在共用的 array 裡
+- (BOOL)containsModel:(id)model;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,362 @@
+//
+//  KHMulticastBinding.m
+//
+//  Created by Calvin Huang on 2017/3/12.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import "KHMulticastBinding.h"
+#import "KHBindingCore.h"
+#import "KHDataBinding.h"
+#import <objc/runtime.h>
+
+//  index 換成 array 在 binding 裡的 section
+static NSIndexPath *KHMulticastIndex(NSIndexPath *index, NSInteger section)
+{
+    return index.section == section ? index : [NSIndexPath indexPathForRow:index.row inSection:section];
+}
+
+static NSArray *KHMulticastIndexes(NSArray<NSIndexPath*> *indexes, NSInteger section)
+{
+    NSMutableArray *result = [[NSMutableArray alloc] initWithCapacity: indexes.count ];
+    for ( NSIndexPath *index in indexes ) {
+        [result addObject:KHMulticastIndex( index, section )];
+    }
+    return result;
+}
+
+//  共用的 model 資訊，一個 model 只有一個，對 model 註冊 KVO，變動時轉給每個 binding 的 KHPairInfo
+@interface KHMulticastModel : NSObject <KHBindingPair>
+
+@property (nonatomic,assign) KHMulticastBinding *owner;
+@property (nonatomic,assign) id model;
+
+@end
+
+@interface KHMulticastBinding ()
+
+- (void)model:(id)model didChangeKeyPath:(NSString*)keyPath;
+
+@end
+
+
+@implementation KHMulticastModel
+
+@synthesize model = _model;
+
+- (void)dealloc
+{
+    [self deObserveModel];
+}
+
+- (void)setModel:(id)model
+{
+    if ( _model == model ) {
+        return;
+    }
+    [self deObserveModel];
+    _model = model;
+    [self observeModel];
+}
+
+- (void)observeModel
+{
+    if ( _model == nil ) {
+        return;
+    }
+    unsigned int numOfProperties;
+    objc_property_t *properties = class_copyPropertyList( [_model class], &numOfProperties );
+    for ( unsigned int pi = 0; pi < numOfProperties; pi++ ) {
+        NSString *propertyName = [[NSString alloc] initWithCString:property_getName(properties[pi]) encoding:NSUTF8StringEncoding];
+        [_model addObserver:self forKeyPath:propertyName options:NSKeyValueObservingOptionNew context:NULL];
+    }
+    free( properties );
+}
+
+- (void)deObserveModel
+{
+    if ( _model == nil ) {
+        return;
+    }
+    unsigned int numOfProperties;
+    objc_property_t *properties = class_copyPropertyList( [_model class], &numOfProperties );
+    for ( unsigned int pi = 0; pi < numOfProperties; pi++ ) {
+        NSString *propertyName = [[NSString alloc] initWithCString:property_getName(properties[pi]) encoding:NSUTF8StringEncoding];
+        [_model removeObserver:self forKeyPath:propertyName];
+    }
+    free( properties );
+}
+
+- (void)observeValueForKeyPath:(NSString *)keyPath ofObject:(id)object change:(NSDictionary<NSString *,id> *)change context:(void *)context
+{
+    [_owner model:object didChangeKeyPath:keyPath];
+}
+
+@end
+
+
+@implementation KHMulticastBinding
+{
+    //  共用的 model index，section 是綁定的 array，pair 是 KHMulticastModel
+    KHBindingCore *_core;
+
+    //  每個 model 在共用的 array 裡出現幾次，比對 pointer，不 retain，全部移除後才解除 KVO
+    CFMutableBagRef _modelCounts;
+
+    NSMutableArray *_bindings;
+}
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self) {
+        _core = [[KHBindingCore alloc] init];
+        _modelCounts = CFBagCreateMutable( NULL, 0, NULL );
+        _bindings = [[NSMutableArray alloc] init];
+        weakRef(self);
+        _core.pairFactory = ^id<KHBindingPair>{
+            KHMulticastModel *pair = [[KHMulticastModel alloc] init];
+            pair.owner = weak_self;
+            return pair;
+        };
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    CFRelease( _modelCounts );
+}
+
+#pragma mark - Property
+
+- (NSArray<KHDataBinding*>*)bindings
+{
+    return [_bindings copy];
+}
+
+- (NSArray<NSMutableArray*>*)sharedArrays
+{
+    return [_core.sectionArray copy];
+}
+
+- (NSUInteger)modelCount
+{
+    return [_core pairCount];
+}
+
+- (BOOL)containsModel:(id)model
+{
+    return [_core pairOfModel:model] != nil;
+}
+
+#pragma mark - Binding
+
+- (void)addBinding:(KHDataBinding*)binding
+{
+    if ( binding.multicastBinding == self ) {
+        return;
+    }
+    if ( binding.multicastBinding != nil ) {
+        NSException *exception = [NSException exceptionWithName:NSInternalInconsistencyException
+                                                          reason:@"binding is already added to another KHMulticastBinding"
+                                                        userInfo:nil];
+        @throw exception;
+    }
+    binding.multicastBinding = self;
+    [_bindings addObject:binding];
+    for ( NSMutableArray *array in _core.sectionArray ) {
+        //  binding 自己的 array 可能也有這些 model，它的 pairInfo 已經註冊的 KVO 要解除
+        for ( id object in array ) {
+            [[binding getPairInfo:object] updateModelObserver];
+        }
+        [binding bindArray:array];
+    }
+}
+
+- (void)removeBinding:(KHDataBinding*)binding
+{
+    if ( binding.multicastBinding != self ) {
+        return;
+    }
+    for ( NSMutableArray *array in _core.sectionArray ) {
+        [binding deBindArray:array];
+    }
+    binding.multicastBinding = nil;
+    [_bindings removeObjectIdenticalTo:binding];
+    //  還留在 binding 自己的 array 的 model，改由 pairInfo 註冊 KVO
+    for ( NSMutableArray *array in _core.sectionArray ) {
+        for ( id object in array ) {
+            [[binding getPairInfo:object] updateModelObserver];
+        }
+    }
+}
+
+#pragma mark - Bind Array
+
+- (NSMutableArray*)createBindArray
+{
+    return [self createBindArrayFromNSArray:nil];
+}
+
+- (NSMutableArray*)createBindArrayFromNSArray:(NSArray*)array
+{
+    NSMutableArray *bindArray = array ? [[NSMutableArray alloc] initWithArray:array] : [[NSMutableArray alloc] init];
+    [self bindArray:bindArray];
+    return bindArray;
+}
+
+- (void)bindArray:(NSMutableArray*)array
+{
+    if ( [_core sectionOfArray:array] != NSNotFound ) {
+        return;
+    }
+    if ( array.kh_delegate != nil ) {
+        NSException *exception = [NSException exceptionWithName:NSInternalInconsistencyException
+                                                          reason:@"array is already bound, deBind it before sharing"
+                                                        userInfo:nil];
+        @throw exception;
+    }
+    [_core addSection:array delegate:self];
+    //  先建立共用的 model，binding 建立 pairInfo 時就不會自己註冊 KVO
+    for ( id object in array ) {
+        [self addSharedModel:object];
+    }
+    for ( KHDataBinding *binding in _bindings ) {
+        [binding bindArray:array];
+    }
+}
+
+- (void)deBindArray:(NSMutableArray*)array
+{
+    if ( [_core sectionOfArray:array] == NSNotFound ) {
+        return;
+    }
+    for ( KHDataBinding *binding in _bindings ) {
+        [binding deBindArray:array];
+    }
+    [_core removeSection:array];
+    for ( id object in array ) {
+        [self removeSharedModel:object];
+    }
+}
+
+#pragma mark - Model Observe
+
+//  model 第一次出現在共用的 array，由這裡註冊 KVO，binding 的 pairInfo 已經註冊的要解除，不然會註冊兩次
+- (void)addSharedModel:(id)model
+{
+    const void *key = (__bridge const void*)model;
+    CFBagAddValue( _modelCounts, key );
+    if ( CFBagGetCountOfValue( _modelCounts, key ) > 1 ) {
+        return;
+    }
+    [_core registerPair:model];
+    [self updateModelObserverOf:model];
+}
+
+//  model 已經不在任何共用的 array，binding 裡還有這個 model 的話，改由它的 pairInfo 註冊 KVO
+- (void)removeSharedModel:(id)model
+{
+    const void *key = (__bridge const void*)model;
+    if ( !CFBagContainsValue( _modelCounts, key ) ) {
+        return;
+    }
+    CFBagRemoveValue( _modelCounts, key );
+    if ( CFBagContainsValue( _modelCounts, key ) ) {
+        return;
+    }
+    [_core removePair:model];
+    [self updateModelObserverOf:model];
+}
+
+- (void)updateModelObserverOf:(id)model
+{
+    for ( KHDataBinding *binding in _bindings ) {
+        [[binding getPairInfo:model] updateModelObserver];
+    }
+}
+
+- (void)model:(id)model didChangeKeyPath:(NSString*)keyPath
+{
+    for ( KHDataBinding *binding in _bindings ) {
+        [[binding getPairInfo:model] modelDidChange:model];
+    }
+}
+
+#pragma mark - Forward (Private)
+
+- (void)forwardArray:(NSMutableArray*)array block:(void(^)(KHDataBinding *binding, NSInteger section))block
+{
+    //  block 裡可能會 removeBinding:
+    for ( KHDataBinding *binding in [_bindings copy] ) {
+        NSInteger section = [binding sectionOfArray:array];
+        if ( section != NSNotFound ) {
+            block( binding, section );
+        }
+    }
+}
+
+#pragma mark - Array Observe
+
+-(void)arrayInsert:(NSMutableArray*)array insertObject:(id)object index:(NSIndexPath*)index
+{
+    [self addSharedModel:object];
+    [self forwardArray:array block:^(KHDataBinding *binding, NSInteger section) {
+        [binding arrayInsert:array insertObject:object index:KHMulticastIndex( index, section )];
+    }];
+}
+
+-(void)arrayInsertSome:(NSMutableArray*)array insertObjects:(NSArray*)objects indexes:(NSArray*)indexes
+{
+    for ( id object in objects ) {
+        [self addSharedModel:object];
+    }
+    [self forwardArray:array block:^(KHDataBinding *binding, NSInteger section) {
+        [binding arrayInsertSome:array insertObjects:objects indexes:KHMulticastIndexes( indexes, section )];
+    }];
+}
+
+-(void)arrayRemove:(NSMutableArray*)array removeObject:(id)object index:(NSIndexPath*)index
+{
+    [self forwardArray:array block:^(KHDataBinding *binding, NSInteger section) {
+        [binding arrayRemove:array removeObject:object index:KHMulticastIndex( index, section )];
+    }];
+    [self removeSharedModel:object];
+}
+
+-(void)arrayRemoveSome:(NSMutableArray*)array removeObjects:(NSArray*)objects indexs:(NSArray*)indexs
+{
+    [self forwardArray:array block:^(KHDataBinding *binding, NSInteger section) {
+        [binding arrayRemoveSome:array removeObjects:objects indexs:KHMulticastIndexes( indexs, section )];
+    }];
+    for ( id object in objects ) {
+        [self removeSharedModel:object];
+    }
+}
+
+-(void)arrayReplace:(NSMutableArray*)array newObject:(id)newObj replacedObject:(id)oldObj index:(NSIndexPath*)index
+{
+    //  KVO 先換到新的 model，binding 的 pairInfo 換 model 時才知道不用自己註冊
+    [self addSharedModel:newObj];
+    [self forwardArray:array block:^(KHDataBinding *binding, NSInteger section) {
+        [binding arrayReplace:array newObject:newObj replacedObject:oldObj index:KHMulticastIndex( index, section )];
+    }];
+    [self removeSharedModel:oldObj];
+}
+
+-(void)arrayUpdate:(NSMutableArray*)array update:(id)object index:(NSIndexPath*)index
+{
+    [self forwardArray:array block:^(KHDataBinding *binding, NSInteger section) {
+        [binding arrayUpdate:array update:object index:KHMulticastIndex( index, section )];
+    }];
+}
+
+-(void)arrayUpdateAll:(NSMutableArray*)array
+{
+    [self forwardArray:array block:^(KHDataBinding *binding, NSInteger section) {
+        [binding arrayUpdateAll:array];
+    }];
+}
+
+@end
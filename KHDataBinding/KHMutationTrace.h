@@ -0,0 +1,138 @@
+//
+//  KHMutationTrace.h
+//
+//  Created by Calvin Huang on 2017/3/12.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "KHPlatform.h"
+#import "NSMutableArray+KHSwizzle.h"
+
+//  記錄與重播 array 的修改
+//
+//  KHMutationRecorder 用 kh_addObserver: 觀察綁定的 array，跟 binding 走一樣的 KHArrayObserveDelegate，
+//  把每個修改與 model 的變動寫成精簡的 binary trace
+//  不存 model，每個 model 只記一個 id，正式版的 app 也可以錄
+//
+//  dataBinding.mutationRecorder = [[KHMutationRecorder alloc] init];
+//  ...
+//  [dataBinding.mutationRecorder writeTraceToFile:path error:nil];
+//
+//  KHMutationReplayer 讀取 trace，套用到新的 NSMutableArray，array 由呼叫的一方綁到任何 binding，
+//  量每一步的 latency，並在每一步之後檢查是否一致。Benchmark/ 可以在 mock view 上重播
+//
+//  ./obj/khbench --replay trace.khmt
+//
+//  trace 格式，little endian，header 之後的數字都是 unsigned LEB128 varint
+//  header  : "KHMT" uint16 version uint16 reserved
+//  event   : uint8 op, section id, 跟上一個 event 相差的微秒, payload
+//  index 的 list 存跟上一個 index + 1 的差 (zigzag)，連續的 range 每個 index 只要一個 byte
+//  model id 依第一次出現的順序從 1 開始，比看過的最大 id 多超過 1 的 trace 會被拒絕
+//
+//  所有 method 都只能在 main thread 呼叫
+
+NS_ASSUME_NONNULL_BEGIN
+
+extern NSString *const KHMutationTraceErrorDomain;
+
+typedef NS_ENUM(uint8_t, KHMutationTraceOp) {
+    //  array 綁定，payload: count, model ids
+    KHMutationTraceBind = 1,
+    //  array 解除綁定
+    KHMutationTraceUnbind,
+    //  payload: index, model id
+    KHMutationTraceInsert,
+    //  payload: count, indexes, model ids
+    KHMutationTraceInsertSome,
+    //  payload: index
+    KHMutationTraceRemove,
+    //  payload: count, indexes
+    KHMutationTraceRemoveSome,
+    //  removeAllObjects
+    KHMutationTraceRemoveAll,
+    //  payload: index, new model id
+    KHMutationTraceReplace,
+    //  -[NSMutableArray update:]，payload: index
+    KHMutationTraceUpdate,
+    //  -[NSMutableArray updateAll]
+    KHMutationTraceUpdateAll,
+    //  model 的 property 變動 (KVO)，section id 是 0，payload: model id
+    KHMutationTraceModelChange,
+};
+
+//  op 的名稱，用在報表
+FOUNDATION_EXPORT NSString *KHMutationTraceOpName(KHMutationTraceOp op);
+
+
+@interface KHMutationRecorder : NSObject <KHArrayObserveDelegate>
+
+//  目前記錄的 event 數
+@property (nonatomic,readonly) NSUInteger eventCount;
+
+//  開始記錄 array，會先記下 array 目前的內容
+- (void)recordArray:(NSMutableArray*)array;
+- (void)stopRecordingArray:(NSMutableArray*)array;
+
+//  model 的 property 變動，KHPairInfo 收到 KVO 時呼叫
+- (void)recordModelChange:(id)model;
+
+//  清空已記錄的 event，model id 重新編號，目前記錄中的 array 會重新記下內容
+- (void)reset;
+
+- (NSData*)traceData;
+- (BOOL)writeTraceToFile:(NSString*)path error:(NSError* _Nullable * _Nullable)error;
+
+@end
+
+
+//  replay 時代替原本 model 的物件，同一個 model id 是同一個物件
+//  KHMutationTraceModelChange 會修改 revision，binding 有觀察 model 的話會收到 KVO
+@interface KHMutationTraceModel : NSObject
+
+@property (nonatomic,readonly) NSUInteger modelID;
+@property (nonatomic) NSUInteger revision;
+
+@end
+
+
+@interface KHMutationReplayResult : NSObject
+
+@property (nonatomic,readonly) NSUInteger eventCount;
+//  套用全部 event 的時間，不含檢查
+@property (nonatomic,readonly) NSTimeInterval duration;
+//  trace 錄下的時間長度
+@property (nonatomic,readonly) NSTimeInterval recordedDuration;
+@property (nonatomic,readonly) double eventsPerSecond;
+//  key: op 名稱 / value: 次數
+@property (nonatomic,readonly) NSDictionary<NSString*,NSNumber*> *opCounts;
+
+//  檢查失敗的 event index 與原因，都通過的話是 NSNotFound 與 nil
+@property (nonatomic,readonly) NSUInteger failedEventIndex;
+@property (nonatomic,readonly,nullable) NSString *failure;
+
+//  單一 event 的 latency，percentile 是 0~100
+- (NSTimeInterval)latencyPercentile:(double)percentile;
+
+//  可以轉成 JSON 的報表
+- (NSDictionary<NSString*,id>*)report;
+
+@end
+
+
+@interface KHMutationReplayer : NSObject
+
+@property (nonatomic,readonly) NSUInteger eventCount;
+
+//  格式不對的話回傳 nil
+- (nullable instancetype)initWithData:(NSData*)data error:(NSError* _Nullable * _Nullable)error;
+
+//  bind / deBind 把 replay 建立的 array 綁定到要測的 binding
+//  verify 在每個 event 之後呼叫，sections 是目前綁定中的 array，依綁定順序，有問題的話回傳原因，replay 會停下來
+- (KHMutationReplayResult*)replayWithBind:(void(^)(NSMutableArray *array))bind
+                                   deBind:(void(^)(NSMutableArray *array))deBind
+                                   verify:(NSString* _Nullable(^ _Nullable)(NSArray<NSMutableArray*> *sections))verify;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,663 @@
+//
+//  KHMutationTrace.m
+//
+//  Created by Calvin Huang on 2017/3/12.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import "KHMutationTrace.h"
+#ifdef __APPLE__
+#import <mach/mach_time.h>
+#else
+#import <time.h>
+#endif
+
+NSString *const KHMutationTraceErrorDomain = @"KHMutationTrace";
+
+static const char KHTraceMagic[4] = { 'K', 'H', 'M', 'T' };
+static const uint16_t KHTraceVersion = 1;
+static const double KHTraceNanosPerSecond = 1e9;
+
+NSString *KHMutationTraceOpName(KHMutationTraceOp op)
+{
+    switch ( op ) {
+        case KHMutationTraceBind:           return @"bind";
+        case KHMutationTraceUnbind:         return @"unbind";
+        case KHMutationTraceInsert:         return @"insert";
+        case KHMutationTraceInsertSome:     return @"insertSome";
+        case KHMutationTraceRemove:         return @"remove";
+        case KHMutationTraceRemoveSome:     return @"removeSome";
+        case KHMutationTraceRemoveAll:      return @"removeAll";
+        case KHMutationTraceReplace:        return @"replace";
+        case KHMutationTraceUpdate:         return @"update";
+        case KHMutationTraceUpdateAll:      return @"updateAll";
+        case KHMutationTraceModelChange:    return @"modelChange";
+    }
+    return @"unknown";
+}
+
+//  nanosecond，只用來算差值
+static uint64_t KHTraceNow(void)
+{
+#ifdef __APPLE__
+    static mach_timebase_info_data_t timebase;
+    if ( timebase.denom == 0 ) {
+        mach_timebase_info(&timebase);
+    }
+    return mach_absolute_time() * timebase.numer / timebase.denom;
+#else
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+static void KHTraceWriteVarint(NSMutableData *data, uint64_t value)
+{
+    uint8_t bytes[10];
+    NSUInteger length = 0;
+    do {
+        uint8_t byte = value & 0x7f;
+        value >>= 7;
+        bytes[length++] = value ? ( byte | 0x80 ) : byte;
+    } while ( value );
+    [data appendBytes:bytes length:length];
+}
+
+//  index 存與上一個 index + 1 的差，連續的 index 只要一個 byte
+static void KHTraceWriteIndexes(NSMutableData *data, NSArray<NSIndexPath*> *indexes)
+{
+    int64_t expected = 0;
+    for ( NSIndexPath *index in indexes ) {
+        int64_t delta = (int64_t)index.row - expected;
+        KHTraceWriteVarint( data, (uint64_t)( ( delta << 1 ) ^ ( delta >> 63 ) ) );
+        expected = index.row + 1;
+    }
+}
+
+typedef struct {
+    const uint8_t *bytes;
+    NSUInteger length;
+    NSUInteger offset;
+    BOOL failed;
+    //  目前看過最大的 model id
+    uint64_t maxModelID;
+    //  model id 不合理時的 id
+    uint64_t badModelID;
+} KHTraceReader;
+
+static uint64_t KHTraceReadVarint(KHTraceReader *reader)
+{
+    uint64_t value = 0;
+    for ( unsigned shift = 0; shift < 64; shift += 7 ) {
+        if ( reader->offset >= reader->length ) {
+            reader->failed = YES;
+            return 0;
+        }
+        uint8_t byte = reader->bytes[reader->offset++];
+        value |= (uint64_t)( byte & 0x7f ) << shift;
+        if ( !( byte & 0x80 ) ) {
+            return value;
+        }
+    }
+    reader->failed = YES;
+    return 0;
+}
+
+//  model id 依第一次出現的順序從 1 開始編，新的 id 最多只會比看過的大 1
+//  replay 時會產生到這個 id 為止的 model，不檢查的話一個很大的 id 就會用光記憶體
+static uint64_t KHTraceReadModelID(KHTraceReader *reader)
+{
+    uint64_t modelID = KHTraceReadVarint( reader );
+    if ( reader->failed ) {
+        return 0;
+    }
+    if ( modelID > reader->maxModelID + 1 ) {
+        reader->badModelID = modelID;
+        reader->failed = YES;
+        return 0;
+    }
+    if ( modelID > reader->maxModelID ) {
+        reader->maxModelID = modelID;
+    }
+    return modelID;
+}
+
+
+@implementation KHMutationRecorder
+{
+    NSMutableData *_data;
+    uint64_t _lastTime;
+
+    //  key: array / value: section id，從 1 開始
+    NSMapTable *_sectionIDs;
+    NSUInteger _nextSectionID;
+
+    //  key: model / value: model id，從 1 開始
+    NSMapTable *_modelIDs;
+    NSUInteger _nextModelID;
+}
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self) {
+        //  model 與 array 都用 pointer 比對，也不 retain
+        NSPointerFunctionsOptions keyOptions = NSPointerFunctionsWeakMemory | NSPointerFunctionsObjectPointerPersonality;
+        _sectionIDs = [[NSMapTable alloc] initWithKeyOptions:keyOptions valueOptions:NSPointerFunctionsStrongMemory capacity:4];
+        _modelIDs = [[NSMapTable alloc] initWithKeyOptions:keyOptions valueOptions:NSPointerFunctionsStrongMemory capacity:256];
+        [self resetData];
+    }
+    return self;
+}
+
+- (void)resetData
+{
+    _data = [[NSMutableData alloc] initWithCapacity: 4096 ];
+    [_data appendBytes:KHTraceMagic length:4];
+    uint16_t header[2] = { NSSwapHostShortToLittle(KHTraceVersion), 0 };
+    [_data appendBytes:header length:sizeof(header)];
+    _eventCount = 0;
+    _lastTime = 0;
+}
+
+- (void)reset
+{
+    [self resetData];
+    //  新的 trace 的 model id 要從 1 重新開始，replay 時 id 不能比出現過的大超過 1
+    [_modelIDs removeAllObjects];
+    _nextModelID = 0;
+    for ( NSMutableArray *array in _sectionIDs ) {
+        [self writeBindOfArray:array section:[[_sectionIDs objectForKey:array] unsignedIntegerValue]];
+    }
+}
+
+#pragma mark - Record
+
+- (void)recordArray:(NSMutableArray*)array
+{
+    if ( [_sectionIDs objectForKey:array] ) {
+        return;
+    }
+    NSUInteger section = ++_nextSectionID;
+    [_sectionIDs setObject:@(section) forKey:array];
+    [array kh_addObserver:self];
+    [self writeBindOfArray:array section:section];
+}
+
+- (void)stopRecordingArray:(NSMutableArray*)array
+{
+    NSUInteger section = [self sectionOfArray:array];
+    if ( section == 0 ) {
+        return;
+    }
+    [self beginEvent:KHMutationTraceUnbind section:section];
+    [array kh_removeObserver:self];
+    [_sectionIDs removeObjectForKey:array];
+}
+
+- (void)recordModelChange:(id)model
+{
+    if ( model == nil ) {
+        return;
+    }
+    [self beginEvent:KHMutationTraceModelChange section:0];
+    KHTraceWriteVarint( _data, [self modelIDOf:model] );
+}
+
+- (NSData*)traceData
+{
+    return [_data copy];
+}
+
+- (BOOL)writeTraceToFile:(NSString*)path error:(NSError**)error
+{
+    return [_data writeToFile:path options:NSDataWritingAtomic error:error];
+}
+
+#pragma mark - Encode
+
+- (NSUInteger)sectionOfArray:(NSMutableArray*)array
+{
+    return [[_sectionIDs objectForKey:array] unsignedIntegerValue];
+}
+
+- (NSUInteger)modelIDOf:(id)model
+{
+    NSNumber *modelID = [_modelIDs objectForKey:model];
+    if ( modelID == nil ) {
+        modelID = @(++_nextModelID);
+        [_modelIDs setObject:modelID forKey:model];
+    }
+    return [modelID unsignedIntegerValue];
+}
+
+//  時間存 microsecond 的差，_lastTime 只加上存進去的部分，不會累積誤差
+- (void)beginEvent:(KHMutationTraceOp)op section:(NSUInteger)section
+{
+    uint64_t now = KHTraceNow();
+    uint64_t delta = _lastTime ? ( now - _lastTime ) / 1000 : 0;
+    _lastTime = _lastTime ? _lastTime + delta * 1000 : now;
+    uint8_t opByte = op;
+    [_data appendBytes:&opByte length:1];
+    KHTraceWriteVarint( _data, section );
+    KHTraceWriteVarint( _data, delta );
+    _eventCount++;
+}
+
+- (void)writeBindOfArray:(NSMutableArray*)array section:(NSUInteger)section
+{
+    [self beginEvent:KHMutationTraceBind section:section];
+    KHTraceWriteVarint( _data, array.count );
+    for ( id model in array ) {
+        KHTraceWriteVarint( _data, [self modelIDOf:model] );
+    }
+}
+
+#pragma mark - Array Observe
+
+-(void)arrayInsert:(NSMutableArray*)array insertObject:(id)object index:(NSIndexPath*)index
+{
+    NSUInteger section = [self sectionOfArray:array];
+    if ( section == 0 ) return;
+    [self beginEvent:KHMutationTraceInsert section:section];
+    KHTraceWriteVarint( _data, index.row );
+    KHTraceWriteVarint( _data, [self modelIDOf:object] );
+}
+
+-(void)arrayInsertSome:(NSMutableArray *)array insertObjects:(NSArray *)objects indexes:(NSArray *)indexes
+{
+    NSUInteger section = [self sectionOfArray:array];
+    if ( section == 0 ) return;
+    [self beginEvent:KHMutationTraceInsertSome section:section];
+    KHTraceWriteVarint( _data, objects.count );
+    KHTraceWriteIndexes( _data, indexes );
+    for ( id model in objects ) {
+        KHTraceWriteVarint( _data, [self modelIDOf:model] );
+    }
+}
+
+-(void)arrayRemove:(NSMutableArray*)array removeObject:(id)object index:(NSIndexPath*)index
+{
+    NSUInteger section = [self sectionOfArray:array];
+    if ( section == 0 ) return;
+    [self beginEvent:KHMutationTraceRemove section:section];
+    KHTraceWriteVarint( _data, index.row );
+}
+
+-(void)arrayRemoveSome:(NSMutableArray *)array removeObjects:(NSArray *)objects indexs:(NSArray *)indexs
+{
+    NSUInteger section = [self sectionOfArray:array];
+    if ( section == 0 ) return;
+    //  removeAllObjects 只要記一個 op
+    if ( array.count == 0 ) {
+        [self beginEvent:KHMutationTraceRemoveAll section:section];
+        return;
+    }
+    [self beginEvent:KHMutationTraceRemoveSome section:section];
+    KHTraceWriteVarint( _data, indexs.count );
+    KHTraceWriteIndexes( _data, indexs );
+}
+
+-(void)arrayReplace:(NSMutableArray*)array newObject:(id)newObj replacedObject:(id)oldObj index:(NSIndexPath*)index
+{
+    NSUInteger section = [self sectionOfArray:array];
+    if ( section == 0 ) return;
+    [self beginEvent:KHMutationTraceReplace section:section];
+    KHTraceWriteVarint( _data, index.row );
+    KHTraceWriteVarint( _data, [self modelIDOf:newObj] );
+}
+
+-(void)arrayUpdate:(NSMutableArray *)array update:(id)object index:(NSIndexPath *)index
+{
+    NSUInteger section = [self sectionOfArray:array];
+    if ( section == 0 ) return;
+    [self beginEvent:KHMutationTraceUpdate section:section];
+    KHTraceWriteVarint( _data, index.row );
+}
+
+-(void)arrayUpdateAll:(NSMutableArray *)array
+{
+    NSUInteger section = [self sectionOfArray:array];
+    if ( section == 0 ) return;
+    [self beginEvent:KHMutationTraceUpdateAll section:section];
+}
+
+@end
+
+
+@implementation KHMutationTraceModel
+
+- (instancetype)initWithModelID:(NSUInteger)modelID
+{
+    self = [super init];
+    if (self) {
+        _modelID = modelID;
+    }
+    return self;
+}
+
+- (NSString *)description
+{
+    return [NSString stringWithFormat:@"<KHMutationTraceModel %lu>", (unsigned long)_modelID];
+}
+
+@end
+
+
+@implementation KHMutationReplayResult
+{
+    @public
+    NSUInteger _eventCount;
+    NSTimeInterval _duration;
+    NSTimeInterval _recordedDuration;
+    NSDictionary *_opCounts;
+    NSUInteger _failedEventIndex;
+    NSString *_failure;
+    //  排序過的 latency
+    NSArray<NSNumber*> *_latencies;
+}
+
+- (double)eventsPerSecond
+{
+    return _duration > 0 ? _eventCount / _duration : 0;
+}
+
+- (NSTimeInterval)latencyPercentile:(double)percentile
+{
+    if ( _latencies.count == 0 ) {
+        return 0;
+    }
+    NSUInteger index = (NSUInteger)( MAX( 0, MIN( percentile, 100 ) ) / 100.0 * ( _latencies.count - 1 ) + 0.5 );
+    return [_latencies[index] doubleValue];
+}
+
+- (NSDictionary<NSString*,id>*)report
+{
+    NSMutableDictionary *report = [@{ @"events":@(_eventCount),
+                                      @"duration":@(_duration),
+                                      @"recordedDuration":@(_recordedDuration),
+                                      @"eventsPerSecond":@(self.eventsPerSecond),
+                                      @"latencyP50":@([self latencyPercentile:50]),
+                                      @"latencyP90":@([self latencyPercentile:90]),
+                                      @"latencyP99":@([self latencyPercentile:99]),
+                                      @"latencyMax":@([self latencyPercentile:100]),
+                                      @"ops":_opCounts ?: @{} } mutableCopy];
+    if ( _failure ) {
+        report[@"failedEvent"] = @(_failedEventIndex);
+        report[@"failure"] = _failure;
+    }
+    return report;
+}
+
+@end
+
+
+//  解析後的 event，payload 是 _values 裡的位置
+typedef struct {
+    KHMutationTraceOp op;
+    uint32_t section;
+    uint32_t count;
+    uint32_t payload;
+    uint64_t time;
+} KHTraceEvent;
+
+@implementation KHMutationReplayer
+{
+    NSMutableData *_events;
+    NSMutableData *_values;
+}
+
+- (instancetype)initWithData:(NSData*)data error:(NSError**)error
+{
+    self = [super init];
+    if (self) {
+        _events = [[NSMutableData alloc] init];
+        _values = [[NSMutableData alloc] init];
+        NSString *reason = [self parseData:data];
+        if ( reason ) {
+            if ( error ) {
+                *error = [NSError errorWithDomain:KHMutationTraceErrorDomain code:1 userInfo:@{ NSLocalizedDescriptionKey:reason }];
+            }
+            return nil;
+        }
+    }
+    return self;
+}
+
+- (void)appendValue:(uint64_t)value
+{
+    uint32_t v = (uint32_t)value;
+    [_values appendBytes:&v length:sizeof(v)];
+}
+
+//  先全部解析好，replay 時量到的只有 binding 的時間
+- (NSString*)parseData:(NSData*)data
+{
+    if ( data.length < 8 || memcmp( data.bytes, KHTraceMagic, 4 ) != 0 ) {
+        return @"not a mutation trace";
+    }
+    uint16_t version;
+    memcpy( &version, (const uint8_t*)data.bytes + 4, sizeof(version) );
+    if ( NSSwapLittleShortToHost(version) != KHTraceVersion ) {
+        return [NSString stringWithFormat:@"unsupported trace version %u", NSSwapLittleShortToHost(version)];
+    }
+    KHTraceReader reader = { data.bytes, data.length, 8, NO };
+    uint64_t time = 0;
+    while ( reader.offset < reader.length ) {
+        KHTraceEvent event = {0};
+        event.op = reader.bytes[reader.offset++];
+        event.section = (uint32_t)KHTraceReadVarint( &reader );
+        time += KHTraceReadVarint( &reader ) * 1000;
+        event.time = time;
+        event.payload = (uint32_t)( _values.length / sizeof(uint32_t) );
+        switch ( event.op ) {
+            case KHMutationTraceBind:
+                event.count = (uint32_t)KHTraceReadVarint( &reader );
+                for ( uint32_t i=0; i<event.count && !reader.failed; i++ ) {
+                    [self appendValue:KHTraceReadModelID( &reader )];
+                }
+                break;
+            case KHMutationTraceInsertSome:
+            case KHMutationTraceRemoveSome: {
+                event.count = (uint32_t)KHTraceReadVarint( &reader );
+                int64_t expected = 0;
+                for ( uint32_t i=0; i<event.count && !reader.failed; i++ ) {
+                    uint64_t zigzag = KHTraceReadVarint( &reader );
+                    int64_t index = expected + (int64_t)( ( zigzag >> 1 ) ^ -( zigzag & 1 ) );
+                    [self appendValue:(uint64_t)index];
+                    expected = index + 1;
+                }
+                if ( event.op == KHMutationTraceInsertSome ) {
+                    for ( uint32_t i=0; i<event.count && !reader.failed; i++ ) {
+                        [self appendValue:KHTraceReadModelID( &reader )];
+                    }
+                }
+                break;
+            }
+            case KHMutationTraceInsert:
+            case KHMutationTraceReplace:
+                [self appendValue:KHTraceReadVarint( &reader )];
+                [self appendValue:KHTraceReadModelID( &reader )];
+                break;
+            case KHMutationTraceRemove:
+            case KHMutationTraceUpdate:
+                [self appendValue:KHTraceReadVarint( &reader )];
+                break;
+            case KHMutationTraceModelChange:
+                [self appendValue:KHTraceReadModelID( &reader )];
+                break;
+            case KHMutationTraceUnbind:
+            case KHMutationTraceRemoveAll:
+            case KHMutationTraceUpdateAll:
+                break;
+            default:
+                return [NSString stringWithFormat:@"unknown op %u at byte %lu", event.op, (unsigned long)reader.offset - 1];
+        }
+        if ( reader.badModelID ) {
+            return [NSString stringWithFormat:@"model id %llu at byte %lu is ahead of the models seen so far", reader.badModelID, (unsigned long)reader.offset];
+        }
+        if ( reader.failed ) {
+            return @"trace is truncated";
+        }
+        [_events appendBytes:&event length:sizeof(event)];
+    }
+    return nil;
+}
+
+- (NSUInteger)eventCount
+{
+    return _events.length / sizeof(KHTraceEvent);
+}
+
+#pragma mark - Replay
+
+- (KHMutationTraceModel*)modelOfID:(uint32_t)modelID models:(NSMutableArray*)models
+{
+    while ( models.count <= modelID ) {
+        [models addObject:[[KHMutationTraceModel alloc] initWithModelID:models.count]];
+    }
+    return models[modelID];
+}
+
+- (KHMutationReplayResult*)replayWithBind:(void(^)(NSMutableArray *array))bind
+                                   deBind:(void(^)(NSMutableArray *array))deBind
+                                   verify:(NSString*(^)(NSArray<NSMutableArray*> *sections))verify
+{
+    const KHTraceEvent *events = _events.bytes;
+    const uint32_t *values = _values.bytes;
+    NSUInteger eventCount = self.eventCount;
+
+    //  key: section id / value: array，sections 依綁定順序
+    NSMutableDictionary *arrays = [[NSMutableDictionary alloc] init];
+    NSMutableArray *sections = [[NSMutableArray alloc] init];
+    NSMutableArray *models = [[NSMutableArray alloc] init];
+    NSMutableArray *latencies = [[NSMutableArray alloc] initWithCapacity: eventCount ];
+    NSMutableDictionary *opCounts = [[NSMutableDictionary alloc] init];
+    KHMutationReplayResult *result = [[KHMutationReplayResult alloc] init];
+    result->_failedEventIndex = NSNotFound;
+    uint64_t total = 0;
+
+    for ( NSUInteger e = 0; e < eventCount; e++ ) {
+        KHTraceEvent event = events[e];
+        const uint32_t *payload = values + event.payload;
+        NSMutableArray *array = arrays[@(event.section)];
+        NSString *failure = nil;
+        if ( array == nil && event.op != KHMutationTraceBind && event.op != KHMutationTraceModelChange ) {
+            failure = [NSString stringWithFormat:@"section %u is not bound", event.section];
+        }
+        //  index 超出範圍的話就是 trace 與 replay 已經不一致
+        NSUInteger limit = array.count + ( event.op == KHMutationTraceInsert ? 1 : 0 );
+        if ( !failure && ( event.op == KHMutationTraceInsert || event.op == KHMutationTraceRemove ||
+                           event.op == KHMutationTraceReplace || event.op == KHMutationTraceUpdate ) && payload[0] >= limit ) {
+            failure = [NSString stringWithFormat:@"index %u out of range %lu in section %u", payload[0], (unsigned long)array.count, event.section];
+        }
+
+        //  model 在計時前先準備好
+        NSArray *eventModels = nil;
+        NSMutableIndexSet *indexSet = nil;
+        if ( !failure && ( event.op == KHMutationTraceBind || event.op == KHMutationTraceInsertSome ) ) {
+            const uint32_t *modelIDs = event.op == KHMutationTraceBind ? payload : payload + event.count;
+            NSMutableArray *list = [[NSMutableArray alloc] initWithCapacity: event.count ];
+            for ( uint32_t i=0; i<event.count; i++ ) {
+                [list addObject:[self modelOfID:modelIDs[i] models:models]];
+            }
+            eventModels = list;
+        }
+        if ( !failure && ( event.op == KHMutationTraceInsertSome || event.op == KHMutationTraceRemoveSome ) ) {
+            indexSet = [[NSMutableIndexSet alloc] init];
+            for ( uint32_t i=0; i<event.count; i++ ) {
+                [indexSet addIndex:payload[i]];
+            }
+            NSUInteger maxIndex = event.op == KHMutationTraceInsertSome ? array.count + event.count : array.count;
+            if ( indexSet.count != event.count || ( indexSet.count && indexSet.lastIndex >= maxIndex ) ) {
+                failure = [NSString stringWithFormat:@"indexes out of range in section %u", event.section];
+            }
+        }
+        id model = nil;
+        if ( !failure && ( event.op == KHMutationTraceInsert || event.op == KHMutationTraceReplace ) ) {
+            model = [self modelOfID:payload[1] models:models];
+        }
+        else if ( !failure && event.op == KHMutationTraceModelChange ) {
+            model = [self modelOfID:payload[0] models:models];
+        }
+        if ( failure ) {
+            result->_failedEventIndex = e;
+            result->_failure = failure;
+            break;
+        }
+
+        uint64_t start = KHTraceNow();
+        switch ( event.op ) {
+            case KHMutationTraceBind:
+                array = [[NSMutableArray alloc] initWithArray:eventModels];
+                arrays[@(event.section)] = array;
+                [sections addObject:array];
+                bind( array );
+                break;
+            case KHMutationTraceUnbind:
+                deBind( array );
+                [arrays removeObjectForKey:@(event.section)];
+                [sections removeObjectIdenticalTo:array];
+                break;
+            case KHMutationTraceInsert:
+                [array insertObject:model atIndex:payload[0]];
+                break;
+            case KHMutationTraceInsertSome:
+                //  加在最後的話跟 addObjectsFromArray: 走同一條路
+                if ( indexSet.firstIndex == array.count && indexSet.lastIndex - indexSet.firstIndex + 1 == indexSet.count ) {
+                    [array addObjectsFromArray:eventModels];
+                }
+                else {
+                    [array insertObjects:eventModels atIndexes:indexSet];
+                }
+                break;
+            case KHMutationTraceRemove:
+                [array removeObjectAtIndex:payload[0]];
+                break;
+            case KHMutationTraceRemoveSome:
+                [indexSet enumerateIndexesWithOptions:NSEnumerationReverse usingBlock:^(NSUInteger idx, BOOL *stop) {
+                    [array removeObjectAtIndex:idx];
+                }];
+                break;
+            case KHMutationTraceRemoveAll:
+                [array removeAllObjects];
+                break;
+            case KHMutationTraceReplace:
+                [array replaceObjectAtIndex:payload[0] withObject:model];
+                break;
+            case KHMutationTraceUpdate:
+                [array update:array[payload[0]]];
+                break;
+            case KHMutationTraceUpdateAll:
+                [array updateAll];
+                break;
+            case KHMutationTraceModelChange:
+                ((KHMutationTraceModel*)model).revision++;
+                break;
+        }
+        uint64_t elapsed = KHTraceNow() - start;
+        total += elapsed;
+        [latencies addObject:@( (double)elapsed / KHTraceNanosPerSecond )];
+        NSString *opName = KHMutationTraceOpName( event.op );
+        opCounts[opName] = @( [opCounts[opName] unsignedIntegerValue] + 1 );
+        result->_eventCount++;
+
+        if ( verify ) {
+            failure = verify( sections );
+            if ( failure ) {
+                result->_failedEventIndex = e;
+                result->_failure = failure;
+                break;
+            }
+        }
+    }
+
+    result->_duration = (double)total / KHTraceNanosPerSecond;
+    result->_recordedDuration = eventCount ? (double)events[eventCount - 1].time / KHTraceNanosPerSecond : 0;
+    result->_opCounts = opCounts;
+    result->_latencies = [latencies sortedArrayUsingSelector:@selector(compare:)];
+    return result;
+}
+
+@end
@@ -0,0 +1,114 @@
+//
+//  KHPagedArray.h
+//
+//  Created by Calvin Huang on 2017/3/6.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import <UIKit/UIKit.h>
+#import "KHCell.h"
+
+//  虛擬化的 section 資料
+//
+//  KHPagedArray 回報已知的總數，但 memory 裡只留幾個 page 的 model
+//  binding 要的 row 所在的 page 還沒載入時，回傳 KHPagedPlaceholder，並向 data source 要那一頁（含 prefetchPageCount 內的前後頁）
+//  載入的 page 數超過 maxLoadedPages 時，離最後存取的 row 最遠的 page 會被丟掉
+//
+//  跟綁定的 NSMutableArray 不同，只有已載入的 model 有 KHPairInfo，一百萬筆的列表只要 maxLoadedPages * pageSize 個 pair
+//
+//  所有 method 都只能在 main thread 呼叫，跟綁定的 NSMutableArray 一樣
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class KHPagedArray;
+
+@protocol KHPagedArrayDataSource
+
+//  要一頁的 model，取回後呼叫 -[KHPagedArray setObjects:forPage:]
+- (void)pagedArray:(KHPagedArray*)pagedArray fetchPage:(NSInteger)page range:(NSRange)range;
+
+@optional
+//  page 已經從 memory 丟掉，回到畫面上時會再 fetch 一次
+- (void)pagedArray:(KHPagedArray*)pagedArray didEvictPage:(NSInteger)page;
+
+@end
+
+
+//  KHDataBinding 實作這個，讓 pairInfo 與畫面跟著載入的 page 同步
+@protocol KHPagedArrayObserveDelegate
+
+//  page 載入，indexes 是那些 row 的 NSIndexPath
+- (void)pagedArray:(KHPagedArray*)pagedArray didLoadObjects:(NSArray*)objects indexes:(NSArray*)indexes;
+
+//  page 移出 memory，畫面上的 row 要換回 placeholder
+- (void)pagedArray:(KHPagedArray*)pagedArray didEvictObjects:(NSArray*)objects indexes:(NSArray*)indexes;
+
+//  總數變動
+- (void)pagedArrayDidChangeCount:(KHPagedArray*)pagedArray;
+
+@end
+
+
+//  還沒載入的 row，預設對映 UITableViewCell，在 collection view 要自行設定 mapping
+//  [dataBinding setMappingModel:[KHPagedPlaceholder class] :[MyLoadingCell class]];
+@interface KHPagedPlaceholder : UITableViewCellModel
+
+@property (nonatomic,readonly) NSUInteger index;
+
++ (instancetype)placeholderAtIndex:(NSUInteger)index;
+
+@end
+
+
+@interface KHPagedArray : NSObject <NSFastEnumeration>
+
+@property (nullable,nonatomic,weak) id<KHPagedArrayDataSource> dataSource;
+@property (nullable,nonatomic,weak) id<KHPagedArrayObserveDelegate> kh_delegate;
+@property (nonatomic) NSInteger section;
+
+//  總 row 數，包含還沒載入的
+@property (nonatomic) NSUInteger totalCount;
+@property (nonatomic,readonly) NSUInteger count;
+@property (nonatomic,readonly) NSUInteger pageSize;
+
+//  存取的 page 前後各預先 fetch 幾頁，預設 1
+@property (nonatomic) NSUInteger prefetchPageCount;
+
+//  memory 裡最多留幾個 page，預設 10
+@property (nonatomic) NSUInteger maxLoadedPages;
+
+- (instancetype)initWithTotalCount:(NSUInteger)totalCount pageSize:(NSUInteger)pageSize;
+
+//  取得 model，若還沒載入，會回傳 placeholder 並發出 fetch
+- (id)objectAtIndex:(NSUInteger)index;
+- (id)objectAtIndexedSubscript:(NSUInteger)index;
+
+//  取得已載入的 model，不會觸發 fetch
+- (nullable id)loadedObjectAtIndex:(NSUInteger)index;
+
+//  取得還沒載入的 row 的 placeholder，不會觸發 fetch，同一個 row 回傳同一個 placeholder
+- (KHPagedPlaceholder*)placeholderAtIndex:(NSUInteger)index;
+
+//  只找已載入的 page
+- (NSUInteger)indexOfObjectIdenticalTo:(id)anObject;
+
+//  把 data source 取回的資料填入
+- (void)setObjects:(NSArray*)objects forPage:(NSInteger)page;
+
+//  fetch 失敗，讓下次存取時可以重新 fetch
+- (void)failPage:(NSInteger)page;
+
+- (BOOL)isPageLoaded:(NSInteger)page;
+- (NSInteger)pageOfIndex:(NSUInteger)index;
+- (NSRange)rangeOfPage:(NSInteger)page;
+
+//  目前在 memory 裡的 model
+- (NSArray*)loadedObjects;
+
+//  清掉所有已載入的 page
+- (void)evictAllPages;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,335 @@
+//
+//  KHPagedArray.m
+//
+//  Created by Calvin Huang on 2017/3/6.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import "KHPagedArray.h"
+
+@implementation KHPagedPlaceholder
+
++ (instancetype)placeholderAtIndex:(NSUInteger)index
+{
+    KHPagedPlaceholder *placeholder = [[KHPagedPlaceholder alloc] init];
+    placeholder->_index = index;
+    return placeholder;
+}
+
+@end
+
+
+@implementation KHPagedArray
+{
+    //  key: page number / value: models of the page
+    NSMutableDictionary *_pages;
+
+    //  正在 fetch 的 page
+    NSMutableIndexSet *_fetchingPages;
+
+    //  key: model pointer / value: row index，只記錄已載入的 model
+    NSMapTable *_indexOfModel;
+
+    //  key: row index / value: KHPagedPlaceholder，page 載入後就丟掉
+    NSMutableDictionary *_placeholders;
+
+    //  最後一次存取的 page，eviction 時依與它的距離決定先丟哪一頁
+    NSInteger _lastAccessPage;
+
+    //  for in 走訪時的快照，要留著，不然走訪到一半就被釋放了
+    NSArray *_enumerationSnapshot;
+}
+
+- (instancetype)init
+{
+    return [self initWithTotalCount:0 pageSize:50];
+}
+
+- (instancetype)initWithTotalCount:(NSUInteger)totalCount pageSize:(NSUInteger)pageSize
+{
+    self = [super init];
+    if (self) {
+        _totalCount = totalCount;
+        _pageSize = pageSize > 0 ? pageSize : 50;
+        _prefetchPageCount = 1;
+        _maxLoadedPages = 10;
+        _pages = [[NSMutableDictionary alloc] initWithCapacity: 10 ];
+        _fetchingPages = [[NSMutableIndexSet alloc] init];
+        _placeholders = [[NSMutableDictionary alloc] init];
+        _indexOfModel = [[NSMapTable alloc] initWithKeyOptions:NSPointerFunctionsStrongMemory|NSPointerFunctionsObjectPointerPersonality
+                                                  valueOptions:NSPointerFunctionsStrongMemory
+                                                      capacity:_pageSize * _maxLoadedPages];
+    }
+    return self;
+}
+
+#pragma mark - Property
+
+- (NSUInteger)count
+{
+    return _totalCount;
+}
+
+- (void)setTotalCount:(NSUInteger)totalCount
+{
+    if ( _totalCount == totalCount ) {
+        return;
+    }
+    _totalCount = totalCount;
+
+    //  丟掉超出範圍的 page
+    NSInteger lastPage = totalCount > 0 ? [self pageOfIndex:totalCount-1] : -1;
+    for ( NSNumber *pageNum in [_pages allKeys] ) {
+        if ( [pageNum integerValue] > lastPage ) {
+            [self evictPage:[pageNum integerValue]];
+        }
+    }
+    NSIndexSet *outOfRangePages = [_fetchingPages indexesPassingTest:^BOOL(NSUInteger idx, BOOL *stop) {
+        return (NSInteger)idx > lastPage;
+    }];
+    [_fetchingPages removeIndexes:outOfRangePages];
+    [self removePlaceholdersPassingTest:^BOOL(NSUInteger index) {
+        return index >= totalCount;
+    }];
+
+    if ( self.kh_delegate ) {
+        [self.kh_delegate pagedArrayDidChangeCount:self];
+    }
+}
+
+- (void)setMaxLoadedPages:(NSUInteger)maxLoadedPages
+{
+    _maxLoadedPages = MAX( maxLoadedPages, 1 );
+    [self evictFarPages];
+}
+
+#pragma mark - Access
+
+- (id)objectAtIndex:(NSUInteger)index
+{
+    if ( index >= _totalCount ) {
+        @throw [NSException exceptionWithName:NSRangeException
+                                       reason:[NSString stringWithFormat:@"index %lu beyond bounds [0 .. %ld]", (unsigned long)index, (long)_totalCount-1 ]
+                                     userInfo:nil];
+    }
+
+    NSInteger page = [self pageOfIndex:index];
+    _lastAccessPage = page;
+
+    //  當下這頁，跟前後 prefetchPageCount 頁，沒載入就 fetch
+    NSInteger lastPage = [self pageOfIndex:_totalCount-1];
+    NSInteger from = MAX( 0, page - (NSInteger)_prefetchPageCount );
+    NSInteger to = MIN( lastPage, page + (NSInteger)_prefetchPageCount );
+    for ( NSInteger p=from; p<=to; p++ ) {
+        [self fetchPageIfNeeded:p];
+    }
+
+    id object = [self loadedObjectAtIndex:index];
+    if ( object == nil ) {
+        object = [self placeholderAtIndex:index];
+    }
+    return object;
+}
+
+- (id)objectAtIndexedSubscript:(NSUInteger)index
+{
+    return [self objectAtIndex:index];
+}
+
+- (nullable id)loadedObjectAtIndex:(NSUInteger)index
+{
+    NSArray *objects = _pages[@([self pageOfIndex:index])];
+    if ( objects == nil ) {
+        return nil;
+    }
+    NSUInteger offset = index % _pageSize;
+    return offset < objects.count ? objects[offset] : nil;
+}
+
+- (KHPagedPlaceholder*)placeholderAtIndex:(NSUInteger)index
+{
+    //  layout 會一直存取同一個 row，不要每次都生一個新的
+    KHPagedPlaceholder *placeholder = _placeholders[@(index)];
+    if ( placeholder == nil ) {
+        placeholder = [KHPagedPlaceholder placeholderAtIndex:index];
+        _placeholders[@(index)] = placeholder;
+    }
+    return placeholder;
+}
+
+- (void)removePlaceholdersPassingTest:(BOOL(^)(NSUInteger index))test
+{
+    if ( _placeholders.count == 0 ) {
+        return;
+    }
+    NSMutableArray *keys = [[NSMutableArray alloc] init];
+    for ( NSNumber *index in _placeholders ) {
+        if ( test( [index unsignedIntegerValue] ) ) {
+            [keys addObject:index];
+        }
+    }
+    [_placeholders removeObjectsForKeys:keys];
+}
+
+- (NSUInteger)indexOfObjectIdenticalTo:(id)anObject
+{
+    NSNumber *index = [_indexOfModel objectForKey:anObject];
+    return index ? [index unsignedIntegerValue] : NSNotFound;
+}
+
+- (NSArray*)loadedObjects
+{
+    NSMutableArray *objects = [[NSMutableArray alloc] initWithCapacity: _pages.count * _pageSize ];
+    NSArray *sortedPages = [[_pages allKeys] sortedArrayUsingSelector:@selector(compare:)];
+    for ( NSNumber *pageNum in sortedPages ) {
+        [objects addObjectsFromArray:_pages[pageNum]];
+    }
+    return objects;
+}
+
+- (NSUInteger)countByEnumeratingWithState:(NSFastEnumerationState *)state objects:(id __unsafe_unretained [])buffer count:(NSUInteger)len
+{
+    //  只走訪已載入的 model，避免把一百萬個 placeholder 生出來
+    if ( state->state == 0 ) {
+        _enumerationSnapshot = [self loadedObjects];
+    }
+    return [_enumerationSnapshot countByEnumeratingWithState:state objects:buffer count:len];
+}
+
+#pragma mark - Page
+
+- (NSInteger)pageOfIndex:(NSUInteger)index
+{
+    return index / _pageSize;
+}
+
+- (NSRange)rangeOfPage:(NSInteger)page
+{
+    NSUInteger location = page * _pageSize;
+    if ( location >= _totalCount ) {
+        return NSMakeRange(location, 0);
+    }
+    return NSMakeRange(location, MIN( _pageSize, _totalCount - location ) );
+}
+
+- (BOOL)isPageLoaded:(NSInteger)page
+{
+    return _pages[@(page)] != nil;
+}
+
+- (void)fetchPageIfNeeded:(NSInteger)page
+{
+    if ( [self isPageLoaded:page] || [_fetchingPages containsIndex:page] ) {
+        return;
+    }
+    if ( self.dataSource == nil ) {
+        return;
+    }
+    [_fetchingPages addIndex:page];
+    [self.dataSource pagedArray:self fetchPage:page range:[self rangeOfPage:page]];
+}
+
+- (void)setObjects:(NSArray*)objects forPage:(NSInteger)page
+{
+    [_fetchingPages removeIndex:page];
+
+    NSRange range = [self rangeOfPage:page];
+    if ( range.length == 0 ) {
+        return;
+    }
+
+    //  重覆填同一頁，就先把舊的丟掉
+    if ( [self isPageLoaded:page] ) {
+        [self evictPage:page];
+    }
+
+    if ( objects.count > range.length ) {
+        objects = [objects subarrayWithRange:NSMakeRange(0, range.length)];
+    }
+    else{
+        objects = [objects copy];
+    }
+    _pages[@(page)] = objects;
+    [self removePlaceholdersPassingTest:^BOOL(NSUInteger index) {
+        return NSLocationInRange( index, range );
+    }];
+
+    NSMutableArray *indexes = [[NSMutableArray alloc] initWithCapacity: objects.count ];
+    for ( NSUInteger i=0; i<objects.count; i++ ) {
+        [_indexOfModel setObject:@(range.location + i) forKey:objects[i]];
+        [indexes addObject:[NSIndexPath indexPathForRow:range.location + i inSection:self.section]];
+    }
+
+    if ( self.kh_delegate ) {
+        [self.kh_delegate pagedArray:self didLoadObjects:objects indexes:indexes];
+    }
+
+    [self evictFarPages];
+}
+
+- (void)failPage:(NSInteger)page
+{
+    [_fetchingPages removeIndex:page];
+}
+
+- (void)evictAllPages
+{
+    for ( NSNumber *pageNum in [_pages allKeys] ) {
+        [self evictPage:[pageNum integerValue]];
+    }
+    [_fetchingPages removeAllIndexes];
+}
+
+#pragma mark - Eviction
+
+//  超過 memory budget 的話，從離最後存取位置最遠的 page 開始丟
+- (void)evictFarPages
+{
+    if ( _pages.count <= _maxLoadedPages ) {
+        return;
+    }
+
+    NSInteger lastAccessPage = _lastAccessPage;
+    NSArray *sortedPages = [[_pages allKeys] sortedArrayUsingComparator:^NSComparisonResult(NSNumber *page1, NSNumber *page2) {
+        NSInteger distance1 = labs( [page1 integerValue] - lastAccessPage );
+        NSInteger distance2 = labs( [page2 integerValue] - lastAccessPage );
+        if ( distance1 == distance2 ) return NSOrderedSame;
+        return distance1 > distance2 ? NSOrderedAscending : NSOrderedDescending;
+    }];
+
+    for ( NSNumber *pageNum in sortedPages ) {
+        if ( _pages.count <= _maxLoadedPages ) {
+            break;
+        }
+        //  prefetch 範圍內的 page 不丟，不然會一直 fetch 又一直丟
+        if ( labs( [pageNum integerValue] - lastAccessPage ) <= (NSInteger)_prefetchPageCount ) {
+            break;
+        }
+        [self evictPage:[pageNum integerValue]];
+    }
+}
+
+- (void)evictPage:(NSInteger)page
+{
+    NSArray *objects = _pages[@(page)];
+    if ( objects == nil ) {
+        return;
+    }
+    [_pages removeObjectForKey:@(page)];
+
+    NSRange range = [self rangeOfPage:page];
+    NSMutableArray *indexes = [[NSMutableArray alloc] initWithCapacity: objects.count ];
+    for ( NSUInteger i=0; i<objects.count; i++ ) {
+        [_indexOfModel removeObjectForKey:objects[i]];
+        [indexes addObject:[NSIndexPath indexPathForRow:range.location + i inSection:self.section]];
+    }
+
+    if ( self.kh_delegate ) {
+        [self.kh_delegate pagedArray:self didEvictObjects:objects indexes:indexes];
+    }
+    if ( [(NSObject*)self.dataSource respondsToSelector:@selector(pagedArray:didEvictPage:)] ) {
+        [self.dataSource pagedArray:self didEvictPage:page];
+    }
+}
+
+@end
@@ -0,0 +1,124 @@
+//
+//  KHPairStore.h
+//
+//  Created by Calvin Huang on 2017/3/12.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+//  精簡的 pair 狀態存放
+//
+//  預設的 pair 存放方式，每個綁定的 model 要一個 pair 物件、一個 NSValue key 與一個 dictionary entry
+//  KHPairStore 把每個 pair 的狀態放在一塊連續的 KHPairEntry 陣列，用 model pointer 當 key 的 open addressing table 查找
+//  （linear probing，刪除時 backward shift）
+//
+//  slot     : model 的 entry 的 index，model 移除前不會變，移除後的 slot 會再給別的 model 用
+//  facade   : 要用時才建立的 pair 物件，讀寫 slot 的狀態，weak cache，有人拿著的話同一個 model 回傳同一個 facade
+//  userInfo : 只有設定過 user info 的 slot 才有 dictionary
+//
+//  跟 pair 物件一樣，不 retain model 與 cell，不需要 UIKit
+//  所有 method 都只能在 main thread 呼叫
+
+NS_ASSUME_NONNULL_BEGIN
+
+typedef NS_OPTIONS(uint32_t, KHPairFlags) {
+    //  model 變動時要更新 cell，對映 KHPairInfo.enabledObserveModel
+    KHPairFlagObserveModel  = 1 << 0,
+    //  有 userInfo，沒有的話不用查 dictionary
+    KHPairFlagHasUserInfo   = 1 << 1,
+    //  model 在 row 不在畫面上時更新過，對映 KHPairInfo.stale
+    KHPairFlagStale         = 1 << 2,
+    //  有記錄圖片網址，對映 KHPairInfo.imageURLs
+    KHPairFlagHasImageURLs  = 1 << 3,
+};
+
+//  一個 model 的 pair 狀態，64 bit 下是 48 bytes
+typedef struct {
+    __unsafe_unretained id _Nullable model;
+    __unsafe_unretained id _Nullable cell;
+    double width;
+    double height;
+    //  cellNames 的 index + 1，0 表示 nil
+    uint32_t cellName;
+    KHPairFlags flags;
+    //  對映 KHPairInfo.updateGeneration
+    uint32_t generation;
+} KHPairEntry;
+
+
+@interface KHPairStore : NSObject
+
+//  目前的 model 數量
+@property (nonatomic,readonly) NSUInteger count;
+
+//  pair 共用的 owner，KHDataBinding 用來放 binder
+@property (nullable,nonatomic,assign) id owner;
+
+//  新的 slot 的 generation，KHDataBinding 在 updateAll 時更新
+@property (nonatomic) uint32_t generation;
+
+- (instancetype)initWithCapacity:(NSUInteger)capacity;
+
+#pragma mark - Slot
+
+//  沒有的話回傳 NSNotFound
+- (NSUInteger)slotOfModel:(id)model;
+
+//  取得或建立 model 的 slot，新的 slot 預設 KHPairFlagObserveModel
+- (NSUInteger)addModel:(id)model;
+
+//  移除 slot，slot 之後會給別的 model 用
+- (void)removeSlot:(NSUInteger)slot;
+
+//  換 slot 的 model，其他狀態不變，newModel 已經有 slot 的話會先移除它的
+- (void)moveSlot:(NSUInteger)slot toModel:(id)model;
+
+//  第一個 cell 是這個的 slot，沒有的話回傳 NSNotFound
+- (NSUInteger)slotOfCell:(id)cell;
+
+- (void)enumerateModelsUsingBlock:(void(^)(id model, NSUInteger slot, BOOL *stop))block;
+
+#pragma mark - State
+
+- (nullable id)modelAtSlot:(NSUInteger)slot;
+
+- (nullable id)cellAtSlot:(NSUInteger)slot;
+- (void)setCell:(nullable id)cell atSlot:(NSUInteger)slot;
+
+- (double)widthAtSlot:(NSUInteger)slot;
+- (double)heightAtSlot:(NSUInteger)slot;
+- (void)setWidth:(double)width height:(double)height atSlot:(NSUInteger)slot;
+
+//  cell name 只存一份，slot 存 index
+- (nullable NSString*)cellNameAtSlot:(NSUInteger)slot;
+- (void)setCellName:(nullable NSString*)cellName atSlot:(NSUInteger)slot;
+
+- (KHPairFlags)flagsAtSlot:(NSUInteger)slot;
+- (void)setFlags:(KHPairFlags)flags atSlot:(NSUInteger)slot;
+
+- (uint32_t)generationAtSlot:(NSUInteger)slot;
+- (void)setGeneration:(uint32_t)generation atSlot:(NSUInteger)slot;
+
+- (nullable id)userInfoForKey:(id)key atSlot:(NSUInteger)slot;
+- (void)setUserInfo:(nullable id)value forKey:(id<NSCopying>)key atSlot:(NSUInteger)slot;
+- (nullable NSDictionary*)userInfoAtSlot:(NSUInteger)slot;
+
+//  跟 userInfo 分開放，不會蓋到使用者的 key
+- (nullable NSArray<NSString*>*)imageURLsAtSlot:(NSUInteger)slot;
+- (void)setImageURLs:(nullable NSArray<NSString*>*)imageURLs atSlot:(NSUInteger)slot;
+
+#pragma mark - Facade
+
+//  已經存在的 facade，沒有的話回傳 nil
+- (nullable id)facadeAtSlot:(NSUInteger)slot;
+- (void)setFacade:(nullable id)facade atSlot:(NSUInteger)slot;
+
+#pragma mark - Memory
+
+//  entry array、hash table、free list 佔用的 bytes，不含 userInfo 與 facade
+- (size_t)bytesUsed;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,405 @@
+//
+//  KHPairStore.m
+//
+//  Created by Calvin Huang on 2017/3/12.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import "KHPairStore.h"
+
+//  pointer 的低位都是 0，先打散再取 mask
+static inline NSUInteger KHPairHash(__unsafe_unretained id model)
+{
+    uint64_t p = (uint64_t)(uintptr_t)(__bridge void*)model;
+    p ^= p >> 33;
+    p *= 0xff51afd7ed558ccdULL;
+    p ^= p >> 33;
+    return (NSUInteger)p;
+}
+
+@implementation KHPairStore
+{
+    //  pair 狀態，_entryCount 之前的 slot 都用過，model 是 nil 的是空的 slot
+    KHPairEntry *_entries;
+    NSUInteger _entryCount;
+    NSUInteger _entryCapacity;
+
+    //  移除後可以再用的 slot
+    uint32_t *_freeSlots;
+    NSUInteger _freeCount;
+    NSUInteger _freeCapacity;
+
+    //  open addressing table，存 slot + 1，0 表示空的，容量是 2 的次方，最多用一半
+    uint32_t *_buckets;
+    NSUInteger _bucketMask;
+
+    NSMutableArray *_cellNames;
+    NSMutableDictionary *_cellNameIndexes;
+
+    //  key: slot / value: NSMutableDictionary，只有設定過 userInfo 的 slot 才有
+    NSMutableDictionary *_userInfos;
+
+    //  key: slot / value: NSArray，只有記錄過圖片網址的 slot 才有
+    NSMutableDictionary *_imageURLs;
+
+    //  key: slot / value: facade，weak
+    NSMapTable *_facades;
+}
+
+- (instancetype)init
+{
+    return [self initWithCapacity:0];
+}
+
+- (instancetype)initWithCapacity:(NSUInteger)capacity
+{
+    self = [super init];
+    if (self) {
+        _entryCapacity = MAX( capacity, 8 );
+        _entries = calloc( _entryCapacity, sizeof(KHPairEntry) );
+        NSUInteger bucketCount = 16;
+        while ( bucketCount < _entryCapacity * 2 ) {
+            bucketCount <<= 1;
+        }
+        _buckets = calloc( bucketCount, sizeof(uint32_t) );
+        _bucketMask = bucketCount - 1;
+        _cellNames = [[NSMutableArray alloc] init];
+        _cellNameIndexes = [[NSMutableDictionary alloc] init];
+        _userInfos = [[NSMutableDictionary alloc] init];
+        _imageURLs = [[NSMutableDictionary alloc] init];
+        _facades = [NSMapTable strongToWeakObjectsMapTable];
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    free( _entries );
+    free( _freeSlots );
+    free( _buckets );
+}
+
+#pragma mark - Hash Table
+
+//  model 所在的 bucket，沒有的話回傳可以放它的空 bucket
+- (NSUInteger)bucketOfModel:(__unsafe_unretained id)model
+{
+    NSUInteger i = KHPairHash( model ) & _bucketMask;
+    while ( _buckets[i] != 0 ) {
+        if ( _entries[_buckets[i] - 1].model == model ) {
+            return i;
+        }
+        i = ( i + 1 ) & _bucketMask;
+    }
+    return i;
+}
+
+- (void)insertBucketOfSlot:(NSUInteger)slot
+{
+    NSUInteger i = [self bucketOfModel:_entries[slot].model];
+    _buckets[i] = (uint32_t)( slot + 1 );
+}
+
+//  backward shift，後面同一串的 bucket 往前補，不需要 tombstone
+- (void)removeBucketOfSlot:(NSUInteger)slot
+{
+    NSUInteger i = [self bucketOfModel:_entries[slot].model];
+    if ( _buckets[i] == 0 ) {
+        return;
+    }
+    _buckets[i] = 0;
+    NSUInteger j = i;
+    while ( YES ) {
+        j = ( j + 1 ) & _bucketMask;
+        if ( _buckets[j] == 0 ) {
+            break;
+        }
+        NSUInteger k = KHPairHash( _entries[_buckets[j] - 1].model ) & _bucketMask;
+        //  k 在 (i, j] 之間的話，j 不能往前移到 i
+        BOOL stay = i <= j ? ( i < k && k <= j ) : ( i < k || k <= j );
+        if ( stay ) {
+            continue;
+        }
+        _buckets[i] = _buckets[j];
+        _buckets[j] = 0;
+        i = j;
+    }
+}
+
+- (void)growBucketsIfNeeded
+{
+    NSUInteger bucketCount = _bucketMask + 1;
+    if ( ( _count + 1 ) * 2 <= bucketCount ) {
+        return;
+    }
+    free( _buckets );
+    bucketCount <<= 1;
+    _buckets = calloc( bucketCount, sizeof(uint32_t) );
+    _bucketMask = bucketCount - 1;
+    for ( NSUInteger slot=0; slot<_entryCount; slot++ ) {
+        if ( _entries[slot].model ) {
+            [self insertBucketOfSlot:slot];
+        }
+    }
+}
+
+#pragma mark - Slot
+
+- (NSUInteger)slotOfModel:(id)model
+{
+    if ( model == nil ) {
+        return NSNotFound;
+    }
+    uint32_t bucket = _buckets[[self bucketOfModel:model]];
+    return bucket ? bucket - 1 : NSNotFound;
+}
+
+- (NSUInteger)addModel:(id)model
+{
+    NSUInteger slot = [self slotOfModel:model];
+    if ( slot != NSNotFound ) {
+        return slot;
+    }
+    [self growBucketsIfNeeded];
+    if ( _freeCount > 0 ) {
+        slot = _freeSlots[--_freeCount];
+    }
+    else {
+        if ( _entryCount == _entryCapacity ) {
+            _entryCapacity *= 2;
+            _entries = realloc( _entries, _entryCapacity * sizeof(KHPairEntry) );
+            memset( _entries + _entryCount, 0, ( _entryCapacity - _entryCount ) * sizeof(KHPairEntry) );
+        }
+        slot = _entryCount++;
+    }
+    KHPairEntry *entry = &_entries[slot];
+    entry->model = model;
+    entry->flags = KHPairFlagObserveModel;
+    entry->generation = _generation;
+    [self insertBucketOfSlot:slot];
+    _count++;
+    return slot;
+}
+
+- (void)removeSlot:(NSUInteger)slot
+{
+    KHPairEntry *entry = &_entries[slot];
+    if ( entry->model == nil ) {
+        return;
+    }
+    [self removeBucketOfSlot:slot];
+    if ( entry->flags & KHPairFlagHasUserInfo ) {
+        [_userInfos removeObjectForKey:@(slot)];
+    }
+    if ( entry->flags & KHPairFlagHasImageURLs ) {
+        [_imageURLs removeObjectForKey:@(slot)];
+    }
+    [_facades removeObjectForKey:@(slot)];
+    memset( entry, 0, sizeof(KHPairEntry) );
+
+    if ( _freeCount == _freeCapacity ) {
+        _freeCapacity = MAX( _freeCapacity * 2, 16 );
+        _freeSlots = realloc( _freeSlots, _freeCapacity * sizeof(uint32_t) );
+    }
+    _freeSlots[_freeCount++] = (uint32_t)slot;
+    _count--;
+}
+
+- (void)moveSlot:(NSUInteger)slot toModel:(id)model
+{
+    if ( _entries[slot].model == model ) {
+        return;
+    }
+    NSUInteger existSlot = [self slotOfModel:model];
+    if ( existSlot != NSNotFound ) {
+        [self removeSlot:existSlot];
+    }
+    [self removeBucketOfSlot:slot];
+    _entries[slot].model = model;
+    [self insertBucketOfSlot:slot];
+}
+
+//  entry 是連續的，直接掃過去
+- (NSUInteger)slotOfCell:(id)cell
+{
+    if ( cell == nil ) {
+        return NSNotFound;
+    }
+    for ( NSUInteger slot=0; slot<_entryCount; slot++ ) {
+        if ( _entries[slot].cell == cell && _entries[slot].model ) {
+            return slot;
+        }
+    }
+    return NSNotFound;
+}
+
+- (void)enumerateModelsUsingBlock:(void(^)(id model, NSUInteger slot, BOOL *stop))block
+{
+    BOOL stop = NO;
+    for ( NSUInteger slot=0; slot<_entryCount && !stop; slot++ ) {
+        id model = _entries[slot].model;
+        if ( model ) {
+            block( model, slot, &stop );
+        }
+    }
+}
+
+#pragma mark - State
+
+- (id)modelAtSlot:(NSUInteger)slot
+{
+    return _entries[slot].model;
+}
+
+- (id)cellAtSlot:(NSUInteger)slot
+{
+    return _entries[slot].cell;
+}
+
+- (void)setCell:(id)cell atSlot:(NSUInteger)slot
+{
+    _entries[slot].cell = cell;
+}
+
+- (double)widthAtSlot:(NSUInteger)slot
+{
+    return _entries[slot].width;
+}
+
+- (double)heightAtSlot:(NSUInteger)slot
+{
+    return _entries[slot].height;
+}
+
+- (void)setWidth:(double)width height:(double)height atSlot:(NSUInteger)slot
+{
+    _entries[slot].width = width;
+    _entries[slot].height = height;
+}
+
+- (NSString*)cellNameAtSlot:(NSUInteger)slot
+{
+    uint32_t index = _entries[slot].cellName;
+    return index ? _cellNames[index - 1] : nil;
+}
+
+- (void)setCellName:(NSString*)cellName atSlot:(NSUInteger)slot
+{
+    if ( cellName == nil ) {
+        _entries[slot].cellName = 0;
+        return;
+    }
+    NSNumber *index = _cellNameIndexes[cellName];
+    if ( index == nil ) {
+        [_cellNames addObject:[cellName copy]];
+        index = @(_cellNames.count);
+        _cellNameIndexes[_cellNames.lastObject] = index;
+    }
+    _entries[slot].cellName = [index unsignedIntValue];
+}
+
+- (KHPairFlags)flagsAtSlot:(NSUInteger)slot
+{
+    return _entries[slot].flags;
+}
+
+- (void)setFlags:(KHPairFlags)flags atSlot:(NSUInteger)slot
+{
+    //  HasUserInfo、HasImageURLs 由 setUserInfo:、setImageURLs: 管理
+    KHPairFlags managed = KHPairFlagHasUserInfo | KHPairFlagHasImageURLs;
+    _entries[slot].flags = ( flags & ~managed ) | ( _entries[slot].flags & managed );
+}
+
+- (uint32_t)generationAtSlot:(NSUInteger)slot
+{
+    return _entries[slot].generation;
+}
+
+- (void)setGeneration:(uint32_t)generation atSlot:(NSUInteger)slot
+{
+    _entries[slot].generation = generation;
+}
+
+- (id)userInfoForKey:(id)key atSlot:(NSUInteger)slot
+{
+    if ( !( _entries[slot].flags & KHPairFlagHasUserInfo ) ) {
+        return nil;
+    }
+    return _userInfos[@(slot)][key];
+}
+
+- (void)setUserInfo:(id)value forKey:(id<NSCopying>)key atSlot:(NSUInteger)slot
+{
+    NSMutableDictionary *userInfo = nil;
+    if ( _entries[slot].flags & KHPairFlagHasUserInfo ) {
+        userInfo = _userInfos[@(slot)];
+    }
+    else {
+        if ( value == nil ) {
+            return;
+        }
+        userInfo = [[NSMutableDictionary alloc] initWithCapacity: 1 ];
+        _userInfos[@(slot)] = userInfo;
+        _entries[slot].flags |= KHPairFlagHasUserInfo;
+    }
+    if ( value ) {
+        userInfo[key] = value;
+    }
+    else {
+        [userInfo removeObjectForKey:key];
+    }
+}
+
+- (NSDictionary*)userInfoAtSlot:(NSUInteger)slot
+{
+    if ( !( _entries[slot].flags & KHPairFlagHasUserInfo ) ) {
+        return nil;
+    }
+    return _userInfos[@(slot)];
+}
+
+- (NSArray<NSString*>*)imageURLsAtSlot:(NSUInteger)slot
+{
+    if ( !( _entries[slot].flags & KHPairFlagHasImageURLs ) ) {
+        return nil;
+    }
+    return _imageURLs[@(slot)];
+}
+
+- (void)setImageURLs:(NSArray<NSString*>*)imageURLs atSlot:(NSUInteger)slot
+{
+    if ( imageURLs ) {
+        _imageURLs[@(slot)] = [imageURLs copy];
+        _entries[slot].flags |= KHPairFlagHasImageURLs;
+    }
+    else if ( _entries[slot].flags & KHPairFlagHasImageURLs ) {
+        [_imageURLs removeObjectForKey:@(slot)];
+        _entries[slot].flags &= ~KHPairFlagHasImageURLs;
+    }
+}
+
+#pragma mark - Facade
+
+- (id)facadeAtSlot:(NSUInteger)slot
+{
+    return [_facades objectForKey:@(slot)];
+}
+
+- (void)setFacade:(id)facade atSlot:(NSUInteger)slot
+{
+    if ( facade ) {
+        [_facades setObject:facade forKey:@(slot)];
+    }
+    else {
+        [_facades removeObjectForKey:@(slot)];
+    }
+}
+
+#pragma mark - Memory
+
+- (size_t)bytesUsed
+{
+    return _entryCapacity * sizeof(KHPairEntry) + ( _bucketMask + 1 ) * sizeof(uint32_t) + _freeCapacity * sizeof(uint32_t);
+}
+
+@end
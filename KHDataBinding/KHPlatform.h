@@ -0,0 +1,43 @@
+//
+//  KHPlatform.h
+//
+//  Created by Calvin Huang on 2017/3/10.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ *  讓不需要 UIKit 的部分 (KHBindingCore、KVCModel、NSMutableArray+KHSwizzle) 可以在 Linux 上用 GNUstep 編譯
+ *  見 Benchmark/
+ */
+
+#if __has_include(<UIKit/UIKit.h>)
+#import <UIKit/UIKit.h>
+#define KH_HAS_UIKIT 1
+#else
+#define KH_HAS_UIKIT 0
+#endif
+
+//  NSMutableArray 是 class cluster，swizzle 要針對實際的 mutable array class
+#ifdef GNUSTEP
+#define KH_MUTABLE_ARRAY_CLASS_NAME @"GSMutableArray"
+#else
+#define KH_MUTABLE_ARRAY_CLASS_NAME @"__NSArrayM"
+#endif
+
+#if !KH_HAS_UIKIT
+
+//  UIKit 加在 NSIndexPath 上的 row / section
+@interface NSIndexPath (KHRowSection)
+
++ (instancetype)indexPathForRow:(NSInteger)row inSection:(NSInteger)section;
++ (instancetype)indexPathForItem:(NSInteger)item inSection:(NSInteger)section;
+
+@property (nonatomic,readonly) NSInteger section;
+@property (nonatomic,readonly) NSInteger row;
+@property (nonatomic,readonly) NSInteger item;
+
+@end
+
+#endif
@@ -0,0 +1,42 @@
+//
+//  KHPlatform.m
+//
+//  Created by Calvin Huang on 2017/3/10.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import "KHPlatform.h"
+
+#if !KH_HAS_UIKIT
+
+@implementation NSIndexPath (KHRowSection)
+
++ (instancetype)indexPathForRow:(NSInteger)row inSection:(NSInteger)section
+{
+    NSUInteger indexes[2] = { (NSUInteger)section, (NSUInteger)row };
+    return [self indexPathWithIndexes:indexes length:2];
+}
+
++ (instancetype)indexPathForItem:(NSInteger)item inSection:(NSInteger)section
+{
+    return [self indexPathForRow:item inSection:section];
+}
+
+- (NSInteger)section
+{
+    return [self indexAtPosition:0];
+}
+
+- (NSInteger)row
+{
+    return [self indexAtPosition:1];
+}
+
+- (NSInteger)item
+{
+    return [self indexAtPosition:1];
+}
+
+@end
+
+#endif
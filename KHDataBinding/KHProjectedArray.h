@@ -0,0 +1,81 @@
+//
+//  KHProjectedArray.h
+//
+//  Created by Calvin Huang on 2017/3/12.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "NSMutableArray+KHSwizzle.h"
+#import "KHSnapshotArray.h"
+
+//  即時篩選、排序的 section source
+//
+//  KHProjectedArray 顯示 source 裡符合 predicate 的 model，依 comparator 排序
+//  用 kh_addObserver: 觀察 source，source 有沒有綁定都可以
+//  source 改變時只判斷有變動的 model
+//  insert  : 判斷新的 model，有 comparator 用 binary search 插入，沒有就照 source 的順序
+//  remove  : 移除該 model 的 row
+//  update  : -[NSMutableArray update:] 或 refreshObject: 重新判斷，model 可能加入、移出或換位置
+//
+//  換 predicate 或 comparator 會全部重新判斷，但只回報最少的 row 變動
+//  model 跟 source 是同一個物件，binding 在 source 的 section 與 projection 共用 KHPairInfo (和算好的 cell size)
+//
+//  跟綁定的 NSMutableArray 一樣，只能在 main thread 呼叫
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class KHProjectedArray;
+
+//  KHDataBinding implement this to keep pair infos and the view in sync with the projection
+@protocol KHProjectedArrayObserveDelegate
+
+//  rows removed / inserted, removedIndexes are rows before the change, insertedIndexes are rows after the change
+- (void)projectedArray:(KHProjectedArray*)projectedArray didChange:(KHSnapshotChange*)change;
+
+//  a model changed its sort position
+- (void)projectedArray:(KHProjectedArray*)projectedArray didMoveObject:(id)object fromIndex:(NSUInteger)fromIndex toIndex:(NSUInteger)toIndex;
+
+//  a model changed but stays at the same row
+- (void)projectedArray:(KHProjectedArray*)projectedArray didUpdateObject:(id)object index:(NSUInteger)index;
+
+@end
+
+
+@interface KHProjectedArray : NSObject <NSFastEnumeration, KHArrayObserveDelegate>
+
+@property (nullable,nonatomic,weak) id<KHProjectedArrayObserveDelegate> kh_delegate;
+@property (nonatomic) NSInteger section;
+
+@property (nonatomic,readonly) NSMutableArray *source;
+
+//  nil 表示全部都顯示
+@property (nullable,nonatomic,copy) NSPredicate *predicate;
+
+//  nil 表示照 source 的順序，比較結果相同的也照 source 的順序
+@property (nullable,nonatomic,copy) NSComparator comparator;
+
+@property (nonatomic,readonly) NSUInteger count;
+
+- (instancetype)initWithSource:(NSMutableArray*)source predicate:(nullable NSPredicate*)predicate comparator:(nullable NSComparator)comparator;
+
+- (id)objectAtIndex:(NSUInteger)index;
+- (id)objectAtIndexedSubscript:(NSUInteger)index;
+- (NSUInteger)indexOfObjectIdenticalTo:(id)anObject;
+
+//  目前顯示的 model
+- (NSArray*)objects;
+
+//  model 的屬性變了，重新判斷是否顯示以及位置
+- (void)refreshObject:(id)model;
+
+//  全部重新判斷
+- (void)refresh;
+
+//  同時換 predicate 與 comparator，只重新判斷一次
+//  candidates 是可能符合 predicate 的 model，例如 KHSearchIndex 查到的結果，只判斷這些，不用走過整個 source；nil 表示整個 source
+- (void)setPredicate:(nullable NSPredicate*)predicate comparator:(nullable NSComparator)comparator candidates:(nullable NSArray*)candidates;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,456 @@
+//
+//  KHProjectedArray.m
+//
+//  Created by Calvin Huang on 2017/3/12.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import "KHProjectedArray.h"
+
+//  key: model pointer / value: 在 source 的 index，重覆的 model 記第一個，不 retain model
+static CFMutableDictionaryRef KHSourcePositions( NSArray *source )
+{
+    CFMutableDictionaryRef positions = CFDictionaryCreateMutable( NULL, source.count, NULL, NULL );
+    NSUInteger index = 0;
+    for ( id model in source ) {
+        const void *key = (__bridge const void*)model;
+        if ( !CFDictionaryContainsKey( positions, key ) ) {
+            CFDictionarySetValue( positions, key, (const void*)index );
+        }
+        index++;
+    }
+    return positions;
+}
+
+//  不在 source 的 model 排在最後
+static NSUInteger KHSourcePosition( CFDictionaryRef positions, id model )
+{
+    const void *value = NULL;
+    if ( CFDictionaryGetValueIfPresent( positions, (__bridge const void*)model, &value ) ) {
+        return (NSUInteger)value;
+    }
+    return NSNotFound;
+}
+
+@implementation KHProjectedArray
+{
+    //  目前顯示的 model
+    NSMutableArray *_objects;
+
+    //  _objects 裡有哪些 model，比對 pointer，不 retain
+    CFMutableBagRef _members;
+
+    //  for in 走訪時的快照，要留著，不然走訪到一半就被釋放了
+    NSArray *_enumerationSnapshot;
+}
+
+- (instancetype)initWithSource:(NSMutableArray*)source predicate:(NSPredicate*)predicate comparator:(NSComparator)comparator
+{
+    self = [super init];
+    if (self) {
+        _source = source;
+        _predicate = [predicate copy];
+        _comparator = [comparator copy];
+        _objects = [[NSMutableArray alloc] initWithCapacity: source.count ];
+        _members = CFBagCreateMutable( NULL, 0, NULL );
+        [self setObjects:[self evaluateAll]];
+        [source kh_addObserver:self];
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    [_source kh_removeObserver:self];
+    CFRelease( _members );
+}
+
+#pragma mark - Property
+
+- (void)setPredicate:(NSPredicate *)predicate
+{
+    _predicate = [predicate copy];
+    [self refresh];
+}
+
+- (void)setComparator:(NSComparator)comparator
+{
+    _comparator = [comparator copy];
+    [self refresh];
+}
+
+- (NSUInteger)count
+{
+    return _objects.count;
+}
+
+#pragma mark - Access
+
+- (id)objectAtIndex:(NSUInteger)index
+{
+    return [_objects objectAtIndex:index];
+}
+
+- (id)objectAtIndexedSubscript:(NSUInteger)index
+{
+    return [_objects objectAtIndex:index];
+}
+
+- (NSUInteger)indexOfObjectIdenticalTo:(id)anObject
+{
+    return [_objects indexOfObjectIdenticalTo:anObject];
+}
+
+- (NSArray*)objects
+{
+    return [_objects copy];
+}
+
+- (NSUInteger)countByEnumeratingWithState:(NSFastEnumerationState *)state objects:(id __unsafe_unretained [])buffer count:(NSUInteger)len
+{
+    if ( state->state == 0 ) {
+        _enumerationSnapshot = [_objects copy];
+    }
+    return [_enumerationSnapshot countByEnumeratingWithState:state objects:buffer count:len];
+}
+
+#pragma mark - Refresh
+
+- (void)setPredicate:(NSPredicate*)predicate comparator:(NSComparator)comparator candidates:(NSArray*)candidates
+{
+    _predicate = [predicate copy];
+    _comparator = [comparator copy];
+    [self refreshWithObjects:candidates ? [self evaluateObjects:candidates] : [self evaluateAll]];
+}
+
+- (void)refresh
+{
+    [self refreshWithObjects:[self evaluateAll]];
+}
+
+- (void)refreshWithObjects:(NSArray*)newObjects
+{
+    NSArray *oldObjects = [_objects copy];
+    [self setObjects:newObjects];
+
+    KHSnapshotChange *change = [KHSnapshotChange changeFrom:oldObjects to:newObjects];
+    [self notifyChange:change];
+}
+
+- (void)refreshObject:(id)model
+{
+    NSUInteger oldIndex = CFBagContainsValue( _members, (__bridge const void*)model ) ? [_objects indexOfObjectIdenticalTo:model] : NSNotFound;
+    BOOL inSource = [_source indexOfObjectIdenticalTo:model] != NSNotFound;
+    BOOL passed = inSource && [self evaluate:model];
+
+    if ( oldIndex == NSNotFound ) {
+        if ( passed ) {
+            [self insertObjects:@[model] sourceIndexes:@[@([_source indexOfObjectIdenticalTo:model])]];
+        }
+        return;
+    }
+    if ( !passed ) {
+        [self removeObjectsAtIndexes:[NSIndexSet indexSetWithIndex:oldIndex]];
+        return;
+    }
+    if ( _comparator == nil ) {
+        [self.kh_delegate projectedArray:self didUpdateObject:model index:oldIndex];
+        return;
+    }
+
+    //  sort key 可能改了，拿出來重新找位置
+    [_objects removeObjectAtIndex:oldIndex];
+    CFMutableDictionaryRef positions = NULL;
+    NSUInteger newIndex = [self sortedIndexOfObject:model sourceIndex:[_source indexOfObjectIdenticalTo:model] positions:&positions];
+    if ( positions ) {
+        CFRelease( positions );
+    }
+    [_objects insertObject:model atIndex:newIndex];
+    if ( newIndex == oldIndex ) {
+        [self.kh_delegate projectedArray:self didUpdateObject:model index:newIndex];
+    }
+    else{
+        [self.kh_delegate projectedArray:self didMoveObject:model fromIndex:oldIndex toIndex:newIndex];
+    }
+}
+
+#pragma mark - Evaluate
+
+- (BOOL)evaluate:(id)model
+{
+    return _predicate == nil || [_predicate evaluateWithObject:model];
+}
+
+- (NSArray*)evaluateAll
+{
+    return [self evaluateObjects:_source];
+}
+
+- (NSArray*)evaluateObjects:(NSArray*)candidates
+{
+    NSArray *objects = _predicate ? [candidates filteredArrayUsingPredicate:_predicate] : [candidates copy];
+    if ( _comparator == nil ) {
+        return objects;
+    }
+    if ( candidates == _source ) {
+        //  stable，比較結果相同的保持 source 的順序
+        return [objects sortedArrayWithOptions:NSSortStable usingComparator:_comparator];
+    }
+    //  candidates 的順序不一定跟 source 一樣，比較結果相同的用 source 的 index 決定
+    CFMutableDictionaryRef positions = KHSourcePositions( _source );
+    NSComparator comparator = _comparator;
+    objects = [objects sortedArrayUsingComparator:^NSComparisonResult(id obj1, id obj2) {
+        NSComparisonResult result = comparator( obj1, obj2 );
+        if ( result != NSOrderedSame ) {
+            return result;
+        }
+        NSUInteger position1 = KHSourcePosition( positions, obj1 );
+        NSUInteger position2 = KHSourcePosition( positions, obj2 );
+        return position1 < position2 ? NSOrderedAscending : ( position1 > position2 ? NSOrderedDescending : NSOrderedSame );
+    }];
+    CFRelease( positions );
+    return objects;
+}
+
+//  binary search，比較結果相同的依 source 的順序，跟整個重新排序的結果一樣
+//  positions 是 source 的位置表，遇到相同的才建立，同一批插入可以共用，由呼叫的一方 release
+- (NSUInteger)sortedIndexOfObject:(id)model sourceIndex:(NSUInteger)sourceIndex positions:(CFMutableDictionaryRef*)positions
+{
+    NSUInteger low = 0;
+    NSUInteger high = _objects.count;
+    while ( low < high ) {
+        NSUInteger mid = low + ( high - low ) / 2;
+        id object = _objects[mid];
+        NSComparisonResult result = _comparator( object, model );
+        if ( result == NSOrderedSame ) {
+            if ( *positions == NULL ) {
+                *positions = KHSourcePositions( _source );
+            }
+            result = KHSourcePosition( *positions, object ) > sourceIndex ? NSOrderedDescending : NSOrderedAscending;
+        }
+        if ( result == NSOrderedDescending ) {
+            high = mid;
+        }
+        else{
+            low = mid + 1;
+        }
+    }
+    return low;
+}
+
+//  沒有 comparator 時，依 source 的順序找位置：往前找到第一個有顯示的 model，排在它後面
+- (NSUInteger)unsortedIndexOfSourceIndex:(NSUInteger)sourceIndex
+{
+    for ( NSInteger i=(NSInteger)sourceIndex-1; i>=0; i-- ) {
+        id model = _source[i];
+        if ( !CFBagContainsValue( _members, (__bridge const void*)model ) ) {
+            continue;
+        }
+        //  最常見的是加在最後面
+        if ( _objects.lastObject == model ) {
+            return _objects.count;
+        }
+        return [_objects indexOfObjectIdenticalTo:model] + 1;
+    }
+    return 0;
+}
+
+- (void)setObjects:(NSArray*)objects
+{
+    [_objects setArray:objects];
+    CFBagRemoveAllValues( _members );
+    for ( id model in objects ) {
+        CFBagAddValue( _members, (__bridge const void*)model );
+    }
+}
+
+#pragma mark - Change
+
+//  sourceIndexes 是 model 在 source 的位置，依遞增排列
+- (void)insertObjects:(NSArray*)models sourceIndexes:(NSArray*)sourceIndexes
+{
+    NSMutableArray *insertedObjects = [[NSMutableArray alloc] initWithCapacity: models.count ];
+    NSUInteger lastIndex = NSNotFound;
+    CFMutableDictionaryRef positions = NULL;
+    for ( NSUInteger i=0; i<models.count; i++ ) {
+        id model = models[i];
+        if ( ![self evaluate:model] ) {
+            continue;
+        }
+        NSUInteger sourceIndex = [sourceIndexes[i] unsignedIntegerValue];
+        NSUInteger index = _comparator ? [self sortedIndexOfObject:model sourceIndex:sourceIndex positions:&positions] : [self unsortedIndexOfSourceIndex:sourceIndex];
+        [_objects insertObject:model atIndex:index];
+        CFBagAddValue( _members, (__bridge const void*)model );
+        [insertedObjects addObject:model];
+        lastIndex = index;
+    }
+    if ( positions ) {
+        CFRelease( positions );
+    }
+    if ( insertedObjects.count == 0 ) {
+        return;
+    }
+
+    //  全部插完再找 row，不用每插一個就調整之前的 row
+    NSMutableIndexSet *insertedIndexes = [[NSMutableIndexSet alloc] init];
+    if ( insertedObjects.count == 1 ) {
+        [insertedIndexes addIndex:lastIndex];
+    }
+    else{
+        CFMutableBagRef inserting = CFBagCreateMutable( NULL, insertedObjects.count, NULL );
+        for ( id model in insertedObjects ) {
+            CFBagAddValue( inserting, (__bridge const void*)model );
+        }
+        for ( NSUInteger i=0; i<_objects.count && CFBagGetCount( inserting ) > 0; i++ ) {
+            const void *model = (__bridge const void*)_objects[i];
+            if ( CFBagContainsValue( inserting, model ) ) {
+                CFBagRemoveValue( inserting, model );
+                [insertedIndexes addIndex:i];
+            }
+        }
+        CFRelease( inserting );
+    }
+    KHSnapshotChange *change = [[KHSnapshotChange alloc] initWithRemovedObjects:@[] indexes:[NSIndexSet indexSet]
+                                                                insertedObjects:insertedObjects indexes:insertedIndexes
+                                                                       oldCount:_objects.count - insertedObjects.count];
+    [self notifyChange:change];
+}
+
+- (void)removeObjectsAtIndexes:(NSIndexSet*)indexes
+{
+    if ( indexes.count == 0 ) {
+        return;
+    }
+    NSArray *removedObjects = [_objects objectsAtIndexes:indexes];
+    NSUInteger oldCount = _objects.count;
+    [_objects removeObjectsAtIndexes:indexes];
+    for ( id model in removedObjects ) {
+        CFBagRemoveValue( _members, (__bridge const void*)model );
+    }
+    KHSnapshotChange *change = [[KHSnapshotChange alloc] initWithRemovedObjects:removedObjects indexes:indexes
+                                                                insertedObjects:@[] indexes:[NSIndexSet indexSet]
+                                                                       oldCount:oldCount];
+    [self notifyChange:change];
+}
+
+- (void)removeSourceObjects:(NSArray*)models
+{
+    NSMutableIndexSet *indexes = [[NSMutableIndexSet alloc] init];
+    if ( models.count == 1 ) {
+        id model = models.firstObject;
+        if ( CFBagContainsValue( _members, (__bridge const void*)model ) ) {
+            NSUInteger index = [self indexOfRemovedObject:model];
+            if ( index != NSNotFound ) {
+                [indexes addIndex:index];
+            }
+        }
+    }
+    else{
+        //  一次走過全部，bag 記著每個 model 還要移除幾個
+        CFMutableBagRef removing = CFBagCreateMutable( NULL, models.count, NULL );
+        for ( id model in models ) {
+            if ( CFBagContainsValue( _members, (__bridge const void*)model ) ) {
+                CFBagAddValue( removing, (__bridge const void*)model );
+            }
+        }
+        if ( CFBagGetCount( removing ) > 0 ) {
+            for ( NSUInteger i=0; i<_objects.count; i++ ) {
+                const void *model = (__bridge const void*)_objects[i];
+                if ( CFBagContainsValue( removing, model ) ) {
+                    CFBagRemoveValue( removing, model );
+                    [indexes addIndex:i];
+                }
+            }
+        }
+        CFRelease( removing );
+    }
+    [self removeObjectsAtIndexes:indexes];
+}
+
+//  有 comparator 時先用 binary search 找，sort key 被改過的話找不到，再從頭找
+- (NSUInteger)indexOfRemovedObject:(id)model
+{
+    if ( _comparator ) {
+        NSUInteger low = 0;
+        NSUInteger high = _objects.count;
+        while ( low < high ) {
+            NSUInteger mid = low + ( high - low ) / 2;
+            if ( _comparator( _objects[mid], model ) == NSOrderedAscending ) {
+                low = mid + 1;
+            }
+            else{
+                high = mid;
+            }
+        }
+        for ( NSUInteger i=low; i<_objects.count && _comparator( _objects[i], model ) == NSOrderedSame; i++ ) {
+            if ( _objects[i] == model ) {
+                return i;
+            }
+        }
+    }
+    return [_objects indexOfObjectIdenticalTo:model];
+}
+
+- (void)notifyChange:(KHSnapshotChange*)change
+{
+    if ( [change isEmpty] ) {
+        return;
+    }
+    [self.kh_delegate projectedArray:self didChange:change];
+}
+
+#pragma mark - Source Observe
+
+//  插入
+-(void)arrayInsert:(NSMutableArray*)array insertObject:(id)object index:(NSIndexPath*)index
+{
+    [self insertObjects:@[object] sourceIndexes:@[@(index.row)]];
+}
+
+//  插入多項
+-(void)arrayInsertSome:(NSMutableArray *)array insertObjects:(NSArray *)objects indexes:(NSArray *)indexes
+{
+    NSMutableArray *sourceIndexes = [[NSMutableArray alloc] initWithCapacity: indexes.count ];
+    for ( NSIndexPath *index in indexes ) {
+        [sourceIndexes addObject:@(index.row)];
+    }
+    [self insertObjects:objects sourceIndexes:sourceIndexes];
+}
+
+//  刪除
+-(void)arrayRemove:(NSMutableArray*)array removeObject:(id)object index:(NSIndexPath*)index
+{
+    [self removeSourceObjects:@[object]];
+}
+
+//  刪除多項
+-(void)arrayRemoveSome:(NSMutableArray *)array removeObjects:(NSArray *)objects indexs:(NSArray *)indexs
+{
+    //  source 全部清掉了
+    if ( array.count == 0 ) {
+        [self removeObjectsAtIndexes:[NSIndexSet indexSetWithIndexesInRange:NSMakeRange(0, _objects.count)]];
+        return;
+    }
+    [self removeSourceObjects:objects];
+}
+
+//  取代
+-(void)arrayReplace:(NSMutableArray*)array newObject:(id)newObj replacedObject:(id)oldObj index:(NSIndexPath*)index
+{
+    [self removeSourceObjects:@[oldObj]];
+    [self insertObjects:@[newObj] sourceIndexes:@[@(index.row)]];
+}
+
+//  更新
+- (void)arrayUpdate:(NSMutableArray *)array update:(id)object index:(NSIndexPath *)index
+{
+    [self refreshObject:object];
+}
+
+//  更新全部
+- (void)arrayUpdateAll:(NSMutableArray *)array
+{
+    [self refresh];
+}
+
+@end
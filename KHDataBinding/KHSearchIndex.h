@@ -0,0 +1,61 @@
+//
+//  KHSearchIndex.h
+//
+//  Created by Calvin Huang on 2017/3/12.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "NSMutableArray+KHSwizzle.h"
+#import "KHProjectedArray.h"
+
+//  source array 的增量搜尋 index
+//
+//  每打一個字就 filter 整個大 array，要走過每個 model 的每個字串 property
+//  KHSearchIndex 改用 gram 對 model 的 inverted index
+//  prefix  : 每個字開頭的一、兩個字元，給少於三個字元的 query 用
+//  trigram : 每個字每三個字元，長的 query 只看有全部 trigram 的 model
+//
+//  字串不分大小寫、重音、全半形，用非英數字元切成字
+//  query 的每個字都要符合，符合欄位開頭的分數最高，再來是字的開頭、字的中間，前面的 key path 也比較高
+//
+//  用 kh_addObserver: 觀察 source，用 KVO 觀察每個 model 要建立 index 的 key path，
+//  新增、移除、property 改變都只重建那一個 model
+//  buildWithCompletion: 在背景 queue 建立 index，model 也在背景讀取，build 期間的變動等 build 完再補上
+//  model 沒有的 key path 當作沒有值，不會丟 exception，也不會註冊 KVO
+//  其他 method 都只能在 main thread 呼叫
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface KHSearchIndex : NSObject <KHArrayObserveDelegate>
+
+@property (nonatomic,readonly) NSMutableArray *source;
+
+//  nil 表示每個 model 的 class 裡所有 NSString 的 property
+@property (nullable,nonatomic,readonly) NSArray<NSString*> *keyPaths;
+
+//  第一次 build 完成之後才是 YES，在那之前 search: 回傳空的 array
+@property (nonatomic,readonly) BOOL isReady;
+
+//  已經建立 index 的 model 數量
+@property (nonatomic,readonly) NSUInteger count;
+
+- (instancetype)initWithSource:(NSMutableArray*)source keyPaths:(nullable NSArray<NSString*>*)keyPaths;
+
+//  在背景 queue 重建 index，completion 在 main thread 呼叫
+- (void)buildWithCompletion:(nullable void(^)(void))completion;
+
+//  依分數排序的結果，query 是空的回傳空的 array
+- (NSArray*)search:(NSString*)query;
+- (NSArray*)search:(NSString*)query limit:(NSUInteger)limit;
+
+//  model 對 query 的分數，0 表示不符合
+- (NSInteger)scoreOfObject:(id)model query:(NSString*)query;
+
+//  把 query 的結果顯示在 projection，projection 的 source 要是同一個 array，query 是空的就顯示全部
+//  之後 source 或 model 的變動也會反應到 projection，直到換下一個 query
+- (void)applyQuery:(nullable NSString*)query toProjectedArray:(KHProjectedArray*)projectedArray;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,789 @@
+//
+//  KHSearchIndex.m
+//
+//  Created by Calvin Huang on 2017/3/12.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import "KHSearchIndex.h"
+#import "KHDataBinding.h"
+
+static void *KHSearchIndexKVOContext = &KHSearchIndexKVOContext;
+
+//  分數：query 的每個字取最好的一種比對，再加上 key path 的順序
+static const NSInteger kKHSearchFieldStart = 3;
+static const NSInteger kKHSearchWordStart  = 2;
+static const NSInteger kKHSearchWordMiddle = 1;
+static const NSInteger kKHSearchKindWeight = 64;
+
+static NSCharacterSet *KHSearchSeparators( void )
+{
+    static NSCharacterSet *separators = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        separators = [[NSCharacterSet alphanumericCharacterSet] invertedSet];
+    });
+    return separators;
+}
+
+//  轉成比對用的字串：不分大小寫、重音、全半形，字與字之間只留一個空白
+static NSString *KHSearchNormalize( NSString *string )
+{
+    NSString *folded = [string stringByFoldingWithOptions:NSCaseInsensitiveSearch|NSDiacriticInsensitiveSearch|NSWidthInsensitiveSearch locale:nil];
+    NSMutableArray *words = [[NSMutableArray alloc] init];
+    for ( NSString *word in [folded componentsSeparatedByCharactersInSet:KHSearchSeparators()] ) {
+        if ( word.length > 0 ) {
+            [words addObject:word];
+        }
+    }
+    return [words componentsJoinedByString:@" "];
+}
+
+static NSArray *KHSearchWords( NSString *normalized )
+{
+    return normalized.length > 0 ? [normalized componentsSeparatedByString:@" "] : @[];
+}
+
+//  開頭一、兩個字給短的 query 用，"^" 開頭，其他是 trigram
+static void KHSearchAddGrams( NSString *word, NSMutableSet *grams )
+{
+    NSUInteger length = word.length;
+    [grams addObject:[@"^" stringByAppendingString:[word substringToIndex:1]]];
+    if ( length >= 2 ) {
+        [grams addObject:[@"^" stringByAppendingString:[word substringToIndex:2]]];
+    }
+    for ( NSUInteger i=0; i+3<=length; i++ ) {
+        [grams addObject:[word substringWithRange:NSMakeRange(i, 3)]];
+    }
+}
+
+//  query 的字要找哪些 gram，短的字找開頭，長的字要有全部的 trigram
+static NSArray *KHSearchQueryGrams( NSString *word )
+{
+    if ( word.length <= 2 ) {
+        return @[ [@"^" stringByAppendingString:word] ];
+    }
+    NSMutableSet *grams = [[NSMutableSet alloc] init];
+    for ( NSUInteger i=0; i+3<=word.length; i++ ) {
+        [grams addObject:[word substringWithRange:NSMakeRange(i, 3)]];
+    }
+    return [grams allObjects];
+}
+
+static NSArray *KHSearchWordStarts( NSArray *words )
+{
+    NSMutableArray *wordStarts = [[NSMutableArray alloc] initWithCapacity: words.count ];
+    for ( NSString *word in words ) {
+        [wordStarts addObject:[@" " stringByAppendingString:word]];
+    }
+    return wordStarts;
+}
+
+
+#pragma mark - KHSearchRecord
+
+//  一個 model 建好的 index 資料
+@interface KHSearchRecord : NSObject
+
+@property (nonatomic) id model;
+@property (nonatomic) NSUInteger slot;
+
+//  每個 key path 正規化之後的字串，沒有值或讀不到的是空字串
+@property (nonatomic) NSArray<NSString*> *fields;
+@property (nonatomic) NSArray<NSString*> *grams;
+
+//  model 讀得到的 key path，KVO 只註冊這些
+@property (nonatomic) NSArray<NSString*> *keyPaths;
+
+@end
+
+@implementation KHSearchRecord
+
+@end
+
+
+#pragma mark - KHSearchHit
+
+//  search 的一筆結果，order 是比對到的順序，同分時先比對到的在前
+typedef struct {
+    NSInteger score;
+    NSUInteger order;
+    __unsafe_unretained KHSearchRecord *record;
+} KHSearchHit;
+
+//  a 排在 b 前面
+static inline BOOL KHSearchHitBefore( KHSearchHit a, KHSearchHit b )
+{
+    return a.score != b.score ? a.score > b.score : a.order < b.order;
+}
+
+static int KHSearchHitCompare( const void *a, const void *b )
+{
+    return KHSearchHitBefore( *(const KHSearchHit*)a, *(const KHSearchHit*)b ) ? -1 : 1;
+}
+
+//  heap 的每個 parent 都排在 child 後面，heap[0] 是排最後的
+static void KHSearchHeapSiftUp( KHSearchHit *heap, NSUInteger i )
+{
+    while ( i > 0 ) {
+        NSUInteger parent = ( i - 1 ) / 2;
+        if ( !KHSearchHitBefore( heap[parent], heap[i] ) ) {
+            break;
+        }
+        KHSearchHit temp = heap[parent];
+        heap[parent] = heap[i];
+        heap[i] = temp;
+        i = parent;
+    }
+}
+
+static void KHSearchHeapSiftDown( KHSearchHit *heap, NSUInteger count, NSUInteger i )
+{
+    while ( YES ) {
+        NSUInteger last = i;
+        NSUInteger left = i * 2 + 1;
+        NSUInteger right = left + 1;
+        if ( left < count && KHSearchHitBefore( heap[last], heap[left] ) ) {
+            last = left;
+        }
+        if ( right < count && KHSearchHitBefore( heap[last], heap[right] ) ) {
+            last = right;
+        }
+        if ( last == i ) {
+            break;
+        }
+        KHSearchHit temp = heap[last];
+        heap[last] = heap[i];
+        heap[i] = temp;
+        i = last;
+    }
+}
+
+
+#pragma mark - KHSearchStorage
+
+/*
+ *  inverted index，key: gram / value: 有這個 gram 的 slot
+ *  model 用 slot 編號，比存 pointer 省記憶體，交集也快，移除的 slot 會重覆使用
+ */
+@interface KHSearchStorage : NSObject
+
+@property (nonatomic,readonly) NSUInteger count;
+
+- (nullable KHSearchRecord*)recordOfModel:(id)model;
+- (nullable KHSearchRecord*)recordAtSlot:(NSUInteger)slot;
+- (nullable NSIndexSet*)slotsOfGram:(NSString*)gram;
+- (void)addRecord:(KHSearchRecord*)record;
+- (void)removeRecord:(KHSearchRecord*)record;
+- (NSArray<KHSearchRecord*>*)allRecords;
+
+@end
+
+@implementation KHSearchStorage
+{
+    NSMutableDictionary *_postings;
+    NSMutableArray *_slots;
+    NSMutableIndexSet *_freeSlots;
+    NSMapTable *_recordOfModel;
+}
+
+- (instancetype)initWithCapacity:(NSUInteger)capacity
+{
+    self = [super init];
+    if (self) {
+        _postings = [[NSMutableDictionary alloc] init];
+        _slots = [[NSMutableArray alloc] initWithCapacity: capacity ];
+        _freeSlots = [[NSMutableIndexSet alloc] init];
+        _recordOfModel = [[NSMapTable alloc] initWithKeyOptions:NSPointerFunctionsStrongMemory|NSPointerFunctionsObjectPointerPersonality
+                                                   valueOptions:NSPointerFunctionsStrongMemory
+                                                       capacity:capacity];
+    }
+    return self;
+}
+
+- (NSUInteger)count
+{
+    return _recordOfModel.count;
+}
+
+- (KHSearchRecord*)recordOfModel:(id)model
+{
+    return [_recordOfModel objectForKey:model];
+}
+
+- (KHSearchRecord*)recordAtSlot:(NSUInteger)slot
+{
+    id record = _slots[slot];
+    return record == [NSNull null] ? nil : record;
+}
+
+- (NSIndexSet*)slotsOfGram:(NSString*)gram
+{
+    return _postings[gram];
+}
+
+- (void)addRecord:(KHSearchRecord*)record
+{
+    if ( _freeSlots.count > 0 ) {
+        record.slot = _freeSlots.firstIndex;
+        [_freeSlots removeIndex:record.slot];
+        _slots[record.slot] = record;
+    }
+    else{
+        record.slot = _slots.count;
+        [_slots addObject:record];
+    }
+    [_recordOfModel setObject:record forKey:record.model];
+    for ( NSString *gram in record.grams ) {
+        NSMutableIndexSet *slots = _postings[gram];
+        if ( !slots ) {
+            slots = [[NSMutableIndexSet alloc] init];
+            _postings[gram] = slots;
+        }
+        [slots addIndex:record.slot];
+    }
+}
+
+- (void)removeRecord:(KHSearchRecord*)record
+{
+    for ( NSString *gram in record.grams ) {
+        NSMutableIndexSet *slots = _postings[gram];
+        [slots removeIndex:record.slot];
+        if ( slots.count == 0 ) {
+            [_postings removeObjectForKey:gram];
+        }
+    }
+    _slots[record.slot] = [NSNull null];
+    [_freeSlots addIndex:record.slot];
+    [_recordOfModel removeObjectForKey:record.model];
+}
+
+- (NSArray<KHSearchRecord*>*)allRecords
+{
+    NSMutableArray *records = [[NSMutableArray alloc] initWithCapacity: _recordOfModel.count ];
+    for ( id model in _recordOfModel ) {
+        [records addObject:[_recordOfModel objectForKey:model]];
+    }
+    return records;
+}
+
+@end
+
+
+#pragma mark - KHSearchIndex
+
+@implementation KHSearchIndex
+{
+    dispatch_queue_t _queue;
+
+    //  只在 main thread 存取，build 完成時整個換掉
+    KHSearchStorage *_storage;
+
+    //  每次 build 加一，比較舊的 build 完成時直接丟掉
+    NSUInteger _buildGeneration;
+
+    //  build 期間有變動的 model，build 完成後再依 source 重建或移除，不是 nil 表示正在 build
+    NSMutableArray *_pendingModels;
+
+    //  key: class name / value: 要建立 index 的 key path，可能在背景 queue 讀取
+    NSMutableDictionary *_keyPathsOfClass;
+
+    //  目前套用在 projection 的 query
+    __weak KHProjectedArray *_projectedArray;
+    NSArray *_queryWords;
+    NSMapTable *_scoreCache;
+}
+
+- (instancetype)initWithSource:(NSMutableArray*)source keyPaths:(NSArray<NSString*>*)keyPaths
+{
+    self = [super init];
+    if (self) {
+        _source = source;
+        _keyPaths = [keyPaths copy];
+        _queue = dispatch_queue_create("KHSearchIndex", DISPATCH_QUEUE_SERIAL);
+        _storage = [[KHSearchStorage alloc] initWithCapacity:0];
+        _keyPathsOfClass = [[NSMutableDictionary alloc] init];
+        _scoreCache = [[NSMapTable alloc] initWithKeyOptions:NSPointerFunctionsWeakMemory|NSPointerFunctionsObjectPointerPersonality
+                                                valueOptions:NSPointerFunctionsStrongMemory
+                                                    capacity:0];
+        [source kh_addObserver:self];
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    [_source kh_removeObserver:self];
+    for ( KHSearchRecord *record in [_storage allRecords] ) {
+        [self unobserveRecord:record];
+    }
+}
+
+- (NSUInteger)count
+{
+    return _storage.count;
+}
+
+#pragma mark - Build
+
+- (void)buildWithCompletion:(void(^)(void))completion
+{
+    NSArray *snapshot = [_source copy];
+    NSUInteger generation = ++_buildGeneration;
+    if ( !_pendingModels ) {
+        _pendingModels = [[NSMutableArray alloc] init];
+    }
+    void(^completionBlock)(void) = [completion copy];
+    dispatch_async( _queue, ^{
+        KHSearchStorage *storage = [[KHSearchStorage alloc] initWithCapacity:snapshot.count];
+        for ( id model in snapshot ) {
+            if ( [storage recordOfModel:model] ) {
+                continue;
+            }
+            KHSearchRecord *record = [self recordForModel:model];
+            [storage addRecord:record];
+            [self observeRecord:record];
+        }
+        dispatch_async( dispatch_get_main_queue(), ^{
+            [self finishBuild:storage generation:generation];
+            if ( completionBlock ) {
+                completionBlock();
+            }
+        });
+    });
+}
+
+- (void)finishBuild:(KHSearchStorage*)storage generation:(NSUInteger)generation
+{
+    //  之後又 build 過，這份已經舊了
+    if ( generation != _buildGeneration ) {
+        [self unobserveStorageInBackground:storage];
+        return;
+    }
+    KHSearchStorage *oldStorage = _storage;
+    _storage = storage;
+    _isReady = YES;
+    [self unobserveStorageInBackground:oldStorage];
+
+    //  build 期間的變動，依現在的 source 補上
+    NSArray *pendingModels = _pendingModels;
+    _pendingModels = nil;
+    if ( pendingModels.count > 0 ) {
+        NSHashTable *members = [[NSHashTable alloc] initWithOptions:NSPointerFunctionsObjectPointerPersonality capacity: _source.count ];
+        for ( id model in _source ) {
+            [members addObject:model];
+        }
+        for ( id model in pendingModels ) {
+            if ( [members containsObject:model] ) {
+                [self applyIndexModel:model];
+            }
+            else{
+                [self applyRemoveModel:model];
+            }
+        }
+    }
+
+    //  結果可能變了，重新套用 query
+    KHProjectedArray *projectedArray = _projectedArray;
+    if ( projectedArray && _queryWords.count > 0 ) {
+        [self applyQueryWords:_queryWords toProjectedArray:projectedArray];
+    }
+}
+
+- (void)unobserveStorageInBackground:(KHSearchStorage*)storage
+{
+    if ( storage.count == 0 ) {
+        return;
+    }
+    dispatch_async( _queue, ^{
+        for ( KHSearchRecord *record in [storage allRecords] ) {
+            [self unobserveRecord:record];
+        }
+    });
+}
+
+#pragma mark - Record
+
+//  可能在背景 queue 呼叫
+- (NSArray*)keyPathsOfModel:(id)model
+{
+    if ( _keyPaths ) {
+        return _keyPaths;
+    }
+    NSString *className = NSStringFromClass( [model class] );
+    @synchronized( _keyPathsOfClass ) {
+        NSArray *keyPaths = _keyPathsOfClass[className];
+        if ( !keyPaths ) {
+            keyPaths = [KVCModel stringPropertyNamesOfClass:[model class]];
+            _keyPathsOfClass[className] = keyPaths;
+        }
+        return keyPaths;
+    }
+}
+
+//  可能在背景 queue 呼叫，key path 不存在的話 valueForKeyPath: 會丟 exception，那個欄位當作沒有值
+- (KHSearchRecord*)recordForModel:(id)model
+{
+    NSArray *keyPaths = [self keyPathsOfModel:model];
+    NSMutableArray *fields = [[NSMutableArray alloc] initWithCapacity: keyPaths.count ];
+    NSMutableArray *validKeyPaths = [[NSMutableArray alloc] initWithCapacity: keyPaths.count ];
+    NSMutableSet *grams = [[NSMutableSet alloc] init];
+    for ( NSString *keyPath in keyPaths ) {
+        id value = nil;
+        @try {
+            value = [model valueForKeyPath:keyPath];
+            [validKeyPaths addObject:keyPath];
+        }
+        @catch (NSException *exception) {
+            value = nil;
+        }
+        if ( ![value isKindOfClass:[NSString class]] ) {
+            value = [value respondsToSelector:@selector(stringValue)] ? [value stringValue] : nil;
+        }
+        NSString *field = value ? KHSearchNormalize( value ) : @"";
+        [fields addObject:field];
+        for ( NSString *word in KHSearchWords( field ) ) {
+            KHSearchAddGrams( word, grams );
+        }
+    }
+    KHSearchRecord *record = [[KHSearchRecord alloc] init];
+    record.model = model;
+    record.fields = fields;
+    record.grams = [grams allObjects];
+    record.keyPaths = validKeyPaths;
+    return record;
+}
+
+- (void)observeRecord:(KHSearchRecord*)record
+{
+    for ( NSString *keyPath in record.keyPaths ) {
+        [record.model addObserver:self forKeyPath:keyPath options:0 context:KHSearchIndexKVOContext];
+    }
+}
+
+- (void)unobserveRecord:(KHSearchRecord*)record
+{
+    for ( NSString *keyPath in record.keyPaths ) {
+        [record.model removeObserver:self forKeyPath:keyPath context:KHSearchIndexKVOContext];
+    }
+}
+
+//  建立或重建 model 的 index，build 期間也先更新目前的 index，build 完成後再補到新的 index
+- (void)indexModel:(id)model
+{
+    [_pendingModels addObject:model];
+    if ( _isReady ) {
+        [self applyIndexModel:model];
+    }
+}
+
+- (void)removeModel:(id)model
+{
+    [_pendingModels addObject:model];
+    if ( _isReady ) {
+        [self applyRemoveModel:model];
+    }
+}
+
+- (void)applyIndexModel:(id)model
+{
+    KHSearchRecord *oldRecord = [_storage recordOfModel:model];
+    if ( oldRecord ) {
+        [_storage removeRecord:oldRecord];
+    }
+    KHSearchRecord *record = [self recordForModel:model];
+    [_storage addRecord:record];
+    if ( oldRecord ) {
+        //  KVO 是照舊的 record 註冊的，解除時要用一樣的 key path
+        record.keyPaths = oldRecord.keyPaths;
+    }
+    else{
+        [self observeRecord:record];
+    }
+    [_scoreCache removeObjectForKey:model];
+}
+
+- (void)applyRemoveModel:(id)model
+{
+    KHSearchRecord *record = [_storage recordOfModel:model];
+    if ( record ) {
+        [_storage removeRecord:record];
+        [self unobserveRecord:record];
+    }
+    [_scoreCache removeObjectForKey:model];
+}
+
+- (void)observeValueForKeyPath:(NSString *)keyPath ofObject:(id)object change:(NSDictionary<NSString *,id> *)change context:(void *)context
+{
+    if ( context != KHSearchIndexKVOContext ) {
+        [super observeValueForKeyPath:keyPath ofObject:object change:change context:context];
+        return;
+    }
+    if ( ![NSThread isMainThread] ) {
+        dispatch_async( dispatch_get_main_queue(), ^{
+            [self modelDidChange:object];
+        });
+        return;
+    }
+    [self modelDidChange:object];
+}
+
+- (void)modelDidChange:(id)model
+{
+    [_pendingModels addObject:model];
+    //  已經移除的 model，KVO 可能還沒在背景解除
+    if ( !_isReady || ![_storage recordOfModel:model] ) {
+        return;
+    }
+    [self applyIndexModel:model];
+    [self refreshProjectedObject:model];
+}
+
+//  projection 可能比 index 先收到變動，index 更新後再判斷一次
+- (void)refreshProjectedObject:(id)model
+{
+    KHProjectedArray *projectedArray = _projectedArray;
+    if ( projectedArray && _queryWords.count > 0 ) {
+        [projectedArray refreshObject:model];
+    }
+}
+
+#pragma mark - Search
+
+- (NSArray*)search:(NSString*)query
+{
+    return [self search:query limit:NSUIntegerMax];
+}
+
+- (NSArray*)search:(NSString*)query limit:(NSUInteger)limit
+{
+    return [self searchWords:KHSearchWords( KHSearchNormalize( query ) ) limit:limit scores:nil];
+}
+
+- (NSInteger)scoreOfObject:(id)model query:(NSString*)query
+{
+    NSArray *words = KHSearchWords( KHSearchNormalize( query ) );
+    KHSearchRecord *record = [_storage recordOfModel:model] ?: [self recordForModel:model];
+    return [self scoreOfRecord:record words:words];
+}
+
+- (NSArray*)searchWords:(NSArray*)words limit:(NSUInteger)limit scores:(NSMapTable*)scores
+{
+    if ( !_isReady || words.count == 0 || limit == 0 ) {
+        return @[];
+    }
+
+    //  所有字的 gram 都要有，從最少的開始交集
+    NSMutableArray *slotSets = [[NSMutableArray alloc] init];
+    for ( NSString *word in words ) {
+        for ( NSString *gram in KHSearchQueryGrams( word ) ) {
+            NSIndexSet *slots = [_storage slotsOfGram:gram];
+            if ( slots.count == 0 ) {
+                return @[];
+            }
+            [slotSets addObject:slots];
+        }
+    }
+    [slotSets sortUsingComparator:^NSComparisonResult(NSIndexSet *a, NSIndexSet *b) {
+        return a.count < b.count ? NSOrderedAscending : ( a.count > b.count ? NSOrderedDescending : NSOrderedSame );
+    }];
+    NSIndexSet *smallest = slotSets.firstObject;
+
+    //  有 limit 時只留 limit 個，heap 的頂端是目前排最後的
+    NSUInteger capacity = MIN( limit, smallest.count );
+    KHSearchHit *hits = malloc( capacity * sizeof(KHSearchHit) );
+    __block NSUInteger hitCount = 0;
+    __block NSUInteger order = 0;
+    NSArray *wordStarts = KHSearchWordStarts( words );
+    NSInteger maxScore = [self maxScoreOfWords:words];
+    [smallest enumerateIndexesUsingBlock:^(NSUInteger slot, BOOL *stop) {
+        for ( NSUInteger i=1; i<slotSets.count; i++ ) {
+            if ( ![slotSets[i] containsIndex:slot] ) {
+                return;
+            }
+        }
+        //  trigram 都有不代表字串相連，要再比對一次
+        KHSearchRecord *record = [_storage recordAtSlot:slot];
+        NSInteger score = [self scoreOfRecord:record words:words wordStarts:wordStarts];
+        if ( score <= 0 ) {
+            return;
+        }
+        KHSearchHit hit = { score, order++, record };
+        if ( hitCount < capacity ) {
+            hits[hitCount] = hit;
+            KHSearchHeapSiftUp( hits, hitCount++ );
+        }
+        else if ( KHSearchHitBefore( hit, hits[0] ) ) {
+            hits[0] = hit;
+            KHSearchHeapSiftDown( hits, hitCount, 0 );
+        }
+        //  留下的都是最高分，之後比對到的同分也排在後面，不用再算
+        if ( hitCount == capacity && hits[0].score >= maxScore ) {
+            *stop = YES;
+        }
+    }];
+
+    //  分數高的在前，同分的依加入 index 的順序
+    qsort( hits, hitCount, sizeof(KHSearchHit), KHSearchHitCompare );
+    NSMutableArray *results = [[NSMutableArray alloc] initWithCapacity: hitCount ];
+    for ( NSUInteger i=0; i<hitCount; i++ ) {
+        id model = hits[i].record.model;
+        [results addObject:model];
+        if ( scores ) {
+            [scores setObject:@(hits[i].score) forKey:model];
+        }
+    }
+    free( hits );
+    return results;
+}
+
+//  每個字都符合第一個欄位的開頭，keyPaths 是 nil 時每個 class 的欄位數不同，沒有上限
+- (NSInteger)maxScoreOfWords:(NSArray*)words
+{
+    if ( _keyPaths == nil ) {
+        return NSIntegerMax;
+    }
+    return words.count * ( kKHSearchFieldStart * kKHSearchKindWeight + _keyPaths.count );
+}
+
+- (NSInteger)scoreOfRecord:(KHSearchRecord*)record words:(NSArray*)words
+{
+    return [self scoreOfRecord:record words:words wordStarts:KHSearchWordStarts( words )];
+}
+
+//  wordStarts 是每個字前面加一個空白，search 時只建立一次
+- (NSInteger)scoreOfRecord:(KHSearchRecord*)record words:(NSArray*)words wordStarts:(NSArray*)wordStarts
+{
+    if ( words.count == 0 ) {
+        return 0;
+    }
+    NSInteger fieldCount = record.fields.count;
+    NSInteger total = 0;
+    for ( NSUInteger w=0; w<words.count; w++ ) {
+        NSString *word = words[w];
+        NSString *wordStart = wordStarts[w];
+        NSInteger best = 0;
+        for ( NSInteger i=0; i<fieldCount; i++ ) {
+            NSString *field = record.fields[i];
+            NSInteger kind = 0;
+            if ( [field hasPrefix:word] ) {
+                kind = kKHSearchFieldStart;
+            }
+            else if ( [field rangeOfString:wordStart].location != NSNotFound ) {
+                kind = kKHSearchWordStart;
+            }
+            //  短的字只比對開頭，跟 index 一樣
+            else if ( word.length >= 3 && [field rangeOfString:word].location != NSNotFound ) {
+                kind = kKHSearchWordMiddle;
+            }
+            if ( kind > 0 ) {
+                best = MAX( best, kind * kKHSearchKindWeight + ( fieldCount - i ) );
+            }
+        }
+        if ( best == 0 ) {
+            return 0;
+        }
+        total += best;
+    }
+    return total;
+}
+
+#pragma mark - Projection
+
+- (void)applyQuery:(NSString*)query toProjectedArray:(KHProjectedArray*)projectedArray
+{
+    _projectedArray = projectedArray;
+    _queryWords = KHSearchWords( KHSearchNormalize( query ?: @"" ) );
+    if ( _queryWords.count == 0 ) {
+        [_scoreCache removeAllObjects];
+        [projectedArray setPredicate:nil comparator:nil candidates:nil];
+        return;
+    }
+    [self applyQueryWords:_queryWords toProjectedArray:projectedArray];
+}
+
+- (void)applyQueryWords:(NSArray*)words toProjectedArray:(KHProjectedArray*)projectedArray
+{
+    [_scoreCache removeAllObjects];
+    NSArray *results = [self searchWords:words limit:NSUIntegerMax scores:_scoreCache];
+
+    //  之後 source 加入的 model 也用同一個 query 判斷，分數只算一次
+    weakRef(self);
+    NSPredicate *predicate = [NSPredicate predicateWithBlock:^BOOL(id model, NSDictionary *bindings) {
+        return [weak_self cachedScoreOfObject:model] > 0;
+    }];
+    NSComparator comparator = ^NSComparisonResult(id a, id b) {
+        NSInteger sa = [weak_self cachedScoreOfObject:a];
+        NSInteger sb = [weak_self cachedScoreOfObject:b];
+        if ( sa == sb ) {
+            return NSOrderedSame;
+        }
+        return sa > sb ? NSOrderedAscending : NSOrderedDescending;
+    };
+    [projectedArray setPredicate:predicate comparator:comparator candidates:results];
+}
+
+- (NSInteger)cachedScoreOfObject:(id)model
+{
+    NSNumber *score = [_scoreCache objectForKey:model];
+    if ( score ) {
+        return [score integerValue];
+    }
+    //  projection 可能比 index 先收到新加入的 model，還沒有 record 就直接讀 model
+    KHSearchRecord *record = [_storage recordOfModel:model] ?: [self recordForModel:model];
+    NSInteger value = [self scoreOfRecord:record words:_queryWords];
+    [_scoreCache setObject:@(value) forKey:model];
+    return value;
+}
+
+#pragma mark - Source Observe
+
+//  插入
+-(void)arrayInsert:(NSMutableArray*)array insertObject:(id)object index:(NSIndexPath*)index
+{
+    [self indexModel:object];
+}
+
+//  插入多項
+-(void)arrayInsertSome:(NSMutableArray *)array insertObjects:(NSArray *)objects indexes:(NSArray *)indexes
+{
+    for ( id object in objects ) {
+        [self indexModel:object];
+    }
+}
+
+//  刪除
+-(void)arrayRemove:(NSMutableArray*)array removeObject:(id)object index:(NSIndexPath*)index
+{
+    [self removeModel:object];
+}
+
+//  刪除多項
+-(void)arrayRemoveSome:(NSMutableArray *)array removeObjects:(NSArray *)objects indexs:(NSArray *)indexs
+{
+    for ( id object in objects ) {
+        [self removeModel:object];
+    }
+}
+
+//  取代
+-(void)arrayReplace:(NSMutableArray*)array newObject:(id)newObj replacedObject:(id)oldObj index:(NSIndexPath*)index
+{
+    [self removeModel:oldObj];
+    [self indexModel:newObj];
+}
+
+//  更新
+- (void)arrayUpdate:(NSMutableArray *)array update:(id)object index:(NSIndexPath *)index
+{
+    [self indexModel:object];
+    [self refreshProjectedObject:object];
+}
+
+//  更新全部
+- (void)arrayUpdateAll:(NSMutableArray *)array
+{
+    [self buildWithCompletion:nil];
+}
+
+@end
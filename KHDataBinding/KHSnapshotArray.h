@@ -0,0 +1,118 @@
+//
+//  KHSnapshotArray.h
+//
+//  Created by Calvin Huang on 2017/3/12.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import <UIKit/UIKit.h>
+
+//  兩份資料的 section source
+//
+//  一般 bind 的 NSMutableArray 只能在 main thread 修改
+//  KHSnapshotArray 分成兩份
+//  pending   : 用 performChanges: 在任何 thread 修改，依送出的順序在背景 serial queue 執行
+//  committed : 畫面上的資料，只在 main thread 換上
+//
+//  一批修改做完後，在背景 queue 跟上一份 snapshot 做 diff，有設定 sizeBlock 的話，新 model 的 size 也在背景算好
+//  pairInfo、KVO、cell mapping 都要碰到 binding 的狀態，在 main thread 換上 snapshot 時才建立
+//  換上 snapshot 跟畫面的 batch update 在同一次 main thread 執行，畫面不會看到改到一半的資料
+//
+//  count、objectAtIndex: 這些讀取的 method 回傳 committed 的資料，只能在 main thread 呼叫
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class KHSnapshotArray;
+
+//  the difference between two committed snapshots
+@interface KHSnapshotChange : NSObject
+
+//  rows deleted from the old snapshot / rows inserted into the new snapshot
+@property (nonatomic,readonly) NSIndexSet *removedIndexes;
+@property (nonatomic,readonly) NSIndexSet *insertedIndexes;
+
+//  models that left / entered the snapshot, each model only once, used to remove and add pairs
+@property (nonatomic,readonly) NSArray *removedObjects;
+@property (nonatomic,readonly) NSArray *insertedObjects;
+
+//  背景用 sizeBlock 算好的 size (NSValue CGSize)，順序跟 insertedObjects 一樣，沒設定 sizeBlock 時是 nil
+@property (nonatomic,readonly,nullable) NSArray<NSValue*> *preparedSizes;
+
+//  models kept in both snapshots changed their order, delete/insert can't describe it
+@property (nonatomic,readonly) BOOL isReordered;
+
+@property (nonatomic,readonly) NSUInteger oldCount;
+@property (nonatomic,readonly) NSUInteger newCount;
+
+//  diff of two arrays, models are compared by pointer
++ (instancetype)changeFrom:(NSArray*)oldArray to:(NSArray*)newArray;
+
+- (instancetype)initWithRemovedObjects:(NSArray*)removedObjects indexes:(NSIndexSet*)removedIndexes
+                       insertedObjects:(NSArray*)insertedObjects indexes:(NSIndexSet*)insertedIndexes
+                              oldCount:(NSUInteger)oldCount;
+
+- (BOOL)isEmpty;
+
+//  removedIndexes / insertedIndexes as NSIndexPath in the section
+- (NSArray<NSIndexPath*>*)removedIndexPathsInSection:(NSInteger)section;
+- (NSArray<NSIndexPath*>*)insertedIndexPathsInSection:(NSInteger)section;
+
+@end
+
+
+//  KHDataBinding implement this to add pairs and update the view on commit
+@protocol KHSnapshotArrayObserveDelegate
+
+//  called on main thread right after the committed snapshot is replaced
+- (void)snapshotArray:(KHSnapshotArray*)snapshotArray didCommitChange:(KHSnapshotChange*)change;
+
+@end
+
+
+@interface KHSnapshotArray : NSObject <NSFastEnumeration>
+
+@property (nullable,weak) id<KHSnapshotArrayObserveDelegate> kh_delegate;
+@property NSInteger section;
+
+//  count of the committed snapshot
+@property (nonatomic,readonly) NSUInteger count;
+
+//  在背景 queue 計算 cell size，有設定的話 pair 會帶著算好的 size，不用在 main thread 量 cell
+//  block 只能用 model 本身的資料，不要碰 binding 或 view
+@property (nullable,copy) CGSize(^sizeBlock)(id model);
+
+- (instancetype)initWithArray:(nullable NSArray*)array;
+
+#pragma mark - Committed snapshot (main thread)
+
+- (id)objectAtIndex:(NSUInteger)index;
+- (id)objectAtIndexedSubscript:(NSUInteger)index;
+- (NSUInteger)indexOfObjectIdenticalTo:(id)anObject;
+
+//  目前畫面上的資料
+- (NSArray*)snapshot;
+
+#pragma mark - Pending (any thread)
+
+//  修改 pending array，changes 在背景 queue 依呼叫的順序執行，不可以把 pending 留到 block 外使用
+- (void)performChanges:(void(^)(NSMutableArray *pending))changes;
+
+//  completion 在包含這次修改的 snapshot 換上之後，於 main thread 呼叫
+- (void)performChanges:(nullable void(^)(NSMutableArray *pending))changes completion:(nullable void(^)(void))completion;
+
+- (void)addObject:(id)anObject;
+- (void)addObjectsFromArray:(NSArray*)otherArray;
+- (void)insertObject:(id)anObject atIndex:(NSUInteger)index;
+- (void)removeObject:(id)anObject;
+- (void)removeObjectAtIndex:(NSUInteger)index;
+- (void)removeAllObjects;
+- (void)replaceObjectAtIndex:(NSUInteger)index withObject:(id)anObject;
+- (void)setArray:(NSArray*)otherArray;
+
+//  等目前已送出的修改都換上畫面後，在 main thread 呼叫
+- (void)notifyWhenCommitted:(void(^)(void))block;
+
+@end
+
+NS_ASSUME_NONNULL_END
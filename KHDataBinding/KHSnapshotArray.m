@@ -0,0 +1,355 @@
+//
+//  KHSnapshotArray.m
+//
+//  Created by Calvin Huang on 2017/3/12.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import "KHSnapshotArray.h"
+
+@interface KHSnapshotChange ()
+
+@property (nonatomic) NSArray *removedObjects;
+@property (nonatomic) NSIndexSet *removedIndexes;
+@property (nonatomic) NSArray *insertedObjects;
+@property (nonatomic) NSIndexSet *insertedIndexes;
+@property (nonatomic) NSArray *preparedSizes;
+@property (nonatomic) BOOL isReordered;
+@property (nonatomic) NSUInteger oldCount;
+@property (nonatomic) NSUInteger newCount;
+
+@end
+
+//  key: model pointer / value: 出現次數，不 retain model，array 還在就不會被釋放
+static CFMutableDictionaryRef KHCountObjects( NSArray *array )
+{
+    CFMutableDictionaryRef counts = CFDictionaryCreateMutable( NULL, array.count, NULL, NULL );
+    for ( id object in array ) {
+        const void *key = (__bridge const void*)object;
+        uintptr_t count = (uintptr_t)CFDictionaryGetValue( counts, key );
+        CFDictionarySetValue( counts, key, (const void*)(count + 1) );
+    }
+    return counts;
+}
+
+/*
+ *  把 array 拆成兩邊都有的，跟另一邊沒有的
+ *  otherCounts 是另一邊每個 model 的數量，會被扣掉，重覆的 model 前面幾個算保留
+ *  missingObjects 只放另一邊完全沒有的 model，每個一次
+ */
+static void KHSplitObjects( NSArray *array, CFMutableDictionaryRef otherCounts,
+                            NSMutableArray *keptObjects, NSMutableIndexSet *missingIndexes,
+                            NSMutableArray *missingObjects )
+{
+    NSUInteger index = 0;
+    for ( id object in array ) {
+        const void *key = (__bridge const void*)object;
+        const void *value = NULL;
+        if ( CFDictionaryGetValueIfPresent( otherCounts, key, &value ) && (uintptr_t)value > 0 ) {
+            CFDictionarySetValue( otherCounts, key, (const void*)((uintptr_t)value - 1) );
+            [keptObjects addObject:object];
+        }
+        else{
+            [missingIndexes addIndex:index];
+            if ( !CFDictionaryContainsKey( otherCounts, key ) ) {
+                //  記成 0，重覆的 model 只記一次
+                CFDictionarySetValue( otherCounts, key, (const void*)0 );
+                [missingObjects addObject:object];
+            }
+        }
+        index++;
+    }
+}
+
+
+@implementation KHSnapshotChange
+
++ (instancetype)changeFrom:(NSArray*)oldArray to:(NSArray*)newArray
+{
+    CFMutableDictionaryRef oldCounts = KHCountObjects( oldArray );
+    CFMutableDictionaryRef newCounts = KHCountObjects( newArray );
+
+    NSMutableArray *keptOld = [[NSMutableArray alloc] initWithCapacity: oldArray.count ];
+    NSMutableIndexSet *removedIndexes = [[NSMutableIndexSet alloc] init];
+    NSMutableArray *removedObjects = [[NSMutableArray alloc] init];
+    KHSplitObjects( oldArray, newCounts, keptOld, removedIndexes, removedObjects );
+
+    NSMutableArray *keptNew = [[NSMutableArray alloc] initWithCapacity: newArray.count ];
+    NSMutableIndexSet *insertedIndexes = [[NSMutableIndexSet alloc] init];
+    NSMutableArray *insertedObjects = [[NSMutableArray alloc] init];
+    KHSplitObjects( newArray, oldCounts, keptNew, insertedIndexes, insertedObjects );
+
+    CFRelease( oldCounts );
+    CFRelease( newCounts );
+
+    KHSnapshotChange *change = [[KHSnapshotChange alloc] initWithRemovedObjects:removedObjects indexes:removedIndexes
+                                                                insertedObjects:insertedObjects indexes:insertedIndexes
+                                                                       oldCount:oldArray.count];
+
+    //  兩邊都有的 model 順序要一樣，才能只用 delete / insert 描述
+    for ( NSUInteger i=0; i<keptOld.count; i++ ) {
+        if ( keptOld[i] != keptNew[i] ) {
+            change.isReordered = YES;
+            break;
+        }
+    }
+    return change;
+}
+
+- (instancetype)initWithRemovedObjects:(NSArray*)removedObjects indexes:(NSIndexSet*)removedIndexes
+                       insertedObjects:(NSArray*)insertedObjects indexes:(NSIndexSet*)insertedIndexes
+                              oldCount:(NSUInteger)oldCount
+{
+    self = [super init];
+    if (self) {
+        _removedObjects = removedObjects;
+        _removedIndexes = removedIndexes;
+        _insertedObjects = insertedObjects;
+        _insertedIndexes = insertedIndexes;
+        _oldCount = oldCount;
+        _newCount = oldCount - removedIndexes.count + insertedIndexes.count;
+    }
+    return self;
+}
+
+- (BOOL)isEmpty
+{
+    return _removedIndexes.count == 0 && _insertedIndexes.count == 0 && !_isReordered;
+}
+
+- (NSArray<NSIndexPath*>*)removedIndexPathsInSection:(NSInteger)section
+{
+    return [self indexPathsOfIndexes:_removedIndexes section:section];
+}
+
+- (NSArray<NSIndexPath*>*)insertedIndexPathsInSection:(NSInteger)section
+{
+    return [self indexPathsOfIndexes:_insertedIndexes section:section];
+}
+
+- (NSArray*)indexPathsOfIndexes:(NSIndexSet*)indexes section:(NSInteger)section
+{
+    NSMutableArray *indexPaths = [[NSMutableArray alloc] initWithCapacity: indexes.count ];
+    [indexes enumerateIndexesUsingBlock:^(NSUInteger idx, BOOL *stop) {
+        [indexPaths addObject:[NSIndexPath indexPathForRow:idx inSection:section]];
+    }];
+    return indexPaths;
+}
+
+@end
+
+
+@implementation KHSnapshotArray
+{
+    //  以下三個只在 _queue 上存取
+    NSMutableArray *_pending;
+    //  上一次準備好的 snapshot，diff 的基準
+    NSArray *_prepared;
+    //  已經排了 prepare 還沒執行，這段期間的修改會併成一批
+    BOOL _prepareScheduled;
+    //  這一批修改的 completion
+    NSMutableArray *_completions;
+
+    //  畫面上的資料，只在 main thread 存取
+    NSArray *_committed;
+
+    //  for in 走訪時的快照，要留著，不然走訪到一半就被釋放了
+    NSArray *_enumerationSnapshot;
+
+    dispatch_queue_t _queue;
+}
+
+- (instancetype)init
+{
+    return [self initWithArray:nil];
+}
+
+- (instancetype)initWithArray:(NSArray*)array
+{
+    self = [super init];
+    if (self) {
+        _pending = array ? [[NSMutableArray alloc] initWithArray:array] : [[NSMutableArray alloc] init];
+        _prepared = [_pending copy];
+        _committed = _prepared;
+        _completions = [[NSMutableArray alloc] init];
+        _queue = dispatch_queue_create("KHSnapshotArray", DISPATCH_QUEUE_SERIAL);
+    }
+    return self;
+}
+
+#pragma mark - Committed snapshot
+
+- (NSUInteger)count
+{
+    return _committed.count;
+}
+
+- (id)objectAtIndex:(NSUInteger)index
+{
+    return [_committed objectAtIndex:index];
+}
+
+- (id)objectAtIndexedSubscript:(NSUInteger)index
+{
+    return [_committed objectAtIndex:index];
+}
+
+- (NSUInteger)indexOfObjectIdenticalTo:(id)anObject
+{
+    return [_committed indexOfObjectIdenticalTo:anObject];
+}
+
+- (NSArray*)snapshot
+{
+    return _committed;
+}
+
+- (NSUInteger)countByEnumeratingWithState:(NSFastEnumerationState *)state objects:(id __unsafe_unretained [])buffer count:(NSUInteger)len
+{
+    if ( state->state == 0 ) {
+        _enumerationSnapshot = _committed;
+    }
+    return [_enumerationSnapshot countByEnumeratingWithState:state objects:buffer count:len];
+}
+
+#pragma mark - Pending
+
+- (void)performChanges:(void(^)(NSMutableArray *pending))changes
+{
+    [self performChanges:changes completion:nil];
+}
+
+- (void)performChanges:(void(^)(NSMutableArray *pending))changes completion:(void(^)(void))completion
+{
+    void(^completionBlock)(void) = [completion copy];
+    dispatch_async( _queue, ^{
+        if ( changes ) {
+            changes( _pending );
+        }
+        if ( completionBlock ) {
+            [_completions addObject:completionBlock];
+        }
+        [self schedulePrepare];
+    });
+}
+
+- (void)addObject:(id)anObject
+{
+    [self performChanges:^(NSMutableArray *pending) {
+        [pending addObject:anObject];
+    }];
+}
+
+- (void)addObjectsFromArray:(NSArray*)otherArray
+{
+    NSArray *objects = [otherArray copy];
+    [self performChanges:^(NSMutableArray *pending) {
+        [pending addObjectsFromArray:objects];
+    }];
+}
+
+- (void)insertObject:(id)anObject atIndex:(NSUInteger)index
+{
+    [self performChanges:^(NSMutableArray *pending) {
+        [pending insertObject:anObject atIndex:index];
+    }];
+}
+
+- (void)removeObject:(id)anObject
+{
+    [self performChanges:^(NSMutableArray *pending) {
+        [pending removeObjectIdenticalTo:anObject];
+    }];
+}
+
+- (void)removeObjectAtIndex:(NSUInteger)index
+{
+    [self performChanges:^(NSMutableArray *pending) {
+        [pending removeObjectAtIndex:index];
+    }];
+}
+
+- (void)removeAllObjects
+{
+    [self performChanges:^(NSMutableArray *pending) {
+        [pending removeAllObjects];
+    }];
+}
+
+- (void)replaceObjectAtIndex:(NSUInteger)index withObject:(id)anObject
+{
+    [self performChanges:^(NSMutableArray *pending) {
+        [pending replaceObjectAtIndex:index withObject:anObject];
+    }];
+}
+
+- (void)setArray:(NSArray*)otherArray
+{
+    NSArray *objects = [otherArray copy];
+    [self performChanges:^(NSMutableArray *pending) {
+        [pending setArray:objects];
+    }];
+}
+
+- (void)notifyWhenCommitted:(void(^)(void))block
+{
+    [self performChanges:nil completion:block];
+}
+
+#pragma mark - Prepare & Commit
+
+//  在 _queue 上呼叫
+- (void)schedulePrepare
+{
+    if ( _prepareScheduled ) {
+        return;
+    }
+    _prepareScheduled = YES;
+    //  排在已經送進來的修改後面，同一批的修改只 prepare 一次
+    dispatch_async( _queue, ^{
+        [self prepareSnapshot];
+    });
+}
+
+- (void)prepareSnapshot
+{
+    _prepareScheduled = NO;
+
+    NSArray *newSnapshot = [_pending copy];
+    KHSnapshotChange *change = [KHSnapshotChange changeFrom:_prepared to:newSnapshot];
+    _prepared = newSnapshot;
+
+    NSArray *completions = [_completions copy];
+    [_completions removeAllObjects];
+
+    //  背景只算 size，pairInfo、KVO、cell mapping 會動到 binding 的狀態，commit 時在 main thread 做
+    CGSize(^sizeBlock)(id model) = self.sizeBlock;
+    if ( sizeBlock && change.insertedObjects.count > 0 ) {
+        NSMutableArray *sizes = [[NSMutableArray alloc] initWithCapacity: change.insertedObjects.count ];
+        for ( id model in change.insertedObjects ) {
+            [sizes addObject:[NSValue valueWithCGSize:sizeBlock( model )]];
+        }
+        change.preparedSizes = sizes;
+    }
+
+    //  main queue 是 FIFO，commit 的順序跟 prepare 一樣
+    dispatch_async( dispatch_get_main_queue(), ^{
+        [self commitSnapshot:newSnapshot change:change];
+        for ( void(^completion)(void) in completions ) {
+            completion();
+        }
+    });
+}
+
+- (void)commitSnapshot:(NSArray*)snapshot change:(KHSnapshotChange*)change
+{
+    _committed = snapshot;
+    if ( [change isEmpty] ) {
+        return;
+    }
+    if ( self.kh_delegate ) {
+        [self.kh_delegate snapshotArray:self didCommitChange:change];
+    }
+}
+
+@end
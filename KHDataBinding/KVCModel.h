@@ -29,6 +29,13 @@
  // json data 轉成 data model 
  UserData *user = [KVCModel objectWithJSON:jsonData objectClass:[UserData class] keyCorrespond:nil];
  
+ 
+ lazy decode:
+ 子類別的 +decodesLazily 回傳 YES 的話，objectWithDictionary:、convertArray:、objectWithJSON: 建立的 object
+ 只會記住原本的 dictionary，每個 property 在第一次呼叫 getter 時才轉換，包含巢狀的 object 與 classof_ 的 array
+ 轉換的結果跟直接轉換一樣，先呼叫 setter 的 property 不會再被 dictionary 的值蓋掉，轉換時不會送出 KVO
+ 子類別裡直接讀 ivar 的話，要先呼叫 getter 或是 decodeLazyProperties
+ 
  */
 
 
@@ -40,6 +47,9 @@
     NSMutableDictionary *_keyCorrespondDic;
 }
  
+//  回傳 YES 的話，由 dictionary 建立的 object 改成 lazy decode，預設 NO
++(BOOL)decodesLazily;
+
 -(id)initWithDict:(NSDictionary*)dic;
 
 -(void)injectDict:(NSDictionary*)dic;
@@ -52,6 +62,12 @@
 -(void)setProperty:(NSString*)property correspondKey:(NSString*)jsonKey;
 
 -(NSDictionary*)dict;
+
+//  lazy decode 的 object，把還沒轉換的 property 全部轉換
+-(void)decodeLazyProperties;
+
+//  還有沒有沒轉換的 property
+-(BOOL)hasLazyProperties;
 -(NSString*)jsonString;
 -(NSData*)jsonData;
 
@@ -106,10 +122,21 @@
 +(void)injectDictionary:(NSDictionary*)jsonDic toObject:(id)object keyCorrespond:(NSDictionary*)correspondDic;
 
 //  把一個物件的值，轉成另一個物件
+//  property 直接對 property 複製，不經過 dictionary，每組 class 的對映只解析一次
+//  數值型別保留原本的值，UIImage 與其他值物件直接共用，自訂的 model 會複製成目標 property 的 class
+//  array 有 classof_ 的話，元素轉成指定的 class，沒有的話元素直接共用
 +(id)objectWithModel:(id)model objectClass:(Class)cls;
++(id)objectWithModel:(id)model objectClass:(Class)cls keyCorrespond:(NSDictionary*)correspondDic;
+
 //  把一個model的值，填到另一個 model
 +(void)injectWithModel:(id)model toObject:(id)object;
 
+//  correspondDic 跟 dictionary 轉換一樣是 property name / key name，兩邊 key name 相同的 property 互相對映
++(void)injectWithModel:(id)model toObject:(id)object keyCorrespond:(NSDictionary*)correspondDic;
+
+//  把 array 的 model 都複製成指定的 class
++(NSMutableArray*)convertModels:(NSArray*)models toClass:(Class)cls keyCorrespond:(NSDictionary*)correspondDic;
+
 
 //  把 array 的 object 都轉成指定的 class
 +(NSMutableArray*)convertArray:(NSArray*)array toClass:(Class)cls keyCorrespond:(NSDictionary*)correspondDic;
@@ -117,6 +144,9 @@
 //  把 array 的 object 都轉成指定的 dict
 +(NSMutableArray*)convertDictionarys:(NSArray*)array keyCorrespond:(NSDictionary*)correspondDic;
 
+//  class 裡型別是 NSString 的 property name，包含父類別（不含 NSObject），依宣告的順序
++(NSArray*)stringPropertyNamesOfClass:(Class)cls;
+
 
 
 
@@ -7,9 +7,129 @@
 
 #import "KVCModel.h"
 #import <objc/runtime.h>
-#import <UIKit/UIKit.h>
+#import <objc/message.h>
+#import <pthread.h>
+#import "KHPlatform.h"
+
+//  lazy decode 用，一個 property 的解析結果
+@interface KHKVCProperty : NSObject
+{
+    @public
+    NSString *_name;
+    NSString *_type;
+    //  type encoding 的第一個字元，'@' 是物件
+    char _typeCode;
+    //  property 的 class，NSDictionary 的值會轉成它
+    Class _propertyClass;
+    BOOL _isMutableArray;
+    //  classof_xxx 的 class
+    Class _elementClass;
+    //  NO 的話在建立 object 時就直接轉換，例如 readonly、struct、自訂 getter / setter
+    BOOL _lazy;
+    SEL _getter;
+    SEL _setter;
+    //  hook 之前的 setter，轉換時直接呼叫，不會送出 KVO
+    IMP _setterIMP;
+}
+@end
+
+@implementation KHKVCProperty
+@end
+
+
+//  一個 class 的 property 解析結果，每個 class 只解析一次
+@interface KHKVCPlan : NSObject
+{
+    @public
+    NSArray *_properties;
+    //  key: property name / value: index
+    NSDictionary *_indexOfName;
+    NSUInteger _lazyCount;
+}
+@end
+
+@implementation KHKVCPlan
+@end
+
+
+//  lazy decode 的 object 還沒轉換完的狀態，全部轉換完就釋放
+@interface KHKVCLazyState : NSObject
+{
+    @public
+    NSDictionary *_json;
+    NSDictionary *_correspond;
+    KHKVCPlan *_plan;
+    NSUInteger _pending;
+    //  每個 property 一個 bit，1 表示已經轉換或被 setter 設定過
+    uint8_t *_done;
+}
+@end
+
+@implementation KHKVCLazyState
+
+- (void)dealloc
+{
+    free( _done );
+}
+
+@end
+
+
+//  model 複製用，一組 source / target property 的對映
+typedef NS_ENUM(uint8_t, KHKVCCopyKind) {
+    //  同型別的數值，getter 直接傳給 setter
+    KHKVCCopyScalar,
+    //  物件，依值的型別決定共用、轉換或遞迴複製
+    KHKVCCopyObject,
+    //  其他，例如 struct 或是型別不同，用 valueForKey: / setValue:forKey:
+    KHKVCCopyKVC,
+};
+
+@interface KHKVCCopyRule : NSObject
+{
+    @public
+    KHKVCCopyKind _kind;
+    char _typeCode;
+    NSString *_sourceName;
+    NSString *_targetName;
+    //  NULL 的話用 KVC
+    SEL _getter;
+    SEL _setter;
+    //  target property 的 class，與 classof_ 的 class
+    Class _targetClass;
+    Class _elementClass;
+}
+@end
+
+@implementation KHKVCCopyRule
+@end
+
+
+//  model 可能在背景 thread 被讀取（例如 KHSearchIndex），轉換時要 lock
+static pthread_mutex_t khLazyLock;
+
+static void KHLazyLockInit(void)
+{
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        pthread_mutexattr_t attr;
+        pthread_mutexattr_init( &attr );
+        pthread_mutexattr_settype( &attr, PTHREAD_MUTEX_RECURSIVE );
+        pthread_mutex_init( &khLazyLock, &attr );
+        pthread_mutexattr_destroy( &attr );
+    });
+}
 
 @implementation KVCModel
+{
+    //  lazy decode 還沒轉換完的話才有
+    KHKVCLazyState *_lazyState;
+}
+
++(BOOL)decodesLazily
+{
+    return NO;
+}
 
 -(id)initWithDict:(NSDictionary*)dic
 {
@@ -42,6 +162,312 @@
     return [KVCModel dictionaryWithObj:self keyCorrespond:_keyCorrespondDic];
 }
 
+-(void)decodeLazyProperties
+{
+    KHLazyLockInit();
+    pthread_mutex_lock( &khLazyLock );
+    KHKVCLazyState *state = _lazyState;
+    NSArray *properties = state ? state->_plan->_properties : nil;
+    for ( KHKVCProperty *property in properties ) {
+        if ( _lazyState == nil ) {
+            break;
+        }
+        if ( property->_lazy ) {
+            [self kh_decodeLazyProperty:property->_name];
+        }
+    }
+    pthread_mutex_unlock( &khLazyLock );
+}
+
+-(BOOL)hasLazyProperties
+{
+    return _lazyState != nil;
+}
+
+#pragma mark - Lazy Decode
+
+//  建立 cls 的 object 並填入 dictionary 的值，cls 是 lazy decode 的話只記住 dictionary
++(id)kh_objectOfClass:(Class)cls dictionary:(NSDictionary*)dict keyCorrespond:(NSDictionary*)correspondDic
+{
+    id object = [[cls alloc] init];
+    if ( [cls isSubclassOfClass:[KVCModel class]] && [cls decodesLazily] ) {
+        [(KVCModel*)object kh_attachLazyDictionary:dict keyCorrespond:correspondDic];
+    }
+    else {
+        [KVCModel injectDictionary:dict toObject:object keyCorrespond:correspondDic];
+    }
+    return object;
+}
+
+//  property attributes 裡雙引號中的 class name，沒有的話回傳 nil
+static NSString *KHKVCClassNameOfType(NSString *propertyType)
+{
+    NSArray *comp = [propertyType componentsSeparatedByString:@"\""];
+    return comp.count > 2 ? comp[1] : nil;
+}
+
+//  跟 injectDictionary:toObject:keyCorrespond: 一樣只看 cls 自己宣告的 property
++(KHKVCPlan*)kh_planOfClass:(Class)cls
+{
+    static NSMapTable *plans;
+    KHLazyLockInit();
+    pthread_mutex_lock( &khLazyLock );
+    if ( plans == nil ) {
+        plans = [NSMapTable strongToStrongObjectsMapTable];
+    }
+    KHKVCPlan *plan = [plans objectForKey:cls];
+    if ( plan == nil ) {
+        plan = [self kh_buildPlanOfClass:cls];
+        [plans setObject:plan forKey:cls];
+    }
+    pthread_mutex_unlock( &khLazyLock );
+    return plan;
+}
+
++(KHKVCPlan*)kh_buildPlanOfClass:(Class)cls
+{
+    KHKVCPlan *plan = [[KHKVCPlan alloc] init];
+    NSMutableArray *properties = [[NSMutableArray alloc] init];
+    NSMutableDictionary *indexOfName = [[NSMutableDictionary alloc] init];
+    
+    unsigned int numOfProperties;
+    objc_property_t *propertyList = class_copyPropertyList( cls, &numOfProperties );
+    for ( unsigned int pi = 0; pi < numOfProperties; pi++ ) {
+        objc_property_t property = propertyList[pi];
+        KHKVCProperty *info = [[KHKVCProperty alloc] init];
+        info->_name = [[NSString alloc] initWithCString:property_getName(property) encoding:NSUTF8StringEncoding];
+        info->_type = [[NSString alloc] initWithCString:property_getAttributes(property) encoding:NSUTF8StringEncoding];
+        info->_typeCode = info->_type.length > 1 ? [info->_type characterAtIndex:1] : 0;
+        info->_lazy = [self kh_preparePropertyInfo:info ofClass:cls];
+        if ( info->_lazy ) {
+            plan->_lazyCount++;
+        }
+        indexOfName[info->_name] = @(properties.count);
+        [properties addObject:info];
+    }
+    free( propertyList );
+    
+    plan->_properties = properties;
+    plan->_indexOfName = indexOfName;
+    return plan;
+}
+
+//  決定 property 能不能 lazy decode，可以的話 hook getter 與 setter
++(BOOL)kh_preparePropertyInfo:(KHKVCProperty*)info ofClass:(Class)cls
+{
+    //  readonly、自訂 getter / setter、weak 直接轉換，KVC 的行為比較複雜
+    for ( NSString *attribute in [info->_type componentsSeparatedByString:@","] ) {
+        if ( [attribute isEqualToString:@"R"] || [attribute isEqualToString:@"W"] ||
+             [attribute hasPrefix:@"G"] || [attribute hasPrefix:@"S"] ) {
+            return NO;
+        }
+    }
+    if ( info->_typeCode == '@' ) {
+        NSString *className = KHKVCClassNameOfType( info->_type );
+        if ( className == nil ) {
+            //  id 或 block
+            return NO;
+        }
+        info->_propertyClass = NSClassFromString( className );
+        info->_isMutableArray = [className isEqualToString:@"NSMutableArray"];
+        NSString *classRefName = [NSString stringWithFormat:@"classof_%@", info->_name ];
+        objc_property_t classRefProperty = class_getProperty( cls, [classRefName UTF8String] );
+        if ( classRefProperty != NULL ) {
+            NSString *classRefType = [[NSString alloc] initWithCString:property_getAttributes(classRefProperty) encoding:NSUTF8StringEncoding];
+            NSString *elementClassName = KHKVCClassNameOfType( classRefType );
+            if ( elementClassName == nil ) {
+                return NO;
+            }
+            info->_elementClass = NSClassFromString( elementClassName );
+        }
+    }
+    else if ( strchr( "cCsSiIlLqQfdB", info->_typeCode ) == NULL || info->_typeCode == 0 ) {
+        //  struct、char *、pointer
+        return NO;
+    }
+    
+    NSString *setterName = [NSString stringWithFormat:@"set%@%@:", [[info->_name substringToIndex:1] uppercaseString], [info->_name substringFromIndex:1] ];
+    info->_getter = NSSelectorFromString( info->_name );
+    info->_setter = NSSelectorFromString( setterName );
+    Method getterMethod = class_getInstanceMethod( cls, info->_getter );
+    Method setterMethod = class_getInstanceMethod( cls, info->_setter );
+    if ( getterMethod == NULL || setterMethod == NULL ) {
+        return NO;
+    }
+    info->_setterIMP = method_getImplementation( setterMethod );
+    [self kh_hookGetter:getterMethod setter:setterMethod info:info ofClass:cls];
+    return YES;
+}
+
+//  getter：還有沒轉換的 property 就先轉換，再呼叫原本的 getter
+#define KH_LAZY_GETTER( type ) \
+    imp_implementationWithBlock( ^type( KVCModel *self_ ) { \
+        if ( self_->_lazyState ) [self_ kh_decodeLazyProperty:name]; \
+        return ((type(*)(id,SEL))originalGetter)( self_, getter ); \
+    })
+
+//  setter：先設定的值優先，dictionary 的值不再轉換
+#define KH_LAZY_SETTER( type ) \
+    imp_implementationWithBlock( ^( KVCModel *self_, type value ) { \
+        if ( self_->_lazyState ) [self_ kh_skipLazyProperty:name]; \
+        ((void(*)(id,SEL,type))originalSetter)( self_, setter, value ); \
+    })
+
++(void)kh_hookGetter:(Method)getterMethod setter:(Method)setterMethod info:(KHKVCProperty*)info ofClass:(Class)cls
+{
+    NSString *name = info->_name;
+    SEL getter = info->_getter;
+    SEL setter = info->_setter;
+    IMP originalGetter = method_getImplementation( getterMethod );
+    IMP originalSetter = info->_setterIMP;
+    IMP getterHook = NULL;
+    IMP setterHook = NULL;
+    switch ( info->_typeCode ) {
+        case '@': getterHook = KH_LAZY_GETTER( id );                 setterHook = KH_LAZY_SETTER( id ); break;
+        case 'c': getterHook = KH_LAZY_GETTER( char );               setterHook = KH_LAZY_SETTER( char ); break;
+        case 'C': getterHook = KH_LAZY_GETTER( unsigned char );      setterHook = KH_LAZY_SETTER( unsigned char ); break;
+        case 's': getterHook = KH_LAZY_GETTER( short );              setterHook = KH_LAZY_SETTER( short ); break;
+        case 'S': getterHook = KH_LAZY_GETTER( unsigned short );     setterHook = KH_LAZY_SETTER( unsigned short ); break;
+        case 'i': getterHook = KH_LAZY_GETTER( int );                setterHook = KH_LAZY_SETTER( int ); break;
+        case 'I': getterHook = KH_LAZY_GETTER( unsigned int );       setterHook = KH_LAZY_SETTER( unsigned int ); break;
+        case 'l': getterHook = KH_LAZY_GETTER( long );               setterHook = KH_LAZY_SETTER( long ); break;
+        case 'L': getterHook = KH_LAZY_GETTER( unsigned long );      setterHook = KH_LAZY_SETTER( unsigned long ); break;
+        case 'q': getterHook = KH_LAZY_GETTER( long long );          setterHook = KH_LAZY_SETTER( long long ); break;
+        case 'Q': getterHook = KH_LAZY_GETTER( unsigned long long ); setterHook = KH_LAZY_SETTER( unsigned long long ); break;
+        case 'f': getterHook = KH_LAZY_GETTER( float );              setterHook = KH_LAZY_SETTER( float ); break;
+        case 'd': getterHook = KH_LAZY_GETTER( double );             setterHook = KH_LAZY_SETTER( double ); break;
+        case 'B': getterHook = KH_LAZY_GETTER( bool );               setterHook = KH_LAZY_SETTER( bool ); break;
+    }
+    //  getter 是繼承來的話，class_replaceMethod 會加在 cls 上，不影響父類別
+    class_replaceMethod( cls, getter, getterHook, method_getTypeEncoding(getterMethod) );
+    class_replaceMethod( cls, setter, setterHook, method_getTypeEncoding(setterMethod) );
+}
+
+-(void)kh_attachLazyDictionary:(NSDictionary*)dict keyCorrespond:(NSDictionary*)correspondDic
+{
+    if ( dict == nil ) return;
+    KHKVCPlan *plan = [KVCModel kh_planOfClass:[self class]];
+    
+    //  不能 lazy 的 property 現在就轉換，只留下它們的 key 給原本的流程
+    if ( plan->_lazyCount < plan->_properties.count ) {
+        NSMutableDictionary *eagerDic = [[NSMutableDictionary alloc] init];
+        for ( KHKVCProperty *property in plan->_properties ) {
+            if ( property->_lazy ) continue;
+            NSString *jsonKey = correspondDic[property->_name] ?: property->_name;
+            id value = dict[jsonKey];
+            if ( value ) eagerDic[jsonKey] = value;
+        }
+        [KVCModel injectDictionary:eagerDic toObject:self keyCorrespond:correspondDic];
+    }
+    if ( plan->_lazyCount == 0 ) {
+        return;
+    }
+    KHKVCLazyState *state = [[KHKVCLazyState alloc] init];
+    state->_json = dict;
+    state->_correspond = correspondDic;
+    state->_plan = plan;
+    state->_pending = plan->_lazyCount;
+    state->_done = calloc( ( plan->_properties.count + 7 ) / 8, 1 );
+    for ( NSUInteger i=0; i<plan->_properties.count; i++ ) {
+        if ( !((KHKVCProperty*)plan->_properties[i])->_lazy ) {
+            state->_done[i / 8] |= 1 << ( i % 8 );
+        }
+    }
+    _lazyState = state;
+}
+
+//  標記 property 已處理，回傳 NO 表示之前就處理過了
+-(BOOL)kh_markLazyProperty:(NSString*)name
+{
+    KHKVCLazyState *state = _lazyState;
+    NSNumber *index = state->_plan->_indexOfName[name];
+    if ( index == nil ) {
+        //  父類別的 property，不在這個 class 的轉換範圍
+        return NO;
+    }
+    NSUInteger i = index.unsignedIntegerValue;
+    if ( state->_done[i / 8] & ( 1 << ( i % 8 ) ) ) {
+        return NO;
+    }
+    state->_done[i / 8] |= 1 << ( i % 8 );
+    state->_pending--;
+    if ( state->_pending == 0 ) {
+        _lazyState = nil;
+    }
+    return YES;
+}
+
+-(void)kh_skipLazyProperty:(NSString*)name
+{
+    KHLazyLockInit();
+    pthread_mutex_lock( &khLazyLock );
+    if ( _lazyState ) {
+        [self kh_markLazyProperty:name];
+    }
+    pthread_mutex_unlock( &khLazyLock );
+}
+
+-(void)kh_decodeLazyProperty:(NSString*)name
+{
+    KHLazyLockInit();
+    pthread_mutex_lock( &khLazyLock );
+    KHKVCLazyState *state = _lazyState;
+    if ( state && [self kh_markLazyProperty:name] ) {
+        KHKVCProperty *property = state->_plan->_properties[[state->_plan->_indexOfName[name] unsignedIntegerValue]];
+        NSString *jsonKey = state->_correspond[name] ?: name;
+        id value = state->_json[jsonKey];
+        //  值為 nil 或是 NSNull 物件就略過，跟直接轉換一樣
+        if ( value != nil && ![value isKindOfClass:[NSNull class]] ) {
+            [self kh_setDecodedValue:value property:property keyCorrespond:state->_correspond];
+        }
+    }
+    pthread_mutex_unlock( &khLazyLock );
+}
+
+//  跟 injectDictionary:toObject:keyCorrespond: 每個分支的轉換一樣，只是直接呼叫原本的 setter
+-(void)kh_setDecodedValue:(id)value property:(KHKVCProperty*)property keyCorrespond:(NSDictionary*)correspondDic
+{
+    IMP setterIMP = property->_setterIMP;
+    SEL setter = property->_setter;
+    switch ( property->_typeCode ) {
+        case 'c': ((void(*)(id,SEL,char))setterIMP)( self, setter, [value charValue] ); return;
+        case 'C': ((void(*)(id,SEL,unsigned char))setterIMP)( self, setter, [value unsignedCharValue] ); return;
+        case 's': ((void(*)(id,SEL,short))setterIMP)( self, setter, [value shortValue] ); return;
+        case 'S': ((void(*)(id,SEL,unsigned short))setterIMP)( self, setter, [value unsignedShortValue] ); return;
+        case 'i': ((void(*)(id,SEL,int))setterIMP)( self, setter, [value intValue] ); return;
+        case 'I': ((void(*)(id,SEL,unsigned int))setterIMP)( self, setter, [value unsignedIntValue] ); return;
+        case 'l': ((void(*)(id,SEL,long))setterIMP)( self, setter, [value longValue] ); return;
+        case 'L': ((void(*)(id,SEL,unsigned long))setterIMP)( self, setter, [value unsignedLongValue] ); return;
+        case 'q': ((void(*)(id,SEL,long long))setterIMP)( self, setter, [value longLongValue] ); return;
+        case 'Q': ((void(*)(id,SEL,unsigned long long))setterIMP)( self, setter, [value unsignedLongLongValue] ); return;
+        case 'f': ((void(*)(id,SEL,float))setterIMP)( self, setter, [value floatValue] ); return;
+        case 'd': ((void(*)(id,SEL,double))setterIMP)( self, setter, [value doubleValue] ); return;
+        case 'B': ((void(*)(id,SEL,bool))setterIMP)( self, setter, [value boolValue] ); return;
+    }
+    
+    id decoded = value;
+#if KH_HAS_UIKIT
+    if ( [value isKindOfClass:[UIImage class]] ) {
+        NSString* string = [KVCModel base64Decode: value ];
+        NSData* data = [string dataUsingEncoding:NSASCIIStringEncoding];
+        decoded = [[UIImage alloc] initWithData: data ];
+    }
+    else
+#endif
+    if ( [value isKindOfClass: [NSDictionary class] ] ) {
+        decoded = [KVCModel kh_objectOfClass:property->_propertyClass dictionary:value keyCorrespond:correspondDic];
+    }
+    else if( [value isKindOfClass: [NSArray class] ] ){
+        if ( property->_elementClass != NULL ) {
+            decoded = [KVCModel convertArray:value toClass:property->_elementClass keyCorrespond:correspondDic];
+        }
+        else if ( property->_isMutableArray ) {
+            decoded = [[NSMutableArray alloc] initWithArray: value ];
+        }
+    }
+    ((void(*)(id,SEL,id))setterIMP)( self, setter, decoded );
+}
+
 -(NSString*)jsonString
 {
     NSDictionary* dic = [self dict];
@@ -119,6 +545,7 @@
         else{
             //  若是 class 物件，那檢查是不是 objc 的原生資料類別，是的話就直接塞進 dictionary，不是的話就進下一層遞迴，再做一次解析
             if([propertyType hasPrefix:@"T@"]){
+#if KH_HAS_UIKIT
                 //  UIImage
                 if ([value isKindOfClass:[UIImage class]]) {
                     // 要把 image 轉成 base64 string
@@ -126,8 +553,10 @@
                     NSString* base64String = [data base64EncodedStringWithOptions:0];
                     [tmpDic setObject: base64String forKey: pkey ];
                 }
+                else
+#endif
                 //  NSArray
-                else if( [value isKindOfClass:[NSArray class]] ) {
+                if( [value isKindOfClass:[NSArray class]] ) {
                     NSArray *dictionaryArr = [KVCModel convertDictionarys:value keyCorrespond:correspondDic ];
                     [tmpDic setObject: dictionaryArr forKey: pkey ];
                 }
@@ -217,9 +646,7 @@
 //  把 dictionary 轉成 object
 +(id)objectWithDictionary:(NSDictionary*)dict objectClass:(Class)cls keyCorrespond:(NSDictionary*)correspondDic
 {
-    id object = [[cls alloc] init];
-    
-    [KVCModel injectDictionary:dict toObject:object keyCorrespond:correspondDic];
+    id object = [KVCModel kh_objectOfClass:cls dictionary:dict keyCorrespond:correspondDic];
     
     return object;
 }
@@ -274,6 +701,7 @@
         // 是個物件
         else if( [propertyType hasPrefix:@"T@" ] ) {
             
+#if KH_HAS_UIKIT
             // 如果 property 是 UIImage，那要把 dictionary 裡的 value 做 decode base64
             if ( [value isKindOfClass:[UIImage class]] ) {
                 NSString* string = [KVCModel base64Decode: value ];
@@ -281,16 +709,17 @@
                 UIImage* image = [[UIImage alloc] initWithData: data ];
                 [object setValue: image forKey:propertyName ];
             }
+            else
+#endif
             // 若 value 是 NSDictionary，那預期 property 是某種 class type
-            else if ( [value isKindOfClass: [NSDictionary class] ] ) {
+            if ( [value isKindOfClass: [NSDictionary class] ] ) {
                 
                 // 取得 property 的 class
                 NSArray *comp = [propertyType componentsSeparatedByString:@"\""];
                 Class _class = NSClassFromString( comp[1] );
                 
-                // 把 value(Dictionary) 轉成物件
-                id obj = [[_class alloc] init];
-                [KVCModel injectDictionary:value toObject:obj keyCorrespond:correspondDic];
+                // 把 value(Dictionary) 轉成物件，_class 是 lazy decode 的話只記住 dictionary
+                id obj = [KVCModel kh_objectOfClass:_class dictionary:value keyCorrespond:correspondDic];
                 // 填入
                 [object setValue: obj forKey: propertyName ];
             }
@@ -380,17 +809,270 @@
 //  把一個物件的值，轉成另一個物件
 +(id)objectWithModel:(id)model objectClass:(Class)cls
 {
-    NSDictionary *dict = [KVCModel dictionaryWithObj:model];
+    return [KVCModel objectWithModel:model objectClass:cls keyCorrespond:nil];
+}
+
++(id)objectWithModel:(id)model objectClass:(Class)cls keyCorrespond:(NSDictionary*)correspondDic
+{
     id object = [cls new];
-    [KVCModel injectDictionary:dict toObject:object ];
+    [KVCModel injectWithModel:model toObject:object keyCorrespond:correspondDic];
     return object;
 }
 
 //  把一個model的值，填到另一個 model
 +(void)injectWithModel:(id)model toObject:(id)object
 {
-    NSDictionary *dict = [KVCModel dictionaryWithObj:model];
-    [KVCModel injectDictionary:dict toObject:object ];
+    [KVCModel injectWithModel:model toObject:object keyCorrespond:nil];
+}
+
++(void)injectWithModel:(id)model toObject:(id)object keyCorrespond:(NSDictionary*)correspondDic
+{
+    if ( model == nil || object == nil ) return;
+    NSArray *rules = [KVCModel kh_copyRulesFrom:[model class] to:[object class] keyCorrespond:correspondDic];
+    [KVCModel kh_copyModel:model toObject:object rules:rules keyCorrespond:correspondDic];
+}
+
++(NSMutableArray*)convertModels:(NSArray*)models toClass:(Class)cls keyCorrespond:(NSDictionary*)correspondDic
+{
+    if ( ![models isKindOfClass:[NSArray class] ] ) {
+        return nil;
+    }
+    NSMutableArray *finalArray = [[NSMutableArray alloc] initWithCapacity: models.count ];
+    Class lastClass = Nil;
+    NSArray *rules = nil;
+    for ( id model in models ) {
+        //  同一個 class 的 model 共用一份對映，不用每筆都查 cache
+        if ( [model class] != lastClass ) {
+            lastClass = [model class];
+            rules = nil;
+        }
+        id object = [KVCModel kh_copiedValue:model targetClass:cls elementClass:Nil rules:&rules keyCorrespond:correspondDic];
+        [finalArray addObject:object];
+    }
+    return finalArray;
+}
+
+#pragma mark - Model Copy
+
+//  不是自訂 model 的值，複製時直接共用
+static BOOL KHKVCIsValueObject(id value)
+{
+    if ( [value isKindOfClass:[NSString class]] ||
+         [value isKindOfClass:[NSNumber class]] ||
+         [value isKindOfClass:[NSValue class]] ||
+         [value isKindOfClass:[NSDate class]] ||
+         [value isKindOfClass:[NSData class]] ||
+         [value isKindOfClass:[NSURL class]] ||
+         [value isKindOfClass:[NSDictionary class]] ||
+         [value isKindOfClass:[NSNull class]] ) {
+        return YES;
+    }
+#if KH_HAS_UIKIT
+    if ( [value isKindOfClass:[UIImage class]] ) {
+        return YES;
+    }
+#endif
+    return NO;
+}
+
+//  property attributes 裡的自訂 getter / setter，沒有的話用預設的名稱
+static SEL KHKVCAccessor(NSString *propertyType, NSString *prefix, NSString *defaultName)
+{
+    for ( NSString *attribute in [propertyType componentsSeparatedByString:@","] ) {
+        if ( [attribute hasPrefix:prefix] ) {
+            return NSSelectorFromString( [attribute substringFromIndex:1] );
+        }
+    }
+    return NSSelectorFromString( defaultName );
+}
+
+//  key: source class / value: ( key: target class / value: ( key: correspondDic 或 NSNull / value: rules ) )
++(NSArray*)kh_copyRulesFrom:(Class)sourceClass to:(Class)targetClass keyCorrespond:(NSDictionary*)correspondDic
+{
+    static NSMapTable *rulesCache;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        rulesCache = [NSMapTable strongToStrongObjectsMapTable];
+    });
+    id correspondKey = correspondDic ?: [NSNull null];
+    NSArray *rules = nil;
+    @synchronized( rulesCache ) {
+        NSMapTable *targets = [rulesCache objectForKey:sourceClass];
+        if ( targets == nil ) {
+            targets = [NSMapTable strongToStrongObjectsMapTable];
+            [rulesCache setObject:targets forKey:sourceClass];
+        }
+        NSMutableDictionary *corresponds = [targets objectForKey:targetClass];
+        if ( corresponds == nil ) {
+            corresponds = [[NSMutableDictionary alloc] init];
+            [targets setObject:corresponds forKey:targetClass];
+        }
+        rules = corresponds[correspondKey];
+        if ( rules == nil ) {
+            rules = [KVCModel kh_buildCopyRulesFrom:sourceClass to:targetClass keyCorrespond:correspondDic];
+            corresponds[[correspondKey copy]] = rules;
+        }
+    }
+    return rules;
+}
+
+//  跟 dictionaryWithObj: 加上 injectDictionary: 一樣，只看兩個 class 自己宣告的 property，key name 相同的互相對映
++(NSArray*)kh_buildCopyRulesFrom:(Class)sourceClass to:(Class)targetClass keyCorrespond:(NSDictionary*)correspondDic
+{
+    //  key: key name / value: @[ property name, attributes ]
+    NSMutableDictionary *sourceProperties = [[NSMutableDictionary alloc] init];
+    unsigned int numOfProperties;
+    objc_property_t *properties = class_copyPropertyList( sourceClass, &numOfProperties );
+    for ( unsigned int pi = 0; pi < numOfProperties; pi++ ) {
+        NSString *name = [[NSString alloc] initWithCString:property_getName(properties[pi]) encoding:NSUTF8StringEncoding];
+        NSString *type = [[NSString alloc] initWithCString:property_getAttributes(properties[pi]) encoding:NSUTF8StringEncoding];
+        NSString *key = correspondDic[name] ?: name;
+        sourceProperties[key] = @[ name, type ];
+    }
+    free( properties );
+    
+    NSMutableArray *rules = [[NSMutableArray alloc] init];
+    properties = class_copyPropertyList( targetClass, &numOfProperties );
+    for ( unsigned int pi = 0; pi < numOfProperties; pi++ ) {
+        NSString *name = [[NSString alloc] initWithCString:property_getName(properties[pi]) encoding:NSUTF8StringEncoding];
+        NSString *type = [[NSString alloc] initWithCString:property_getAttributes(properties[pi]) encoding:NSUTF8StringEncoding];
+        NSArray *source = sourceProperties[correspondDic[name] ?: name];
+        if ( source == nil ) {
+            continue;
+        }
+        NSString *sourceType = source[1];
+        KHKVCCopyRule *rule = [[KHKVCCopyRule alloc] init];
+        rule->_sourceName = source[0];
+        rule->_targetName = name;
+        
+        SEL getter = KHKVCAccessor( sourceType, @"G", rule->_sourceName );
+        if ( class_getInstanceMethod( sourceClass, getter ) ) {
+            rule->_getter = getter;
+        }
+        BOOL readonly = [[type componentsSeparatedByString:@","] containsObject:@"R"];
+        NSString *setterName = [NSString stringWithFormat:@"set%@%@:", [[name substringToIndex:1] uppercaseString], [name substringFromIndex:1] ];
+        SEL setter = KHKVCAccessor( type, @"S", setterName );
+        if ( !readonly && class_getInstanceMethod( targetClass, setter ) ) {
+            rule->_setter = setter;
+        }
+        
+        char sourceCode = sourceType.length > 1 ? [sourceType characterAtIndex:1] : 0;
+        char targetCode = type.length > 1 ? [type characterAtIndex:1] : 0;
+        rule->_typeCode = targetCode;
+        if ( sourceCode == targetCode && sourceCode != 0 && strchr( "cCsSiIlLqQfdB", sourceCode ) && rule->_getter && rule->_setter ) {
+            rule->_kind = KHKVCCopyScalar;
+        }
+        else if ( sourceCode == '@' && targetCode == '@' ) {
+            rule->_kind = KHKVCCopyObject;
+            NSString *className = KHKVCClassNameOfType( type );
+            rule->_targetClass = className ? NSClassFromString( className ) : Nil;
+            NSString *classRefName = [NSString stringWithFormat:@"classof_%@", name ];
+            objc_property_t classRefProperty = class_getProperty( targetClass, [classRefName UTF8String] );
+            if ( classRefProperty != NULL ) {
+                NSString *classRefType = [[NSString alloc] initWithCString:property_getAttributes(classRefProperty) encoding:NSUTF8StringEncoding];
+                NSString *elementClassName = KHKVCClassNameOfType( classRefType );
+                rule->_elementClass = elementClassName ? NSClassFromString( elementClassName ) : Nil;
+            }
+        }
+        else if ( sourceCode == '*' || targetCode == '*' ) {
+            //  char * 沒辦法安全的複製
+            continue;
+        }
+        else {
+            rule->_kind = KHKVCCopyKVC;
+        }
+        [rules addObject:rule];
+    }
+    free( properties );
+    return rules;
+}
+
+//  getter 傳給 setter，兩邊都是正常的 message send，KVO 與 lazy decode 都照常運作
+#define KH_COPY_SCALAR( type ) \
+    ((void(*)(id,SEL,type))objc_msgSend)( object, rule->_setter, ((type(*)(id,SEL))objc_msgSend)( model, rule->_getter ) )
+
++(void)kh_copyModel:(id)model toObject:(id)object rules:(NSArray*)rules keyCorrespond:(NSDictionary*)correspondDic
+{
+    for ( KHKVCCopyRule *rule in rules ) {
+        if ( rule->_kind == KHKVCCopyScalar ) {
+            switch ( rule->_typeCode ) {
+                case 'c': KH_COPY_SCALAR( char ); break;
+                case 'C': KH_COPY_SCALAR( unsigned char ); break;
+                case 's': KH_COPY_SCALAR( short ); break;
+                case 'S': KH_COPY_SCALAR( unsigned short ); break;
+                case 'i': KH_COPY_SCALAR( int ); break;
+                case 'I': KH_COPY_SCALAR( unsigned int ); break;
+                case 'l': KH_COPY_SCALAR( long ); break;
+                case 'L': KH_COPY_SCALAR( unsigned long ); break;
+                case 'q': KH_COPY_SCALAR( long long ); break;
+                case 'Q': KH_COPY_SCALAR( unsigned long long ); break;
+                case 'f': KH_COPY_SCALAR( float ); break;
+                case 'd': KH_COPY_SCALAR( double ); break;
+                case 'B': KH_COPY_SCALAR( bool ); break;
+            }
+            continue;
+        }
+        
+        id value = rule->_getter ? ((id(*)(id,SEL))objc_msgSend)( model, rule->_getter ) : [model valueForKey:rule->_sourceName];
+        //  值為 nil 或是 NSNull 物件就略過
+        if ( value == nil || [value isKindOfClass:[NSNull class]] ) {
+            continue;
+        }
+        if ( rule->_kind == KHKVCCopyObject ) {
+            value = [KVCModel kh_copiedValue:value targetClass:rule->_targetClass elementClass:rule->_elementClass rules:NULL keyCorrespond:correspondDic];
+            if ( value == nil ) {
+                continue;
+            }
+        }
+        if ( rule->_kind == KHKVCCopyObject && rule->_setter ) {
+            ((void(*)(id,SEL,id))objc_msgSend)( object, rule->_setter, value );
+        }
+        else {
+            [object setValue:value forKey:rule->_targetName];
+        }
+    }
+}
+
+//  把值轉成 targetClass 要的樣子，rules 不是 NULL 的話，用來記住 model 到 targetClass 的對映
++(id)kh_copiedValue:(id)value targetClass:(Class)targetClass elementClass:(Class)elementClass rules:(NSArray * __strong *)rules keyCorrespond:(NSDictionary*)correspondDic
+{
+    if ( [value isKindOfClass:[NSArray class]] ) {
+        NSMutableArray *array = [[NSMutableArray alloc] initWithCapacity: [value count] ];
+        NSArray *elementRules = nil;
+        Class lastClass = Nil;
+        for ( id element in value ) {
+            if ( elementClass == Nil ) {
+                [array addObject:element];
+                continue;
+            }
+            if ( [element class] != lastClass ) {
+                lastClass = [element class];
+                elementRules = nil;
+            }
+            id copied = [KVCModel kh_copiedValue:element targetClass:elementClass elementClass:Nil rules:&elementRules keyCorrespond:correspondDic];
+            if ( copied ) [array addObject:copied];
+        }
+        return array;
+    }
+    if ( KHKVCIsValueObject( value ) ) {
+        //  跟 injectDictionary: 一樣，dictionary 轉成 property 的 class
+        if ( [value isKindOfClass:[NSDictionary class]] && targetClass != Nil && ![targetClass isSubclassOfClass:[NSDictionary class]] ) {
+            return [KVCModel kh_objectOfClass:targetClass dictionary:value keyCorrespond:correspondDic];
+        }
+        return value;
+    }
+    if ( targetClass == Nil ) {
+        return value;
+    }
+    //  自訂的 model，複製成 targetClass 的新 object
+    NSArray *modelRules = rules ? *rules : nil;
+    if ( modelRules == nil ) {
+        modelRules = [KVCModel kh_copyRulesFrom:[value class] to:targetClass keyCorrespond:correspondDic];
+        if ( rules ) *rules = modelRules;
+    }
+    id object = [targetClass new];
+    [KVCModel kh_copyModel:value toObject:object rules:modelRules keyCorrespond:correspondDic];
+    return object;
 }
 
 
@@ -407,8 +1089,7 @@
     for ( NSInteger i=0; i<array.count; i++) {
         id dic = array[i];
         if ( [dic isKindOfClass:[NSDictionary class] ]) {
-            id object = [[cls alloc] init];
-            [KVCModel injectDictionary:dic toObject:object keyCorrespond:correspondDic];
+            id object = [KVCModel kh_objectOfClass:cls dictionary:dic keyCorrespond:correspondDic];
             [finalArray addObject:object];
         }
         else{
@@ -448,6 +1129,29 @@
     return finalArray;
 }
 
++(NSArray*)stringPropertyNamesOfClass:(Class)cls
+{
+    NSMutableArray *names = [[NSMutableArray alloc] init];
+    //  子類別的 property 排前面，不含 NSObject 本身的
+    for ( Class c = cls; c != nil && c != [NSObject class]; c = class_getSuperclass(c) ) {
+        unsigned int numOfProperties;
+        objc_property_t *properties = class_copyPropertyList( c, &numOfProperties );
+        for ( unsigned int pi = 0; pi < numOfProperties; pi++ ) {
+            objc_property_t property = properties[pi];
+            NSString *propertyType = [[NSString alloc] initWithCString:property_getAttributes(property) encoding:NSUTF8StringEncoding];
+            if ( ![propertyType hasPrefix:@"T@\"NSString\""] && ![propertyType hasPrefix:@"T@\"NSMutableString\""] ) {
+                continue;
+            }
+            NSString *propertyName = [[NSString alloc] initWithCString:property_getName(property) encoding:NSUTF8StringEncoding];
+            if ( ![names containsObject:propertyName] ) {
+                [names addObject:propertyName];
+            }
+        }
+        free( properties );
+    }
+    return names;
+}
+
 
 
 
@@ -6,7 +6,7 @@
 //
 
 #import <Foundation/Foundation.h>
-#import <UIKit/UIKit.h>
+#import "KHPlatform.h"
 
 @protocol KHArrayObserveDelegate
 
@@ -42,6 +42,11 @@
 //  Gevin note: 
 @property (nonatomic) BOOL isInsertMulti;
 
+//  除了 kh_delegate 以外，其他也要收到變動通知的物件，例如以這個 array 為 source 的 KHProjectedArray
+//  weak reference，不影響 kh_delegate
+- (void)kh_addObserver:(id<KHArrayObserveDelegate> _Nonnull)observer;
+- (void)kh_removeObserver:(id<KHArrayObserveDelegate> _Nonnull)observer;
+
 // Gevin note: 最後會呼叫 insertObject，所以只要留 insertObject 就好
 //- (void)kh_addObject:(id)object;
 
@@ -30,7 +30,8 @@
         //  Gevin note : 使用 NSMutableArray 必須直接指定使用 __NSArrayM 為 class name
         //               原因好像是說 NSMutableArray 它是一個 class cluster，它的實體會隱
         //               藏 class type，實際的 class type 就叫 __NSArrayM
-        Class class = NSClassFromString(@"__NSArrayM");  //[self class];
+        //               GNUstep 則是 GSMutableArray
+        Class class = NSClassFromString(KH_MUTABLE_ARRAY_CLASS_NAME);  //[self class];
         // When swizzling a class method, use the following:
         // Class class = object_getClass((id)self);
         
@@ -57,6 +58,8 @@
 - (void)setKh_delegate:(id)kh_delegate
 {
     objc_setAssociatedObject(self, @"kh_delegate", kh_delegate, OBJC_ASSOCIATION_RETAIN_NONATOMIC );
+    //  只有 kh_delegate 時 kh_observeDelegates 直接回傳這個，每次修改不用再產生 array
+    objc_setAssociatedObject(self, @"kh_delegates", kh_delegate ? @[kh_delegate] : nil, OBJC_ASSOCIATION_RETAIN_NONATOMIC );
 }
 
 -(id)kh_delegate
@@ -95,10 +98,45 @@
     return NO;
 }
 
+- (void)kh_addObserver:(id<KHArrayObserveDelegate>)observer
+{
+    NSHashTable *observers = objc_getAssociatedObject(self, @"kh_observers");
+    if ( observers == nil ) {
+        observers = [NSHashTable weakObjectsHashTable];
+        objc_setAssociatedObject(self, @"kh_observers", observers, OBJC_ASSOCIATION_RETAIN_NONATOMIC );
+    }
+    [observers addObject:observer];
+}
+
+- (void)kh_removeObserver:(id<KHArrayObserveDelegate>)observer
+{
+    NSHashTable *observers = objc_getAssociatedObject(self, @"kh_observers");
+    [observers removeObject:observer];
+}
+
+//  kh_delegate 在前，再來是 kh_addObserver: 加入的 observer，都沒有的話回傳 nil
+- (NSArray*)kh_observeDelegates
+{
+    NSHashTable *observers = objc_getAssociatedObject(self, @"kh_observers");
+    if ( observers.count == 0 ) {
+        return objc_getAssociatedObject(self, @"kh_delegates");
+    }
+    id delegate = self.kh_delegate;
+    NSMutableArray *delegates = [[NSMutableArray alloc] initWithCapacity: observers.count + 1 ];
+    if ( delegate ) {
+        [delegates addObject:delegate];
+    }
+    for ( id observer in observers ) {
+        [delegates addObject:observer];
+    }
+    return delegates;
+}
+
 
 - (void)kh_addObjectsFromArray:(NSArray*)otherArray
 {
-    if ( self.kh_delegate == nil ) {
+    NSArray *delegates = [self kh_observeDelegates];
+    if ( delegates == nil ) {
         [self kh_addObjectsFromArray:otherArray];
     }
     else{
@@ -109,13 +147,15 @@
         self.isInsertMulti = YES;
         [self kh_addObjectsFromArray:otherArray];
         
-        if ( [(NSObject*)self.kh_delegate respondsToSelector:@selector(arrayInsertSome:insertObjects:indexes:)] ) {
-            NSMutableArray *indexs = [NSMutableArray array];
-            for ( NSInteger i=0; i<otherArray.count; i++) {
-                NSIndexPath *index = [NSIndexPath indexPathForRow:self.count-otherArray.count+i inSection:self.section];
-                [indexs addObject:index];
+        NSMutableArray *indexs = [NSMutableArray array];
+        for ( NSInteger i=0; i<otherArray.count; i++) {
+            NSIndexPath *index = [NSIndexPath indexPathForRow:self.count-otherArray.count+i inSection:self.section];
+            [indexs addObject:index];
+        }
+        for ( id<KHArrayObserveDelegate> delegate in delegates ) {
+            if ( [(NSObject*)delegate respondsToSelector:@selector(arrayInsertSome:insertObjects:indexes:)] ) {
+                [delegate arrayInsertSome:self insertObjects:otherArray indexes:indexs];
             }
-            [self.kh_delegate arrayInsertSome:self insertObjects:otherArray indexes:indexs];
         }
         self.isInsertMulti = NO;
     }
@@ -123,7 +163,8 @@
 
 - (void)kh_insertObject:(id)anObject atIndex:(NSUInteger)index
 {
-    if ( self.kh_delegate == nil ) {
+    NSArray *delegates = [self kh_observeDelegates];
+    if ( delegates == nil ) {
         [self kh_insertObject:anObject atIndex:index];
     }
     else{
@@ -132,8 +173,10 @@
         //  呼叫 addObjectsFromArray，最後會呼叫到這裡，這樣就會變成呼叫多次 delegate 的 arrayInsert:insertObject:
         //  多加 self.isInsertMulti 這個屬性做判斷，如果是 addObjectsFromArray 就不呼叫 arrayInsert:insertObject:
         if ( self.isInsertMulti == NO ) {
-            if ( [(NSObject*)self.kh_delegate respondsToSelector:@selector(arrayInsert:insertObject:index:)] ) {
-                [self.kh_delegate arrayInsert:self insertObject:anObject index:[NSIndexPath indexPathForRow:index inSection:self.section]];
+            for ( id<KHArrayObserveDelegate> delegate in delegates ) {
+                if ( [(NSObject*)delegate respondsToSelector:@selector(arrayInsert:insertObject:index:)] ) {
+                    [delegate arrayInsert:self insertObject:anObject index:[NSIndexPath indexPathForRow:index inSection:self.section]];
+                }
             }
         }
     }
@@ -141,39 +184,46 @@
 
 - (void)kh_insertObjects:(NSArray *)objects atIndexes:(NSIndexSet *)indexes
 {
-    if ( self.kh_delegate == nil ) {
+    NSArray *delegates = [self kh_observeDelegates];
+    if ( delegates == nil ) {
         [self kh_insertObjects:objects atIndexes:indexes];
     }
     else{
         [self kh_insertObjects:objects atIndexes:indexes];
-        if ( [(NSObject*)self.kh_delegate respondsToSelector:@selector(arrayInsertSome:insertObjects:indexes:)] ) {
-            
-            NSMutableArray *indexArray = [[NSMutableArray alloc] init];
-            [indexes enumerateIndexesUsingBlock:^(NSUInteger idx, BOOL *stop){
-                [indexArray addObject:[NSIndexPath indexPathForRow:idx inSection:self.section]];
-            }];
-            [self.kh_delegate arrayInsertSome:self insertObjects:objects indexes:indexArray];
+        
+        NSMutableArray *indexArray = [[NSMutableArray alloc] init];
+        [indexes enumerateIndexesUsingBlock:^(NSUInteger idx, BOOL *stop){
+            [indexArray addObject:[NSIndexPath indexPathForRow:idx inSection:self.section]];
+        }];
+        for ( id<KHArrayObserveDelegate> delegate in delegates ) {
+            if ( [(NSObject*)delegate respondsToSelector:@selector(arrayInsertSome:insertObjects:indexes:)] ) {
+                [delegate arrayInsertSome:self insertObjects:objects indexes:indexArray];
+            }
         }
     }
 }
 
 - (void)kh_removeObjectAtIndex:(NSUInteger)index
 {
-    if ( self.kh_delegate == nil ) {
+    NSArray *delegates = [self kh_observeDelegates];
+    if ( delegates == nil ) {
         [self kh_removeObjectAtIndex:index];
     }
     else{
         id obj = [self objectAtIndex:index];
         [self kh_removeObjectAtIndex:index];
-        if ( [(NSObject*)self.kh_delegate respondsToSelector:@selector(arrayRemove:removeObject:index:)] ) {
-            [self.kh_delegate arrayRemove:self removeObject:obj index:[NSIndexPath indexPathForRow:index inSection:self.section]];
+        for ( id<KHArrayObserveDelegate> delegate in delegates ) {
+            if ( [(NSObject*)delegate respondsToSelector:@selector(arrayRemove:removeObject:index:)] ) {
+                [delegate arrayRemove:self removeObject:obj index:[NSIndexPath indexPathForRow:index inSection:self.section]];
+            }
         }
     }
 }
 
 - (void)kh_removeAllObjects
 {
-    if ( self.kh_delegate == nil ) {
+    NSArray *delegates = [self kh_observeDelegates];
+    if ( delegates == nil ) {
         [self kh_removeAllObjects];
     }
     else{
@@ -181,18 +231,17 @@
             return;
         }
         NSInteger cnt = self.count;
-        if ( [(NSObject*)self.kh_delegate respondsToSelector:@selector(arrayRemoveSome:removeObjects:indexs:)] ) {
-            NSArray *removeObjects = [self copy];
-            [self kh_removeAllObjects];
-            NSMutableArray *indexArr = [[NSMutableArray alloc] init];
-            for ( NSInteger i=0; i<cnt ; i++ ) {
-                NSIndexPath *idx = [NSIndexPath indexPathForRow:i inSection:self.section ];
-                [indexArr addObject: idx ];
-            }
-            [self.kh_delegate arrayRemoveSome:self removeObjects:removeObjects indexs:indexArr];
+        NSArray *removeObjects = [self copy];
+        [self kh_removeAllObjects];
+        NSMutableArray *indexArr = [[NSMutableArray alloc] init];
+        for ( NSInteger i=0; i<cnt ; i++ ) {
+            NSIndexPath *idx = [NSIndexPath indexPathForRow:i inSection:self.section ];
+            [indexArr addObject: idx ];
         }
-        else{
-            [self kh_removeAllObjects];
+        for ( id<KHArrayObserveDelegate> delegate in delegates ) {
+            if ( [(NSObject*)delegate respondsToSelector:@selector(arrayRemoveSome:removeObjects:indexs:)] ) {
+                [delegate arrayRemoveSome:self removeObjects:removeObjects indexs:indexArr];
+            }
         }
     }
 }
@@ -238,15 +287,17 @@
 
 - (void)kh_replaceObjectAtIndex:(NSUInteger)index withObject:(id)anObject
 {
-    if ( self.kh_delegate == nil ) {
+    NSArray *delegates = [self kh_observeDelegates];
+    if ( delegates == nil ) {
         [self kh_replaceObjectAtIndex:index withObject:anObject];
     }
     else{
         id oldObj = [self objectAtIndex:index];
         [self kh_replaceObjectAtIndex:index withObject:anObject];
-        if ( [(NSObject*)self.kh_delegate respondsToSelector:@selector(arrayReplace:newObject:replacedObject:index:)] ) {
-
-            [self.kh_delegate arrayReplace:self newObject:anObject replacedObject:oldObj index:[NSIndexPath indexPathForRow:index inSection:self.section]];
+        for ( id<KHArrayObserveDelegate> delegate in delegates ) {
+            if ( [(NSObject*)delegate respondsToSelector:@selector(arrayReplace:newObject:replacedObject:index:)] ) {
+                [delegate arrayReplace:self newObject:anObject replacedObject:oldObj index:[NSIndexPath indexPathForRow:index inSection:self.section]];
+            }
         }
     }
 }
@@ -267,17 +318,20 @@
         return;
     }
     
-    if ( self.kh_delegate && [(NSObject*)self.kh_delegate respondsToSelector:@selector(arrayUpdate:update:index:)] ) {
-        [self.kh_delegate arrayUpdate:self update:anObject index:[NSIndexPath indexPathForRow:idx inSection:self.section]];
+    for ( id<KHArrayObserveDelegate> delegate in [self kh_observeDelegates] ) {
+        if ( [(NSObject*)delegate respondsToSelector:@selector(arrayUpdate:update:index:)] ) {
+            [delegate arrayUpdate:self update:anObject index:[NSIndexPath indexPathForRow:idx inSection:self.section]];
+        }
     }
 }
 
 - (void)updateAll
 {
-    if ( self.kh_delegate && [(NSObject*)self.kh_delegate respondsToSelector:@selector(arrayUpdateAll:)] ) {
-        [self.kh_delegate arrayUpdateAll:self];
+    for ( id<KHArrayObserveDelegate> delegate in [self kh_observeDelegates] ) {
+        if ( [(NSObject*)delegate respondsToSelector:@selector(arrayUpdateAll:)] ) {
+            [delegate arrayUpdateAll:self];
+        }
     }
-    
 }
 
 
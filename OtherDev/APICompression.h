@@ -0,0 +1,60 @@
+//
+//  APICompression.h
+//
+//  Created by Calvin Huang on 2017/3/13.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ *  APIOperation 用的 gzip / deflate 壓縮，使用系統的 zlib (要 link libz)
+ *
+ *  request body 用 gzipData: 壓縮後加上 Content-Encoding: gzip
+ *  response 用 APIInflateStream 逐段解壓，解出來的資料直接交給 outputBlock，不會留著整份壓縮前或壓縮後的資料
+ */
+
+extern NSString *const APICompressionErrorDomain;
+
+typedef NS_ENUM(NSInteger, APIContentEncoding) {
+    APIContentEncodingIdentity = 0,
+    APIContentEncodingGzip,
+    //  HTTP 的 deflate 是 zlib 格式
+    APIContentEncodingDeflate,
+};
+
+@interface APICompression : NSObject
+
++ (NSData*)gzipData:(NSData*)data;
++ (NSData*)deflateData:(NSData*)data;
+
+//  gzip 或 zlib 格式，自動判斷
++ (NSData*)inflateData:(NSData*)data error:(NSError**)error;
+
+//  response 的 Content-Encoding，不認得的當成 identity
++ (APIContentEncoding)encodingOfResponse:(NSHTTPURLResponse*)response;
+
+//  依開頭的 magic number 判斷資料是不是真的還是壓縮的，至少要 2 byte
+//  NSURLSession 會自己解開 gzip / deflate，但 response header 還是會留著 Content-Encoding
++ (BOOL)isCompressedData:(NSData*)data encoding:(APIContentEncoding)encoding;
+
+@end
+
+
+@interface APIInflateStream : NSObject
+
+//  每解出一段就呼叫，在 appendData: 的 thread 執行
+@property (nonatomic,copy) void(^outputBlock)(NSData *data);
+
+//  收到的壓縮資料長度
+@property (nonatomic,readonly) NSUInteger inputLength;
+//  解壓後的長度
+@property (nonatomic,readonly) NSUInteger outputLength;
+
+//  資料錯誤時回傳 NO，之後的資料都不再處理
+- (BOOL)appendData:(NSData*)data error:(NSError**)error;
+
+//  資料都收完了，檢查有沒有被截斷
+- (BOOL)finish:(NSError**)error;
+
+@end
@@ -0,0 +1,209 @@
+//
+//  APICompression.m
+//
+//  Created by Calvin Huang on 2017/3/13.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import "APICompression.h"
+#import <zlib.h>
+
+NSString *const APICompressionErrorDomain = @"APICompression";
+
+//  windowBits 加 16 是 gzip 格式，加 32 是自動判斷 gzip / zlib
+#define API_ZLIB_WINDOW_BITS 15
+#define API_INFLATE_BUFFER_SIZE 16384
+
+static NSError* APICompressionError( int status, const char *message )
+{
+    NSString *reason = message ? [NSString stringWithUTF8String:message] : [NSString stringWithFormat:@"zlib error %d", status];
+    return [NSError errorWithDomain:APICompressionErrorDomain code:status userInfo:@{ NSLocalizedDescriptionKey:reason }];
+}
+
+static NSData* APIDeflate( NSData *data, int windowBits )
+{
+    z_stream stream;
+    memset( &stream, 0, sizeof(stream) );
+    if ( deflateInit2( &stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, windowBits, 8, Z_DEFAULT_STRATEGY ) != Z_OK ) {
+        return nil;
+    }
+    //  一次壓完，輸出大小不會超過 deflateBound
+    NSMutableData *output = [NSMutableData dataWithLength: deflateBound( &stream, (uLong)data.length ) ];
+    stream.next_in = (Bytef*)data.bytes;
+    stream.avail_in = (uInt)data.length;
+    stream.next_out = output.mutableBytes;
+    stream.avail_out = (uInt)output.length;
+    int status = deflate( &stream, Z_FINISH );
+    [output setLength: stream.total_out ];
+    deflateEnd( &stream );
+    return status == Z_STREAM_END ? output : nil;
+}
+
+
+@implementation APICompression
+
++ (NSData*)gzipData:(NSData*)data
+{
+    return APIDeflate( data, API_ZLIB_WINDOW_BITS + 16 );
+}
+
++ (NSData*)deflateData:(NSData*)data
+{
+    return APIDeflate( data, API_ZLIB_WINDOW_BITS );
+}
+
++ (NSData*)inflateData:(NSData*)data error:(NSError**)error
+{
+    NSMutableData *output = [[NSMutableData alloc] initWithCapacity: data.length * 4 ];
+    APIInflateStream *stream = [[APIInflateStream alloc] init];
+    stream.outputBlock = ^(NSData *chunk) {
+        [output appendData:chunk];
+    };
+    if ( ![stream appendData:data error:error] || ![stream finish:error] ) {
+        return nil;
+    }
+    return output;
+}
+
++ (APIContentEncoding)encodingOfResponse:(NSHTTPURLResponse*)response
+{
+    NSDictionary *headers = response.allHeaderFields;
+    for ( NSString *key in headers ) {
+        if ( [key caseInsensitiveCompare:@"Content-Encoding"] != NSOrderedSame ) {
+            continue;
+        }
+        NSString *value = [[headers[key] stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]] lowercaseString];
+        if ( [value isEqualToString:@"gzip"] || [value isEqualToString:@"x-gzip"] ) {
+            return APIContentEncodingGzip;
+        }
+        if ( [value isEqualToString:@"deflate"] ) {
+            return APIContentEncodingDeflate;
+        }
+    }
+    return APIContentEncodingIdentity;
+}
+
++ (BOOL)isCompressedData:(NSData*)data encoding:(APIContentEncoding)encoding
+{
+    if ( data.length < 2 ) {
+        return NO;
+    }
+    const uint8_t *bytes = data.bytes;
+    switch ( encoding ) {
+        case APIContentEncodingGzip:
+            return bytes[0] == 0x1f && bytes[1] == 0x8b;
+        case APIContentEncodingDeflate:
+            //  zlib header：CM 為 8，而且前兩個 byte 是 31 的倍數
+            return ( bytes[0] & 0x0f ) == 8 && ( bytes[0] * 256 + bytes[1] ) % 31 == 0;
+        default:
+            return NO;
+    }
+}
+
+@end
+
+
+@implementation APIInflateStream
+{
+    z_stream _stream;
+    BOOL _initialized;
+    //  目前的 gzip member 已經結束
+    BOOL _streamEnded;
+    NSError *_failError;
+}
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self) {
+        memset( &_stream, 0, sizeof(_stream) );
+        int status = inflateInit2( &_stream, API_ZLIB_WINDOW_BITS + 32 );
+        if ( status == Z_OK ) {
+            _initialized = YES;
+        }
+        else{
+            _failError = APICompressionError( status, _stream.msg );
+        }
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    if ( _initialized ) {
+        inflateEnd( &_stream );
+    }
+}
+
+- (BOOL)appendData:(NSData*)data error:(NSError**)error
+{
+    if ( _failError ) {
+        if ( error ) *error = _failError;
+        return NO;
+    }
+    if ( data.length == 0 ) {
+        return YES;
+    }
+    _inputLength += data.length;
+
+    //  輸出用固定大小的 buffer，解出一段就交出去
+    uint8_t buffer[API_INFLATE_BUFFER_SIZE];
+    _stream.next_in = (Bytef*)data.bytes;
+    _stream.avail_in = (uInt)data.length;
+    do {
+        //  gzip 可以由好幾個 member 接在一起
+        if ( _streamEnded ) {
+            inflateReset( &_stream );
+            _streamEnded = NO;
+        }
+        _stream.next_out = buffer;
+        _stream.avail_out = sizeof(buffer);
+        int status = inflate( &_stream, Z_NO_FLUSH );
+
+        NSUInteger produced = sizeof(buffer) - _stream.avail_out;
+        if ( produced > 0 ) {
+            _outputLength += produced;
+            if ( _outputBlock ) {
+                _outputBlock( [NSData dataWithBytes:buffer length:produced] );
+            }
+        }
+
+        if ( status == Z_STREAM_END ) {
+            _streamEnded = YES;
+            if ( _stream.avail_in == 0 ) {
+                break;
+            }
+        }
+        //  輸入用完了，等下一段
+        else if ( status == Z_BUF_ERROR ) {
+            break;
+        }
+        else if ( status != Z_OK ) {
+            _failError = APICompressionError( status, _stream.msg );
+            if ( error ) *error = _failError;
+            return NO;
+        }
+    } while ( _stream.avail_in > 0 || _stream.avail_out == 0 );
+
+    //  不要留著指向呼叫端資料的指標
+    _stream.next_in = NULL;
+    _stream.avail_in = 0;
+    return YES;
+}
+
+- (BOOL)finish:(NSError**)error
+{
+    if ( _failError ) {
+        if ( error ) *error = _failError;
+        return NO;
+    }
+    //  沒有 body (例如 HEAD、304) 不算錯誤
+    if ( _inputLength > 0 && !_streamEnded ) {
+        _failError = APICompressionError( Z_DATA_ERROR, "compressed data is truncated" );
+        if ( error ) *error = _failError;
+        return NO;
+    }
+    return YES;
+}
+
+@end
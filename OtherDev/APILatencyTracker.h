@@ -0,0 +1,39 @@
+//
+//  APILatencyTracker.h
+//
+//  Created by Calvin Huang on 2017/3/12.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ *  記錄每個 endpoint 的回應時間 (收到 response header 的時間)
+ *
+ *  每個 endpoint 一個 histogram，bucket 寬度每格大 10%，範圍 1ms ~ 90 秒
+ *  樣本數超過 maxSamples 時所有 bucket 減半，讓舊的資料慢慢淡出，跟得上 server 的變化
+ *
+ *  endpoint 是 method + host + path，不含 query
+ *  thread safe
+ */
+@interface APILatencyTracker : NSObject
+
+//  樣本數少於這個數量時，percentile 回傳 0，預設 20
+@property (nonatomic) NSUInteger minimumSamples;
+//  預設 1000
+@property (nonatomic) NSUInteger maxSamples;
+
++ (instancetype)sharedTracker;
+
++ (NSString*)endpointWithMethod:(NSString*)method url:(NSURL*)url;
+
+- (void)recordLatency:(NSTimeInterval)latency forEndpoint:(NSString*)endpoint;
+
+//  percentile 介於 0~1，例如 0.99，回傳秒數，樣本不夠時回傳 0
+- (NSTimeInterval)latencyAtPercentile:(double)percentile forEndpoint:(NSString*)endpoint;
+
+- (NSUInteger)sampleCountForEndpoint:(NSString*)endpoint;
+
+- (void)reset;
+
+@end
@@ -0,0 +1,129 @@
+//
+//  APILatencyTracker.m
+//
+//  Created by Calvin Huang on 2017/3/12.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import "APILatencyTracker.h"
+
+//  bucket i 的上限是 1.1^(i+1) ms，120 格到 1.1^120 ms ≈ 92 秒
+#define API_LATENCY_BUCKETS 120
+#define API_LATENCY_GROWTH 1.1
+
+@interface APILatencyHistogram : NSObject
+{
+@public
+    double _buckets[API_LATENCY_BUCKETS];
+    double _count;
+}
+
+@end
+
+@implementation APILatencyHistogram
+
+@end
+
+
+@implementation APILatencyTracker
+{
+    //  key: endpoint  value: APILatencyHistogram
+    NSMutableDictionary *_histogramDic;
+}
+
++ (instancetype)sharedTracker
+{
+    static APILatencyTracker *tracker = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        tracker = [[APILatencyTracker alloc] init];
+    });
+    return tracker;
+}
+
++ (NSString*)endpointWithMethod:(NSString*)method url:(NSURL*)url
+{
+    return [NSString stringWithFormat:@"%@ %@%@", method, url.host, url.path];
+}
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self) {
+        _minimumSamples = 20;
+        _maxSamples = 1000;
+        _histogramDic = [[NSMutableDictionary alloc] initWithCapacity: 10 ];
+    }
+    return self;
+}
+
+static NSInteger APILatencyBucket( NSTimeInterval latency )
+{
+    double ms = latency * 1000;
+    if ( ms <= 1 ) {
+        return 0;
+    }
+    NSInteger index = (NSInteger)floor( log(ms) / log(API_LATENCY_GROWTH) );
+    return MIN( MAX( index, 0 ), API_LATENCY_BUCKETS - 1 );
+}
+
+- (void)recordLatency:(NSTimeInterval)latency forEndpoint:(NSString*)endpoint
+{
+    if ( endpoint == nil || latency < 0 ) {
+        return;
+    }
+    @synchronized(self) {
+        APILatencyHistogram *histogram = _histogramDic[endpoint];
+        if ( histogram == nil ) {
+            histogram = [[APILatencyHistogram alloc] init];
+            _histogramDic[endpoint] = histogram;
+        }
+        histogram->_buckets[ APILatencyBucket( latency ) ] += 1;
+        histogram->_count += 1;
+        
+        //  減半，舊的樣本權重越來越低
+        if ( histogram->_count > _maxSamples ) {
+            for ( NSInteger i=0; i<API_LATENCY_BUCKETS; i++ ) {
+                histogram->_buckets[i] *= 0.5;
+            }
+            histogram->_count *= 0.5;
+        }
+    }
+}
+
+- (NSTimeInterval)latencyAtPercentile:(double)percentile forEndpoint:(NSString*)endpoint
+{
+    @synchronized(self) {
+        APILatencyHistogram *histogram = _histogramDic[endpoint];
+        if ( histogram == nil || histogram->_count < _minimumSamples ) {
+            return 0;
+        }
+        double target = histogram->_count * MIN( MAX( percentile, 0 ), 1 );
+        double sum = 0;
+        for ( NSInteger i=0; i<API_LATENCY_BUCKETS; i++ ) {
+            sum += histogram->_buckets[i];
+            if ( sum >= target && histogram->_buckets[i] > 0 ) {
+                //  回傳 bucket 的上限，寧可估高一點
+                return pow( API_LATENCY_GROWTH, i + 1 ) / 1000.0;
+            }
+        }
+        return pow( API_LATENCY_GROWTH, API_LATENCY_BUCKETS ) / 1000.0;
+    }
+}
+
+- (NSUInteger)sampleCountForEndpoint:(NSString*)endpoint
+{
+    @synchronized(self) {
+        APILatencyHistogram *histogram = _histogramDic[endpoint];
+        return histogram ? (NSUInteger)histogram->_count : 0;
+    }
+}
+
+- (void)reset
+{
+    @synchronized(self) {
+        [_histogramDic removeAllObjects];
+    }
+}
+
+@end
@@ -7,12 +7,23 @@
 //
 
 #import <Foundation/Foundation.h>
+#import "APIResponseCache.h"
+#import "APILatencyTracker.h"
+#import "APICompression.h"
 
 @class APIOperation;
 // api response block
 typedef void(^APIOperationResponse)(APIOperation* api, id responseObject );
 typedef void(^APIOperationError)(APIOperation* api, NSError* error );
 
+//  不是連線造成的錯誤
+extern NSString *const APIOperationErrorDomain;
+
+typedef NS_ENUM(NSInteger, APIOperationErrorCode) {
+    //  建立 request 時發生 exception，例如 body 無法序列化，reason 在 localizedDescription
+    APIOperationErrorInvalidRequest = 1,
+};
+
 
 @protocol APIDataSerializeDelegate
 
@@ -23,9 +34,30 @@ typedef void(^APIOperationError)(APIOperation* api, NSError* error );
 // override by subclass
 - (id)unSerialize:(APIOperation*)api data:(NSData*)data;
 
+//  逐段解序列化
+//  unserializer 有實作 unSerialize:didReceiveData: 的話，收到的資料會一段一段送進來，不會先整個存起來
+//  收到 response header 時會先呼叫 unSerializeBegin:，全部收完後呼叫 unSerializeDidFinish: 取得結果
+//  這種 unserializer 有狀態，每個 operation 要用自己的 instance
+- (void)unSerializeBegin:(APIOperation*)api;
+- (void)unSerialize:(APIOperation*)api didReceiveData:(NSData*)data;
+- (id)unSerializeDidFinish:(APIOperation*)api;
+//  unSerializeDidFinish: 之後呼叫，有回傳錯誤的話，當作失敗呼叫 fail block，也不存入 cache
+- (NSError*)unSerializeError:(APIOperation*)api;
+
 @end
 
 
+typedef NS_ENUM(NSInteger, APICachePolicy) {
+    //  依 response 的 Cache-Control，沒過期直接用 cache，過期用 If-None-Match / If-Modified-Since 重新驗證
+    //  在 stale-while-revalidate 時間內的，先回傳 cache 再重新驗證
+    APICachePolicyDefault = 0,
+    //  不讀也不寫 cache
+    APICachePolicyIgnoreCache,
+    //  有 cache 就先回傳 (就算過期)，再重新驗證，讓畫面可以馬上顯示
+    APICachePolicyStaleWhileRevalidate,
+};
+
+
 // serialize block
 typedef NSData* (^APIDataSerializer)(APIOperation* api,id requestObj );
 typedef id (^APIDataUnserializer)(APIOperation* api,NSData*data);
@@ -65,10 +97,25 @@ typedef id (^APIDataUnserializer)(APIOperation* api,NSData*data);
 
 
 
+/**
+ *  非同步的 NSOperation，所有 operation 共用一個 NSURLSession，同一個 host 的連線會重用
+ *  送出 request 後就不佔用 operation queue 的 thread，收到的資料直接交給 unserializer
+ *  cancel 後不會呼叫 response / fail block
+ *
+ *  同時有相同的 GET (method、加上 param 後的網址、body 都相同)，只會送出一個 request，結果分給每個 operation
+ *  有設定 responseCache 時，GET 會依 cachePolicy 使用 cache
+ *  回傳過期的 cache 後重新驗證，內容有變的話會再呼叫一次 response block
+ *
+ *  每個 endpoint 的回應時間記在 latencyTracker，timeout 依 p99 調整
+ *  GET、HEAD、PUT、DELETE、OPTIONS 遇到連線錯誤或 502/503/504 會隨機延遲後重試
+ *  hedged 的 GET 超過 p95 還沒有回應時，會再送一個相同的 request，用先回應的那個
+ *
+ *  gzip / deflate 的 response 邊收邊解壓，直接交給 unserializer
+ */
 @interface APIOperation : NSOperation
 {
     
-    NSURLConnection *conn;
+    NSURLSessionDataTask *_task;
     
 //    NSMutableURLRequest *request;
     
@@ -91,16 +138,38 @@ typedef id (^APIDataUnserializer)(APIOperation* api,NSData*data);
 @property (nonatomic) NSString* method; // GET or POST , PUT , DELETE
 @property (nonatomic) NSDictionary* param;
 @property (nonatomic) NSData* body;
-@property (nonatomic) NSOperationQueue* queue;
+@property (nonatomic) NSOperationQueue* queue; // response / fail block 在哪個 queue 執行，nil 的話在 session 的 delegate queue 執行
+@property (nonatomic) NSTimeInterval timeoutInterval; // 預設 15 秒，adaptiveTimeout 時為上限
+@property (nonatomic) APILatencyTracker* latencyTracker; // 預設 sharedTracker，nil 不記錄
+@property (nonatomic) BOOL adaptiveTimeout; // 依 endpoint 的 p99 設定 timeout，樣本不足時用 timeoutInterval，預設 YES
+@property (nonatomic) NSUInteger maxRetryCount; // 最多重試幾次，只用在 idempotent 的 method，預設 2
+@property (nonatomic) NSTimeInterval retryBaseDelay; // 第 n 次重試在 0 ~ retryBaseDelay * 2^(n-1) 之間隨機等待，預設 0.2 秒
+@property (nonatomic) BOOL hedged; // 只用在 GET，預設 NO
+@property (nonatomic) NSUInteger requestCompressionThreshold; // body 超過這個大小 (byte) 時用 gzip 壓縮，server 要能處理 Content-Encoding，預設 0 不壓縮
+@property (nonatomic,readonly) NSUInteger receivedBytes; // 收到的 body 長度 (解壓前)
+@property (nonatomic,readonly) NSUInteger decodedBytes; // 解壓後的 body 長度
+@property (nonatomic,readonly) NSUInteger retryCount; // 已經重試的次數
+@property (nonatomic,readonly) BOOL hedgeWon; // 用的是 hedge request 的回應
+@property (nonatomic) APICachePolicy cachePolicy;
+@property (nonatomic,readonly) BOOL fromCache; // 這次 response block 收到的是 cache 的內容
 @property (nonatomic) id<APIDataSerializeDelegate> serializer; // 序列化物件
 @property (nonatomic) id<APIDataSerializeDelegate> unserializer; // 解序列化函式指標
 @property (nonatomic,readonly) NSString* result;    // 收到的結果
 @property (nonatomic) int statusCode;   // api 回應狀態碼
+@property (nonatomic,readonly) NSHTTPURLResponse* response;
 @property (nonatomic) BOOL debug;
 
 
 -(instancetype)initWithSerializer:(id)serializer unserializer:(id)unserializer;
 
+//  共用 session 的設定，設定後新的 request 會用新的 session，nil 表示用 defaultSessionConfiguration
++ (void)setSessionConfiguration:(NSURLSessionConfiguration*)configuration;
++ (NSURLSessionConfiguration*)sessionConfiguration;
+
+//  共用的 response cache，預設 nil 不使用
++ (void)setResponseCache:(APIResponseCache*)cache;
++ (APIResponseCache*)responseCache;
+
 -(void)GET:(NSString*)api
      param:(NSDictionary*)param
       body:(id)body
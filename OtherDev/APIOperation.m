@@ -8,6 +8,9 @@
 
 #import "APIOperation.h"
 #import "Base64Utility.h"
+#import "APICompression.h"
+
+NSString *const APIOperationErrorDomain = @"APIOperation";
 
 
 @implementation BlockDataSerializer
@@ -134,9 +137,284 @@
 
 //----------------------------------------------------
 
+@interface APIOperation ()
+
+- (void)task:(NSURLSessionTask*)task didReceiveResponse:(NSURLResponse*)response;
+- (void)task:(NSURLSessionTask*)task didReceiveData:(NSData*)data;
+- (void)task:(NSURLSessionTask*)task didCompleteWithError:(NSError*)error;
+
+@end
+
+
+//  所有 APIOperation 共用一個 NSURLSession，session 只有一個 delegate，再依 task 轉給對應的 operation
+//  相同的 GET 共用一個 task，task 的 callback 會轉給掛在上面的每個 operation
+@interface APISessionTransport : NSObject <NSURLSessionDataDelegate>
+
+@property (nonatomic,copy) NSURLSessionConfiguration *configuration;
+
++ (instancetype)sharedTransport;
+
+//  送出 request，回傳 operation 掛上的 task
+//  coalesceKey 相同而且還沒收到 response 的 task，直接共用不另外送出
+- (NSURLSessionDataTask*)startRequest:(NSURLRequest*)request coalesceKey:(NSString*)coalesceKey operation:(APIOperation*)operation;
+
+//  operation 不再接收 task 的 callback，task 上沒有其他 operation 時就 cancel task
+- (void)detachOperation:(APIOperation*)operation fromTask:(NSURLSessionTask*)task;
+
+@end
+
+@implementation APISessionTransport
+{
+    NSURLSession *_session;
+    
+    //  session 的 delegate queue，必須是 serial，同一個 task 的 callback 才會依序
+    NSOperationQueue *_delegateQueue;
+    
+    //  key: [NSValue valueWithNonretainedObject:task]  value: NSMutableArray<APIOperation>
+    NSMutableDictionary *_operationDic;
+    
+    //  還沒收到 response 的 GET，之後相同的 request 可以加入
+    //  key: coalesceKey  value: task
+    NSMutableDictionary *_inflightDic;
+    
+    //  key: [NSValue valueWithNonretainedObject:task]  value: coalesceKey
+    NSMutableDictionary *_coalesceKeyDic;
+}
+
++ (instancetype)sharedTransport
+{
+    static APISessionTransport *transport = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        transport = [[APISessionTransport alloc] init];
+    });
+    return transport;
+}
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self) {
+        _operationDic = [[NSMutableDictionary alloc] initWithCapacity: 10 ];
+        _inflightDic = [[NSMutableDictionary alloc] initWithCapacity: 10 ];
+        _coalesceKeyDic = [[NSMutableDictionary alloc] initWithCapacity: 10 ];
+        _delegateQueue = [[NSOperationQueue alloc] init];
+        _delegateQueue.maxConcurrentOperationCount = 1;
+        _delegateQueue.name = @"APIOperation.session";
+    }
+    return self;
+}
+
+- (NSURLSessionConfiguration*)configuration
+{
+    @synchronized(self) {
+        return _configuration;
+    }
+}
+
+- (void)setConfiguration:(NSURLSessionConfiguration*)configuration
+{
+    @synchronized(self) {
+        _configuration = [configuration copy];
+        //  舊的 session 等進行中的 task 結束後再釋放
+        [_session finishTasksAndInvalidate];
+        _session = nil;
+    }
+}
+
+- (NSURLSessionDataTask*)startRequest:(NSURLRequest*)request coalesceKey:(NSString*)coalesceKey operation:(APIOperation*)operation
+{
+    NSURLSessionDataTask *task = nil;
+    @synchronized(self) {
+        if ( coalesceKey ) {
+            task = _inflightDic[coalesceKey];
+            if ( task ) {
+                [_operationDic[[NSValue valueWithNonretainedObject:task]] addObject:operation];
+                return task;
+            }
+        }
+        if ( _session == nil ) {
+            NSURLSessionConfiguration *configuration = _configuration;
+            if ( configuration == nil ) {
+                configuration = [NSURLSessionConfiguration defaultSessionConfiguration];
+                configuration.HTTPShouldSetCookies = NO;
+            }
+            _session = [NSURLSession sessionWithConfiguration:configuration delegate:self delegateQueue:_delegateQueue];
+        }
+        task = [_session dataTaskWithRequest:request];
+        NSValue *taskKey = [NSValue valueWithNonretainedObject:task];
+        _operationDic[taskKey] = [NSMutableArray arrayWithObject:operation];
+        if ( coalesceKey ) {
+            _inflightDic[coalesceKey] = task;
+            _coalesceKeyDic[taskKey] = coalesceKey;
+        }
+    }
+    [task resume];
+    return task;
+}
+
+- (void)detachOperation:(APIOperation*)operation fromTask:(NSURLSessionTask*)task
+{
+    BOOL cancelTask = NO;
+    @synchronized(self) {
+        NSValue *taskKey = [NSValue valueWithNonretainedObject:task];
+        NSMutableArray *operations = _operationDic[taskKey];
+        if ( operations == nil ) {
+            return;
+        }
+        [operations removeObjectIdenticalTo:operation];
+        if ( operations.count == 0 ) {
+            [_operationDic removeObjectForKey:taskKey];
+            [self removeInflightTask:taskKey];
+            cancelTask = YES;
+        }
+    }
+    if ( cancelTask ) {
+        [task cancel];
+    }
+}
+
+//  已經開始收資料的 task 不能再加入，後來的 operation 會漏掉前面的資料
+- (void)removeInflightTask:(NSValue*)taskKey
+{
+    NSString *coalesceKey = _coalesceKeyDic[taskKey];
+    if ( coalesceKey ) {
+        [_inflightDic removeObjectForKey:coalesceKey];
+        [_coalesceKeyDic removeObjectForKey:taskKey];
+    }
+}
+
+- (NSArray*)operationsForTask:(NSURLSessionTask*)task
+{
+    NSValue *taskKey = [NSValue valueWithNonretainedObject:task];
+    @synchronized(self) {
+        return [_operationDic[taskKey] copy];
+    }
+}
+
+#pragma mark - NSURLSessionDataDelegate
+
+- (void)URLSession:(NSURLSession *)session dataTask:(NSURLSessionDataTask *)dataTask didReceiveResponse:(NSURLResponse *)response completionHandler:(void (^)(NSURLSessionResponseDisposition))completionHandler
+{
+    NSArray *operations = nil;
+    @synchronized(self) {
+        NSValue *taskKey = [NSValue valueWithNonretainedObject:dataTask];
+        [self removeInflightTask:taskKey];
+        operations = [_operationDic[taskKey] copy];
+    }
+    for ( APIOperation *operation in operations ) {
+        [operation task:dataTask didReceiveResponse:response];
+    }
+    completionHandler( NSURLSessionResponseAllow );
+}
+
+- (void)URLSession:(NSURLSession *)session dataTask:(NSURLSessionDataTask *)dataTask didReceiveData:(NSData *)data
+{
+    for ( APIOperation *operation in [self operationsForTask:dataTask] ) {
+        [operation task:dataTask didReceiveData:data];
+    }
+}
+
+- (void)URLSession:(NSURLSession *)session task:(NSURLSessionTask *)task didCompleteWithError:(NSError *)error
+{
+    NSArray *operations = nil;
+    @synchronized(self) {
+        NSValue *taskKey = [NSValue valueWithNonretainedObject:task];
+        [self removeInflightTask:taskKey];
+        operations = _operationDic[taskKey];
+        [_operationDic removeObjectForKey:taskKey];
+    }
+    for ( APIOperation *operation in operations ) {
+        [operation task:task didCompleteWithError:error];
+    }
+}
+
+@end
+
+
+//----------------------------------------------------
+
+//  adaptive timeout 為 p99 的幾倍
+#define API_TIMEOUT_P99_MULTIPLIER 3
+//  adaptive timeout 的下限
+#define API_MINIMUM_TIMEOUT 1.0
+//  重試前最多等多久
+#define API_MAXIMUM_RETRY_DELAY 5.0
 
 
 @implementation APIOperation
+{
+    BOOL _executing;
+    BOOL _finished;
+    
+    //  unserializer 可以逐段解序列化
+    BOOL _streaming;
+    
+    //  cache 用的 key，沒有使用 cache 時為 nil
+    NSString *_cacheKey;
+    //  送出條件式 request 時的 cache
+    APICacheEntry *_cacheEntry;
+    //  收到 304，cache 的內容還是最新的
+    BOOL _notModified;
+    //  已經先回傳過期的 cache，正在重新驗證
+    BOOL _servedStale;
+    //  這次的 response 要存入 cache
+    BOOL _shouldStore;
+    //  逐段解序列化時，另外留一份 body 存入 cache
+    NSMutableData *_cacheData;
+    
+    //  加上 cache 條件後的 request，重試與 hedge 都用這個
+    NSURLRequest *_request;
+    //  latency tracker 用的 key
+    NSString *_endpoint;
+    //  這次嘗試的 primary request 送出的時間，hedge 先回應也用它記錄 latency
+    //  hedge 是等到 p95 才送的，用 hedge 自己的時間會讓 p95 越記越小
+    CFAbsoluteTime _taskStartTime;
+    //  hedge request，還沒決定用哪一個回應前才會有
+    NSURLSessionDataTask *_hedgeTask;
+    //  這次嘗試已經收到 response
+    BOOL _responseReceived;
+    //  收到可重試的 status code，body 不用解，結束後重試
+    BOOL _retryPending;
+    //  等待重試中，沒有 task
+    BOOL _waitingRetry;
+    //  有一次嘗試逾時，之後的重試用完整的 timeoutInterval
+    BOOL _timedOut;
+    
+    //  response 的 Content-Encoding
+    APIContentEncoding _contentEncoding;
+    //  有 Content-Encoding 時，先收 2 byte 判斷資料是不是已經被 NSURLSession 解開
+    NSMutableData *_sniffData;
+    //  逐段解壓縮
+    APIInflateStream *_inflater;
+    NSError *_decodeError;
+}
+
+static APIResponseCache *sharedResponseCache = nil;
+
++ (void)setSessionConfiguration:(NSURLSessionConfiguration*)configuration
+{
+    [APISessionTransport sharedTransport].configuration = configuration;
+}
+
++ (NSURLSessionConfiguration*)sessionConfiguration
+{
+    return [APISessionTransport sharedTransport].configuration;
+}
+
++ (void)setResponseCache:(APIResponseCache*)cache
+{
+    @synchronized(self) {
+        sharedResponseCache = cache;
+    }
+}
+
++ (APIResponseCache*)responseCache
+{
+    @synchronized(self) {
+        return sharedResponseCache;
+    }
+}
 
 -(instancetype)init
 {
@@ -153,7 +431,11 @@
         _serializer = serializer;
         _unserializer = unserializer;
         _receiveData = [[NSMutableData alloc] init];
-        _queue = [NSOperationQueue mainQueue];
+        _timeoutInterval = 15;
+        _latencyTracker = [APILatencyTracker sharedTracker];
+        _adaptiveTimeout = YES;
+        _maxRetryCount = 2;
+        _retryBaseDelay = 0.2;
     }
     return self;
     
@@ -257,127 +539,774 @@
     
 }
 
-- (void)main
+#pragma mark - NSOperation
+
+- (BOOL)isAsynchronous
+{
+    return YES;
+}
+
+- (BOOL)isConcurrent
+{
+    return YES;
+}
+
+- (BOOL)isExecuting
+{
+    @synchronized(self) {
+        return _executing;
+    }
+}
+
+- (BOOL)isFinished
 {
+    @synchronized(self) {
+        return _finished;
+    }
+}
+
+- (void)start
+{
+    if ( self.isCancelled ) {
+        [self finish];
+        return;
+    }
+    
+    [self willChangeValueForKey:@"isExecuting"];
+    @synchronized(self) {
+        _executing = YES;
+    }
+    [self didChangeValueForKey:@"isExecuting"];
+    
     @autoreleasepool {
-        
-        NSMutableURLRequest* request=[[NSMutableURLRequest alloc]init];
-        
-        // api + param
-        //-----------------------------
-        NSString* api = _apiUrl;
-        if ( _param ) {
-            api = [self url:api combineParam:_param ];
+        //  exception 不能丟出 start，不然 operation 一直是 executing，queue 的位置也不會釋放
+        @try {
+            [self startRequest];
         }
-        
-        //  建立 NSURL
-        //-----------------------------
-        [request setURL: [NSURL URLWithString:api] ];
-        
-        // request method
-        //-----------------------------
-        [request setHTTPMethod: _method ];
-        
-        if ( _debug ) {
-            printf("%s %s\n", [_method UTF8String], [api UTF8String]);
+        @catch (NSException *exception) {
+            NSDictionary *userInfo = @{ NSLocalizedDescriptionKey: exception.reason ?: exception.name,
+                                        @"exceptionName": exception.name };
+            NSError *error = [NSError errorWithDomain:APIOperationErrorDomain code:APIOperationErrorInvalidRequest userInfo:userInfo];
+            [self performCallback:^{
+                if ( _apiFailBlock ) {
+                    _apiFailBlock( self, error );
+                }
+            } finish:YES];
         }
-        
-        // body 做序列化
-        //-----------------------------
-        id serialBody = nil;
-        if( _body  ){
-            if ( _serializer ) {
-                serialBody = [_serializer serialize:self data:_body];
+    }
+}
+
+- (void)startRequest
+{
+    NSMutableURLRequest *request = [self makeRequest];
+    
+    //  只有 GET 會用 cache
+    if ( [_method isEqualToString:@"GET"] ) {
+        APIResponseCache *cache = [APIOperation responseCache];
+        if ( cache && _cachePolicy != APICachePolicyIgnoreCache ) {
+            if ( [self applyCache:cache toRequest:request] ) {
+                return;
             }
-            else{
-                if( [_body isKindOfClass:[NSString class]]){
-                    serialBody = [(NSString*)_body dataUsingEncoding:NSUTF8StringEncoding];
-                }
-                if ( [_body isKindOfClass:[NSData class]]) {
-                    serialBody = _body;
-                }
-                else{
-                    NSException* exception = [NSException exceptionWithName:@"Parameter invalid"
-                                                                     reason:@"parameter is not a NSString or you did not assign a serializer to parse param." userInfo:nil];
-                    @throw exception;
-                }
+        }
+    }
+    
+    _request = [request copy];
+    _endpoint = [APILatencyTracker endpointWithMethod:_method url:request.URL];
+    [self sendRequest];
+}
+
+- (void)cancel
+{
+    [super cancel];
+    NSURLSessionDataTask *task = nil;
+    NSURLSessionDataTask *hedgeTask = nil;
+    BOOL waitingRetry = NO;
+    @synchronized(self) {
+        task = _task;
+        hedgeTask = _hedgeTask;
+        waitingRetry = _waitingRetry;
+    }
+    //  task 可能還有其他 operation 共用，只把自己拿掉
+    APISessionTransport *transport = [APISessionTransport sharedTransport];
+    if ( hedgeTask ) {
+        [transport detachOperation:self fromTask:hedgeTask];
+    }
+    if ( task ) {
+        [transport detachOperation:self fromTask:task];
+    }
+    if ( task || waitingRetry ) {
+        [self finish];
+    }
+}
+
+- (void)finish
+{
+    @synchronized(self) {
+        if ( _finished ) {
+            return;
+        }
+    }
+    [self willChangeValueForKey:@"isExecuting"];
+    [self willChangeValueForKey:@"isFinished"];
+    @synchronized(self) {
+        _executing = NO;
+        _finished = YES;
+        _task = nil;
+        _hedgeTask = nil;
+        _waitingRetry = NO;
+    }
+    [self didChangeValueForKey:@"isFinished"];
+    [self didChangeValueForKey:@"isExecuting"];
+}
+
+#pragma mark - Request
+
+- (NSMutableURLRequest*)makeRequest
+{
+    NSMutableURLRequest* request=[[NSMutableURLRequest alloc]init];
+    
+    // api + param
+    //-----------------------------
+    NSString* api = _apiUrl;
+    if ( _param ) {
+        api = [self url:api combineParam:_param ];
+    }
+    
+    //  建立 NSURL
+    //-----------------------------
+    [request setURL: [NSURL URLWithString:api] ];
+    
+    // request method
+    //-----------------------------
+    [request setHTTPMethod: _method ];
+    
+    if ( _debug ) {
+        printf("%s %s\n", [_method UTF8String], [api UTF8String]);
+    }
+    
+    // body 做序列化
+    //-----------------------------
+    id serialBody = nil;
+    if( _body  ){
+        if ( _serializer ) {
+            serialBody = [_serializer serialize:self data:_body];
+        }
+        else{
+            if( [_body isKindOfClass:[NSString class]]){
+                serialBody = [(NSString*)_body dataUsingEncoding:NSUTF8StringEncoding];
             }
-            
-            if ( serialBody ) {
-                [request setHTTPBody: serialBody ];
+            else if ( [_body isKindOfClass:[NSData class]]) {
+                serialBody = _body;
+            }
+            else{
+                NSException* exception = [NSException exceptionWithName:@"Parameter invalid"
+                                                                 reason:@"parameter is not a NSString or you did not assign a serializer to parse param." userInfo:nil];
+                @throw exception;
             }
         }
         
-        // 設定 request header
-        //-----------------------------
-        if (self.acceptType) {
-            [request setValue:self.acceptType forHTTPHeaderField:@"Accept"];  // 跟 server 說，client 預期可以收到什麼格式
+        //  body 夠大才壓縮，壓縮後沒有比較小就送原本的
+        if ( serialBody && _requestCompressionThreshold > 0 && [serialBody length] >= _requestCompressionThreshold ) {
+            NSData *gzipBody = [APICompression gzipData:serialBody];
+            if ( gzipBody && gzipBody.length < [serialBody length] ) {
+                serialBody = gzipBody;
+                [request setValue:@"gzip" forHTTPHeaderField:@"Content-Encoding"];
+            }
         }
-        if ( self.contentType ) {
-            [request setValue:self.contentType forHTTPHeaderField:@"Content-Type"]; // 跟 server 說，我寄過去的是什麼格式
+        
+        if ( serialBody ) {
+            [request setHTTPBody: serialBody ];
         }
-        if ( _debug ) {
-            printf("Accept:%s\n",[self.acceptType UTF8String]);
-            printf("Content-Type:%s\n",[self.contentType UTF8String]);
+    }
+    
+    // 設定 request header
+    //-----------------------------
+    if (self.acceptType) {
+        [request setValue:self.acceptType forHTTPHeaderField:@"Accept"];  // 跟 server 說，client 預期可以收到什麼格式
+    }
+    if ( self.contentType ) {
+        [request setValue:self.contentType forHTTPHeaderField:@"Content-Type"]; // 跟 server 說，我寄過去的是什麼格式
+    }
+    [request setValue:@"gzip, deflate" forHTTPHeaderField:@"Accept-Encoding"]; // 收到的 response 會逐段解壓
+
+    if ( _debug ) {
+        printf("Accept:%s\n",[self.acceptType UTF8String]);
+        printf("Content-Type:%s\n",[self.contentType UTF8String]);
+    }
+    
+    //  設定一些 request 的設定
+    //------------------------------
+    [request setTimeoutInterval: _timeoutInterval ];
+    [request setHTTPShouldHandleCookies:NO];
+    
+    return request;
+}
+
+- (NSMutableURLRequest*)requestForAttempt
+{
+    NSMutableURLRequest *request = [_request mutableCopy];
+    //  server 變慢時依舊的 p99 算出來的 timeout 太短，逾時後重試不再用它
+    if ( _adaptiveTimeout && !_timedOut ) {
+        [request setTimeoutInterval: [self adaptiveTimeoutInterval] ];
+    }
+    return request;
+}
+
+//  p99 的幾倍，不超過 timeoutInterval，樣本不足時就用 timeoutInterval
+- (NSTimeInterval)adaptiveTimeoutInterval
+{
+    NSTimeInterval p99 = [_latencyTracker latencyAtPercentile:0.99 forEndpoint:_endpoint];
+    if ( p99 <= 0 ) {
+        return _timeoutInterval;
+    }
+    return MIN( _timeoutInterval, MAX( API_MINIMUM_TIMEOUT, p99 * API_TIMEOUT_P99_MULTIPLIER ) );
+}
+
+- (void)sendRequest
+{
+    NSMutableURLRequest *request = [self requestForAttempt];
+    
+    //  只有 GET 會合併相同的 request
+    NSString *coalesceKey = nil;
+    if ( [_method isEqualToString:@"GET"] ) {
+        coalesceKey = [self coalesceKeyWithRequest:request];
+    }
+    
+    APISessionTransport *transport = [APISessionTransport sharedTransport];
+    CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+    NSURLSessionDataTask *task = [transport startRequest:request coalesceKey:coalesceKey operation:self];
+    @synchronized(self) {
+        _task = task;
+        _taskStartTime = startTime;
+        _responseReceived = NO;
+        _waitingRetry = NO;
+    }
+    
+    //  在 task 建立前就被 cancel 了
+    if ( self.isCancelled ) {
+        [transport detachOperation:self fromTask:task];
+        [self finish];
+        return;
+    }
+    
+    if ( _hedged && [_method isEqualToString:@"GET"] ) {
+        [self scheduleHedgeForTask:task];
+    }
+}
+
+#pragma mark - Hedge
+
+//  等到 p95 還沒有回應，再送一個相同的 request
+- (void)scheduleHedgeForTask:(NSURLSessionDataTask*)task
+{
+    NSTimeInterval delay = [_latencyTracker latencyAtPercentile:0.95 forEndpoint:_endpoint];
+    if ( delay <= 0 ) {
+        return;
+    }
+    __weak APIOperation *weakSelf = self;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)), dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        [weakSelf sendHedgeForTask:task];
+    });
+}
+
+- (void)sendHedgeForTask:(NSURLSessionDataTask*)primaryTask
+{
+    @synchronized(self) {
+        //  已經有回應、換了下一次嘗試、或已經結束
+        if ( _finished || _task != primaryTask || _responseReceived || _hedgeTask ) {
+            return;
         }
-        
-        //  設定一些 request 的設定
-        //------------------------------
-        [request setTimeoutInterval: 15 ];
-        [request setHTTPShouldHandleCookies:NO];
-        
-        // 發送請求
-        //-----------------------------
-        NSURLResponse *res = nil;
-        NSError *err = nil;
-        
-        //  送出後取得資料
-        //-----------------------------
-        NSData *data = [NSURLConnection sendSynchronousRequest:request returningResponse:&res error:&err];
-        
-        //  檢查此次連線的狀態
-        //-----------------------------
-        if ( res ) {
-            //連線建立成功
-            //取得狀態
-            _statusCode = (int)[(NSHTTPURLResponse *)res statusCode];
-            printf("%s statusCode:%d\n", [_title UTF8String], _statusCode );
+    }
+    if ( self.isCancelled ) {
+        return;
+    }
+    
+    //  hedge 一定要真的送出去，不能合併到原本的 task
+    APISessionTransport *transport = [APISessionTransport sharedTransport];
+    NSURLSessionDataTask *hedgeTask = [transport startRequest:[self requestForAttempt] coalesceKey:nil operation:self];
+    BOOL useless = NO;
+    @synchronized(self) {
+        //  送出的期間 primary 收到回應了
+        useless = _finished || _task != primaryTask || _responseReceived;
+        if ( !useless ) {
+            _hedgeTask = hedgeTask;
         }
+    }
+    if ( useless ) {
+        [transport detachOperation:self fromTask:hedgeTask];
+    }
+}
 
-        //  發生錯誤
-        //-----------------------------
-        if ( err ) {
-            _apiFailBlock( self, err );
+//  先收到 response 的 task 留下，另一個取消
+//  回傳 NO 表示 task 已經不是這個 operation 在用的
+- (BOOL)acceptResponseFromTask:(NSURLSessionTask*)task
+{
+    NSURLSessionDataTask *loser = nil;
+    @synchronized(self) {
+        if ( task == _hedgeTask ) {
+            loser = _task;
+            _task = _hedgeTask;
+            _hedgeWon = YES;
         }
-        else{
-            //  連線成功
-            //-----------------------------
-            
-            //  解序列化
-            id responseObj = nil;
-            //  如果有自訂的序列化程序，就執行，如果沒有就直接轉成字串
-            if( _unserializer ) {
-                if (_debug&&data) {
-                    NSLog(@"receive:%@", [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding] );
-                }
-                responseObj = [_unserializer unSerialize:self data:data];
-            }
-            else{
-                responseObj = [[NSString alloc]initWithData:data encoding:NSUTF8StringEncoding];
-                if (_debug&&responseObj) {
-                    NSLog(@"receive:%@", responseObj );
-                }
-            }
-            
-            //  若都無法解序列化，就直接把收到的 data 送去
-            if ( responseObj == nil ) {
-                _apiResBlock( self, data );
+        else if ( task == _task ) {
+            loser = _hedgeTask;
+        }
+        else {
+            return NO;
+        }
+        _hedgeTask = nil;
+        _responseReceived = YES;
+    }
+    if ( loser ) {
+        [[APISessionTransport sharedTransport] detachOperation:self fromTask:loser];
+    }
+    return YES;
+}
+
+- (BOOL)isCurrentTask:(NSURLSessionTask*)task
+{
+    @synchronized(self) {
+        return task == _task;
+    }
+}
+
+#pragma mark - Retry
+
+- (BOOL)isIdempotent
+{
+    static NSSet *methods = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        methods = [NSSet setWithObjects:@"GET", @"HEAD", @"PUT", @"DELETE", @"OPTIONS", nil];
+    });
+    return [methods containsObject:[_method uppercaseString]];
+}
+
+- (BOOL)canRetry
+{
+    return _retryCount < _maxRetryCount && [self isIdempotent];
+}
+
+//  連線層的暫時性錯誤
+- (BOOL)isRetryableError:(NSError*)error
+{
+    if ( ![error.domain isEqualToString:NSURLErrorDomain] ) {
+        return NO;
+    }
+    switch ( error.code ) {
+        case NSURLErrorTimedOut:
+        case NSURLErrorNetworkConnectionLost:
+        case NSURLErrorCannotConnectToHost:
+        case NSURLErrorCannotFindHost:
+        case NSURLErrorDNSLookupFailed:
+            return YES;
+        default:
+            return NO;
+    }
+}
+
+- (BOOL)isRetryableStatusCode:(int)statusCode
+{
+    return statusCode == 502 || statusCode == 503 || statusCode == 504;
+}
+
+//  full jitter，避免同時失敗的 request 又同時重試
+- (void)scheduleRetry
+{
+    _retryCount++;
+    NSTimeInterval maxDelay = MIN( _retryBaseDelay * pow( 2, _retryCount - 1 ), API_MAXIMUM_RETRY_DELAY );
+    NSTimeInterval delay = maxDelay * arc4random_uniform( 1001 ) / 1000.0;
+    @synchronized(self) {
+        _task = nil;
+        _hedgeTask = nil;
+        _waitingRetry = YES;
+    }
+    //  等待的期間被 cancel 會由 cancel 結束，在這之前就被 cancel 的在這裡結束
+    if ( self.isCancelled ) {
+        [self finish];
+        return;
+    }
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)), dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        @synchronized(self) {
+            if ( _finished ) {
+                return;
             }
-            else{
-                _apiResBlock( self, responseObj );
+        }
+        @autoreleasepool {
+            [self sendRequest];
+        }
+    });
+}
+
+#pragma mark - Cache
+
+//  method + 加上 param 後的網址 + body
+- (NSString*)cacheKeyWithRequest:(NSURLRequest*)request
+{
+    NSMutableString *key = [[NSMutableString alloc] initWithFormat:@"%@ %@", request.HTTPMethod, request.URL.absoluteString ];
+    if ( request.HTTPBody.length > 0 ) {
+        [key appendFormat:@" %@", [Base64Utility md5Data: request.HTTPBody ]];
+    }
+    return key;
+}
+
+//  header 不同的 request 回應也可能不同，不能合併
+- (NSString*)coalesceKeyWithRequest:(NSURLRequest*)request
+{
+    NSString *key = _cacheKey ? _cacheKey : [self cacheKeyWithRequest:request];
+    return [NSString stringWithFormat:@"%@|%@|%@|%@", key,
+            [request valueForHTTPHeaderField:@"Accept"],
+            [request valueForHTTPHeaderField:@"If-None-Match"],
+            [request valueForHTTPHeaderField:@"If-Modified-Since"]];
+}
+
+//  回傳 YES 表示 cache 還沒過期，直接用 cache 回應，不用送出 request
+- (BOOL)applyCache:(APIResponseCache*)cache toRequest:(NSMutableURLRequest*)request
+{
+    //  自己處理 cache，不用 NSURLCache
+    [request setCachePolicy: NSURLRequestReloadIgnoringLocalCacheData ];
+    _cacheKey = [self cacheKeyWithRequest:request];
+    
+    APICacheEntry *entry = [cache entryForKey:_cacheKey];
+    NSData *data = [cache dataForEntry:entry];
+    if ( data == nil ) {
+        return NO;
+    }
+    
+    if ( [entry isFresh] ) {
+        [self deliverCachedData:data entry:entry finish:YES];
+        return YES;
+    }
+    
+    //  過期了，可以的話先回傳 cache，同時重新驗證
+    if ( _cachePolicy == APICachePolicyStaleWhileRevalidate || [entry canServeStale] ) {
+        _servedStale = YES;
+        [self deliverCachedData:data entry:entry finish:NO];
+    }
+    
+    _cacheEntry = entry;
+    if ( entry.etag ) {
+        [request setValue:entry.etag forHTTPHeaderField:@"If-None-Match"];
+    }
+    if ( entry.lastModified ) {
+        [request setValue:entry.lastModified forHTTPHeaderField:@"If-Modified-Since"];
+    }
+    return NO;
+}
+
+- (void)deliverCachedData:(NSData*)data entry:(APICacheEntry*)entry finish:(BOOL)finish
+{
+    _statusCode = entry.statusCode;
+    id responseObj = [self unserializeData:data];
+    [self performCallback:^{
+        _fromCache = YES;
+        if ( _apiResBlock ) {
+            _apiResBlock( self, responseObj );
+        }
+    } finish:finish];
+}
+
+#pragma mark - Response
+
+- (void)task:(NSURLSessionTask*)task didReceiveResponse:(NSURLResponse*)response
+{
+    if ( ![self acceptResponseFromTask:task] ) {
+        return;
+    }
+    
+    //  連線建立成功，取得狀態
+    //-----------------------------
+    if ( [response isKindOfClass:[NSHTTPURLResponse class]] ) {
+        _response = (NSHTTPURLResponse*)response;
+        _statusCode = (int)_response.statusCode;
+        printf("%s statusCode:%d\n", [_title UTF8String], _statusCode );
+    }
+    
+    //  redirect 或重新收一次 response 時，之前收到的都不算
+    [_receiveData setLength: 0 ];
+    _cacheData = nil;
+    _receivedBytes = 0;
+    _decodedBytes = 0;
+    _inflater = nil;
+    _decodeError = nil;
+    _contentEncoding = _response ? [APICompression encodingOfResponse:_response] : APIContentEncodingIdentity;
+    _sniffData = _contentEncoding != APIContentEncodingIdentity ? [[NSMutableData alloc] initWithCapacity: 2 ] : nil;
+    
+    //  server 暫時無法處理，body 不用解，結束後重試
+    _retryPending = [self isRetryableStatusCode:_statusCode] && [self canRetry];
+    if ( _retryPending ) {
+        _streaming = NO;
+        return;
+    }
+    
+    //  記錄收到 response 的時間，5xx 的回應時間不代表正常的情況
+    if ( _statusCode < 500 ) {
+        CFAbsoluteTime startTime = 0;
+        @synchronized(self) {
+            startTime = _taskStartTime;
+        }
+        [_latencyTracker recordLatency:CFAbsoluteTimeGetCurrent() - startTime forEndpoint:_endpoint];
+    }
+    
+    _notModified = ( _statusCode == 304 && _cacheEntry != nil );
+    _shouldStore = ( _cacheKey != nil && _statusCode == 200 );
+    
+    //  304 沒有 body，之後用 cache 的內容
+    _streaming = !_notModified && [(NSObject*)_unserializer respondsToSelector:@selector(unSerialize:didReceiveData:)];
+    if ( _streaming ) {
+        if ( _shouldStore && [APIResponseCache isCacheableResponse:_response] ) {
+            _cacheData = [[NSMutableData alloc] init];
+        }
+        if ( [(NSObject*)_unserializer respondsToSelector:@selector(unSerializeBegin:)] ) {
+            [_unserializer unSerializeBegin:self];
+        }
+    }
+}
+
+- (void)task:(NSURLSessionTask*)task didReceiveData:(NSData*)data
+{
+    if ( self.isCancelled || _retryPending || ![self isCurrentTask:task] ) {
+        return;
+    }
+    _receivedBytes += data.length;
+    if ( _decodeError ) {
+        return;
+    }
+    
+    if ( _sniffData ) {
+        [_sniffData appendData:data];
+        if ( _sniffData.length < 2 ) {
+            return;
+        }
+        data = _sniffData;
+        _sniffData = nil;
+        if ( [APICompression isCompressedData:data encoding:_contentEncoding] ) {
+            _inflater = [[APIInflateStream alloc] init];
+            __weak APIOperation *weakSelf = self;
+            _inflater.outputBlock = ^(NSData *output) {
+                [weakSelf receiveBodyData:output];
+            };
+        }
+    }
+    
+    //  解壓出來的資料一段一段交給 unserializer，壓縮的資料不保留
+    if ( _inflater ) {
+        NSError *error = nil;
+        if ( ![_inflater appendData:data error:&error] ) {
+            _decodeError = error;
+        }
+        return;
+    }
+    [self receiveBodyData:data];
+}
+
+- (void)receiveBodyData:(NSData*)data
+{
+    _decodedBytes += data.length;
+    if ( _streaming ) {
+        [_unserializer unSerialize:self didReceiveData:data];
+        [_cacheData appendData:data];
+        if ( _debug ) {
+            [_receiveData appendData:data];
+        }
+    }
+    else{
+        [_receiveData appendData:data];
+    }
+}
+
+- (void)task:(NSURLSessionTask*)task didCompleteWithError:(NSError*)error
+{
+    @synchronized(self) {
+        if ( task != _task && task != _hedgeTask ) {
+            return;
+        }
+        //  primary 與 hedge 還沒有回應就有一個失敗了，等另一個
+        if ( _hedgeTask ) {
+            if ( task == _task ) {
+                _task = _hedgeTask;
+                _hedgeWon = YES;
             }
+            _hedgeTask = nil;
+            return;
         }
     }
+    
+    //  被 cancel 的不呼叫 callback
+    if ( self.isCancelled ) {
+        [self finish];
+        return;
+    }
+    
+    //  逾時的嘗試收不到 response，用它的 timeout 當作樣本 (實際只會更久)
+    //  不記的話 tracker 看不到變慢，每次都用舊的 timeout 又逾時
+    if ( [error.domain isEqualToString:NSURLErrorDomain] && error.code == NSURLErrorTimedOut ) {
+        [_latencyTracker recordLatency:task.originalRequest.timeoutInterval forEndpoint:_endpoint];
+        _timedOut = YES;
+    }
+    
+    //  暫時性的錯誤，重試
+    //-----------------------------
+    if ( _retryPending || ( error && [self isRetryableError:error] && [self canRetry] ) ) {
+        _retryPending = NO;
+        [self scheduleRetry];
+        return;
+    }
+    
+    if ( error == nil ) {
+        error = [self finishDecoding];
+    }
+    
+    //  發生錯誤
+    //-----------------------------
+    if ( error ) {
+        [self failWithError:error];
+        return;
+    }
+    
+    APIResponseCache *cache = [APIOperation responseCache];
+    
+    //  304，cache 的內容還是最新的
+    //-----------------------------
+    if ( _notModified ) {
+        [cache updateEntry:_cacheEntry withNotModifiedResponse:_response];
+        if ( _servedStale ) {
+            [self finish];
+            return;
+        }
+        NSData *data = [cache dataForEntry:_cacheEntry];
+        if ( data ) {
+            [self deliverCachedData:data entry:_cacheEntry finish:YES];
+            return;
+        }
+    }
+    
+    //  連線成功
+    //-----------------------------
+    NSData *data = [_receiveData copy];
+    if (_debug&&data.length) {
+        NSLog(@"receive:%@", [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding] );
+    }
+    
+    //  解序列化
+    id responseObj = nil;
+    if ( _streaming ) {
+        if ( [(NSObject*)_unserializer respondsToSelector:@selector(unSerializeDidFinish:)] ) {
+            responseObj = [_unserializer unSerializeDidFinish:self];
+        }
+        //  若都無法解序列化，就直接把收到的 data 送去
+        if ( responseObj == nil ) {
+            responseObj = data;
+        }
+    }
+    else{
+        responseObj = [self unserializeData:data];
+    }
+    
+    //  資料格式錯誤，不能當成功，也不能存入 cache
+    NSError *unserializeError = [self unserializeError];
+    if ( unserializeError ) {
+        [self failWithError:unserializeError];
+        return;
+    }
+    
+    //  存入 cache，不能存的 response 會把舊的刪掉
+    if ( _shouldStore ) {
+        [cache storeResponse:_response data:_streaming ? _cacheData : data forKey:_cacheKey];
+    }
+    
+    [self performCallback:^{
+        _fromCache = NO;
+        if ( _apiResBlock ) {
+            _apiResBlock( self, responseObj );
+        }
+    } finish:YES];
+}
+
+- (void)failWithError:(NSError*)error
+{
+    //  已經回傳過 cache 了，重新驗證失敗就不再通知
+    if ( _servedStale ) {
+        [self finish];
+        return;
+    }
+    [self performCallback:^{
+        if ( _apiFailBlock ) {
+            _apiFailBlock( self, error );
+        }
+    } finish:YES];
+}
+
+//  逐段解序列化的 unserializer 回報的錯誤
+- (NSError*)unserializeError
+{
+    if ( [(NSObject*)_unserializer respondsToSelector:@selector(unSerializeError:)] ) {
+        return [_unserializer unSerializeError:self];
+    }
+    return nil;
+}
+
+//  收到的資料不到 2 byte 就結束的，直接當成沒壓縮
+//  回傳解壓縮的錯誤
+- (NSError*)finishDecoding
+{
+    if ( _sniffData.length > 0 ) {
+        [self receiveBodyData:_sniffData];
+    }
+    _sniffData = nil;
+    if ( _inflater && _decodeError == nil ) {
+        NSError *error = nil;
+        if ( ![_inflater finish:&error] ) {
+            _decodeError = error;
+        }
+    }
+    _inflater = nil;
+    return _decodeError;
+}
+
+//  一次解序列化整個 body
+- (id)unserializeData:(NSData*)data
+{
+    id responseObj = nil;
+    if ( [(NSObject*)_unserializer respondsToSelector:@selector(unSerialize:didReceiveData:)] ) {
+        if ( [(NSObject*)_unserializer respondsToSelector:@selector(unSerializeBegin:)] ) {
+            [_unserializer unSerializeBegin:self];
+        }
+        [_unserializer unSerialize:self didReceiveData:data];
+        if ( [(NSObject*)_unserializer respondsToSelector:@selector(unSerializeDidFinish:)] ) {
+            responseObj = [_unserializer unSerializeDidFinish:self];
+        }
+    }
+    //  如果有自訂的序列化程序，就執行，如果沒有就直接轉成字串
+    else if( _unserializer ) {
+        responseObj = [_unserializer unSerialize:self data:data];
+    }
+    else{
+        responseObj = [[NSString alloc]initWithData:data encoding:NSUTF8StringEncoding];
+    }
+    
+    //  若都無法解序列化，就直接把收到的 data 送去
+    return responseObj ? responseObj : data;
+}
+
+//  在指定的 queue 執行 callback
+//  finish 為 YES 時，callback 執行完 operation 才算結束
+- (void)performCallback:(void(^)(void))callback finish:(BOOL)finish
+{
+    void(^block)(void) = ^{
+        if ( !self.isCancelled ) {
+            callback();
+        }
+        if ( finish ) {
+            [self finish];
+        }
+    };
+    if ( _queue == nil || _queue == [NSOperationQueue currentQueue] ) {
+        block();
+    }
+    else{
+        [_queue addOperationWithBlock:block];
+    }
 }
 
 #pragma mark - Private
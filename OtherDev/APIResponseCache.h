@@ -0,0 +1,72 @@
+//
+//  APIResponseCache.h
+//
+//  Created by Calvin Huang on 2017/3/11.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ *  APIOperation 用的 HTTP response cache
+ *
+ *  依照 response 的 Cache-Control (max-age, no-cache, no-store, must-revalidate, stale-while-revalidate)、
+ *  Expires、ETag、Last-Modified 決定能不能存、多久內不用重新驗證
+ *  body 存在磁碟，總大小超過 capacity 時，最久沒用到的先刪掉
+ *
+ *  [APIOperation setResponseCache:[[APIResponseCache alloc] initWithDirectory:path capacity:20*1024*1024]];
+ *
+ *  thread safe
+ */
+
+@interface APICacheEntry : NSObject
+
+@property (nonatomic,readonly) NSString *key;
+@property (nonatomic,readonly) int statusCode;
+@property (nonatomic,readonly) NSDictionary *headers;
+@property (nonatomic,readonly) NSString *etag;
+@property (nonatomic,readonly) NSString *lastModified;
+//  存入或最後一次驗證的時間
+@property (nonatomic,readonly) NSDate *responseDate;
+//  多久內不用重新驗證，-1 表示每次都要驗證
+@property (nonatomic,readonly) NSTimeInterval maxAge;
+//  過期後多久內可以先用舊的，同時在背景重新驗證
+@property (nonatomic,readonly) NSTimeInterval staleWhileRevalidate;
+//  no-cache 或 must-revalidate，過期就不能直接用
+@property (nonatomic,readonly) BOOL mustRevalidate;
+@property (nonatomic,readonly) NSUInteger size;
+
+//  還在 max-age 內，不用發 request
+- (BOOL)isFresh;
+
+//  過期了，但還在 stale-while-revalidate 的時間內
+- (BOOL)canServeStale;
+
+@end
+
+
+@interface APIResponseCache : NSObject
+
+@property (nonatomic,readonly) NSString *directory;
+//  body 總大小上限 (byte)
+@property (nonatomic,readonly) NSUInteger capacity;
+@property (nonatomic,readonly) NSUInteger currentSize;
+
+- (instancetype)initWithDirectory:(NSString*)directory capacity:(NSUInteger)capacity;
+
+//  是否可以存入 cache：200、沒有 no-store、而且有 max-age 或 ETag / Last-Modified
++ (BOOL)isCacheableResponse:(NSHTTPURLResponse*)response;
+
+- (APICacheEntry*)entryForKey:(NSString*)key;
+- (NSData*)dataForEntry:(APICacheEntry*)entry;
+
+//  不能存的 response 會把舊的 entry 刪掉
+- (APICacheEntry*)storeResponse:(NSHTTPURLResponse*)response data:(NSData*)data forKey:(NSString*)key;
+
+//  收到 304，用新的 header 更新存放時間與期限，body 不變
+- (APICacheEntry*)updateEntry:(APICacheEntry*)entry withNotModifiedResponse:(NSHTTPURLResponse*)response;
+
+- (void)removeEntryForKey:(NSString*)key;
+- (void)removeAllEntries;
+
+@end
@@ -0,0 +1,347 @@
+//
+//  APIResponseCache.m
+//
+//  Created by Calvin Huang on 2017/3/11.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import "APIResponseCache.h"
+#import "Base64Utility.h"
+
+//  header 的 key 不分大小寫
+static NSString* APIHeaderValue( NSDictionary *headers, NSString *name )
+{
+    for ( NSString *key in headers ) {
+        if ( [key caseInsensitiveCompare:name] == NSOrderedSame ) {
+            return headers[key];
+        }
+    }
+    return nil;
+}
+
+//  Cache-Control: max-age=60, stale-while-revalidate=30 → @{ @"max-age":@"60", @"stale-while-revalidate":@"30" }
+static NSDictionary* APIParseCacheControl( NSString *value )
+{
+    NSMutableDictionary *directives = [[NSMutableDictionary alloc] init];
+    NSCharacterSet *trimSet = [NSCharacterSet characterSetWithCharactersInString:@" \t\""];
+    for ( NSString *part in [value componentsSeparatedByString:@","] ) {
+        NSString *directive = [part stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
+        if ( directive.length == 0 ) {
+            continue;
+        }
+        NSRange range = [directive rangeOfString:@"="];
+        if ( range.location == NSNotFound ) {
+            directives[[directive lowercaseString]] = @"";
+        }
+        else{
+            NSString *name = [[directive substringToIndex:range.location] stringByTrimmingCharactersInSet:trimSet];
+            NSString *argument = [[directive substringFromIndex:range.location + 1] stringByTrimmingCharactersInSet:trimSet];
+            directives[[name lowercaseString]] = argument;
+        }
+    }
+    return directives;
+}
+
+static NSDate* APIParseHTTPDate( NSString *value )
+{
+    if ( value == nil ) {
+        return nil;
+    }
+    static NSDateFormatter *formatter = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        formatter = [[NSDateFormatter alloc] init];
+        formatter.locale = [NSLocale localeWithLocaleIdentifier:@"en_US_POSIX"];
+        formatter.timeZone = [NSTimeZone timeZoneWithAbbreviation:@"GMT"];
+        formatter.dateFormat = @"EEE, dd MMM yyyy HH:mm:ss zzz";
+    });
+    @synchronized(formatter) {
+        return [formatter dateFromString:value];
+    }
+}
+
+
+@interface APICacheEntry ()
+
+@property (nonatomic) NSString *key;
+@property (nonatomic) NSString *fileName;
+@property (nonatomic) int statusCode;
+@property (nonatomic) NSDictionary *headers;
+@property (nonatomic) NSDate *responseDate;
+@property (nonatomic) NSDate *lastAccess;
+@property (nonatomic) NSUInteger size;
+
+@end
+
+@implementation APICacheEntry
+{
+    BOOL _noCache;
+}
+
+- (instancetype)initWithDictionary:(NSDictionary*)dic
+{
+    self = [super init];
+    if (self) {
+        _key = dic[@"key"];
+        _fileName = dic[@"fileName"];
+        _statusCode = [dic[@"statusCode"] intValue];
+        _responseDate = dic[@"responseDate"];
+        _lastAccess = dic[@"lastAccess"];
+        _size = [dic[@"size"] unsignedIntegerValue];
+        self.headers = dic[@"headers"];
+    }
+    return self;
+}
+
+- (NSDictionary*)dictionary
+{
+    return @{ @"key":_key,
+              @"fileName":_fileName,
+              @"statusCode":@(_statusCode),
+              @"headers":_headers ? _headers : @{},
+              @"responseDate":_responseDate,
+              @"lastAccess":_lastAccess,
+              @"size":@(_size) };
+}
+
+- (void)setHeaders:(NSDictionary *)headers
+{
+    _headers = [headers copy];
+    _etag = APIHeaderValue( headers, @"ETag" );
+    _lastModified = APIHeaderValue( headers, @"Last-Modified" );
+
+    NSDictionary *directives = APIParseCacheControl( APIHeaderValue( headers, @"Cache-Control" ) );
+    _noCache = directives[@"no-cache"] != nil;
+    _mustRevalidate = _noCache || directives[@"must-revalidate"] != nil;
+    _staleWhileRevalidate = [directives[@"stale-while-revalidate"] doubleValue];
+
+    _maxAge = -1;
+    if ( directives[@"max-age"] ) {
+        _maxAge = [directives[@"max-age"] doubleValue];
+    }
+    else{
+        //  沒有 max-age 時看 Expires
+        NSDate *expires = APIParseHTTPDate( APIHeaderValue( headers, @"Expires" ) );
+        if ( expires ) {
+            NSDate *date = APIParseHTTPDate( APIHeaderValue( headers, @"Date" ) );
+            _maxAge = MAX( 0, [expires timeIntervalSinceDate: date ? date : _responseDate ? _responseDate : [NSDate date] ] );
+        }
+    }
+}
+
+- (NSTimeInterval)age
+{
+    return [[NSDate date] timeIntervalSinceDate:_responseDate];
+}
+
+- (BOOL)isFresh
+{
+    return !_noCache && _maxAge > 0 && [self age] < _maxAge;
+}
+
+- (BOOL)canServeStale
+{
+    return !_mustRevalidate && _maxAge >= 0 && _staleWhileRevalidate > 0 && [self age] < _maxAge + _staleWhileRevalidate;
+}
+
+@end
+
+
+@implementation APIResponseCache
+{
+    //  key: cache key  value: APICacheEntry
+    NSMutableDictionary *_entryDic;
+
+    NSString *_indexPath;
+}
+
++ (BOOL)isCacheableResponse:(NSHTTPURLResponse*)response
+{
+    if ( response.statusCode != 200 ) {
+        return NO;
+    }
+    NSDictionary *headers = response.allHeaderFields;
+    NSDictionary *directives = APIParseCacheControl( APIHeaderValue( headers, @"Cache-Control" ) );
+    if ( directives[@"no-store"] ) {
+        return NO;
+    }
+    return directives[@"max-age"] || APIHeaderValue( headers, @"Expires" ) || APIHeaderValue( headers, @"ETag" ) || APIHeaderValue( headers, @"Last-Modified" );
+}
+
+- (instancetype)initWithDirectory:(NSString*)directory capacity:(NSUInteger)capacity
+{
+    self = [super init];
+    if (self) {
+        _directory = [directory copy];
+        _capacity = capacity;
+        _indexPath = [directory stringByAppendingPathComponent:@"index.plist"];
+        _entryDic = [[NSMutableDictionary alloc] initWithCapacity: 20 ];
+
+        [[NSFileManager defaultManager] createDirectoryAtPath:directory withIntermediateDirectories:YES attributes:nil error:nil];
+
+        //  讀取上次的 index
+        NSArray *index = [NSArray arrayWithContentsOfFile:_indexPath];
+        for ( NSDictionary *dic in index ) {
+            APICacheEntry *entry = [[APICacheEntry alloc] initWithDictionary:dic];
+            if ( entry.key && entry.fileName ) {
+                _entryDic[entry.key] = entry;
+                _currentSize += entry.size;
+            }
+        }
+        [self evictIfNeeded];
+    }
+    return self;
+}
+
+- (NSString*)pathOfEntry:(APICacheEntry*)entry
+{
+    return [_directory stringByAppendingPathComponent:entry.fileName];
+}
+
+#pragma mark - Read
+
+- (APICacheEntry*)entryForKey:(NSString*)key
+{
+    if ( key == nil ) {
+        return nil;
+    }
+    @synchronized(self) {
+        return _entryDic[key];
+    }
+}
+
+- (NSData*)dataForEntry:(APICacheEntry*)entry
+{
+    @synchronized(self) {
+        if ( entry == nil || _entryDic[entry.key] != entry ) {
+            return nil;
+        }
+        NSData *data = [NSData dataWithContentsOfFile:[self pathOfEntry:entry] options:NSDataReadingMappedIfSafe error:nil];
+        if ( data == nil ) {
+            //  檔案被系統清掉了
+            [self removeEntry:entry];
+            [self saveIndex];
+            return nil;
+        }
+        entry.lastAccess = [NSDate date];
+        return data;
+    }
+}
+
+#pragma mark - Write
+
+- (APICacheEntry*)storeResponse:(NSHTTPURLResponse*)response data:(NSData*)data forKey:(NSString*)key
+{
+    if ( key == nil ) {
+        return nil;
+    }
+    @synchronized(self) {
+        APICacheEntry *oldEntry = _entryDic[key];
+        if ( oldEntry ) {
+            [self removeEntry:oldEntry];
+        }
+
+        if ( ![APIResponseCache isCacheableResponse:response] || data.length > _capacity ) {
+            [self saveIndex];
+            return nil;
+        }
+
+        APICacheEntry *entry = [[APICacheEntry alloc] init];
+        entry.key = key;
+        entry.fileName = [Base64Utility md5: key ];
+        entry.statusCode = (int)response.statusCode;
+        entry.responseDate = [NSDate date];
+        entry.lastAccess = entry.responseDate;
+        entry.size = data.length;
+        entry.headers = response.allHeaderFields;
+
+        if ( ![data writeToFile:[self pathOfEntry:entry] atomically:YES] ) {
+            [self saveIndex];
+            return nil;
+        }
+        _entryDic[key] = entry;
+        _currentSize += entry.size;
+        [self evictIfNeeded];
+        [self saveIndex];
+        return entry;
+    }
+}
+
+- (APICacheEntry*)updateEntry:(APICacheEntry*)entry withNotModifiedResponse:(NSHTTPURLResponse*)response
+{
+    @synchronized(self) {
+        if ( entry == nil || _entryDic[entry.key] != entry ) {
+            return nil;
+        }
+        //  304 帶的 header 蓋掉原本的
+        NSMutableDictionary *headers = [entry.headers mutableCopy];
+        [response.allHeaderFields enumerateKeysAndObjectsUsingBlock:^(NSString *key, id value, BOOL *stop) {
+            for ( NSString *oldKey in [headers allKeys] ) {
+                if ( [oldKey caseInsensitiveCompare:key] == NSOrderedSame ) {
+                    [headers removeObjectForKey:oldKey];
+                }
+            }
+            headers[key] = value;
+        }];
+        entry.responseDate = [NSDate date];
+        entry.lastAccess = entry.responseDate;
+        entry.headers = headers;
+        [self saveIndex];
+        return entry;
+    }
+}
+
+- (void)removeEntryForKey:(NSString*)key
+{
+    @synchronized(self) {
+        APICacheEntry *entry = _entryDic[key];
+        if ( entry ) {
+            [self removeEntry:entry];
+            [self saveIndex];
+        }
+    }
+}
+
+- (void)removeAllEntries
+{
+    @synchronized(self) {
+        for ( APICacheEntry *entry in [_entryDic allValues] ) {
+            [self removeEntry:entry];
+        }
+        [self saveIndex];
+    }
+}
+
+#pragma mark - Private
+
+- (void)removeEntry:(APICacheEntry*)entry
+{
+    [_entryDic removeObjectForKey:entry.key];
+    _currentSize -= entry.size;
+    [[NSFileManager defaultManager] removeItemAtPath:[self pathOfEntry:entry] error:nil];
+}
+
+//  超過容量時，最久沒用到的先刪
+- (void)evictIfNeeded
+{
+    while ( _currentSize > _capacity && _entryDic.count > 0 ) {
+        APICacheEntry *oldest = nil;
+        for ( APICacheEntry *entry in [_entryDic objectEnumerator] ) {
+            if ( oldest == nil || [entry.lastAccess compare:oldest.lastAccess] == NSOrderedAscending ) {
+                oldest = entry;
+            }
+        }
+        [self removeEntry:oldest];
+    }
+}
+
+- (void)saveIndex
+{
+    NSMutableArray *index = [[NSMutableArray alloc] initWithCapacity: _entryDic.count ];
+    for ( APICacheEntry *entry in [_entryDic objectEnumerator] ) {
+        [index addObject:[entry dictionary]];
+    }
+    [index writeToFile:_indexPath atomically:YES];
+}
+
+@end
@@ -0,0 +1,49 @@
+//
+//  APIStreamArrayUnserializer.h
+//
+//  Created by Calvin Huang on 2017/3/10.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "APIOperation.h"
+
+/**
+ *  一邊收資料一邊把 JSON 陣列裡的元素轉成 model，分批加到 bind 的 array
+ *
+ *  不用等整個 response 收完，第一批元素解出來就會出現在畫面上
+ *  每批在 main thread 用 addObjectsFromArray: 加入，binding 會做一次 insert
+ *
+ *  NSMutableArray *userList = [dataBinder createBindArray];
+ *  APIStreamArrayUnserializer *unserializer = [[APIStreamArrayUnserializer alloc] initWithKeyPath:@"results" modelClass:[UserModel class] targetArray:userList];
+ *  APIOperation *api = [[APIOperation alloc] initWithSerializer:[APIJSONSerializer new] unserializer:unserializer];
+ *
+ *  有狀態，每個 APIOperation 用自己的 instance
+ */
+@interface APIStreamArrayUnserializer : NSObject <APIDataSerializeDelegate>
+
+//  陣列在 JSON 裡的位置，nil 表示最外層就是陣列
+@property (nonatomic,readonly) NSString *keyPath;
+//  元素要轉成的 model class，nil 就直接加入 NSDictionary
+@property (nonatomic,readonly) Class modelClass;
+//  轉 model 時的 property 與 json key 對應，參考 KVCModel
+@property (nonatomic) NSDictionary *keyCorrespond;
+@property (nonatomic,weak,readonly) NSMutableArray *targetArray;
+
+//  第一批湊到幾個就加入，讓第一個畫面儘快出現，預設 10
+@property (nonatomic) NSUInteger firstBatchSize;
+//  之後每批的數量，預設 50
+@property (nonatomic) NSUInteger batchSize;
+//  資料來得慢時，距離上一批超過這個時間，就算不滿一批也先加入，預設 0.2 秒
+@property (nonatomic) NSTimeInterval flushInterval;
+
+//  每批加入 targetArray 之後呼叫，在 main thread
+@property (nonatomic,copy) void(^didAppendBatch)(NSArray *models);
+
+//  解析失敗或陣列沒有收完整的原因，失敗之後收到的資料都不處理
+//  APIOperation 會呼叫 fail block，也不會存入 cache，已經加入 targetArray 的 model 不會移除
+@property (nonatomic,readonly) NSError *error;
+
+- (instancetype)initWithKeyPath:(NSString*)keyPath modelClass:(Class)modelClass targetArray:(NSMutableArray*)targetArray;
+
+@end
@@ -0,0 +1,167 @@
+//
+//  APIStreamArrayUnserializer.m
+//
+//  Created by Calvin Huang on 2017/3/10.
+//  Copyright © 2017年 GevinChen. All rights reserved.
+//
+
+#import "APIStreamArrayUnserializer.h"
+#import "KHJSONArrayDecoder.h"
+#import "KVCModel.h"
+
+@implementation APIStreamArrayUnserializer
+{
+    KHJSONArrayDecoder *_decoder;
+    
+    //  全部解出的 model，最後交給 response block
+    NSMutableArray *_models;
+    
+    //  還沒加入 targetArray 的 model
+    NSMutableArray *_pending;
+    
+    NSUInteger _batchCount;
+    CFAbsoluteTime _lastFlushTime;
+}
+
+- (instancetype)initWithKeyPath:(NSString*)keyPath modelClass:(Class)modelClass targetArray:(NSMutableArray*)targetArray
+{
+    self = [super init];
+    if (self) {
+        _keyPath = [keyPath copy];
+        _modelClass = modelClass;
+        _targetArray = targetArray;
+        _firstBatchSize = 10;
+        _batchSize = 50;
+        _flushInterval = 0.2;
+        _models = [[NSMutableArray alloc] initWithCapacity: 50 ];
+        _pending = [[NSMutableArray alloc] initWithCapacity: 50 ];
+        _decoder = [[KHJSONArrayDecoder alloc] initWithKeyPath:keyPath];
+        
+        __weak typeof(self) weakSelf = self;
+        _decoder.elementBlock = ^(id element, NSUInteger index) {
+            [weakSelf receiveElement:element];
+        };
+    }
+    return self;
+}
+
+#pragma mark - APIDataSerializeDelegate
+
+- (void)unSerializeBegin:(APIOperation*)api
+{
+    //  同一個 operation 又收到一次 response (例如先回傳過期的 cache，重新驗證後內容有變)，先拿掉上次加入的
+    if ( _models.count > 0 ) {
+        NSArray *previous = [_models copy];
+        NSMutableArray *targetArray = _targetArray;
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [APIStreamArrayUnserializer removeModels:previous fromArray:targetArray];
+        });
+    }
+    [_decoder reset];
+    [_models removeAllObjects];
+    [_pending removeAllObjects];
+    _batchCount = 0;
+    _error = nil;
+    _lastFlushTime = CFAbsoluteTimeGetCurrent();
+}
+
+- (void)unSerialize:(APIOperation*)api didReceiveData:(NSData*)data
+{
+    if ( _error ) {
+        return;
+    }
+    NSError *error = nil;
+    if ( ![_decoder appendData:data error:&error] ) {
+        _error = error;
+        if ( api.debug ) {
+            printf("stream array unserialize error: %s\n", [error.localizedDescription UTF8String] );
+        }
+    }
+    
+    //  資料來得慢，不滿一批也先送出
+    if ( _pending.count > 0 && CFAbsoluteTimeGetCurrent() - _lastFlushTime >= _flushInterval ) {
+        [self flush];
+    }
+}
+
+- (id)unSerializeDidFinish:(APIOperation*)api
+{
+    //  沒收完整的陣列也是格式錯誤
+    if ( _error == nil && !_decoder.isArrayFinished ) {
+        _error = [NSError errorWithDomain:KHJSONArrayDecoderErrorDomain code:1 userInfo:@{ NSLocalizedDescriptionKey:@"array is not finished" }];
+    }
+    //  失敗的話，還沒加入的就不加了，APIOperation 會呼叫 fail block
+    if ( _error ) {
+        [_pending removeAllObjects];
+        return nil;
+    }
+    [self flush];
+    return [_models copy];
+}
+
+- (NSError*)unSerializeError:(APIOperation*)api
+{
+    return _error;
+}
+
+#pragma mark - Batch
+
++ (void)removeModels:(NSArray*)models fromArray:(NSMutableArray*)array
+{
+    //  全部都是上次加入的，一次清掉
+    if ( array.count == models.count && array.firstObject == models.firstObject && array.lastObject == models.lastObject ) {
+        [array removeAllObjects];
+        return;
+    }
+    //  比對 pointer，caller 自己加入的相等 (isEqual:) 的 model 不能刪
+    NSHashTable *modelSet = [[NSHashTable alloc] initWithOptions:NSPointerFunctionsStrongMemory|NSPointerFunctionsObjectPointerPersonality capacity:models.count];
+    for ( id model in models ) {
+        [modelSet addObject:model];
+    }
+    for ( NSInteger i=array.count-1; i>=0; i-- ) {
+        if ( [modelSet containsObject:array[i]] ) {
+            [array removeObjectAtIndex:i];
+        }
+    }
+}
+
+- (void)receiveElement:(id)element
+{
+    id model = element;
+    if ( _modelClass && [element isKindOfClass:[NSDictionary class]] ) {
+        model = [KVCModel objectWithDictionary:element objectClass:_modelClass keyCorrespond:_keyCorrespond];
+    }
+    if ( model == nil ) {
+        return;
+    }
+    [_models addObject:model];
+    [_pending addObject:model];
+    
+    NSUInteger limit = _batchCount == 0 ? _firstBatchSize : _batchSize;
+    if ( _pending.count >= MAX( limit, 1 ) ) {
+        [self flush];
+    }
+}
+
+- (void)flush
+{
+    if ( _pending.count == 0 ) {
+        return;
+    }
+    NSArray *batch = [_pending copy];
+    [_pending removeAllObjects];
+    _batchCount++;
+    _lastFlushTime = CFAbsoluteTimeGetCurrent();
+    
+    //  bind 的 array 變動會更新畫面，一定要在 main thread
+    NSMutableArray *targetArray = _targetArray;
+    void(^didAppendBatch)(NSArray*) = _didAppendBatch;
+    dispatch_async(dispatch_get_main_queue(), ^{
+        [targetArray addObjectsFromArray:batch];
+        if ( didAppendBatch ) {
+            didAppendBatch( batch );
+        }
+    });
+}
+
+@end
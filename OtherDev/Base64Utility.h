@@ -8,15 +8,37 @@
 
 #import <Foundation/Foundation.h>
 
+//  直接寫入呼叫端配置好的 buffer
+//  arm64 用 NEON、x86 用 SSSE3 一次處理 16 byte 以上，剩下的查表
+
+//  dst 至少 length * 2，不會補 '\0'
+void Base64UtilityHexEncode( const uint8_t *src, size_t length, char *dst, BOOL uppercase );
+//  大小寫都可以，長度是奇數或有不合法字元時回傳 -1，dst 至少 length / 2
+long Base64UtilityHexDecode( const char *src, size_t length, uint8_t *dst );
+
+size_t Base64UtilityBase64EncodedLength( size_t length );
+//  標準字元表，結尾補 =，回傳寫入的長度
+size_t Base64UtilityBase64Encode( const uint8_t *src, size_t length, char *dst );
+size_t Base64UtilityBase64DecodedMaxLength( size_t length );
+//  結尾的 = 可有可無，有其他不合法字元 (包括空白、換行) 時回傳 -1
+long Base64UtilityBase64Decode( const char *src, size_t length, uint8_t *dst );
+
+
 @interface Base64Utility : NSObject
 
 +(NSString*)urlEncoded:(NSString*)str;
 +(NSString*)urlDecoded :(NSString*)str;
 +(NSString *)base64Encode:(NSString *)plainString;
 +(NSString *)base64Decode:(NSString *)base64String;
++(NSString*)base64StringFromData:(NSData*)data;
+//  nil 或空字串回傳空的 data，長度不是 4 的倍數 (沒有 padding) 或有不合法字元時回傳 nil
+//  跟 initWithBase64EncodedString:options:0 一樣，C 的 Base64UtilityBase64Decode 比較寬鬆
++(NSData*)dataFromBase64String:(NSString*)string;
 +(NSString*)stringFromByte:(Byte)byteVal;
 +(NSString*)hexStringFromData:(NSData*)data;
++(NSString*)hexStringFromData:(NSData*)data uppercase:(BOOL)uppercase;
 +(NSData *)dataFromHexString:(NSString *)string;
 +(NSString*)md5:(NSString*)string;
++(NSString*)md5Data:(NSData*)data;
 
 @end
@@ -9,6 +9,346 @@
 #import "Base64Utility.h"
 #import <CommonCrypto/CommonDigest.h>
 
+//  arm64 用 NEON，x86 (模擬器) 有 SSSE3 時用 SSSE3，其他只用查表
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define BASE64_UTILITY_NEON 1
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#define BASE64_UTILITY_SSSE3 1
+#endif
+
+static const char kHexLower[] = "0123456789abcdef";
+static const char kHexUpper[] = "0123456789ABCDEF";
+static const char kBase64Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+//  byte → 兩個字元，查表一次寫兩個 byte
+static uint16_t kHexLowerTable[256];
+static uint16_t kHexUpperTable[256];
+//  字元 → 數值，不合法的是 0xff
+static uint8_t kHexDecodeTable[256];
+static uint8_t kBase64DecodeTable[256];
+
+static void Base64UtilityInitTables( void )
+{
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        for ( int i=0; i<256; i++ ) {
+            char lower[2] = { kHexLower[i >> 4], kHexLower[i & 0xf] };
+            char upper[2] = { kHexUpper[i >> 4], kHexUpper[i & 0xf] };
+            memcpy( &kHexLowerTable[i], lower, 2 );
+            memcpy( &kHexUpperTable[i], upper, 2 );
+        }
+        memset( kHexDecodeTable, 0xff, sizeof(kHexDecodeTable) );
+        for ( int i=0; i<16; i++ ) {
+            kHexDecodeTable[(uint8_t)kHexLower[i]] = i;
+            kHexDecodeTable[(uint8_t)kHexUpper[i]] = i;
+        }
+        memset( kBase64DecodeTable, 0xff, sizeof(kBase64DecodeTable) );
+        for ( int i=0; i<64; i++ ) {
+            kBase64DecodeTable[(uint8_t)kBase64Alphabet[i]] = i;
+        }
+    });
+}
+
+#pragma mark - Hex
+
+void Base64UtilityHexEncode( const uint8_t *src, size_t length, char *dst, BOOL uppercase )
+{
+    Base64UtilityInitTables();
+    size_t i = 0;
+#if BASE64_UTILITY_NEON
+    const uint8x16_t mask = vdupq_n_u8( 0x0f );
+    const uint8x16_t nine = vdupq_n_u8( 9 );
+    const uint8x16_t zero = vdupq_n_u8( '0' );
+    const uint8x16_t alpha = vdupq_n_u8( uppercase ? 'A' - '0' - 10 : 'a' - '0' - 10 );
+    for ( ; i + 16 <= length; i += 16 ) {
+        uint8x16_t in = vld1q_u8( src + i );
+        uint8x16_t hi = vshrq_n_u8( in, 4 );
+        uint8x16_t lo = vandq_u8( in, mask );
+        uint8x16x2_t out;
+        out.val[0] = vaddq_u8( vaddq_u8( hi, zero ), vandq_u8( vcgtq_u8( hi, nine ), alpha ) );
+        out.val[1] = vaddq_u8( vaddq_u8( lo, zero ), vandq_u8( vcgtq_u8( lo, nine ), alpha ) );
+        //  交錯寫出 hi lo hi lo ...
+        vst2q_u8( (uint8_t*)dst + i * 2, out );
+    }
+#elif BASE64_UTILITY_SSSE3
+    const __m128i mask = _mm_set1_epi8( 0x0f );
+    const __m128i digits = _mm_loadu_si128( (const __m128i*)( uppercase ? kHexUpper : kHexLower ) );
+    for ( ; i + 16 <= length; i += 16 ) {
+        __m128i in = _mm_loadu_si128( (const __m128i*)( src + i ) );
+        __m128i hi = _mm_and_si128( _mm_srli_epi16( in, 4 ), mask );
+        __m128i lo = _mm_and_si128( in, mask );
+        //  16 個字元剛好是一個 pshufb 的表
+        hi = _mm_shuffle_epi8( digits, hi );
+        lo = _mm_shuffle_epi8( digits, lo );
+        _mm_storeu_si128( (__m128i*)( dst + i * 2 ), _mm_unpacklo_epi8( hi, lo ) );
+        _mm_storeu_si128( (__m128i*)( dst + i * 2 + 16 ), _mm_unpackhi_epi8( hi, lo ) );
+    }
+#endif
+    const uint16_t *table = uppercase ? kHexUpperTable : kHexLowerTable;
+    for ( ; i < length; i++ ) {
+        memcpy( dst + i * 2, &table[src[i]], 2 );
+    }
+}
+
+long Base64UtilityHexDecode( const char *src, size_t length, uint8_t *dst )
+{
+    Base64UtilityInitTables();
+    if ( length % 2 != 0 ) {
+        return -1;
+    }
+    size_t count = length / 2;
+    size_t i = 0;
+#if BASE64_UTILITY_NEON
+    const uint8x16_t ten = vdupq_n_u8( 10 );
+    const uint8x16_t six = vdupq_n_u8( 6 );
+    for ( ; i + 16 <= count; i += 16 ) {
+        //  讀 32 個字元，分成奇數與偶數位置
+        uint8x16x2_t in = vld2q_u8( (const uint8_t*)src + i * 2 );
+        uint8x16_t value[2];
+        uint8x16_t valid = vdupq_n_u8( 0xff );
+        for ( int k=0; k<2; k++ ) {
+            uint8x16_t digit = vsubq_u8( in.val[k], vdupq_n_u8( '0' ) );
+            uint8x16_t letter = vsubq_u8( vorrq_u8( in.val[k], vdupq_n_u8( 0x20 ) ), vdupq_n_u8( 'a' ) );
+            uint8x16_t isDigit = vcltq_u8( digit, ten );
+            uint8x16_t isLetter = vcltq_u8( letter, six );
+            value[k] = vorrq_u8( vandq_u8( digit, isDigit ), vandq_u8( vaddq_u8( letter, ten ), isLetter ) );
+            valid = vandq_u8( valid, vorrq_u8( isDigit, isLetter ) );
+        }
+        //  有不合法的字元，交給下面逐字處理
+        if ( vminvq_u8( valid ) == 0 ) {
+            break;
+        }
+        vst1q_u8( dst + i, vorrq_u8( vshlq_n_u8( value[0], 4 ), value[1] ) );
+    }
+#elif BASE64_UTILITY_SSSE3
+    const __m128i nine = _mm_set1_epi8( 9 );
+    const __m128i five = _mm_set1_epi8( 5 );
+    const __m128i lowByte = _mm_set1_epi16( 0x00ff );
+    for ( ; i + 16 <= count; i += 16 ) {
+        __m128i packed[2];
+        int invalid = 0;
+        for ( int k=0; k<2; k++ ) {
+            __m128i in = _mm_loadu_si128( (const __m128i*)( src + i * 2 + k * 16 ) );
+            __m128i digit = _mm_sub_epi8( in, _mm_set1_epi8( '0' ) );
+            __m128i letter = _mm_sub_epi8( _mm_or_si128( in, _mm_set1_epi8( 0x20 ) ), _mm_set1_epi8( 'a' ) );
+            //  unsigned 的 x <= n 等於 min(x, n) == x
+            __m128i isDigit = _mm_cmpeq_epi8( _mm_min_epu8( digit, nine ), digit );
+            __m128i isLetter = _mm_cmpeq_epi8( _mm_min_epu8( letter, five ), letter );
+            __m128i value = _mm_or_si128( _mm_and_si128( digit, isDigit ), _mm_and_si128( _mm_add_epi8( letter, _mm_set1_epi8( 10 ) ), isLetter ) );
+            invalid |= _mm_movemask_epi8( _mm_or_si128( isDigit, isLetter ) ) ^ 0xffff;
+            //  每 16 bit 是 (hi, lo)，合成一個 byte 放在低 8 bit
+            packed[k] = _mm_or_si128( _mm_slli_epi16( _mm_and_si128( value, lowByte ), 4 ), _mm_srli_epi16( value, 8 ) );
+        }
+        if ( invalid ) {
+            break;
+        }
+        _mm_storeu_si128( (__m128i*)( dst + i ), _mm_packus_epi16( packed[0], packed[1] ) );
+    }
+#endif
+    for ( ; i < count; i++ ) {
+        uint8_t hi = kHexDecodeTable[(uint8_t)src[i * 2]];
+        uint8_t lo = kHexDecodeTable[(uint8_t)src[i * 2 + 1]];
+        if ( ( hi | lo ) == 0xff ) {
+            return -1;
+        }
+        dst[i] = (uint8_t)( ( hi << 4 ) | lo );
+    }
+    return (long)count;
+}
+
+#pragma mark - Base64
+
+size_t Base64UtilityBase64EncodedLength( size_t length )
+{
+    return ( length + 2 ) / 3 * 4;
+}
+
+size_t Base64UtilityBase64Encode( const uint8_t *src, size_t length, char *dst )
+{
+    Base64UtilityInitTables();
+    size_t i = 0;
+    char *out = dst;
+#if BASE64_UTILITY_NEON
+    uint8x16x4_t alphabet;
+    for ( int k=0; k<4; k++ ) {
+        alphabet.val[k] = vld1q_u8( (const uint8_t*)kBase64Alphabet + k * 16 );
+    }
+    const uint8x16_t mask = vdupq_n_u8( 0x3f );
+    for ( ; i + 48 <= length; i += 48 ) {
+        //  48 byte 拆成每 3 byte 一組的三個 vector
+        uint8x16x3_t in = vld3q_u8( src + i );
+        uint8x16x4_t index;
+        index.val[0] = vshrq_n_u8( in.val[0], 2 );
+        index.val[1] = vandq_u8( vorrq_u8( vshlq_n_u8( in.val[0], 4 ), vshrq_n_u8( in.val[1], 4 ) ), mask );
+        index.val[2] = vandq_u8( vorrq_u8( vshlq_n_u8( in.val[1], 2 ), vshrq_n_u8( in.val[2], 6 ) ), mask );
+        index.val[3] = vandq_u8( in.val[2], mask );
+        uint8x16x4_t result;
+        for ( int k=0; k<4; k++ ) {
+            result.val[k] = vqtbl4q_u8( alphabet, index.val[k] );
+        }
+        vst4q_u8( (uint8_t*)out, result );
+        out += 64;
+    }
+#elif BASE64_UTILITY_SSSE3
+    //  每次處理 12 byte，但會讀 16 byte，所以後面要留 4 byte
+    const __m128i shuffle = _mm_set_epi8( 10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1 );
+    const __m128i shiftTable = _mm_setr_epi8( 'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                              '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+                                              '/' - 63, 'A', 0, 0 );
+    for ( ; i + 16 <= length; i += 12 ) {
+        __m128i in = _mm_shuffle_epi8( _mm_loadu_si128( (const __m128i*)( src + i ) ), shuffle );
+        //  把 3 byte 拆成 4 個 6 bit
+        __m128i t0 = _mm_mulhi_epu16( _mm_and_si128( in, _mm_set1_epi32( 0x0fc0fc00 ) ), _mm_set1_epi32( 0x04000040 ) );
+        __m128i t1 = _mm_mullo_epi16( _mm_and_si128( in, _mm_set1_epi32( 0x003f03f0 ) ), _mm_set1_epi32( 0x01000010 ) );
+        __m128i index = _mm_or_si128( t0, t1 );
+        //  0..25 → 13，26..51 → 0，52..61 → 1..10，62 → 11，63 → 12，再查要加多少
+        __m128i range = _mm_subs_epu8( index, _mm_set1_epi8( 51 ) );
+        range = _mm_or_si128( range, _mm_and_si128( _mm_cmpgt_epi8( _mm_set1_epi8( 26 ), index ), _mm_set1_epi8( 13 ) ) );
+        __m128i result = _mm_add_epi8( _mm_shuffle_epi8( shiftTable, range ), index );
+        _mm_storeu_si128( (__m128i*)out, result );
+        out += 16;
+    }
+#endif
+    for ( ; i + 3 <= length; i += 3 ) {
+        uint32_t v = ( src[i] << 16 ) | ( src[i+1] << 8 ) | src[i+2];
+        out[0] = kBase64Alphabet[( v >> 18 ) & 0x3f];
+        out[1] = kBase64Alphabet[( v >> 12 ) & 0x3f];
+        out[2] = kBase64Alphabet[( v >> 6 ) & 0x3f];
+        out[3] = kBase64Alphabet[v & 0x3f];
+        out += 4;
+    }
+    if ( i < length ) {
+        uint32_t v = src[i] << 16;
+        if ( i + 1 < length ) {
+            v |= src[i+1] << 8;
+        }
+        out[0] = kBase64Alphabet[( v >> 18 ) & 0x3f];
+        out[1] = kBase64Alphabet[( v >> 12 ) & 0x3f];
+        out[2] = i + 1 < length ? kBase64Alphabet[( v >> 6 ) & 0x3f] : '=';
+        out[3] = '=';
+        out += 4;
+    }
+    return out - dst;
+}
+
+size_t Base64UtilityBase64DecodedMaxLength( size_t length )
+{
+    return ( length + 3 ) / 4 * 3;
+}
+
+long Base64UtilityBase64Decode( const char *src, size_t length, uint8_t *dst )
+{
+    Base64UtilityInitTables();
+    //  結尾的 = 不算，沒有 padding 也可以
+    size_t end = length;
+    if ( end > 0 && src[end-1] == '=' ) end--;
+    if ( end > 0 && src[end-1] == '=' ) end--;
+    if ( length % 4 == 0 ? length - end > 2 : ( end != length || length % 4 == 1 ) ) {
+        return -1;
+    }
+    size_t i = 0;
+    uint8_t *out = dst;
+#if BASE64_UTILITY_NEON
+    //  字元 0..127 對應的值，不合法的是 0xff
+    uint8x16x4_t table[2];
+    for ( int k=0; k<8; k++ ) {
+        uint8_t part[16];
+        for ( int j=0; j<16; j++ ) {
+            part[j] = kBase64DecodeTable[k * 16 + j];
+        }
+        table[k / 4].val[k % 4] = vld1q_u8( part );
+    }
+    const uint8x16_t offset = vdupq_n_u8( 64 );
+    for ( ; i + 64 <= end; i += 64 ) {
+        uint8x16x4_t in = vld4q_u8( (const uint8_t*)src + i );
+        uint8x16_t invalid = vdupq_n_u8( 0 );
+        for ( int k=0; k<4; k++ ) {
+            uint8x16_t c = in.val[k];
+            //  超出表的範圍會得到 0，大於 127 另外標記
+            uint8x16_t value = vorrq_u8( vqtbl4q_u8( table[0], c ), vqtbl4q_u8( table[1], vsubq_u8( c, offset ) ) );
+            invalid = vorrq_u8( invalid, vorrq_u8( value, vcgtq_u8( c, vdupq_n_u8( 127 ) ) ) );
+            in.val[k] = value;
+        }
+        if ( vmaxvq_u8( invalid ) > 63 ) {
+            break;
+        }
+        uint8x16x3_t result;
+        result.val[0] = vorrq_u8( vshlq_n_u8( in.val[0], 2 ), vshrq_n_u8( in.val[1], 4 ) );
+        result.val[1] = vorrq_u8( vshlq_n_u8( in.val[1], 4 ), vshrq_n_u8( in.val[2], 2 ) );
+        result.val[2] = vorrq_u8( vshlq_n_u8( in.val[2], 6 ), in.val[3] );
+        vst3q_u8( out, result );
+        out += 48;
+    }
+#elif BASE64_UTILITY_SSSE3
+    const __m128i lutLo = _mm_setr_epi8( 0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                         0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a );
+    const __m128i lutHi = _mm_setr_epi8( 0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                         0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10 );
+    const __m128i lutRoll = _mm_setr_epi8( 0, 16, 19, 4, -65, -65, -71, -71,
+                                           0, 0, 0, 0, 0, 0, 0, 0 );
+    const __m128i mask2F = _mm_set1_epi8( 0x2f );
+    const __m128i pack = _mm_setr_epi8( 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1 );
+    for ( ; i + 16 <= end; i += 16 ) {
+        __m128i in = _mm_loadu_si128( (const __m128i*)( src + i ) );
+        __m128i hiNibbles = _mm_and_si128( _mm_srli_epi32( in, 4 ), mask2F );
+        __m128i lo = _mm_shuffle_epi8( lutLo, _mm_and_si128( in, mask2F ) );
+        __m128i hi = _mm_shuffle_epi8( lutHi, hiNibbles );
+        //  高低 4 bit 的分類沒有交集就是合法字元
+        if ( _mm_movemask_epi8( _mm_cmpgt_epi8( _mm_and_si128( lo, hi ), _mm_setzero_si128() ) ) != 0 ) {
+            break;
+        }
+        __m128i roll = _mm_shuffle_epi8( lutRoll, _mm_add_epi8( _mm_cmpeq_epi8( in, mask2F ), hiNibbles ) );
+        __m128i value = _mm_add_epi8( in, roll );
+        //  4 個 6 bit 合成 3 byte
+        value = _mm_maddubs_epi16( value, _mm_set1_epi32( 0x01400140 ) );
+        value = _mm_madd_epi16( value, _mm_set1_epi32( 0x00011000 ) );
+        value = _mm_shuffle_epi8( value, pack );
+        uint8_t buffer[16];
+        _mm_storeu_si128( (__m128i*)buffer, value );
+        memcpy( out, buffer, 12 );
+        out += 12;
+    }
+#endif
+    uint32_t v = 0;
+    int bits = 0;
+    for ( ; i < end; i++ ) {
+        uint8_t d = kBase64DecodeTable[(uint8_t)src[i]];
+        if ( d == 0xff ) {
+            return -1;
+        }
+        v = ( v << 6 ) | d;
+        bits += 6;
+        if ( bits >= 8 ) {
+            bits -= 8;
+            *out++ = (uint8_t)( v >> bits );
+        }
+    }
+    return out - dst;
+}
+
+//  ASCII 字串直接取得內部的 buffer，取不到就複製一份，有非 ASCII 字元時回傳 NULL
+//  string 不能是 nil，CFStringGetCStringPtr 不接受 NULL
+static const char* Base64UtilityASCIIBytes( NSString *string, NSData **holder )
+{
+    const char *bytes = CFStringGetCStringPtr( (__bridge CFStringRef)string, kCFStringEncodingASCII );
+    if ( bytes ) {
+        return bytes;
+    }
+    *holder = [string dataUsingEncoding:NSASCIIStringEncoding];
+    return (*holder).bytes;
+}
+
+static NSString* Base64UtilityStringWithBuffer( char *buffer, size_t length )
+{
+    if ( length == 0 ) {
+        free( buffer );
+        return @"";
+    }
+    return [[NSString alloc] initWithBytesNoCopy:buffer length:length encoding:NSASCIIStringEncoding freeWhenDone:YES];
+}
+
 @implementation Base64Utility
 
 +(NSString*)urlEncoded:(NSString*)str {
@@ -34,14 +374,14 @@
 +(NSString *)base64Encode:(NSString *)plainString
 {
     NSData *plainData = [plainString dataUsingEncoding:NSUTF8StringEncoding];
-    NSString *base64String = [plainData base64EncodedStringWithOptions:0];
+    NSString *base64String = [self base64StringFromData:plainData];
     return base64String;
 }
 
 + (NSString *)base64Decode:(NSString *)base64String
 {
     
-    NSData *plainTextData = [[NSData alloc] initWithBase64EncodedString:base64String options:0];
+    NSData *plainTextData = [self dataFromBase64String:base64String];
     NSString *plainText = [[NSString alloc] initWithData:plainTextData encoding:NSUTF8StringEncoding];
 #if !__has_feature(objc_arc)
     [plainText autorelease];
@@ -49,33 +389,78 @@
     return plainText;
 }
 
++ (NSString*)base64StringFromData:(NSData*)data
+{
+    size_t length = Base64UtilityBase64EncodedLength( data.length );
+    char *buffer = malloc( MAX( length, 1 ) );
+    Base64UtilityBase64Encode( data.bytes, data.length, buffer );
+    return Base64UtilityStringWithBuffer( buffer, length );
+}
+
++ (NSData*)dataFromBase64String:(NSString*)string
+{
+    //  nil 與空字串跟原本一樣回傳空的 data
+    if ( string.length == 0 ) {
+        return [NSData data];
+    }
+    //  沒有 padding 的，原本的 initWithBase64EncodedString: 不接受，交給系統維持一樣的結果
+    if ( string.length % 4 != 0 ) {
+        return [[NSData alloc] initWithBase64EncodedString:string options:0];
+    }
+    NSData *holder = nil;
+    const char *bytes = Base64UtilityASCIIBytes( string, &holder );
+    if ( bytes ) {
+        NSUInteger length = string.length;
+        NSMutableData *data = [[NSMutableData alloc] initWithLength: Base64UtilityBase64DecodedMaxLength( length ) ];
+        long decoded = Base64UtilityBase64Decode( bytes, length, data.mutableBytes );
+        if ( decoded >= 0 ) {
+            [data setLength: decoded ];
+            return data;
+        }
+    }
+    //  不合法的交給系統判斷，跟原本的行為一樣
+    return [[NSData alloc] initWithBase64EncodedString:string options:0];
+}
+
 +(NSString*)stringFromByte:(Byte)byteVal
 {
-    NSMutableString *str=[NSMutableString string];
-    
-    //取高四位
-    Byte byte1 = byteVal>>4;
-    //取低四位
-    Byte byte2=byteVal & 0xf;
-    //拼接16进制字符串
-    [str appendFormat:@"%x",byte1];
-    [str appendFormat:@"%x",byte2];
-    return str;
+    char hex[2];
+    Base64UtilityHexEncode( &byteVal, 1, hex, NO );
+    return [[NSString alloc] initWithBytes:hex length:2 encoding:NSASCIIStringEncoding];
 }
 
 +(NSString*)hexStringFromData:(NSData*)data
 {
-    NSMutableString *str=[NSMutableString string];
-    Byte *byte= (Byte*)[data bytes];
-    for(int i=0;i<[data length];i++){
-        //byte+i为指针
-        [str appendString:[self stringFromByte:*(byte+i)]];
-    }
-    return str;
+    return [self hexStringFromData:data uppercase:NO];
 }
 
++(NSString*)hexStringFromData:(NSData*)data uppercase:(BOOL)uppercase
+{
+    size_t length = data.length * 2;
+    char *buffer = malloc( MAX( length, 1 ) );
+    Base64UtilityHexEncode( data.bytes, data.length, buffer, uppercase );
+    return Base64UtilityStringWithBuffer( buffer, length );
+}
 
 +(NSData *)dataFromHexString:(NSString *)string {
+    if ( string.length == 0 ) {
+        return [NSMutableData data];
+    }
+    //  全部是 hex 字元的直接解
+    NSData *holder = nil;
+    const char *bytes = Base64UtilityASCIIBytes( string, &holder );
+    NSUInteger length = string.length;
+    if ( bytes && length % 2 == 0 ) {
+        NSMutableData *data = [[NSMutableData alloc] initWithLength: length / 2 ];
+        if ( Base64UtilityHexDecode( bytes, length, data.mutableBytes ) >= 0 ) {
+            return data;
+        }
+    }
+    //  有分隔字元的，照原本的方式略過
+    return [self scanDataFromHexString:string];
+}
+
++(NSData *)scanDataFromHexString:(NSString *)string {
     string = [string lowercaseString];
     NSMutableData *data= [NSMutableData new];
 #if !__has_feature(objc_arc)
@@ -103,18 +488,17 @@
     const char *cStr = [string UTF8String];
     unsigned char result[CC_MD5_DIGEST_LENGTH];
     CC_MD5( cStr, (CC_LONG)strlen(cStr), result );
-    return [NSString
-            stringWithFormat: @"%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X",
-            result[0], result[1],
-            result[2], result[3],
-            result[4], result[5],
-            result[6], result[7],
-            result[8], result[9],
-            result[10], result[11],
-            result[12], result[13],
-            result[14], result[15]
-            ];
-    
+    char hex[CC_MD5_DIGEST_LENGTH * 2];
+    Base64UtilityHexEncode( result, CC_MD5_DIGEST_LENGTH, hex, YES );
+    return [[NSString alloc] initWithBytes:hex length:sizeof(hex) encoding:NSASCIIStringEncoding];
+}
+
++(NSString*)md5Data:(NSData*)data{
+    unsigned char result[CC_MD5_DIGEST_LENGTH];
+    CC_MD5( data.bytes, (CC_LONG)data.length, result );
+    char hex[CC_MD5_DIGEST_LENGTH * 2];
+    Base64UtilityHexEncode( result, CC_MD5_DIGEST_LENGTH, hex, YES );
+    return [[NSString alloc] initWithBytes:hex length:sizeof(hex) encoding:NSASCIIStringEncoding];
 }
 
 @end